@@ -1,25 +1,70 @@
 import argparse
+import base64
 import json
 import os
+import struct
 
 # import uuid
 from kafka import KafkaConsumer
 
+from payload_proto import decode_message
+
 parser = argparse.ArgumentParser()
 parser.add_argument(
     "--topic",
     type=str,
     default="test",
 )
+parser.add_argument(
+    "--format",
+    choices=["json", "protobuf"],
+    default="json",
+    help="format in the [payload] group of the msgconv config",
+)
 args = parser.parse_args()
 
+# featureVectorEncoding -> struct format of one value; see feature-vector-encoding
+# in the [payload] group of the msgconv config
+FEATURE_VECTOR_FORMATS = {"float32": ("f", 4), "fp16": ("e", 2), "int8": ("b", 1)}
+
+
+def decode_feature_vector(obj):
+    """Replaces a base64 featureVector of the object by its list of floats."""
+    encoding = obj.pop("featureVectorEncoding", None)
+    if encoding is None:
+        return
+    code, size = FEATURE_VECTOR_FORMATS[encoding]
+    raw = base64.b64decode(obj["featureVector"])
+    values = struct.unpack("<%d%s" % (len(raw) // size, code), raw)
+    if encoding == "int8":
+        scale = obj.pop("featureVectorScale")
+        values = [v * scale for v in values]
+    obj["featureVector"] = list(values)
+
+
+def decode_event(event_data):
+    # message-per=object: "object"; frame: "objects"; batch: "frames", each
+    # with its "objects"
+    for frame in [event_data] + event_data.get("frames", []):
+        for obj in frame.get("objects", []):
+            decode_feature_vector(obj)
+    if "object" in event_data:
+        decode_feature_vector(event_data["object"])
+    return event_data
+
+
+def deserialize(value):
+    if args.format == "protobuf":
+        return decode_message(value)
+    return decode_event(json.loads(value.decode("utf-8").replace("'", '"')))
+
 
 consumer = KafkaConsumer(
     args.topic,
     bootstrap_servers="10.1.1.41:9092",
     auto_offset_reset="latest",
     enable_auto_commit=True,
-    value_deserializer=lambda x: json.loads(x.decode("utf-8").replace("'", '"')),
+    value_deserializer=deserialize,
 )
 
 # do a dummy poll to retrieve some message
@@ -0,0 +1,174 @@
+"""Decoder of the binary custom payloads (format=protobuf in the msgconv config).
+
+The schema is sources/libs/nvmsgconv/deepstream_schema/dsmeta_payload.proto.
+This reads the wire format directly, without the protobuf package or generated
+code, into dicts named after the schema fields. Unknown fields are skipped, so
+newer producers stay readable.
+"""
+
+import struct
+
+SUPPORTED_VERSION = 1
+
+_VARINT, _FIXED64, _LENGTH_DELIMITED, _FIXED32 = 0, 1, 2, 5
+
+EMBEDDING_ENCODINGS = {0: ("float32", "f", 4), 1: ("fp16", "e", 2), 2: ("int8", "b", 1)}
+
+
+def _varint(buf, pos):
+    result = shift = 0
+    while True:
+        byte = buf[pos]
+        pos += 1
+        result |= (byte & 0x7F) << shift
+        if byte < 0x80:
+            return result, pos
+        shift += 7
+
+
+def _fields(buf):
+    """Yields (field number, value) of a message; length-delimited values are
+    memoryviews, fixed32 values raw 4 byte views."""
+    pos, end = 0, len(buf)
+    while pos < end:
+        key, pos = _varint(buf, pos)
+        wire_type = key & 7
+        if wire_type == _VARINT:
+            value, pos = _varint(buf, pos)
+        elif wire_type == _LENGTH_DELIMITED:
+            size, pos = _varint(buf, pos)
+            value = buf[pos : pos + size]
+            pos += size
+        elif wire_type == _FIXED32:
+            value = buf[pos : pos + 4]
+            pos += 4
+        elif wire_type == _FIXED64:
+            value = buf[pos : pos + 8]
+            pos += 8
+        else:
+            raise ValueError("unsupported wire type %d" % wire_type)
+        yield key >> 3, value
+
+
+def _float(raw):
+    return struct.unpack("<f", raw)[0]
+
+
+def _signed64(value):
+    return value - (1 << 64) if value >= 1 << 63 else value
+
+
+def _text(raw):
+    return bytes(raw).decode("utf-8")
+
+
+def _bbox(buf):
+    names = {1: "left", 2: "top", 3: "right", 4: "bottom"}
+    bbox = dict.fromkeys(names.values(), 0.0)
+    for field, value in _fields(buf):
+        if field in names:
+            bbox[names[field]] = _float(value)
+    return bbox
+
+
+def _identity(buf):
+    identity = {"index": 0, "label": "", "confidence": 0.0}
+    for field, value in _fields(buf):
+        if field == 1:
+            identity["index"] = value
+        elif field == 2:
+            identity["label"] = _text(value)
+        elif field == 3:
+            identity["confidence"] = _float(value)
+    return identity
+
+
+def _embedding(buf):
+    encoding, data, scale = 0, b"", 1.0
+    for field, value in _fields(buf):
+        if field == 1:
+            encoding = value
+        elif field == 2:
+            data = bytes(value)
+        elif field == 3:
+            scale = _float(value)
+    name, code, size = EMBEDDING_ENCODINGS[encoding]
+    values = struct.unpack("<%d%s" % (len(data) // size, code), data)
+    if name == "int8":
+        values = [v * scale for v in values]
+    return list(values)
+
+
+def _object(buf):
+    obj = {
+        "id": None,
+        "label": "",
+        "confidence": 0.0,
+        "landmarks": [],
+        "identities": [],
+        "custom_json": [],
+    }
+    for field, value in _fields(buf):
+        if field == 1:
+            obj["id"] = value
+        elif field == 2:
+            obj["label"] = _text(value)
+        elif field == 3:
+            obj["confidence"] = _float(value)
+        elif field == 4:
+            obj["bbox"] = _bbox(value)
+        elif field == 5:
+            obj["landmarks"].extend(struct.unpack("<%df" % (len(value) // 4), value))
+        elif field == 6:
+            obj["identities"].append(_identity(value))
+        elif field == 7:
+            obj["featureVector"] = _embedding(value)
+        elif field == 8:
+            obj["file_path"] = _text(value)
+        elif field == 9:
+            obj["custom_json"].append(_text(value))
+    return obj
+
+
+def _frame(buf):
+    frame = {
+        "source_id": 0,
+        "frame_num": 0,
+        "buf_pts": 0,
+        "ntp_timestamp": 0,
+        "custom_json": [],
+        "objects": [],
+    }
+    for field, value in _fields(buf):
+        if field == 1:
+            frame["source_id"] = value
+        elif field == 2:
+            frame["frame_num"] = _signed64(value)
+        elif field == 3:
+            frame["buf_pts"] = value
+        elif field == 4:
+            frame["ntp_timestamp"] = value
+        elif field == 5:
+            frame["custom_json"].append(_text(value))
+        elif field == 6:
+            frame["objects"].append(_object(value))
+    return frame
+
+
+def decode_message(data):
+    """Decodes one payload (bytes) into a dict."""
+    buf = memoryview(data)
+    message = {"version": 0, "messageid": "", "timestamp_us": 0, "frames": []}
+    for field, value in _fields(buf):
+        if field == 1:
+            message["version"] = value
+        elif field == 2:
+            message["messageid"] = _text(value)
+        elif field == 3:
+            message["timestamp_us"] = _signed64(value)
+        elif field == 4:
+            message["frames"].append(_frame(value))
+    version = message["version"]
+    if version > SUPPORTED_VERSION:
+        raise ValueError("unsupported payload version %d" % version)
+    return message
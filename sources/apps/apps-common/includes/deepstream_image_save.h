@@ -42,6 +42,13 @@ typedef struct {
     /* Start Custom */
     /////////////////
     guint quality;
+    /** Frames copied for saving and not yet encoded / encoded MiB not yet written */
+    guint queue_depth;
+    guint max_pending_mb;
+    /** When a queue is full, give up the oldest entry instead of the new one */
+    gboolean drop_oldest;
+    guint num_workers;
+    gboolean direct_io;
     ////////////////
     /* End Custom */
     ////////////////
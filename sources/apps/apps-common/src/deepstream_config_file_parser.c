@@ -234,6 +234,11 @@ GST_DEBUG_CATEGORY(APP_CFG_PARSER_CAT);
 /* Start Custom */
 /////////////////
 #define CONFIG_GROUP_IMG_SAVE_QUALITY "quality"
+#define CONFIG_GROUP_IMG_SAVE_QUEUE_DEPTH "queue-depth"
+#define CONFIG_GROUP_IMG_SAVE_MAX_PENDING_MB "max-pending-mb"
+#define CONFIG_GROUP_IMG_SAVE_QUEUE_POLICY "queue-policy"
+#define CONFIG_GROUP_IMG_SAVE_NUM_WORKERS "num-workers"
+#define CONFIG_GROUP_IMG_SAVE_DIRECT_IO "direct-io"
 ////////////////
 /* End Custom */
 ////////////////
@@ -1989,6 +1994,11 @@ gboolean parse_image_save(NvDsImageSave *config,
     /* Start Custom */
     /////////////////
     config->quality = 80;
+    config->queue_depth = 4;
+    config->max_pending_mb = 64;
+    config->drop_oldest = FALSE;
+    config->num_workers = 2;
+    config->direct_io = FALSE;
     ////////////////
     /* End Custom */
     ////////////////
@@ -2046,6 +2056,37 @@ gboolean parse_image_save(NvDsImageSave *config,
             config->quality =
                 g_key_file_get_integer(key_file, group, CONFIG_GROUP_IMG_SAVE_QUALITY, &error);
             CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_IMG_SAVE_QUEUE_DEPTH)) {
+            config->queue_depth =
+                g_key_file_get_integer(key_file, group, CONFIG_GROUP_IMG_SAVE_QUEUE_DEPTH, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_IMG_SAVE_MAX_PENDING_MB)) {
+            config->max_pending_mb = g_key_file_get_integer(
+                key_file, group, CONFIG_GROUP_IMG_SAVE_MAX_PENDING_MB, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_IMG_SAVE_QUEUE_POLICY)) {
+            gchar *policy = g_key_file_get_string(key_file, group,
+                                                  CONFIG_GROUP_IMG_SAVE_QUEUE_POLICY, &error);
+            CHECK_ERROR(error);
+            if (!g_strcmp0(policy, "skip")) {
+                config->drop_oldest = FALSE;
+            } else if (!g_strcmp0(policy, "drop-oldest")) {
+                config->drop_oldest = TRUE;
+            } else {
+                NVGSTDS_ERR_MSG_V("Invalid queue-policy '%s', expected 'skip' or 'drop-oldest'",
+                                  policy);
+                g_free(policy);
+                goto done;
+            }
+            g_free(policy);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_IMG_SAVE_NUM_WORKERS)) {
+            config->num_workers =
+                g_key_file_get_integer(key_file, group, CONFIG_GROUP_IMG_SAVE_NUM_WORKERS, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_IMG_SAVE_DIRECT_IO)) {
+            config->direct_io =
+                g_key_file_get_boolean(key_file, group, CONFIG_GROUP_IMG_SAVE_DIRECT_IO, &error);
+            CHECK_ERROR(error);
         }
         ////////////////
         /* End Custom */
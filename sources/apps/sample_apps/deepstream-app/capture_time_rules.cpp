@@ -22,11 +22,13 @@
 
 #include "capture_time_rules.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <sstream>
 
-constexpr unsigned seconds_in_day = 86400;
+constexpr unsigned minutes_in_day = 24 * 60;
+constexpr unsigned all_days = 0x7f;
 
 static std::vector<std::string> split_string(const std::string &str, char split_char)
 {
@@ -73,6 +75,37 @@ CaptureTimeRules::ParseResult CaptureTimeRules::stoi_err_handling(unsigned &dst,
     return PARSE_RESULT_OK;
 }
 
+bool CaptureTimeRules::parse_days(unsigned &days, const std::string &src)
+{
+    static const char *names[] = {"mon", "tue", "wed", "thu", "fri", "sat", "sun"};
+    auto day_index = [](std::string name) {
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        for (unsigned i = 0; i < 7; ++i)
+            if (name == names[i])
+                return static_cast<int>(i);
+        return -1;
+    };
+
+    days = 0;
+    for (const auto &item : split_string(src, ' ')) {
+        if (item.empty())
+            continue;
+        /// Split by hand: an empty end ("mon-") must not read as "mon"
+        size_t dash = item.find('-');
+        int first = day_index(item.substr(0, dash));
+        int last = dash == std::string::npos ? first : day_index(item.substr(dash + 1));
+        if (first < 0 || last < 0)
+            return false;
+        /// Ranges may wrap around the week end, e.g. fri-mon
+        for (int d = first;; d = (d + 1) % 7) {
+            days |= 1u << d;
+            if (d == last)
+                break;
+        }
+    }
+    return days != 0;
+}
+
 bool CaptureTimeRules::parsing_contains_error(const std::vector<ParseResult> &parse_res_list,
                                               const std::vector<std::string> &str_list,
                                               const std::string &curr_line,
@@ -138,9 +171,10 @@ bool CaptureTimeRules::single_time_rule_parser(const std::string &path,
     std::vector<std::string> time1;
     std::vector<std::string> time2;
     std::vector<std::string> time_to_skip;
+    std::string days = "mon-sun";
     do {
         auto split_line = split_string(line, ',');
-        if (split_line.size() != 3) {
+        if (split_line.size() != 3 && split_line.size() != 4) {
             parse_error_line = true;
             break;
         }
@@ -159,13 +193,17 @@ bool CaptureTimeRules::single_time_rule_parser(const std::string &path,
             parse_error_line = true;
             break;
         }
+        if (split_line.size() == 4)
+            days = split_line[3];
     } while (false);
 
     if (parse_error_line) {
         std::cerr << "Parsing error " << path << ":" << (line_number) << "\n"
                   << line << "\n"
                   << "Each line from the second one should have the following format:\n"
-                  << "<hours>:<minutes>,<hours>:<minutes>,<hours>:<minutes>:<seconds>\n";
+                  << "<hours>:<minutes>,<hours>:<minutes>,<hours>:<minutes>:<seconds>[,<days>]\n"
+                  << "where the optional days are the days the rule begins on, e.g. "
+                     "\"mon-fri\" or \"sat sun\" (default every day).\n";
         return false;
     }
     unsigned tts_h;
@@ -187,9 +225,13 @@ bool CaptureTimeRules::single_time_rule_parser(const std::string &path,
     if (parsing_contains_error(parse_res_list, elm_list, line, line_number)) {
         return false;
     }
-    t.end_time_is_next_day =
-        (t.end_time_hour < t.begin_time_hour ||
-         (t.end_time_hour == t.begin_time_hour && t.end_time_minute <= t.begin_time_minute));
+    if (!parse_days(t.days, days)) {
+        std::cerr << "Parsing error " << path << ":" << (line_number) << "\n"
+                  << line << "\n"
+                  << "Days should be names among mon tue wed thu fri sat sun or ranges of them "
+                     "separated by spaces, e.g. \"mon-fri\" or \"sat sun\".\n";
+        return false;
+    }
 
     t.interval_between_frame_capture_seconds = ((tts_h * 60) + tts_m) * 60 + tts_s;
     rules_.push_back(t);
@@ -199,8 +241,9 @@ bool CaptureTimeRules::single_time_rule_parser(const std::string &path,
 void CaptureTimeRules::init(const std::string &path, unsigned int default_second_interval)
 {
     default_duration_ = std::chrono::seconds(default_second_interval);
+    rules_.clear();
+    valid_span_.store(0);
 
-    end_of_current_time_interval_ = std::chrono::system_clock::now() - default_duration_;
     std::ifstream file(path);
     if (!file.good()) {
         std::cerr << "Could not open " << path << ".\n";
@@ -215,71 +258,109 @@ void CaptureTimeRules::init(const std::string &path, unsigned int default_second
         no_error &= single_time_rule_parser(path, line, line_number);
         line_number++;
     }
+    compile_rules();
     init_ = no_error;
 }
 
-CaptureTimeRules::t_duration CaptureTimeRules::getCurrentTimeInterval()
+void CaptureTimeRules::compile_rules()
 {
-    auto now = std::chrono::system_clock::now();
-    if (now < end_of_current_time_interval_) {
-        return current_time_interval_;
-    }
+    interval_by_minute_.assign(minutes_in_week, default_duration_.count());
 
-    time_t tt = std::chrono::system_clock::to_time_t(now);
-    tm local_tm = *localtime(&tt);
-    for (const auto &elm : rules_) {
-        if (isInTimeRule(elm, local_tm)) {
-            local_tm.tm_hour = elm.end_time_hour;
-            local_tm.tm_min = elm.end_time_minute;
-            auto tp = std::chrono::system_clock::from_time_t(std::mktime(&local_tm));
-            if (elm.end_time_is_next_day)
-                tp += std::chrono::hours(24);
-            end_of_current_time_interval_ = tp;
-            current_time_interval_ =
-                std::chrono::seconds(elm.interval_between_frame_capture_seconds);
-            return current_time_interval_;
+    /// Painted last to first so that the first rule of the file wins.
+    for (auto it = rules_.rbegin(); it != rules_.rend(); ++it) {
+        unsigned begin = it->begin_time_hour * 60 + it->begin_time_minute;
+        unsigned end = it->end_time_hour * 60 + it->end_time_minute;
+        /// An end at or before the begin is on the next day.
+        unsigned length = end > begin ? end - begin : end + minutes_in_day - begin;
+
+        for (unsigned day = 0; day < 7; ++day) {
+            if (!(it->days & (1u << day)))
+                continue;
+            unsigned first = day * minutes_in_day + begin;
+            for (unsigned m = 0; m < length; ++m)
+                interval_by_minute_[(first + m) % minutes_in_week] =
+                    it->interval_between_frame_capture_seconds;
         }
     }
-    current_time_interval_ = default_duration_;
-    tm tmp_tm = *localtime(&tt);
-    t_duration time_diff = std::chrono::seconds(seconds_in_day);
-    for (const auto &elm : rules_) {
-        tmp_tm.tm_hour = elm.begin_time_hour;
-        tmp_tm.tm_min = elm.begin_time_minute;
-        auto tp = std::chrono::system_clock::from_time_t(std::mktime(&tmp_tm));
-        if (now > tp)
-            continue;
-        t_duration diff = std::chrono::duration_cast<std::chrono::seconds>(tp - now);
-        if (diff < time_diff)
-            time_diff = diff;
-    }
-    if (time_diff < std::chrono::seconds(seconds_in_day - 1)) {
-        end_of_current_time_interval_ = now + time_diff;
-    }
-    return current_time_interval_;
 }
 
-bool CaptureTimeRules::isInTimeRule(const CaptureTimeRules::TimeRule &t, const tm &now)
+CaptureTimeRules::t_duration CaptureTimeRules::getTimeIntervalAt(unsigned minute_of_week) const
 {
-    unsigned n_h = static_cast<unsigned>(now.tm_hour);
-    unsigned n_m = static_cast<unsigned>(now.tm_min);
+    if (interval_by_minute_.empty())
+        return default_duration_;
+    return std::chrono::seconds(interval_by_minute_[minute_of_week % minutes_in_week]);
+}
 
-    bool is_after_begin =
-        n_h > t.begin_time_hour || (n_h == t.begin_time_hour && n_m >= t.begin_time_minute);
-    bool is_before_end =
-        n_h < t.end_time_hour || (n_h == t.end_time_hour && n_m < t.end_time_minute);
-    if (!t.end_time_is_next_day)
-        return is_after_begin && is_before_end;
+CaptureTimeRules::t_duration CaptureTimeRules::getTimeIntervalAt(t_time_pt now,
+                                                                t_time_pt &valid_from,
+                                                                t_time_pt &valid_until) const
+{
+    time_t now_s = std::chrono::system_clock::to_time_t(now);
+    tm local_tm;
+    localtime_r(&now_s, &local_tm);
+    unsigned minute = ((local_tm.tm_wday + 6) % 7) * minutes_in_day + local_tm.tm_hour * 60 +
+                      local_tm.tm_min;
+    t_duration interval = getTimeIntervalAt(minute);
 
-    bool is_after_begin_plus_24 = (n_h + 24) > t.begin_time_hour ||
-                                  ((n_h + 24) == t.begin_time_hour && n_m >= t.begin_time_minute);
-    bool is_before_end_plus_24 =
-        n_h < (t.end_time_hour + 24) || (n_h == (t.end_time_hour + 24) && n_m < t.end_time_minute);
+    /// Minutes until the interval changes, a whole week if it never does.
+    unsigned minutes = 1;
+    while (minutes < minutes_in_week && getTimeIntervalAt(minute + minutes) == interval)
+        minutes++;
+    time_t begin_s = now_s - std::min(local_tm.tm_sec, 59);
+    time_t end_s = begin_s + minutes * 60;
 
-    bool next_day_condition =
-        (is_after_begin && is_before_end_plus_24) || (is_after_begin_plus_24 && is_before_end);
+    /// A DST change before that shifts the local minutes: stop at it.
+    tm end_tm;
+    localtime_r(&end_s, &end_tm);
+    if (end_tm.tm_gmtoff != local_tm.tm_gmtoff) {
+        time_t same = now_s;
+        time_t changed = end_s;
+        while (changed - same > 1) {
+            time_t mid = same + (changed - same) / 2;
+            tm mid_tm;
+            localtime_r(&mid, &mid_tm);
+            if (mid_tm.tm_gmtoff == local_tm.tm_gmtoff)
+                same = mid;
+            else
+                changed = mid;
+        }
+        end_s = changed;
+    }
 
-    return next_day_condition;
+    valid_from = std::chrono::system_clock::from_time_t(begin_s);
+    valid_until = std::chrono::system_clock::from_time_t(end_s);
+    return interval;
+}
+
+void CaptureTimeRules::refresh(t_time_pt now)
+{
+    t_time_pt begin, end;
+    uint32_t interval = getTimeIntervalAt(now, begin, end).count();
+
+    /// A reader seeing the new span also sees the new start and interval.
+    valid_span_.store(0, std::memory_order_relaxed);
+    current_interval_s_.store(interval, std::memory_order_relaxed);
+    valid_from_.store(begin.time_since_epoch().count(), std::memory_order_relaxed);
+    valid_span_.store((end - begin).count(), std::memory_order_release);
+}
+
+bool CaptureTimeRules::window_holds(t_time_pt now) const
+{
+    uint64_t span = valid_span_.load(std::memory_order_acquire);
+    /// Unsigned, so a clock set before valid_from_ is out of range too.
+    return static_cast<uint64_t>(now.time_since_epoch().count() -
+                                 valid_from_.load(std::memory_order_relaxed)) < span;
+}
+
+CaptureTimeRules::t_duration CaptureTimeRules::getCurrentTimeInterval()
+{
+    auto now = std::chrono::system_clock::now();
+    if (!window_holds(now)) {
+        std::lock_guard<std::mutex> lock(refresh_mutex_);
+        if (!window_holds(now))
+            refresh(now);
+    }
+    return std::chrono::seconds(current_interval_s_.load(std::memory_order_relaxed));
 }
 
 bool CaptureTimeRules::is_init_()
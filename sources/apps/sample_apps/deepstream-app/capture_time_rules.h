@@ -22,30 +22,57 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <ctime>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <vector>
 
 class CaptureTimeRules {
+public:
     typedef std::chrono::time_point<std::chrono::system_clock> t_time_pt;
     typedef std::chrono::duration<unsigned long long> t_duration;
 
-public:
-    /// Fills the time rules with the content of the file in path
+    /// Fills the time rules with the content of the file in path and compiles
+    /// them into a table giving the interval for every minute of the week.
     /// \param path containing the time rules
     /// \param default_second_interval When no rules are present for a
     /// certain time interval, this default duration is used.
     void init(const std::string &path, unsigned default_second_interval);
 
     /// Compute the correct time interval using the local computer time.
+    /// Until the interval changes (next rule boundary or UTC offset change)
+    /// this is one comparison against the cached deadline. Safe to call from
+    /// several threads; one racing with a refresh gets the old or the new
+    /// interval.
     /// \return the computed time interval to skip for current time
     t_duration getCurrentTimeInterval();
 
+    /// Interval of a minute of the week, without looking at the clock.
+    /// \param minute_of_week 0 is Monday 00:00 local time
+    /// \return the interval to skip during that minute
+    t_duration getTimeIntervalAt(unsigned minute_of_week) const;
+
+    /// Interval at a given time and the span over which it holds: from the
+    /// start of that local minute until the interval changes, cut short at
+    /// the next UTC offset change (DST). getCurrentTimeInterval() caches it.
+    /// \param now the time to look up
+    /// \param valid_from set to the start of the local minute of now
+    /// \param valid_until set to the end of the span, excluded
+    /// \return the interval to skip at now
+    t_duration getTimeIntervalAt(t_time_pt now,
+                                 t_time_pt &valid_from,
+                                 t_time_pt &valid_until) const;
+
     /// \return True if the construction of the the object went well.
     /// False otherwise
     bool is_init_();
 
+    static constexpr unsigned minutes_in_week = 7 * 24 * 60;
+
 private:
     struct TimeRule {
         unsigned begin_time_hour;
@@ -53,17 +80,10 @@ private:
         unsigned end_time_hour;
         unsigned end_time_minute;
         unsigned interval_between_frame_capture_seconds;
-        bool end_time_is_next_day;
+        /// Days the rule begins on, bit 0 is Monday
+        unsigned days;
     };
 
-    /// Test if a timestamp is between 2 other timestamps
-    /// \param t structure containing the left and right bounding
-    /// bounding timestamps
-    /// \param now the current time
-    /// \return True if the current time is between the 2 bounding
-    /// timestamps
-    static bool isInTimeRule(const TimeRule &t, const tm &now);
-
     enum ParseResult {
         PARSE_RESULT_OK,
         PARSE_RESULT_BAD_CHARS,
@@ -72,6 +92,7 @@ private:
     };
 
     static ParseResult stoi_err_handling(unsigned &dst, const std::string &src, unsigned max_bound);
+    static bool parse_days(unsigned &days, const std::string &src);
     static bool parsing_contains_error(const std::vector<ParseResult> &parse_res_list,
                                        const std::vector<std::string> &str_list,
                                        const std::string &curr_line,
@@ -80,9 +101,25 @@ private:
                                  const std::string &line,
                                  unsigned line_number);
 
+    /// Paints the rules into interval_by_minute_, the first matching rule of
+    /// the file wins as before.
+    void compile_rules();
+
+    /// Caches the interval at now and its validity window.
+    void refresh(t_time_pt now);
+
+    /// Whether the cached interval holds at now.
+    bool window_holds(t_time_pt now) const;
+
     std::chrono::seconds default_duration_;
-    t_time_pt end_of_current_time_interval_;
-    t_duration current_time_interval_;
     std::vector<TimeRule> rules_;
+    std::vector<uint32_t> interval_by_minute_;
+    /// current_interval_s_ holds from valid_from_ for valid_span_ ticks of
+    /// the system clock; a clock set backwards also falls outside. Published
+    /// by refresh() with valid_span_ last.
+    std::atomic<t_time_pt::rep> valid_from_{0};
+    std::atomic<uint64_t> valid_span_{0};
+    std::atomic<uint32_t> current_interval_s_{0};
+    std::mutex refresh_mutex_;
     bool init_ = false;
 };
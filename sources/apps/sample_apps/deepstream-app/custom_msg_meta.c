@@ -0,0 +1,175 @@
+/*
+ * Custom message metadata, see custom_msg_meta.h.
+ */
+
+#include "custom_msg_meta.h"
+
+#include <string.h>
+
+#include "json_writer.h"
+#include "nvdsmeta_schema.h"
+
+/* Large enough for a frame message with an URI and an image path. */
+#define BLOB_TEXT_SIZE 1024
+/* Free blobs kept for reuse; more than that in flight are allocated. */
+#define BLOB_POOL_MAX 256
+
+typedef struct _CustomMsgBlob CustomMsgBlob;
+
+struct _CustomMsgBlob {
+    /* First, so the blob is the user_meta_data the converter reads. */
+    NvDsCustomMsgInfo info;
+    CustomMsgBlob *next_free;
+    gsize capacity;
+    gchar text[];
+};
+
+static GMutex pool_lock;
+static CustomMsgBlob *pool_free;
+static guint pool_free_count;
+
+static void
+scratch_free(gpointer data)
+{
+    g_string_free((GString *)data, TRUE);
+}
+
+static GPrivate scratch_key = G_PRIVATE_INIT(scratch_free);
+
+/* Empty per-thread buffer for the JSON of one message. */
+static GString *
+scratch_get(void)
+{
+    GString *scratch = g_private_get(&scratch_key);
+
+    if (!scratch) {
+        scratch = g_string_sized_new(BLOB_TEXT_SIZE);
+        g_private_set(&scratch_key, scratch);
+    }
+    g_string_truncate(scratch, 0);
+    return scratch;
+}
+
+/* Blob holding a NUL-terminated copy of @text. */
+static CustomMsgBlob *
+blob_new(const gchar *text, gsize len)
+{
+    CustomMsgBlob *blob = NULL;
+
+    if (len < BLOB_TEXT_SIZE) {
+        g_mutex_lock(&pool_lock);
+        blob = pool_free;
+        if (blob) {
+            pool_free = blob->next_free;
+            pool_free_count--;
+        }
+        g_mutex_unlock(&pool_lock);
+        if (!blob) {
+            blob = g_malloc(sizeof(CustomMsgBlob) + BLOB_TEXT_SIZE);
+            blob->capacity = BLOB_TEXT_SIZE;
+        }
+    } else {
+        blob = g_malloc(sizeof(CustomMsgBlob) + len + 1);
+        blob->capacity = len + 1;
+    }
+
+    memcpy(blob->text, text, len);
+    blob->text[len] = '\0';
+    blob->info.message = blob->text;
+    blob->info.size = (guint)len;
+    blob->next_free = NULL;
+    return blob;
+}
+
+static void
+blob_release(CustomMsgBlob *blob)
+{
+    if (blob->capacity == BLOB_TEXT_SIZE) {
+        g_mutex_lock(&pool_lock);
+        if (pool_free_count < BLOB_POOL_MAX) {
+            blob->next_free = pool_free;
+            pool_free = blob;
+            pool_free_count++;
+            blob = NULL;
+        }
+        g_mutex_unlock(&pool_lock);
+    }
+    g_free(blob);
+}
+
+static gpointer
+blob_copy_func(gpointer data, gpointer user_data)
+{
+    NvDsUserMeta *user_meta = (NvDsUserMeta *)data;
+    CustomMsgBlob *src = (CustomMsgBlob *)user_meta->user_meta_data;
+
+    return blob_new(src->text, src->info.size);
+}
+
+static void
+blob_release_func(gpointer data, gpointer user_data)
+{
+    NvDsUserMeta *user_meta = (NvDsUserMeta *)data;
+
+    blob_release((CustomMsgBlob *)user_meta->user_meta_data);
+    user_meta->user_meta_data = NULL;
+}
+
+/* User meta carrying the JSON in @scratch, NULL if the pool is empty. */
+static NvDsUserMeta *
+user_meta_new(NvDsBatchMeta *batch_meta, const GString *scratch)
+{
+    NvDsUserMeta *user_meta = nvds_acquire_user_meta_from_pool(batch_meta);
+
+    if (!user_meta) {
+        g_print("Error in attaching event meta to buffer\n");
+        return NULL;
+    }
+    user_meta->user_meta_data = blob_new(scratch->str, scratch->len);
+    user_meta->base_meta.meta_type = NVDS_CUSTOM_MSG_BLOB;
+    user_meta->base_meta.copy_func = (NvDsMetaCopyFunc)blob_copy_func;
+    user_meta->base_meta.release_func = (NvDsMetaReleaseFunc)blob_release_func;
+    return user_meta;
+}
+
+gboolean
+custom_msg_meta_attach_to_frame(NvDsBatchMeta *batch_meta, NvDsFrameMeta *frame_meta,
+                                const gchar *uri, gint64 frame_number, const gchar *file_path)
+{
+    GString *scratch = scratch_get();
+    NvDsUserMeta *user_meta;
+
+    g_string_append_c(scratch, '{');
+    json_append_member(scratch, "uri", uri ? uri : "");
+    g_string_append_c(scratch, ',');
+    json_append_int_member(scratch, "frame_number", frame_number);
+    if (file_path && *file_path) {
+        g_string_append_c(scratch, ',');
+        json_append_member(scratch, "filePath", file_path);
+    }
+    g_string_append_c(scratch, '}');
+
+    user_meta = user_meta_new(batch_meta, scratch);
+    if (!user_meta)
+        return FALSE;
+    nvds_add_user_meta_to_frame(frame_meta, user_meta);
+    return TRUE;
+}
+
+gboolean
+custom_msg_meta_attach_to_object(NvDsBatchMeta *batch_meta, NvDsObjectMeta *obj_meta,
+                                 const gchar *file_path)
+{
+    GString *scratch = scratch_get();
+    NvDsUserMeta *user_meta;
+
+    g_string_append_c(scratch, '{');
+    json_append_member(scratch, "filePath", file_path);
+    g_string_append_c(scratch, '}');
+
+    user_meta = user_meta_new(batch_meta, scratch);
+    if (!user_meta)
+        return FALSE;
+    nvds_add_user_meta_to_obj(obj_meta, user_meta);
+    return TRUE;
+}
@@ -0,0 +1,38 @@
+/*
+ * NVDS_CUSTOM_MSG_BLOB metadata for the message converter.
+ *
+ * The JSON of each message is written into a per-thread buffer and copied
+ * into a blob taken from a shared pool: the NvDsCustomMsgInfo and its text
+ * share one allocation, which goes back to the pool when the metadata is
+ * released.
+ */
+
+#ifndef __CUSTOM_MSG_META_H__
+#define __CUSTOM_MSG_META_H__
+
+#include <glib.h>
+
+#include "nvdsmeta.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Attaches {"uri", "frame_number"[, "filePath"]} to @frame_meta.
+ * @file_path may be NULL when no image of the frame was saved.
+ * FALSE if no user meta could be acquired.
+ */
+gboolean custom_msg_meta_attach_to_frame(NvDsBatchMeta *batch_meta, NvDsFrameMeta *frame_meta,
+                                         const gchar *uri, gint64 frame_number,
+                                         const gchar *file_path);
+
+/** Attaches {"filePath"} to @obj_meta. FALSE if no user meta could be acquired. */
+gboolean custom_msg_meta_attach_to_object(NvDsBatchMeta *batch_meta, NvDsObjectMeta *obj_meta,
+                                          const gchar *file_path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CUSTOM_MSG_META_H__ */
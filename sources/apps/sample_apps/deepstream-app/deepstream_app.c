@@ -23,6 +23,8 @@
 #include "deepstream_app.h"
 #include "nvbufsurface.h"
 #include "nvbufsurftransform.h"
+#include "presence_tracker.h"
+#include "startup_plan.h"
 
 #include <cuda_runtime.h>
 #include <gst/gst.h>
@@ -37,9 +39,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <json-glib/json-glib.h>
-#include <png.h>
 #include <sys/time.h>
-#include <curl/curl.h>
 
 #include <glib.h>
 #include <gio/gio.h>
@@ -49,42 +49,16 @@
 #include <ifaddrs.h>
 #include <netdb.h>
 
-static const char* get_color_format_str(NvBufSurfaceColorFormat format) {
-    switch (format) {
-        case NVBUF_COLOR_FORMAT_RGBA: return "RGBA";
-        case NVBUF_COLOR_FORMAT_RGB: return "RGB";
-        case NVBUF_COLOR_FORMAT_NV12: return "NV12";
-        case NVBUF_COLOR_FORMAT_NV21: return "NV21";
-        case NVBUF_COLOR_FORMAT_BGR: return "BGR";
-        case NVBUF_COLOR_FORMAT_GRAY8: return "GRAY8";
-        default: return "UNKNOWN";
-    }
-}
-static const char base64_chars[] =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
-
 static void initialize_camera_info(AppCtx* appCtx);
-const char* get_student_id_from_name(const char* name);
-static char* encode_full_frame_base64(NvBufSurface* surface, NvDsFrameMeta* frame_meta);
-/* Cấu trúc để theo dõi người đã xuất hiện */
-typedef struct PersonTracker {
-    char name[256];
-    time_t last_log_time;
-    gboolean is_present;
-    struct PersonTracker* next;
-} PersonTracker;
-/* Danh sách linked list để theo dõi các người */
-static PersonTracker* person_list = NULL;
-static GMutex person_list_mutex;
-// Thay đổi cấu trúc StudentInfo
-#define MAX_STUDENTS 2000
-typedef struct {
-    int id;
-    char full_name[128];
-} StudentInfo;
-StudentInfo students[MAX_STUDENTS];
-int num_students = 0;
+/* Theo dõi sự hiện diện theo mã sinh viên (hash table + timer wheel) */
+static PresenceTracker* presence_tracker = NULL;
+static guint presence_timer_id = 0;
+/* Bảng mã sinh viên -> họ tên, chỉ dùng khi hiển thị */
+static IdentityTable* identity_table = NULL;
+static guint identity_gie_id = IDENTITY_DEFAULT_GIE_ID;
+static guint identity_refresh_timer_id = 0;
+/* Đo thời gian từ lúc khởi động đến lần nhận diện đầu tiên (một lần) */
+static gint first_recognition_logged = 0;
 
 // Thêm cấu trúc để lưu thông tin camera
 typedef struct {
@@ -100,570 +74,344 @@ static gboolean camera_info_initialized = FALSE;
 // Hàm lấy địa chỉ IP từ URL RTSP
 /* Thời gian timeout  */
 #define PRESENCE_TIMEOUT 300
-/* Thời gian giu log (3 ngày) */
-#define LOG_RETENTION_DAYS 3
-#define LOG_RETENTION_SECONDS (LOG_RETENTION_DAYS * 24 * 60 * 60)  // 3 days in seconds
 
+/* Dispatcher giao recognition event lên API trên worker thread */
+static EventDispatcher* event_dispatcher = NULL;
+/* Ảnh snapshot được scale trên streaming thread, nén JPEG trên worker thread */
+static SnapshotEncoder* snapshot_encoder = NULL;
+/* Spool trên đĩa cho các event gửi thất bại (thay cho log.json) */
+static EventSpool* event_spool = NULL;
+static gint spool_replaying = 0;
+static guint spool_sync_timer_id = 0;
+static guint spool_retry_timer_id = 0;
+static guint cleanup_data_timer_id = 0;
+#define LOG_RETRY_INTERVAL 180
+#define LOG_RETRY_BATCH 32
+
+/* Đưa một lô event từ spool vào lại hàng đợi của dispatcher.
+ * Các event gửi lỗi lần nữa sẽ được on_recognition_event_failed ghi lại vào spool. */
+static void replay_spooled_events(void) {
+    EventDispatcherStats stats;
+    gint budget, requeued = 0;
+
+    if (!event_spool || !event_dispatcher) {
+        return;
+    }
+    /* Chỉ một thread replay tại một thời điểm */
+    if (!g_atomic_int_compare_and_exchange(&spool_replaying, 0, 1)) {
+        return;
+    }
 
+    /* Chỉ lấy một lô nhỏ để không chiếm hết hàng đợi của event mới */
+    event_dispatcher_get_stats(event_dispatcher, &stats);
+    budget = LOG_RETRY_BATCH - (gint)stats.queued;
 
-/* Hàm tạo file log.json nếu chưa có */
-static gboolean create_log_file_if_not_exists(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (file == NULL) {
-        /* File chưa tồn tại, tạo file mới với array JSON rỗng */
-        file = fopen(filename, "w");
-        if (file == NULL) {
-            g_print("Error: Cannot create log file %s\n", filename);
-            return FALSE;
+    while (requeued < budget) {
+        RecognitionEvent* event = event_spool_peek(event_spool);
+        if (!event) {
+            break;
         }
-        fprintf(file, "[]");
-        fclose(file);
-        g_print("Created new log file: %s\n", filename);
-    } else {
-        fclose(file);
-    }
-    return TRUE;
-}
-
-/* Hàm tìm person trong danh sách */
-static PersonTracker* find_person(const char* name) {
-    PersonTracker* current = person_list;
-    while (current != NULL) {
-        if (strcmp(current->name, name) == 0) {
-            return current;
+        /* Khi hàng đợi đầy, event bị từ chối sẽ được on_recognition_event_failed
+         * ghi lại vào cuối spool, nên vẫn bỏ qua bản ghi này rồi dừng lô */
+        gboolean queued = event_dispatcher_enqueue(event_dispatcher, event);
+        event_spool_advance(event_spool);
+        if (!queued) {
+            break;
         }
-        current = current->next;
+        requeued++;
     }
-    return NULL;
-}
 
-/* Hàm thêm person mới vào danh sách */
-static PersonTracker* add_person(const char* name) {
-    PersonTracker* new_person = (PersonTracker*)malloc(sizeof(PersonTracker));
-    if (new_person == NULL) {
-        g_print("Error: Cannot allocate memory for new person\n");
-        return NULL;
+    if (requeued > 0) {
+        g_print("Retry: %d spooled logs requeued, %" G_GUINT64_FORMAT " remaining\n",
+                requeued, event_spool_pending(event_spool));
     }
-
-    strncpy(new_person->name, name, sizeof(new_person->name) - 1);
-    new_person->name[sizeof(new_person->name) - 1] = '\0';
-    new_person->last_log_time  = time(NULL);
-    new_person->is_present = TRUE;
-    new_person->next = person_list;
-    person_list = new_person;
-
-    return new_person;
+    g_atomic_int_set(&spool_replaying, 0);
 }
 
-const char* get_student_id_from_name(const char* person_name) {
-    static char id[16];
-    if (!person_name) return NULL;
-    const char* comma = strchr(person_name, ',');
-    if (!comma) return NULL;
-    size_t len = comma - person_name;
-    if (len >= sizeof(id)) len = sizeof(id) - 1;
-    strncpy(id, person_name, len);
-    id[len] = '\0';
-    return id;
-}
-/* Hàm ghi log recognition event với thông tin mới */
-static void log_recognition_event(const char* person_name, NvBufSurface* surface,
-                                  NvDsFrameMeta* frame_meta, NvDsObjectMeta* obj_meta)  {
-    JsonParser* parser = NULL;
-    JsonNode* root_node = NULL;
-    JsonArray* root_array = NULL;
-    JsonObject* new_entry = NULL;
-    JsonGenerator* generator = NULL;
-    char timestamp_str[64];
-    time_t current_time;
-    struct tm* time_info;
-    gchar* json_string = NULL;
-    GError* error = NULL;
-    gboolean api_success = FALSE;
-
-    g_mutex_lock(&person_list_mutex);
-
-    current_time = time(NULL);
-    PersonTracker* person = find_person(person_name);
-
-    if (person == NULL) {
-        // Người mới, thêm vào danh sách và ghi log
-        person = add_person(person_name);
-        if (person == NULL) {
-            g_mutex_unlock(&person_list_mutex);
-            return;
-        }
-        // Log lần đầu tiên
-    } else if (person->is_present == FALSE) {
-        // Người này đã vắng mặt đủ lâu, giờ xuất hiện lại => log
-        person->is_present = TRUE;
-        person->last_log_time = current_time;
-        // Log lần quay lại
+/* Callback của dispatcher: gửi API thất bại (worker thread) hoặc hàng đợi đầy
+ * (thread riêng của dispatcher, nên không chặn streaming thread) */
+static void on_recognition_event_failed(const RecognitionEvent* event, gpointer user_data) {
+    if (event_spool && event_spool_append(event_spool, event)) {
+        g_print("Saved to local spool due to API failure or full queue for student_id: %s\n",
+                event->student_id);
     } else {
-        // Người này vẫn đang hiện diện, chỉ cập nhật last_log_time, KHÔNG log
-        person->last_log_time = current_time;
-        g_mutex_unlock(&person_list_mutex);
-        return;
+        g_print("Error: could not spool log for student_id: %s\n", event->student_id);
     }
-    // Đủ điều kiện log (mới hoặc vừa quay lại sau khi vắng mặt)
-    g_mutex_unlock(&person_list_mutex);
-
-    /* Format timestamp */
-    time_info = localtime(&current_time);
-    strftime(timestamp_str, sizeof(timestamp_str), "%d-%m-%Y %H:%M:%S", time_info);
+}
 
-    // Lấy student_id thay vì sử dụng tên
-    const char* student_id = get_student_id_from_name(person_name);
-    if (!student_id) {
-        student_id = "UNKNOWN";
+/* Callback của dispatcher (worker thread): gửi API thành công.
+ * API hoạt động lại => tiếp tục gửi các event trong spool. Mỗi event replay
+ * thành công lại kéo thêm một lô, nên spool được xả với tốc độ mà API chịu được. */
+static void on_recognition_event_delivered(const RecognitionEvent* event, gpointer user_data) {
+    if (event_spool && event_spool_pending(event_spool) > 0) {
+        replay_spooled_events();
     }
+}
 
-    // Lấy thông tin camera dựa trên source_id
-    guint source_id = frame_meta ? frame_meta->pad_index : 0;
-    const char* ip_address = "unknown";
-    const char* mac_address = "unknown";
-
-    if (source_id < MAX_CAMERAS && camera_info_initialized) {
-        ip_address = camera_info[source_id].ip_address;
-        mac_address = camera_info[source_id].mac_address;
-    }
-
-    char* full_frame_base64 = NULL;
-    if (surface && frame_meta) {
-        full_frame_base64 = encode_full_frame_base64(surface, frame_meta);
-    }
-
-    /* Thử gửi lên server trước */
-    CURL *curl;
-    CURLcode res;
-    long response_code = 0;
-    curl = curl_easy_init();
-    if (curl) {
-        // Tạo JSON body
-        JsonBuilder *builder = json_builder_new();
-        json_builder_begin_object(builder);
-        json_builder_set_member_name(builder, "student_id");
-        json_builder_add_string_value(builder, student_id);
-        json_builder_set_member_name(builder, "ip_address");
-        json_builder_add_string_value(builder, ip_address);
-        json_builder_set_member_name(builder, "mac_address");
-        json_builder_add_string_value(builder, mac_address);
-        json_builder_set_member_name(builder, "face_image");
-        json_builder_add_string_value(builder, full_frame_base64 ? full_frame_base64 : "");
-        json_builder_set_member_name(builder, "timestamp");
-        json_builder_add_string_value(builder, timestamp_str);
-        json_builder_end_object(builder);
-
-        JsonGenerator *gen = json_generator_new();
-        JsonNode *root = json_builder_get_root(builder);
-        json_generator_set_root(gen, root);
-        gchar *json_body = json_generator_to_data(gen, NULL);
-
-        struct curl_slist *headers = NULL;
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-
-        curl_easy_setopt(curl, CURLOPT_URL, "https://topcam.ai.vn/apis/aiFaceRecognitionLogAPI");
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_body);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L); // Timeout 10 giây
-
-        res = curl_easy_perform(curl);
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
-
-        if (res == CURLE_OK && response_code == 200) {
-            api_success = TRUE;
-            g_print("Successfully sent log to API for student_id: %s\n", student_id);
-
-            /* Khi API thành công, thử gửi lại các log local đã tồn tại */
-            static time_t last_retry_time = 0;
-            time_t now = time(NULL);
-            if (now - last_retry_time > 180) { // Chỉ retry mỗi 1 phút để tránh spam
-                last_retry_time = now;
-
-                // Kiểm tra xem có file log.json không và có log nào cần retry không
-                if (access("log.json", F_OK) == 0) {
-                    JsonParser* retry_parser = json_parser_new();
-                    GError* retry_error = NULL;
-
-                    if (json_parser_load_from_file(retry_parser, "log.json", &retry_error)) {
-                        JsonNode* retry_root = json_parser_get_root(retry_parser);
-                        if (JSON_NODE_HOLDS_ARRAY(retry_root)) {
-                            JsonArray* retry_array = json_node_get_array(retry_root);
-                            gint retry_count = json_array_get_length(retry_array);
-
-                            if (retry_count > 0) {
-                                g_print("Found %d pending logs, attempting to retry...\n", retry_count);
-
-                                JsonArray* remaining_logs = json_array_new();
-                                gboolean has_successful_retries = FALSE;
-
-                                // Duyệt qua từng log và thử gửi lại
-                                for (gint i = 0; i < retry_count; i++) {
-                                    JsonNode* log_node = json_array_get_element(retry_array, i);
-                                    if (!JSON_NODE_HOLDS_OBJECT(log_node)) continue;
-
-                                    JsonObject* log_obj = json_node_get_object(log_node);
-                                    const char* retry_student_id = json_object_get_string_member(log_obj, "student_id");
-                                    const char* retry_timestamp = json_object_get_string_member(log_obj, "timestamp");
-                                    const char* retry_ip = json_object_get_string_member(log_obj, "ip_address");
-                                    const char* retry_mac = json_object_get_string_member(log_obj, "mac_address");
-                                    const char* retry_image = json_object_get_string_member(log_obj, "face_image");
-
-                                    if (!retry_student_id || !retry_timestamp || !retry_ip || !retry_mac) {
-                                        continue; // Bỏ qua log thiếu thông tin
-                                    }
-
-                                    // Thử gửi log này
-                                    CURL *retry_curl = curl_easy_init();
-                                    if (retry_curl) {
-                                        JsonBuilder *retry_builder = json_builder_new();
-                                        json_builder_begin_object(retry_builder);
-                                        json_builder_set_member_name(retry_builder, "student_id");
-                                        json_builder_add_string_value(retry_builder, retry_student_id);
-                                        json_builder_set_member_name(retry_builder, "ip_address");
-                                        json_builder_add_string_value(retry_builder, retry_ip);
-                                        json_builder_set_member_name(retry_builder, "mac_address");
-                                        json_builder_add_string_value(retry_builder, retry_mac);
-                                        json_builder_set_member_name(retry_builder, "face_image");
-                                        json_builder_add_string_value(retry_builder, retry_image ? retry_image : "");
-                                        json_builder_set_member_name(retry_builder, "timestamp");
-                                        json_builder_add_string_value(retry_builder, retry_timestamp);
-                                        json_builder_end_object(retry_builder);
-
-                                        JsonGenerator *retry_gen = json_generator_new();
-                                        JsonNode *retry_json_root = json_builder_get_root(retry_builder);
-                                        json_generator_set_root(retry_gen, retry_json_root);
-                                        gchar *retry_json_body = json_generator_to_data(retry_gen, NULL);
-
-                                        struct curl_slist *retry_headers = NULL;
-                                        retry_headers = curl_slist_append(retry_headers, "Content-Type: application/json");
-
-                                        curl_easy_setopt(retry_curl, CURLOPT_URL, "https://topcam.ai.vn/apis/aiFaceRecognitionLogAPI");
-                                        curl_easy_setopt(retry_curl, CURLOPT_POST, 1L);
-                                        curl_easy_setopt(retry_curl, CURLOPT_HTTPHEADER, retry_headers);
-                                        curl_easy_setopt(retry_curl, CURLOPT_POSTFIELDS, retry_json_body);
-                                        curl_easy_setopt(retry_curl, CURLOPT_TIMEOUT, 5L); // Timeout ngắn hơn cho retry
-
-                                        CURLcode retry_res = curl_easy_perform(retry_curl);
-                                        long retry_response_code = 0;
-                                        curl_easy_getinfo(retry_curl, CURLINFO_RESPONSE_CODE, &retry_response_code);
-
-                                        if (retry_res == CURLE_OK && retry_response_code == 200) {
-                                            has_successful_retries = TRUE;
-                                            g_print("Successfully retried log for student_id: %s\n", retry_student_id);
-                                        } else {
-                                            // Gửi thất bại, giữ lại log này
-                                            json_array_add_element(remaining_logs, json_node_copy(log_node));
-                                        }
-
-                                        curl_slist_free_all(retry_headers);
-                                        curl_easy_cleanup(retry_curl);
-                                        g_free(retry_json_body);
-                                        json_node_free(retry_json_root);
-                                        g_object_unref(retry_gen);
-                                        g_object_unref(retry_builder);
-                                    } else {
-                                        // Không tạo được curl, giữ lại log
-                                        json_array_add_element(remaining_logs, json_node_copy(log_node));
-                                    }
-                                }
-
-                                // Cập nhật file log.json với những log chưa gửi được
-                                if (has_successful_retries) {
-                                    JsonNode* remaining_root = json_node_new(JSON_NODE_ARRAY);
-                                    json_node_set_array(remaining_root, remaining_logs);
-
-                                    JsonGenerator* retry_generator = json_generator_new();
-                                    json_generator_set_root(retry_generator, remaining_root);
-                                    json_generator_set_pretty(retry_generator, TRUE);
-
-                                    GError* write_error = NULL;
-                                    if (!json_generator_to_file(retry_generator, "log.json", &write_error)) {
-                                        g_print("Error updating log.json after retry: %s\n", write_error->message);
-                                        g_error_free(write_error);
-                                    } else {
-                                        gint remaining_count = json_array_get_length(remaining_logs);
-                                        g_print("Retry completed: %d logs sent, %d logs remaining\n",
-                                               retry_count - remaining_count, remaining_count);
-                                    }
-
-                                    json_node_free(remaining_root);
-                                    g_object_unref(retry_generator);
-                                } else {
-                                    json_array_unref(remaining_logs);
-                                }
-                            }
-                        }
-                    } else {
-                        g_error_free(retry_error);
-                    }
-                    g_object_unref(retry_parser);
-                }
-            }
-        } else {
-            g_print("Failed to send log to API: %s (HTTP: %ld)\n",
-                   curl_easy_strerror(res), response_code);
-        }
-
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        g_free(json_body);
-        json_node_free(root);
-        g_object_unref(gen);
-        g_object_unref(builder);
-    }
+/* Timer: thử lại spool kể cả khi không có event mới nào được gửi thành công */
+static gboolean retry_spooled_events(gpointer user_data) {
+    replay_spooled_events();
+    return TRUE; /* Tiếp tục timer */
+}
 
-    /* Nếu gửi API thành công, không cần lưu vào file local */
-    if (api_success) {
-        if (full_frame_base64) {
-            free(full_frame_base64);
-        }
-        return;
-    }
+/* Timer: fsync các record vừa ghi và lưu cursor */
+static gboolean sync_event_spool(gpointer user_data) {
+    event_spool_sync(event_spool);
+    return TRUE; /* Tiếp tục timer */
+}
 
-    /* Nếu gửi API thất bại, lưu vào file log.json local */
-    g_print("Saving to local log due to API failure for student_id: %s\n", student_id);
+/* Chuyển log.json của phiên bản cũ (nếu còn) vào spool, chạy một lần */
+static void import_legacy_log_file(const char* filename) {
+    JsonParser* parser = NULL;
+    GError* error = NULL;
+    guint imported = 0;
 
-    /* Tạo file log.json nếu chưa có */
-    if (!create_log_file_if_not_exists("log.json")) {
-        if (full_frame_base64) {
-            free(full_frame_base64);
-        }
+    if (access(filename, F_OK) != 0) {
         return;
     }
 
-    /* Parse file JSON hiện tại */
     parser = json_parser_new();
-
-    if (!json_parser_load_from_file(parser, "log.json", &error)) {
-        g_print("Error parsing log.json: %s\n", error->message);
+    if (!json_parser_load_from_file(parser, filename, &error)) {
+        g_print("Error parsing %s: %s\n", filename, error->message);
         g_error_free(error);
         g_object_unref(parser);
-        if (full_frame_base64) {
-            free(full_frame_base64);
-        }
         return;
     }
 
-    root_node = json_parser_get_root(parser);
-    if (!JSON_NODE_HOLDS_ARRAY(root_node)) {
-        g_print("Error: log.json does not contain an array\n");
-        g_object_unref(parser);
-        if (full_frame_base64) {
-            free(full_frame_base64);
-        }
-        return;
-    }
-
-    root_array = json_node_get_array(root_node);
-
-    /* Tạo entry mới */
-    new_entry = json_object_new();
+    JsonNode* root_node = json_parser_get_root(parser);
+    if (JSON_NODE_HOLDS_ARRAY(root_node)) {
+        JsonArray* root_array = json_node_get_array(root_node);
+        guint length = json_array_get_length(root_array);
 
-    // Thêm các trường vào JSON
-    json_object_set_string_member(new_entry, "student_id", student_id);
-    json_object_set_string_member(new_entry, "timestamp", timestamp_str);
-    json_object_set_string_member(new_entry, "ip_address", ip_address);
-    json_object_set_string_member(new_entry, "mac_address", mac_address);
+        for (guint i = 0; i < length; i++) {
+            JsonNode* log_node = json_array_get_element(root_array, i);
+            if (!JSON_NODE_HOLDS_OBJECT(log_node)) continue;
 
-    if (full_frame_base64) {
-        json_object_set_string_member(new_entry, "face_image", full_frame_base64);
-        free(full_frame_base64);
-    } else {
-        json_object_set_string_member(new_entry, "face_image", "");
-    }
-
-    /* Thêm vào array */
-    JsonNode* entry_node = json_node_new(JSON_NODE_OBJECT);
-    json_node_set_object(entry_node, new_entry);
-    json_array_add_element(root_array, entry_node);
+            JsonObject* log_obj = json_node_get_object(log_node);
+            const char* student_id = json_object_get_string_member(log_obj, "student_id");
+            const char* timestamp = json_object_get_string_member(log_obj, "timestamp");
+            const char* ip = json_object_get_string_member(log_obj, "ip_address");
+            const char* mac = json_object_get_string_member(log_obj, "mac_address");
+            const char* image = json_object_get_string_member(log_obj, "face_image");
+            struct tm time_struct = {0};
+            RecognitionEvent event = {0};
 
-    /* Ghi lại file */
-    generator = json_generator_new();
-    json_generator_set_root(generator, root_node);
-    json_generator_set_pretty(generator, TRUE);
-
-    if (!json_generator_to_file(generator, "log.json", &error)) {
-        g_print("Error writing to log.json: %s\n", error->message);
-        g_error_free(error);
-    } else {
-        g_print("Saved to local log: %s (ID: %s) at %s from IP: %s\n",
-                person_name, student_id, timestamp_str, ip_address);
+            if (!student_id || !timestamp || !ip || !mac ||
+                !strptime(timestamp, "%d-%m-%Y %H:%M:%S", &time_struct)) {
+                continue; // Bỏ qua log thiếu thông tin
+            }
+            time_struct.tm_isdst = -1;
+            event.timestamp = mktime(&time_struct);
+            g_strlcpy(event.student_id, student_id, sizeof(event.student_id));
+            g_strlcpy(event.ip_address, ip, sizeof(event.ip_address));
+            g_strlcpy(event.mac_address, mac, sizeof(event.mac_address));
+            event.face_image = (gchar*)(image && image[0] ? image : NULL);
+            if (event_spool_append(event_spool, &event)) {
+                imported++;
+            }
+        }
     }
-
-    /* Cleanup */
-    g_object_unref(generator);
     g_object_unref(parser);
+
+    gchar* imported_name = g_strconcat(filename, ".imported", NULL);
+    rename(filename, imported_name);
+    g_print("Imported %u pending logs from %s into the spool (old file kept as %s)\n",
+            imported, filename, imported_name);
+    g_free(imported_name);
 }
 
-/* Hàm xóa log cũ hơn 3 ngày */
-static void cleanup_old_logs() {
-    JsonParser* parser = NULL;
-    JsonNode* root_node = NULL;
-    JsonArray* root_array = NULL;
-    JsonArray* new_array = NULL;
-    JsonGenerator* generator = NULL;
-    GError* error = NULL;
-    time_t current_time = time(NULL);
-    time_t cutoff_time = current_time - LOG_RETENTION_SECONDS;
-    gint array_length, i;
-    gboolean has_changes = FALSE;
+/* Hàm ghi log recognition event với thông tin mới.
+ * Chạy trên streaming thread: chỉ tạo event và đưa vào hàng đợi, không bao giờ
+ * chờ network. */
+static void log_recognition_event(guint32 student_id, NvBufSurface* surface,
+                                  NvDsFrameMeta* frame_meta, NvDsObjectMeta* obj_meta)  {
+    guint change;
 
-    /* Kiểm tra xem file log.json có tồn tại không */
-    if (access("log.json", F_OK) != 0) {
-        return; /* File không tồn tại, không cần cleanup */
+    if (!event_dispatcher || !presence_tracker) {
+        return;
+    }
+    if (g_atomic_int_compare_and_exchange(&first_recognition_logged, 0, 1)) {
+        g_print("First recognition %.1f s after process start\n", startup_process_age());
     }
 
-    /* Parse file JSON hiện tại */
-    parser = json_parser_new();
-
-    if (!json_parser_load_from_file(parser, "log.json", &error)) {
-        g_print("Error parsing log.json for cleanup: %s\n", error->message);
-        g_error_free(error);
-        g_object_unref(parser);
+    /* Chỉ log khi người này mới xuất hiện hoặc quay lại sau khi vắng mặt;
+     * nếu vẫn đang hiện diện thì chỉ cập nhật thời điểm thấy gần nhất */
+    change = presence_tracker_observe(presence_tracker, student_id,
+                                      frame_meta ? frame_meta->pad_index : 0,
+                                      g_get_monotonic_time() / G_USEC_PER_SEC);
+    if (!(change & PRESENCE_ARRIVED)) {
         return;
     }
 
-    root_node = json_parser_get_root(parser);
-    if (!JSON_NODE_HOLDS_ARRAY(root_node)) {
-        g_print("Error: log.json does not contain an array\n");
-        g_object_unref(parser);
+    RecognitionEvent* event = recognition_event_new();
+    if (!event) {
         return;
     }
+    event->timestamp = time(NULL);
 
-    root_array = json_node_get_array(root_node);
-    array_length = json_array_get_length(root_array);
-
-    /* Tạo array mới để chứa các entry còn hợp lệ */
-    new_array = json_array_new();
-
-    /* Duyệt qua các entry và chỉ giữ lại những entry trong 3 ngày */
-    for (i = 0; i < array_length; i++) {
-        JsonNode* element_node = json_array_get_element(root_array, i);
-        if (JSON_NODE_HOLDS_OBJECT(element_node)) {
-            JsonObject* entry_obj = json_node_get_object(element_node);
-            const gchar* timestamp_str = json_object_get_string_member(entry_obj, "timestamp");
-
-            if (timestamp_str) {
-                struct tm time_struct = {0};
-                time_t entry_time;
+    g_snprintf(event->student_id, sizeof(event->student_id), "%u", student_id);
 
-                /* Parse timestamp string (format: "YYYY-MM-DD HH:MM:SS") */
-                if (strptime(timestamp_str, "%Y-%m-%d %H:%M:%S", &time_struct)) {
-                    entry_time = mktime(&time_struct);
-
-                    /* Nếu entry còn trong thời hạn 3 ngày, giữ lại */
-                    if (entry_time >= cutoff_time) {
-                        json_array_add_element(new_array, json_node_copy(element_node));
-                    } else {
-                        has_changes = TRUE;
-                        g_print("Removed old log entry: %s at %s\n",
-                               json_object_get_string_member(entry_obj, "name"),
-                               timestamp_str);
-                    }
-                } else {
-                    /* Nếu không parse được timestamp, giữ lại để an toàn */
-                    json_array_add_element(new_array, json_node_copy(element_node));
-                }
-            } else {
-                /* Nếu không có timestamp, giữ lại để an toàn */
-                json_array_add_element(new_array, json_node_copy(element_node));
-            }
-        }
+    // Lấy thông tin camera dựa trên source_id
+    event->source_id = frame_meta ? frame_meta->pad_index : 0;
+    if (event->source_id < MAX_CAMERAS && camera_info_initialized) {
+        g_strlcpy(event->ip_address, camera_info[event->source_id].ip_address,
+                  sizeof(event->ip_address));
+        g_strlcpy(event->mac_address, camera_info[event->source_id].mac_address,
+                  sizeof(event->mac_address));
+    } else {
+        g_strlcpy(event->ip_address, "unknown", sizeof(event->ip_address));
+        g_strlcpy(event->mac_address, "unknown", sizeof(event->mac_address));
     }
 
-    /* Nếu có thay đổi, ghi lại file */
-    if (has_changes) {
-        JsonNode* new_root = json_node_new(JSON_NODE_ARRAY);
-        json_node_set_array(new_root, new_array);
-
-        generator = json_generator_new();
-        json_generator_set_root(generator, new_root);
-        json_generator_set_pretty(generator, TRUE);
-
-        if (!json_generator_to_file(generator, "log.json", &error)) {
-            g_print("Error writing cleaned log.json: %s\n", error->message);
-            g_error_free(error);
-        } else {
-            g_print("Cleaned up old log entries (older than %d days)\n", LOG_RETENTION_DAYS);
-        }
-
-        g_object_unref(generator);
-        json_node_free(new_root);
-    } else {
-        json_array_unref(new_array);
+    /* Encoder nhận event và tự gửi đi khi ảnh đã sẵn sàng; nếu hết buffer
+     * thì gửi event không kèm ảnh thay vì chặn pipeline */
+    if (snapshot_encoder && surface && frame_meta &&
+        snapshot_encoder_submit(snapshot_encoder, surface, frame_meta->batch_id,
+                                obj_meta ? &obj_meta->rect_params : NULL, event)) {
+        return;
     }
 
-    g_object_unref(parser);
+    event_dispatcher_enqueue(event_dispatcher, event);
 }
 
-/* Hàm cleanup để đánh dấu người không còn xuất hiện */
-static gboolean cleanup_absent_persons(gpointer user_data) {
-    time_t current_time = time(NULL);
-    PersonTracker* current;
-
-    g_mutex_lock(&person_list_mutex);
-    current = person_list;
+static void on_snapshot_encoded(RecognitionEvent* event, gpointer user_data) {
+    event_dispatcher_enqueue(event_dispatcher, event);
+}
 
-    while (current != NULL) {
-        if (current->is_present && (current_time - current->last_log_time ) >= PRESENCE_TIMEOUT) {
-            current->is_present = FALSE;
-            g_print("Person %s marked as absent\n", current->name);
-        }
-        current = current->next;
+/* Gọi khi một người không còn xuất hiện sau PRESENCE_TIMEOUT giây */
+static void on_person_absent(guint32 id, guint source_id, gpointer user_data) {
+    if (source_id == PRESENCE_ANY_SOURCE) {
+        g_print("Person %u marked as absent\n", id);
     }
+}
+
+/* Timer wheel chỉ xét những người đến hạn, nên có thể chạy mỗi giây */
+static gboolean expire_absent_persons(gpointer user_data) {
+    presence_tracker_expire(presence_tracker, g_get_monotonic_time() / G_USEC_PER_SEC);
+    return TRUE; /* Tiếp tục timer */
+}
 
-    g_mutex_unlock(&person_list_mutex);
+static gboolean refresh_identity_table(gpointer user_data) {
+    identity_table_refresh(identity_table);
     return TRUE; /* Tiếp tục timer */
 }
 
 /* Hàm cleanup định kỳ cho log và ảnh cũ */
 static gboolean cleanup_old_data(gpointer user_data) {
-    cleanup_old_logs();
+    event_spool_expire(event_spool);
     return TRUE; /* Tiếp tục timer */
 }
 
 
 void initialize_logging_system(AppCtx* appCtx) {
-    if (!create_log_file_if_not_exists("log.json")) {
-        return;
+    presence_tracker = presence_tracker_new(PRESENCE_TIMEOUT, on_person_absent, NULL);
+
+    /* Họ tên sinh viên, đọc lại khi file labels thay đổi (cùng file với faiss index) */
+    identity_table = identity_table_new(appCtx->config.identity_config.labels_file);
+    if (appCtx->config.identity_config.gie_id) {
+        identity_gie_id = appCtx->config.identity_config.gie_id;
     }
-    g_mutex_init(&person_list_mutex);
+    identity_refresh_timer_id = g_timeout_add_seconds(10, refresh_identity_table, NULL);
 
     // Khởi tạo thông tin camera
     initialize_camera_info(appCtx);
 
+    event_spool = event_spool_open(&appCtx->config.event_spool_config);
+    if (!event_spool) {
+        g_print("Error: cannot open event spool, undelivered logs will be lost\n");
+    } else {
+        import_legacy_log_file("log.json");
+    }
 
-    /* Tạo timer để cleanup các person không còn xuất hiện (chạy mỗi 30 giây) */
-    g_timeout_add_seconds(30, cleanup_absent_persons, NULL);
+    /* Worker gửi event lên API, tách khỏi streaming thread */
+    event_dispatcher = event_dispatcher_new(&appCtx->config.recognition_event_config,
+                                            on_recognition_event_failed,
+                                            on_recognition_event_delivered, NULL);
+    if (event_dispatcher) {
+        snapshot_encoder = snapshot_encoder_new(&appCtx->config.snapshot_config,
+                                                on_snapshot_encoded, NULL);
+    }
 
-    /* Tạo timer để cleanup log và ảnh cũ (chạy mỗi 6 giờ) */
-    g_timeout_add_seconds(6 * 60 * 60, cleanup_old_data, NULL);
+    /* Tạo timer để đánh dấu các person không còn xuất hiện (chạy mỗi giây) */
+    presence_timer_id = g_timeout_add_seconds(1, expire_absent_persons, NULL);
 
-    /* Chạy cleanup ngay lần đầu để xóa data cũ */
-    cleanup_old_logs();
+    if (event_spool) {
+        /* Tạo timer để cleanup log và ảnh cũ (chạy mỗi 6 giờ) */
+        cleanup_data_timer_id = g_timeout_add_seconds(6 * 60 * 60, cleanup_old_data, NULL);
+        spool_sync_timer_id = g_timeout_add_seconds(1, sync_event_spool, NULL);
+        spool_retry_timer_id =
+            g_timeout_add_seconds(LOG_RETRY_INTERVAL, retry_spooled_events, NULL);
 
-    g_print("Face recognition logging system initialized with %d-day retention\n", LOG_RETENTION_DAYS);
+        /* Chạy cleanup ngay lần đầu để xóa data cũ */
+        cleanup_old_data(NULL);
+    }
+
+    g_print("Face recognition logging system initialized\n");
 }
 
 
 void cleanup_logging_system() {
-    PersonTracker* current = person_list;
-    PersonTracker* next;
-
-
-
-    g_mutex_lock(&person_list_mutex);
-    while (current != NULL) {
-        next = current->next;
-        free(current);
-        current = next;
-    }
-    person_list = NULL;
-    g_mutex_unlock(&person_list_mutex);
-
-    g_mutex_clear(&person_list_mutex);
+    if (presence_timer_id) {
+        g_source_remove(presence_timer_id);
+        presence_timer_id = 0;
+    }
+    if (identity_refresh_timer_id) {
+        g_source_remove(identity_refresh_timer_id);
+        identity_refresh_timer_id = 0;
+    }
+    if (spool_sync_timer_id) {
+        g_source_remove(spool_sync_timer_id);
+        g_source_remove(spool_retry_timer_id);
+        g_source_remove(cleanup_data_timer_id);
+        spool_sync_timer_id = spool_retry_timer_id = cleanup_data_timer_id = 0;
+    }
+
+    /* Nén nốt các snapshot đang chờ trước khi dừng dispatcher */
+    if (snapshot_encoder) {
+        SnapshotEncoderStats stats;
+
+        snapshot_encoder_get_stats(snapshot_encoder, &stats);
+        snapshot_encoder_free(snapshot_encoder);
+        snapshot_encoder = NULL;
+        if (stats.captured && stats.encoded) {
+            g_print("Snapshots: %" G_GUINT64_FORMAT " events, %" G_GUINT64_FORMAT
+                    " images (avg %" G_GUINT64_FORMAT " bytes), capture %" G_GUINT64_FORMAT
+                    " us, encode %" G_GUINT64_FORMAT " us per event, %" G_GUINT64_FORMAT
+                    " busy, %" G_GUINT64_FORMAT " failed\n",
+                    stats.captured, stats.encoded, stats.encoded_bytes / stats.encoded,
+                    stats.capture_us / stats.captured, stats.encode_us / stats.captured,
+                    stats.busy, stats.failed);
+        }
+    }
+
+    /* Chờ các request đang gửi; event còn lại được lưu vào spool */
+    if (event_dispatcher) {
+        EventDispatcherStats stats;
+
+        event_dispatcher_get_stats(event_dispatcher, &stats);
+        g_print("Recognition events: %" G_GUINT64_FORMAT " queued, %" G_GUINT64_FORMAT
+                " delivered, %" G_GUINT64_FORMAT " failed, %" G_GUINT64_FORMAT " dropped, %"
+                G_GUINT64_FORMAT " requests, %" G_GUINT64_FORMAT " KiB sent\n",
+                stats.enqueued, stats.delivered, stats.failed, stats.dropped, stats.requests,
+                stats.bytes_sent / 1024);
+        event_dispatcher_free(event_dispatcher);
+        event_dispatcher = NULL;
+    }
+    event_spool_close(event_spool);
+    event_spool = NULL;
+
+    if (presence_tracker) {
+        PresenceTrackerStats stats;
+
+        presence_tracker_get_stats(presence_tracker, &stats);
+        g_print("Presence: %" G_GUINT64_FORMAT " arrivals, %" G_GUINT64_FORMAT
+                " departures, %u still present\n",
+                stats.arrivals, stats.departures, stats.present);
+        presence_tracker_free(presence_tracker);
+        presence_tracker = NULL;
+    }
+    identity_table_free(identity_table);
+    identity_table = NULL;
     g_print("Face recognition logging system cleaned up\n");
 }
 
@@ -709,45 +457,51 @@ static gboolean extract_ip_from_rtsp_url(const char* rtsp_url, char* ip_buffer,
     return TRUE;
 }
 
-// Hàm lấy MAC address từ IP (cần có quyền truy cập ARP table)
+/* MAC giả từ số ngẫu nhiên khi camera chưa có trong ARP cache */
+static void make_fake_mac(char* mac_buffer, size_t buffer_size) {
+    snprintf(mac_buffer, buffer_size, "00:00:00:%02x:%02x:%02x",
+             (unsigned char)(rand() % 256),
+             (unsigned char)(rand() % 256),
+             (unsigned char)(rand() % 256));
+}
+
+/* Hàm lấy MAC address từ IP: tra ARP cache của kernel trong /proc/net/arp
+ * (cùng dữ liệu với `arp -n`, nhưng không phải chạy shell cho mỗi camera).
+ * Mỗi dòng: "IP address  HW type  Flags  HW address  Mask  Device". */
 static gboolean get_mac_from_ip(const char* ip_address, char* mac_buffer, size_t buffer_size) {
+    gchar* contents = NULL;
+    gboolean found = FALSE;
+
     if (!ip_address || !mac_buffer || buffer_size < 18) {
         return FALSE;
     }
 
-    char command[256];
-    snprintf(command, sizeof(command), "arp -n %s 2>/dev/null | awk 'NR==2{print $3}'", ip_address);
+    if (g_file_get_contents("/proc/net/arp", &contents, NULL, NULL)) {
+        gchar** lines = g_strsplit(contents, "\n", -1);
 
-    FILE* fp = popen(command, "r");
-    if (!fp) {
-        // Nếu không lấy được, tạo MAC giả từ IP
-        snprintf(mac_buffer, buffer_size, "00:00:00:%02x:%02x:%02x",
-                 (unsigned char)(rand() % 256),
-                 (unsigned char)(rand() % 256),
-                 (unsigned char)(rand() % 256));
-        return FALSE;
-    }
+        /* Bỏ dòng tiêu đề */
+        for (guint i = 1; lines[i] && !found; i++) {
+            char ip[64], mac[32];
+            unsigned int flags;
 
-    if (fgets(mac_buffer, buffer_size, fp) != NULL) {
-        // Xóa newline
-        char* newline = strchr(mac_buffer, '\n');
-        if (newline) *newline = '\0';
-
-        // Kiểm tra định dạng MAC
-        if (strlen(mac_buffer) >= 17) {
-            pclose(fp);
-            return TRUE;
+            if (sscanf(lines[i], "%63s %*s %x %31s", ip, &flags, mac) != 3) {
+                continue;
+            }
+            /* Flags 0x0: entry chưa hoàn tất, MAC toàn số 0 */
+            if (strcmp(ip, ip_address) == 0 && (flags & 0x2) && strlen(mac) >= 17) {
+                g_strlcpy(mac_buffer, mac, buffer_size);
+                found = TRUE;
+            }
         }
+        g_strfreev(lines);
+        g_free(contents);
     }
 
-    pclose(fp);
-
     // Nếu không lấy được MAC thực, tạo MAC giả
-    snprintf(mac_buffer, buffer_size, "00:00:00:%02x:%02x:%02x",
-             (unsigned char)(rand() % 256),
-             (unsigned char)(rand() % 256),
-             (unsigned char)(rand() % 256));
-    return FALSE;
+    if (!found) {
+        make_fake_mac(mac_buffer, buffer_size);
+    }
+    return found;
 }
 
 // Hàm khởi tạo thông tin camera
@@ -787,46 +541,6 @@ static void initialize_camera_info(AppCtx* appCtx) {
     camera_info_initialized = TRUE;
 }
 
-void load_labels(const char* filename) {
-    if (!filename) {
-        g_print("Error: Invalid filename provided to load_labels\n");
-        return;
-    }
-
-    FILE* f = fopen(filename, "r");
-    if (!f) {
-        g_print("Error: Cannot open label file: %s\n", filename);
-        return;
-    }
-
-    char line[256];
-    num_students = 0;
-
-    while (fgets(line, sizeof(line), f) && num_students < MAX_STUDENTS) {
-        int id;
-        char name[128], code[64];
-
-        // Thêm kiểm tra định dạng dòng
-        if (strlen(line) < 3) continue; // Bỏ qua dòng trống hoặc quá ngắn
-
-        if (sscanf(line, "%d,%127[^,],%63s", &id, name, code) == 3) {
-            students[num_students].id = id;
-            strncpy(students[num_students].full_name, name, sizeof(students[num_students].full_name) - 1);
-            students[num_students].full_name[sizeof(students[num_students].full_name) - 1] = '\0';
-            num_students++;
-        } else {
-            g_print("Warning: Invalid line format in label file: %s\n", line);
-        }
-    }
-
-    fclose(f);
-    g_print("Loaded %d students from label file\n", num_students);
-
-    if (num_students >= MAX_STUDENTS) {
-        g_print("Warning: Reached maximum number of students (%d). Some entries may be ignored.\n", MAX_STUDENTS);
-    }
-}
-
 #define MAX_DISPLAY_LEN 64
 static guint batch_num = 0;
 static guint demux_batch_num = 0;
@@ -1193,6 +907,7 @@ static void process_meta(AppCtx *appCtx, NvDsBatchMeta *batch_meta, GstBuffer *f
             gint class_index = obj->class_id;
             NvDsGieConfig *gie_config = NULL;
             gchar *str_ins_pos = NULL;
+            gchar *str_end = NULL;
 
             if (obj->unique_component_id == (gint)appCtx->config.primary_gie_config.unique_id) {
                 gie_config = &appCtx->config.primary_gie_config;
@@ -1244,6 +959,7 @@ static void process_meta(AppCtx *appCtx, NvDsBatchMeta *batch_meta, GstBuffer *f
             obj->text_params.display_text = g_malloc(128);
             obj->text_params.display_text[0] = '\0';
             str_ins_pos = obj->text_params.display_text;
+            str_end = obj->text_params.display_text + 128;
 
             if (obj->obj_label[0] != '\0')
                 sprintf(str_ins_pos, "%s", obj->obj_label);
@@ -1269,18 +985,27 @@ static void process_meta(AppCtx *appCtx, NvDsBatchMeta *batch_meta, GstBuffer *f
                 for (NvDsMetaList *l_label = cmeta->label_info_list; l_label != NULL;
                      l_label = l_label->next) {
                     NvDsLabelInfo *label = (NvDsLabelInfo *)l_label->data;
-                    const char *person_name = NULL;
-                    if (label->pResult_label) {
-                        sprintf(str_ins_pos, " %s", label->pResult_label);
-                        person_name = label->pResult_label;
+                    if (cmeta->unique_component_id == (gint)identity_gie_id) {
+                        /* Nhận diện chỉ mang mã sinh viên, họ tên tra ở đây */
+                        gchar name[MAX_LABEL_SIZE];
+                        if (identity_table && identity_table_get_name(identity_table,
+                                                                      label->label_id, name,
+                                                                      sizeof(name))) {
+                            g_snprintf(str_ins_pos, str_end - str_ins_pos, " %s", name);
+                        } else {
+                            g_snprintf(str_ins_pos, str_end - str_ins_pos, " #%u",
+                                       label->label_id);
+                        }
+                    } else if (label->pResult_label) {
+                        g_snprintf(str_ins_pos, str_end - str_ins_pos, " %s",
+                                   label->pResult_label);
                     } else if (label->result_label[0] != '\0') {
-                        sprintf(str_ins_pos, " %s", label->result_label);
-                        person_name = label->result_label;
+                        g_snprintf(str_ins_pos, str_end - str_ins_pos, " %s",
+                                   label->result_label);
                     }
 
                     str_ins_pos += strlen(str_ins_pos);
-
-                    }
+                }
                 }
             }
         }
@@ -1384,19 +1109,17 @@ static GstPadProbeReturn gie_processing_done_buf_prob(GstPad *pad,
             for (NvDsMetaList *l_class = obj->classifier_meta_list; l_class != NULL; l_class = l_class->next) {
                 NvDsClassifierMeta *cmeta = (NvDsClassifierMeta *)l_class->data;
 
+                // ✅ CHỈ XÉT KẾT QUẢ CỦA MODEL NHẬN DIỆN: label_id LÀ MÃ SINH VIÊN
+                if (cmeta->unique_component_id != (gint)identity_gie_id) {
+                    continue;
+                }
+
                 for (NvDsMetaList *l_label = cmeta->label_info_list; l_label != NULL; l_label = l_label->next) {
                     NvDsLabelInfo *label = (NvDsLabelInfo *)l_label->data;
 
-                    const char *person_name = NULL;
-                    if (label->pResult_label) {
-                        person_name = label->pResult_label;
-                    } else if (label->result_label[0] != '\0') {
-                        person_name = label->result_label;
-                    }
-
-                    // ✅ CHỈ LOG KHI CÓ TÊN NGƯỜI VÀ SURFACE HỢP LỆ
-                    if (person_name && strlen(person_name) > 0 && surface) {
-                        log_recognition_event(person_name, surface, frame_meta, obj);
+                    // ✅ CHỈ LOG KHI SURFACE HỢP LỆ
+                    if (surface) {
+                        log_recognition_event(label->label_id, surface, frame_meta, obj);
                     }
                 }
             }
@@ -1935,10 +1658,6 @@ gboolean create_pipeline(AppCtx *appCtx,
         NVGSTDS_ERR_MSG_V("Failed to create pipeline");
         goto done;
     }
-    // Khởi tạo hệ thống logging nhận diện khuôn mặt
-    initialize_logging_system(appCtx);
-    g_print("Face recognition logging system initialized\n");
-
     bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline->pipeline));
     pipeline->bus_id = gst_bus_add_watch(bus, bus_callback, appCtx);
     gst_object_unref(bus);
@@ -2277,6 +1996,51 @@ done:
     return ret;
 }
 
+/////////////////
+/* Start Custom */
+/////////////////
+static gboolean start_inference_element(gpointer data)
+{
+    return gst_element_set_state(GST_ELEMENT(data), GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE;
+}
+
+gboolean start_inference_engines(AppCtx *appCtx)
+{
+    NvDsPipeline *pipeline = &appCtx->pipeline;
+    StartupPlan *plan;
+    gboolean ret;
+
+    if (gst_element_set_state(pipeline->pipeline, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE) {
+        NVGSTDS_ERR_MSG_V("Failed to set pipeline to READY");
+        return FALSE;
+    }
+
+    /* nvinfer creates its context (and deserializes the engine) in
+     * READY->PAUSED. Started here one thread each; when the pipeline goes
+     * to PAUSED they are already there and the bin skips them. */
+    plan = startup_plan_new("Inference engines");
+    if (pipeline->common_elements.primary_gie_bin.primary_gie) {
+        startup_plan_add(plan, "primary-gie", start_inference_element,
+                         pipeline->common_elements.primary_gie_bin.primary_gie, NULL);
+    }
+    for (guint i = 0; i < appCtx->config.num_secondary_gie_sub_bins; i++) {
+        GstElement *sgie = pipeline->common_elements.secondary_gie_bin.sub_bins[i].secondary_gie;
+        gchar *name;
+
+        if (!sgie)
+            continue;
+        name = g_strdup_printf("secondary-gie-%u", i);
+        startup_plan_add(plan, name, start_inference_element, sgie, NULL);
+        g_free(name);
+    }
+    ret = startup_plan_run(plan);
+    startup_plan_free(plan);
+    return ret;
+}
+////////////////
+/* End Custom */
+////////////////
+
 /**
  * Function to destroy pipeline and release the resources, probes etc.
  */
@@ -2413,356 +2177,3 @@ gboolean resume_pipeline(AppCtx *appCtx)
         return FALSE;
     }
 }
-
-static char* base64_encode(const unsigned char* data, size_t input_length) {
-    if (!data || input_length == 0) {
-        return NULL;
-    }
-
-    size_t output_length = 4 * ((input_length + 2) / 3);
-    char* encoded_data = (char*)malloc(output_length + 1);
-    if (!encoded_data) {
-        return NULL;
-    }
-
-    for (size_t i = 0, j = 0; i < input_length;) {
-        uint32_t octet_a = i < input_length ? data[i++] : 0;
-        uint32_t octet_b = i < input_length ? data[i++] : 0;
-        uint32_t octet_c = i < input_length ? data[i++] : 0;
-
-        uint32_t triple = (octet_a << 0x10) + (octet_b << 0x08) + octet_c;
-
-        encoded_data[j++] = base64_chars[(triple >> 3 * 6) & 0x3F];
-        encoded_data[j++] = base64_chars[(triple >> 2 * 6) & 0x3F];
-        encoded_data[j++] = base64_chars[(triple >> 1 * 6) & 0x3F];
-        encoded_data[j++] = base64_chars[(triple >> 0 * 6) & 0x3F];
-    }
-
-    // Padding
-    int padding = input_length % 3;
-    if (padding) {
-        for (int i = 0; i < 3 - padding; i++) {
-            encoded_data[output_length - 1 - i] = '=';
-        }
-    }
-
-    encoded_data[output_length] = '\0';
-    return encoded_data;
-}
-
-static NvBufSurfaceMemType get_actual_memory_type(NvBufSurface* surface) {
-    if (surface->memType != NVBUF_MEM_DEFAULT) {
-        return surface->memType;
-    }
-
-    // NVBUF_MEM_DEFAULT sẽ map thành:
-    // - NVBUF_MEM_CUDA_DEVICE cho dGPU (desktop GPU)
-    // - NVBUF_MEM_SURFACE_ARRAY cho Jetson
-
-    // Kiểm tra CUDA device để xác định platform
-    int device_count = 0;
-    cudaError_t cuda_status = cudaGetDeviceCount(&device_count);
-
-    if (cuda_status == cudaSuccess && device_count > 0) {
-        struct cudaDeviceProp prop;
-        cudaGetDeviceProperties(&prop, 0);
-
-        // Jetson devices có integrated memory
-        if (prop.integrated) {
-            return NVBUF_MEM_SURFACE_ARRAY;
-        } else {
-            return NVBUF_MEM_CUDA_DEVICE;
-        }
-    }
-
-    // Fallback: assume desktop GPU
-    return NVBUF_MEM_CUDA_DEVICE;
-}
-
-static char* copy_gpu_data_to_host(NvBufSurface* surface, guint batch_id) {
-    if (!surface || batch_id >= surface->numFilled) {
-        return NULL;
-    }
-
-    NvBufSurfaceParams* params = &surface->surfaceList[batch_id];
-
-    if (params->colorFormat != NVBUF_COLOR_FORMAT_RGBA) {
-        return NULL;
-    }
-
-    size_t frame_size = params->width * params->height * 4;
-    char* host_buffer = (char*)malloc(frame_size);
-    if (!host_buffer) {
-        g_print("[ERROR] Failed to allocate host buffer\n");
-        return NULL;
-    }
-
-    // Use cudaMemcpy for device memory
-    cudaError_t err = cudaMemcpy(host_buffer, params->dataPtr, frame_size, cudaMemcpyDeviceToHost);
-    if (err != cudaSuccess) {
-        g_print("[ERROR] cudaMemcpy failed: %s\n", cudaGetErrorString(err));
-        free(host_buffer);
-        return NULL;
-    }
-
-    return host_buffer;
-}
-// Callback function cho PNG writer
-static void png_write_callback(png_structp png_ptr, png_bytep data, png_size_t length) {
-    struct {
-        unsigned char** buffer;
-        size_t* size;
-        size_t* capacity;
-    }* write_data = (void*)png_get_io_ptr(png_ptr);
-
-    size_t new_size = *(write_data->size) + length;
-    if (new_size > *(write_data->capacity)) {
-        *(write_data->capacity) = new_size * 2;
-        *(write_data->buffer) = (unsigned char*)realloc(*(write_data->buffer), *(write_data->capacity));
-    }
-
-    memcpy(*(write_data->buffer) + *(write_data->size), data, length);
-    *(write_data->size) = new_size;
-}
-
-// Hàm resize RGBA data với bilinear interpolation
-static unsigned char* resize_rgba_bilinear(unsigned char* src_data, int src_width, int src_height,
-                                          int dst_width, int dst_height) {
-    if (!src_data) return NULL;
-
-    unsigned char* dst_data = (unsigned char*)malloc(dst_width * dst_height * 4);
-    if (!dst_data) return NULL;
-
-    float x_ratio = (float)src_width / dst_width;
-    float y_ratio = (float)src_height / dst_height;
-
-    for (int y = 0; y < dst_height; y++) {
-        for (int x = 0; x < dst_width; x++) {
-            float src_x = x * x_ratio;
-            float src_y = y * y_ratio;
-
-            int x1 = (int)src_x;
-            int y1 = (int)src_y;
-            int x2 = (x1 + 1 < src_width) ? x1 + 1 : x1;
-            int y2 = (y1 + 1 < src_height) ? y1 + 1 : y1;
-
-            float dx = src_x - x1;
-            float dy = src_y - y1;
-
-            for (int c = 0; c < 4; c++) { // RGBA channels
-                float val = (1 - dx) * (1 - dy) * src_data[(y1 * src_width + x1) * 4 + c] +
-                           dx * (1 - dy) * src_data[(y1 * src_width + x2) * 4 + c] +
-                           (1 - dx) * dy * src_data[(y2 * src_width + x1) * 4 + c] +
-                           dx * dy * src_data[(y2 * src_width + x2) * 4 + c];
-
-                dst_data[(y * dst_width + x) * 4 + c] = (unsigned char)val;
-            }
-        }
-    }
-
-    return dst_data;
-}
-
-// Hàm chuyển RGBA thành PNG
-static char* rgba_to_png_base64(unsigned char* rgba_data, int width, int height) {
-    if (!rgba_data) return NULL;
-
-    png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (!png_ptr) return NULL;
-
-    png_infop info_ptr = png_create_info_struct(png_ptr);
-    if (!info_ptr) {
-        png_destroy_write_struct(&png_ptr, NULL);
-        return NULL;
-    }
-
-    unsigned char* png_buffer = NULL;
-    size_t png_size = 0;
-    size_t png_capacity = 0;
-
-    struct {
-        unsigned char** buffer;
-        size_t* size;
-        size_t* capacity;
-    } write_data = { &png_buffer, &png_size, &png_capacity };
-
-    if (setjmp(png_jmpbuf(png_ptr))) {
-        png_destroy_write_struct(&png_ptr, &info_ptr);
-        if (png_buffer) free(png_buffer);
-        return NULL;
-    }
-
-    // Setup PNG write callback
-    png_set_write_fn(png_ptr, &write_data, png_write_callback, NULL);
-
-    // Set PNG header
-    png_set_IHDR(png_ptr, info_ptr, width, height, 8,
-                 PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
-                 PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
-
-    // Set compression level (0-9, 6 is default)
-    png_set_compression_level(png_ptr, 6);
-
-    png_write_info(png_ptr, info_ptr);
-
-    // Create row pointers
-    png_bytep* row_pointers = (png_bytep*)malloc(sizeof(png_bytep) * height);
-    for (int y = 0; y < height; y++) {
-        row_pointers[y] = rgba_data + y * width * 4;
-    }
-
-    png_write_image(png_ptr, row_pointers);
-    png_write_end(png_ptr, NULL);
-
-    // Cleanup
-    free(row_pointers);
-    png_destroy_write_struct(&png_ptr, &info_ptr);
-
-    // Encode PNG to base64
-    char* base64_result = base64_encode(png_buffer, png_size);
-    free(png_buffer);
-
-    return base64_result;
-}
-
-static char* encode_full_frame_base64(NvBufSurface* surface, NvDsFrameMeta* frame_meta) {
-    if (!surface || !frame_meta) {
-        g_print("[DEBUG] Invalid surface or frame_meta\n");
-        return NULL;
-    }
-
-    guint batch_id = frame_meta->batch_id;
-    if (batch_id >= surface->numFilled) {
-        batch_id = 0;
-    }
-
-    NvBufSurfaceParams* params = &surface->surfaceList[batch_id];
-
-    if (params->colorFormat != NVBUF_COLOR_FORMAT_RGBA) {
-        g_print("[DEBUG] Skipping non-RGBA format: %s\n", get_color_format_str(params->colorFormat));
-        return NULL;
-    }
-
-    const int TARGET_WIDTH = 1280;
-    const int TARGET_HEIGHT = 720;
-
-    char* result = NULL;
-    char* host_data = NULL;
-    unsigned char* resized_data = NULL;
-    char* png_base64 = NULL;
-
-    switch (surface->memType) {
-        case NVBUF_MEM_DEFAULT: {
-            NvBufSurfaceMemType actual_type = get_actual_memory_type(surface);
-
-            if (actual_type == NVBUF_MEM_CUDA_DEVICE) {
-                host_data = copy_gpu_data_to_host(surface, batch_id);
-                if (host_data) {
-                    // Resize ảnh từ original size xuống 720p
-                    resized_data = resize_rgba_bilinear((unsigned char*)host_data,
-                                                       params->width, params->height,
-                                                       TARGET_WIDTH, TARGET_HEIGHT);
-                    free(host_data);
-
-                    if (resized_data) {
-                        png_base64 = rgba_to_png_base64(resized_data, TARGET_WIDTH, TARGET_HEIGHT);
-                        free(resized_data);
-                    }
-                }
-            } else {
-                // Jetson: NVBUF_MEM_SURFACE_ARRAY - có thể map trực tiếp
-                if (NvBufSurfaceMap(surface, batch_id, 0, NVBUF_MAP_READ) == 0) {
-                    if (params->dataPtr) {
-                        resized_data = resize_rgba_bilinear((unsigned char*)params->dataPtr,
-                                                           params->width, params->height,
-                                                           TARGET_WIDTH, TARGET_HEIGHT);
-                        if (resized_data) {
-                            png_base64 = rgba_to_png_base64(resized_data, TARGET_WIDTH, TARGET_HEIGHT);
-                            free(resized_data);
-                        }
-                    }
-                    NvBufSurfaceUnMap(surface, batch_id, 0);
-                }
-            }
-            break;
-        }
-
-        case NVBUF_MEM_CUDA_PINNED:
-        case NVBUF_MEM_CUDA_UNIFIED: {
-            if (NvBufSurfaceMap(surface, batch_id, 0, NVBUF_MAP_READ) == 0) {
-                NvBufSurfaceSyncForCpu(surface, batch_id, 0);
-
-                if (params->dataPtr) {
-                    resized_data = resize_rgba_bilinear((unsigned char*)params->dataPtr,
-                                                       params->width, params->height,
-                                                       TARGET_WIDTH, TARGET_HEIGHT);
-                    if (resized_data) {
-                        png_base64 = rgba_to_png_base64(resized_data, TARGET_WIDTH, TARGET_HEIGHT);
-                        free(resized_data);
-
-                    }
-                }
-
-                NvBufSurfaceUnMap(surface, batch_id, 0);
-            }
-            break;
-        }
-
-        case NVBUF_MEM_CUDA_DEVICE: {
-            host_data = copy_gpu_data_to_host(surface, batch_id);
-            if (host_data) {
-                resized_data = resize_rgba_bilinear((unsigned char*)host_data,
-                                                   params->width, params->height,
-                                                   TARGET_WIDTH, TARGET_HEIGHT);
-                free(host_data);
-
-                if (resized_data) {
-                    png_base64 = rgba_to_png_base64(resized_data, TARGET_WIDTH, TARGET_HEIGHT);
-                    free(resized_data);
-                }
-            }
-            break;
-        }
-
-        case NVBUF_MEM_SURFACE_ARRAY: {
-            if (NvBufSurfaceMap(surface, batch_id, 0, NVBUF_MAP_READ) == 0) {
-                if (params->dataPtr) {
-                    resized_data = resize_rgba_bilinear((unsigned char*)params->dataPtr,
-                                                       params->width, params->height,
-                                                       TARGET_WIDTH, TARGET_HEIGHT);
-                    if (resized_data) {
-                        png_base64 = rgba_to_png_base64(resized_data, TARGET_WIDTH, TARGET_HEIGHT);
-                        free(resized_data);
-
-                    }
-                }
-                NvBufSurfaceUnMap(surface, batch_id, 0);
-            }
-            break;
-        }
-
-        default: {
-            g_print("[ERROR] Unsupported memory type: %d\n", surface->memType);
-            break;
-        }
-    }
-
-    if (!png_base64) {
-        g_print("[ERROR] Failed to encode PNG frame - all methods failed\n");
-        return NULL;
-    }
-
-    // ✅ Tạo string theo định dạng web chuẩn
-    const char* mime_type = "image/png";
-    size_t header_len = snprintf(NULL, 0, "data:%s;base64,", mime_type);
-    size_t total_len = header_len + strlen(png_base64) + 1;
-
-    result = (char*)malloc(total_len);
-    if (result) {
-        snprintf(result, total_len, "data:%s;base64,%s", mime_type, png_base64);
-
-    }
-
-    free(png_base64);
-    return result;
-}
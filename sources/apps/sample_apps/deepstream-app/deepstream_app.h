@@ -40,6 +40,11 @@ extern "C" {
 /* Start Custom */
 /////////////////
 #include "deepstream_dspostprocessing.h"
+#include "event_dispatcher.h"
+#include "event_spool.h"
+#include "identity_table.h"
+#include "snapshot_encoder.h"
+#include "student_sync.h"
 ////////////////
 /* End Custom */
 ////////////////
@@ -190,6 +195,11 @@ typedef struct {
     /* Start Custom */
     /////////////////
     NvDsDsPostProcessingConfig dspostprocessing_config;
+    NvDsRecognitionEventConfig recognition_event_config;
+    NvDsEventSpoolConfig event_spool_config;
+    NvDsSnapshotConfig snapshot_config;
+    NvDsIdentityConfig identity_config;
+    NvDsStudentSyncConfig student_sync_config;
     ////////////////
     /* End Custom */
     ////////////////
@@ -263,6 +273,26 @@ void toggle_show_bbox_text(AppCtx *appCtx);
 void destroy_pipeline(AppCtx *appCtx);
 void restart_pipeline(AppCtx *appCtx);
 
+/////////////////
+/* Start Custom */
+/////////////////
+/**
+ * Starts the face recognition logging system (identities, presence, event
+ * spool and dispatcher) for the config of @appCtx. Called once per process,
+ * independently of create_pipeline(); destroy_pipeline() tears it down.
+ */
+void initialize_logging_system(AppCtx *appCtx);
+
+/**
+ * Brings the pipeline to READY and starts its inference elements in
+ * parallel, so that their TensorRT engines are deserialized concurrently
+ * instead of one after the other while the pipeline goes to PAUSED.
+ */
+gboolean start_inference_engines(AppCtx *appCtx);
+////////////////
+/* End Custom */
+////////////////
+
 /**
  * Function to read properties from configuration file.
  *
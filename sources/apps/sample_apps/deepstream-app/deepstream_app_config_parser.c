@@ -36,6 +36,46 @@
 
 #define CONFIG_GROUP_SOURCE_SGIE_BATCH_SIZE "sgie-batch-size"
 
+/* Start Custom */
+#define CONFIG_GROUP_RECOGNITION_EVENT "recognition-event"
+#define CONFIG_GROUP_RECOGNITION_EVENT_API_URL "api-url"
+#define CONFIG_GROUP_RECOGNITION_EVENT_QUEUE_SIZE "queue-size"
+#define CONFIG_GROUP_RECOGNITION_EVENT_NUM_WORKERS "num-workers"
+#define CONFIG_GROUP_RECOGNITION_EVENT_MAX_CONNECTIONS "max-connections"
+#define CONFIG_GROUP_RECOGNITION_EVENT_TIMEOUT_MS "timeout-ms"
+#define CONFIG_GROUP_RECOGNITION_EVENT_DROP_POLICY "drop-policy"
+#define CONFIG_GROUP_RECOGNITION_EVENT_BATCH_MAX_EVENTS "batch-max-events"
+#define CONFIG_GROUP_RECOGNITION_EVENT_BATCH_MAX_KB "batch-max-kb"
+#define CONFIG_GROUP_RECOGNITION_EVENT_BATCH_LINGER_MS "batch-linger-ms"
+#define CONFIG_GROUP_RECOGNITION_EVENT_COMPRESSION "compression"
+#define CONFIG_GROUP_RECOGNITION_EVENT_SPOOL_DIR "spool-dir"
+#define CONFIG_GROUP_RECOGNITION_EVENT_SPOOL_SEGMENT_SIZE_KB "spool-segment-size-kb"
+#define CONFIG_GROUP_RECOGNITION_EVENT_SPOOL_SYNC_INTERVAL_MS "spool-sync-interval-ms"
+#define CONFIG_GROUP_RECOGNITION_EVENT_SPOOL_RETENTION_DAYS "spool-retention-days"
+#define CONFIG_GROUP_RECOGNITION_SNAPSHOT "recognition-snapshot"
+#define CONFIG_GROUP_RECOGNITION_SNAPSHOT_POLICY "policy"
+#define CONFIG_GROUP_RECOGNITION_SNAPSHOT_FACE_WIDTH "face-width"
+#define CONFIG_GROUP_RECOGNITION_SNAPSHOT_FACE_HEIGHT "face-height"
+#define CONFIG_GROUP_RECOGNITION_SNAPSHOT_FACE_MARGIN "face-margin"
+#define CONFIG_GROUP_RECOGNITION_SNAPSHOT_WIDTH "width"
+#define CONFIG_GROUP_RECOGNITION_SNAPSHOT_HEIGHT "height"
+#define CONFIG_GROUP_RECOGNITION_SNAPSHOT_JPEG_QUALITY "jpeg-quality"
+#define CONFIG_GROUP_RECOGNITION_SNAPSHOT_NUM_WORKERS "num-workers"
+#define CONFIG_GROUP_RECOGNITION_SNAPSHOT_POOL_SIZE "pool-size"
+#define CONFIG_GROUP_RECOGNITION_SNAPSHOT_GPU_ID "gpu-id"
+#define CONFIG_GROUP_RECOGNITION_IDENTITY "recognition-identity"
+#define CONFIG_GROUP_RECOGNITION_IDENTITY_LABELS_FILE "labels-file"
+#define CONFIG_GROUP_RECOGNITION_IDENTITY_GIE_ID "gie-id"
+#define CONFIG_GROUP_STUDENT_SYNC "student-sync"
+#define CONFIG_GROUP_STUDENT_SYNC_ENABLE "enable"
+#define CONFIG_GROUP_STUDENT_SYNC_SYNC_URL "sync-url"
+#define CONFIG_GROUP_STUDENT_SYNC_LAST_UPDATED_URL "last-updated-url"
+#define CONFIG_GROUP_STUDENT_SYNC_TOKEN "token"
+#define CONFIG_GROUP_STUDENT_SYNC_DB_FILE "db-file"
+#define CONFIG_GROUP_STUDENT_SYNC_TIMEOUT_MS "timeout-ms"
+#define CONFIG_GROUP_STUDENT_SYNC_FEATURE_DIM "feature-dim"
+/* End Custom */
+
 GST_DEBUG_CATEGORY_EXTERN(APP_CFG_PARSER_CAT);
 
 #define CHECK_ERROR(error)                                       \
@@ -222,6 +262,343 @@ done:
     return ret;
 }
 
+/* Start Custom */
+static gboolean parse_recognition_event(NvDsRecognitionEventConfig *config,
+                                        NvDsEventSpoolConfig *spool_config, GKeyFile *key_file)
+{
+    gboolean ret = FALSE;
+    gchar **keys = NULL;
+    gchar **key = NULL;
+    GError *error = NULL;
+
+    keys = g_key_file_get_keys(key_file, CONFIG_GROUP_RECOGNITION_EVENT, NULL, &error);
+    CHECK_ERROR(error);
+
+    for (key = keys; *key; key++) {
+        if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_EVENT_API_URL)) {
+            g_free(config->api_url);
+            config->api_url = g_key_file_get_string(key_file, CONFIG_GROUP_RECOGNITION_EVENT,
+                                                    CONFIG_GROUP_RECOGNITION_EVENT_API_URL, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_EVENT_QUEUE_SIZE)) {
+            config->queue_size = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_EVENT, CONFIG_GROUP_RECOGNITION_EVENT_QUEUE_SIZE,
+                &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_EVENT_NUM_WORKERS)) {
+            config->num_workers = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_EVENT,
+                CONFIG_GROUP_RECOGNITION_EVENT_NUM_WORKERS, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_EVENT_MAX_CONNECTIONS)) {
+            config->max_connections = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_EVENT,
+                CONFIG_GROUP_RECOGNITION_EVENT_MAX_CONNECTIONS, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_EVENT_TIMEOUT_MS)) {
+            config->timeout_ms = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_EVENT, CONFIG_GROUP_RECOGNITION_EVENT_TIMEOUT_MS,
+                &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_EVENT_DROP_POLICY)) {
+            gchar *policy = g_key_file_get_string(key_file, CONFIG_GROUP_RECOGNITION_EVENT,
+                                                  CONFIG_GROUP_RECOGNITION_EVENT_DROP_POLICY,
+                                                  &error);
+            CHECK_ERROR(error);
+            if (!g_strcmp0(policy, "newest")) {
+                config->drop_policy = EVENT_DROP_NEWEST;
+            } else if (!g_strcmp0(policy, "oldest")) {
+                config->drop_policy = EVENT_DROP_OLDEST;
+            } else {
+                NVGSTDS_ERR_MSG_V("Invalid drop-policy '%s', expected 'newest' or 'oldest'",
+                                  policy);
+                g_free(policy);
+                goto done;
+            }
+            g_free(policy);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_EVENT_BATCH_MAX_EVENTS)) {
+            config->batch_max_events = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_EVENT,
+                CONFIG_GROUP_RECOGNITION_EVENT_BATCH_MAX_EVENTS, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_EVENT_BATCH_MAX_KB)) {
+            config->batch_max_kb = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_EVENT,
+                CONFIG_GROUP_RECOGNITION_EVENT_BATCH_MAX_KB, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_EVENT_BATCH_LINGER_MS)) {
+            config->batch_linger_ms = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_EVENT,
+                CONFIG_GROUP_RECOGNITION_EVENT_BATCH_LINGER_MS, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_EVENT_COMPRESSION)) {
+            gchar *compression = g_key_file_get_string(
+                key_file, CONFIG_GROUP_RECOGNITION_EVENT,
+                CONFIG_GROUP_RECOGNITION_EVENT_COMPRESSION, &error);
+            CHECK_ERROR(error);
+            if (!g_strcmp0(compression, "none")) {
+                config->compression = EVENT_COMPRESSION_NONE;
+            } else if (!g_strcmp0(compression, "gzip")) {
+                config->compression = EVENT_COMPRESSION_GZIP;
+            } else {
+                NVGSTDS_ERR_MSG_V("Invalid compression '%s', expected 'none' or 'gzip'",
+                                  compression);
+                g_free(compression);
+                goto done;
+            }
+            g_free(compression);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_EVENT_SPOOL_DIR)) {
+            g_free(spool_config->dir);
+            spool_config->dir = g_key_file_get_string(
+                key_file, CONFIG_GROUP_RECOGNITION_EVENT, CONFIG_GROUP_RECOGNITION_EVENT_SPOOL_DIR,
+                &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_EVENT_SPOOL_SEGMENT_SIZE_KB)) {
+            spool_config->segment_size_kb = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_EVENT,
+                CONFIG_GROUP_RECOGNITION_EVENT_SPOOL_SEGMENT_SIZE_KB, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_EVENT_SPOOL_SYNC_INTERVAL_MS)) {
+            spool_config->sync_interval_ms = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_EVENT,
+                CONFIG_GROUP_RECOGNITION_EVENT_SPOOL_SYNC_INTERVAL_MS, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_EVENT_SPOOL_RETENTION_DAYS)) {
+            spool_config->retention_days = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_EVENT,
+                CONFIG_GROUP_RECOGNITION_EVENT_SPOOL_RETENTION_DAYS, &error);
+            CHECK_ERROR(error);
+        } else {
+            NVGSTDS_WARN_MSG_V("Unknown key '%s' for group [%s]", *key,
+                               CONFIG_GROUP_RECOGNITION_EVENT);
+        }
+    }
+
+    ret = TRUE;
+done:
+    if (error) {
+        g_error_free(error);
+    }
+    if (keys) {
+        g_strfreev(keys);
+    }
+    if (!ret) {
+        NVGSTDS_ERR_MSG_V("%s failed", __func__);
+    }
+    return ret;
+}
+
+static gboolean parse_recognition_snapshot(NvDsSnapshotConfig *config, GKeyFile *key_file)
+{
+    gboolean ret = FALSE;
+    gchar **keys = NULL;
+    gchar **key = NULL;
+    GError *error = NULL;
+
+    keys = g_key_file_get_keys(key_file, CONFIG_GROUP_RECOGNITION_SNAPSHOT, NULL, &error);
+    CHECK_ERROR(error);
+
+    for (key = keys; *key; key++) {
+        if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_SNAPSHOT_POLICY)) {
+            gchar *policy = g_key_file_get_string(key_file, CONFIG_GROUP_RECOGNITION_SNAPSHOT,
+                                                  CONFIG_GROUP_RECOGNITION_SNAPSHOT_POLICY,
+                                                  &error);
+            CHECK_ERROR(error);
+            if (!g_strcmp0(policy, "face")) {
+                config->policy = SNAPSHOT_POLICY_FACE;
+            } else if (!g_strcmp0(policy, "context")) {
+                config->policy = SNAPSHOT_POLICY_CONTEXT;
+            } else if (!g_strcmp0(policy, "both")) {
+                config->policy = SNAPSHOT_POLICY_BOTH;
+            } else {
+                NVGSTDS_ERR_MSG_V("Invalid policy '%s', expected 'face', 'context' or 'both'",
+                                  policy);
+                g_free(policy);
+                goto done;
+            }
+            g_free(policy);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_SNAPSHOT_FACE_WIDTH)) {
+            config->face_width = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_SNAPSHOT,
+                CONFIG_GROUP_RECOGNITION_SNAPSHOT_FACE_WIDTH, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_SNAPSHOT_FACE_HEIGHT)) {
+            config->face_height = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_SNAPSHOT,
+                CONFIG_GROUP_RECOGNITION_SNAPSHOT_FACE_HEIGHT, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_SNAPSHOT_FACE_MARGIN)) {
+            config->face_margin = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_SNAPSHOT,
+                CONFIG_GROUP_RECOGNITION_SNAPSHOT_FACE_MARGIN, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_SNAPSHOT_WIDTH)) {
+            config->width = g_key_file_get_integer(key_file, CONFIG_GROUP_RECOGNITION_SNAPSHOT,
+                                                   CONFIG_GROUP_RECOGNITION_SNAPSHOT_WIDTH, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_SNAPSHOT_HEIGHT)) {
+            config->height = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_SNAPSHOT,
+                CONFIG_GROUP_RECOGNITION_SNAPSHOT_HEIGHT, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_SNAPSHOT_JPEG_QUALITY)) {
+            config->jpeg_quality = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_SNAPSHOT,
+                CONFIG_GROUP_RECOGNITION_SNAPSHOT_JPEG_QUALITY, &error);
+            CHECK_ERROR(error);
+            if (config->jpeg_quality < 1 || config->jpeg_quality > 100) {
+                NVGSTDS_ERR_MSG_V("Invalid jpeg-quality %u, expected 1-100",
+                                  config->jpeg_quality);
+                goto done;
+            }
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_SNAPSHOT_NUM_WORKERS)) {
+            config->num_workers = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_SNAPSHOT,
+                CONFIG_GROUP_RECOGNITION_SNAPSHOT_NUM_WORKERS, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_SNAPSHOT_POOL_SIZE)) {
+            config->pool_size = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_SNAPSHOT,
+                CONFIG_GROUP_RECOGNITION_SNAPSHOT_POOL_SIZE, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_SNAPSHOT_GPU_ID)) {
+            config->gpu_id = g_key_file_get_integer(
+                key_file, CONFIG_GROUP_RECOGNITION_SNAPSHOT,
+                CONFIG_GROUP_RECOGNITION_SNAPSHOT_GPU_ID, &error);
+            CHECK_ERROR(error);
+        } else {
+            NVGSTDS_WARN_MSG_V("Unknown key '%s' for group [%s]", *key,
+                               CONFIG_GROUP_RECOGNITION_SNAPSHOT);
+        }
+    }
+
+    ret = TRUE;
+done:
+    if (error) {
+        g_error_free(error);
+    }
+    if (keys) {
+        g_strfreev(keys);
+    }
+    if (!ret) {
+        NVGSTDS_ERR_MSG_V("%s failed", __func__);
+    }
+    return ret;
+}
+
+static gboolean parse_recognition_identity(NvDsIdentityConfig *config, GKeyFile *key_file,
+                                           gchar *cfg_file_path)
+{
+    gboolean ret = FALSE;
+    gchar **keys = NULL;
+    gchar **key = NULL;
+    GError *error = NULL;
+
+    keys = g_key_file_get_keys(key_file, CONFIG_GROUP_RECOGNITION_IDENTITY, NULL, &error);
+    CHECK_ERROR(error);
+
+    for (key = keys; *key; key++) {
+        if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_IDENTITY_LABELS_FILE)) {
+            gchar *str = g_key_file_get_string(key_file, CONFIG_GROUP_RECOGNITION_IDENTITY,
+                                               CONFIG_GROUP_RECOGNITION_IDENTITY_LABELS_FILE,
+                                               &error);
+            CHECK_ERROR(error);
+            g_free(config->labels_file);
+            config->labels_file = get_absolute_file_path(cfg_file_path, str);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_RECOGNITION_IDENTITY_GIE_ID)) {
+            config->gie_id = g_key_file_get_integer(key_file, CONFIG_GROUP_RECOGNITION_IDENTITY,
+                                                    CONFIG_GROUP_RECOGNITION_IDENTITY_GIE_ID,
+                                                    &error);
+            CHECK_ERROR(error);
+        } else {
+            NVGSTDS_WARN_MSG_V("Unknown key '%s' for group [%s]", *key,
+                               CONFIG_GROUP_RECOGNITION_IDENTITY);
+        }
+    }
+
+    ret = TRUE;
+done:
+    if (error) {
+        g_error_free(error);
+    }
+    if (keys) {
+        g_strfreev(keys);
+    }
+    if (!ret) {
+        NVGSTDS_ERR_MSG_V("%s failed", __func__);
+    }
+    return ret;
+}
+
+static gboolean parse_student_sync(NvDsStudentSyncConfig *config, GKeyFile *key_file,
+                                   gchar *cfg_file_path)
+{
+    gboolean ret = FALSE;
+    gchar **keys = NULL;
+    gchar **key = NULL;
+    GError *error = NULL;
+
+    keys = g_key_file_get_keys(key_file, CONFIG_GROUP_STUDENT_SYNC, NULL, &error);
+    CHECK_ERROR(error);
+
+    for (key = keys; *key; key++) {
+        if (!g_strcmp0(*key, CONFIG_GROUP_STUDENT_SYNC_ENABLE)) {
+            config->disabled = !g_key_file_get_boolean(key_file, CONFIG_GROUP_STUDENT_SYNC,
+                                                       CONFIG_GROUP_STUDENT_SYNC_ENABLE, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_STUDENT_SYNC_SYNC_URL)) {
+            g_free(config->sync_url);
+            config->sync_url = g_key_file_get_string(key_file, CONFIG_GROUP_STUDENT_SYNC,
+                                                     CONFIG_GROUP_STUDENT_SYNC_SYNC_URL, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_STUDENT_SYNC_LAST_UPDATED_URL)) {
+            g_free(config->last_updated_url);
+            config->last_updated_url = g_key_file_get_string(
+                key_file, CONFIG_GROUP_STUDENT_SYNC, CONFIG_GROUP_STUDENT_SYNC_LAST_UPDATED_URL,
+                &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_STUDENT_SYNC_TOKEN)) {
+            g_free(config->token);
+            config->token = g_key_file_get_string(key_file, CONFIG_GROUP_STUDENT_SYNC,
+                                                  CONFIG_GROUP_STUDENT_SYNC_TOKEN, &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_STUDENT_SYNC_DB_FILE)) {
+            gchar *str = g_key_file_get_string(key_file, CONFIG_GROUP_STUDENT_SYNC,
+                                               CONFIG_GROUP_STUDENT_SYNC_DB_FILE, &error);
+            CHECK_ERROR(error);
+            g_free(config->db_file);
+            config->db_file = get_absolute_file_path(cfg_file_path, str);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_STUDENT_SYNC_TIMEOUT_MS)) {
+            config->timeout_ms = g_key_file_get_integer(key_file, CONFIG_GROUP_STUDENT_SYNC,
+                                                        CONFIG_GROUP_STUDENT_SYNC_TIMEOUT_MS,
+                                                        &error);
+            CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_STUDENT_SYNC_FEATURE_DIM)) {
+            config->feature_dim = g_key_file_get_integer(key_file, CONFIG_GROUP_STUDENT_SYNC,
+                                                         CONFIG_GROUP_STUDENT_SYNC_FEATURE_DIM,
+                                                         &error);
+            CHECK_ERROR(error);
+        } else {
+            NVGSTDS_WARN_MSG_V("Unknown key '%s' for group [%s]", *key,
+                               CONFIG_GROUP_STUDENT_SYNC);
+        }
+    }
+
+    ret = TRUE;
+done:
+    if (error) {
+        g_error_free(error);
+    }
+    if (keys) {
+        g_strfreev(keys);
+    }
+    if (!ret) {
+        NVGSTDS_ERR_MSG_V("%s failed", __func__);
+    }
+    return ret;
+}
+/* End Custom */
+
 static gboolean parse_app(NvDsConfig *config, GKeyFile *key_file, gchar *cfg_file_path)
 {
     gboolean ret = FALSE;
@@ -466,6 +843,22 @@ gboolean parse_config_file(NvDsConfig *config, gchar *cfg_file_path)
         if (!g_strcmp0(*group, CONFIG_GROUP_DSPOSTPROCESSING)) {
             parse_err = !parse_dspostprocessing(&config->dspostprocessing_config, cfg_file);
         }
+
+        if (!g_strcmp0(*group, CONFIG_GROUP_RECOGNITION_EVENT)) {
+            parse_err = !parse_recognition_event(&config->recognition_event_config,
+                                                 &config->event_spool_config, cfg_file);
+        }
+        if (!g_strcmp0(*group, CONFIG_GROUP_RECOGNITION_SNAPSHOT)) {
+            parse_err = !parse_recognition_snapshot(&config->snapshot_config, cfg_file);
+        }
+        if (!g_strcmp0(*group, CONFIG_GROUP_RECOGNITION_IDENTITY)) {
+            parse_err = !parse_recognition_identity(&config->identity_config, cfg_file,
+                                                    cfg_file_path);
+        }
+        if (!g_strcmp0(*group, CONFIG_GROUP_STUDENT_SYNC)) {
+            parse_err = !parse_student_sync(&config->student_sync_config, cfg_file,
+                                            cfg_file_path);
+        }
         ////////////////
         /* End Custom */
         ////////////////
@@ -25,7 +25,7 @@
 /////////////////
 /* Start Custom */
 /////////////////
-#include <json-glib/json-glib.h>
+#include <limits.h>
 #include <math.h>
 #include <stdlib.h>
 ////////////////
@@ -40,11 +40,12 @@
 /////////////////
 /* Start Custom */
 /////////////////
+#include "custom_msg_meta.h"
 #include "image_meta_consumer.h"
 #include "nvbufsurface.h"
-#include "nvds_obj_encode.h"
 #include "nvdsmeta.h"
 #include "nvdsmeta_schema.h"
+#include "startup_plan.h"
 ////////////////
 /* End Custom */
 ////////////////
@@ -57,15 +58,20 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <vector>
 #include "deepstream_app.h"
 
 // Thread đồng bộ database 2 lần/ngày
-// Synchronize database immediately on app start, then continue as before
+// Đồng bộ ngay khi khởi động app, sau đó 2 lần/ngày vào giờ ngẫu nhiên.
+// Chỉ tải các thay đổi kể từ lần đồng bộ trước và cập nhật thẳng vào gallery
+// đang chạy (student_sync.h), không gọi script Python.
 void* sync_student_db_thread(void* arg) {
+    StudentSync *sync = static_cast<StudentSync *>(arg);
+
     // Sync once at startup
     printf("Đang đồng bộ database học sinh lần đầu khi khởi động app...\n");
-    system("python3 ./scripts/create_db_fr_server.py");
-    sleep(60); // Wait 1 minute to avoid duplicate syncs
+    student_sync_run(sync);
+    time_t last_sync = time(NULL);
 
     while (1) {
         time_t now = time(NULL);
@@ -81,21 +87,33 @@ void* sync_student_db_thread(void* arg) {
         int hour = tm_now->tm_hour;
         int minute = tm_now->tm_min;
 
-        if ((hour == rand_hour && minute == rand_minute) ||
-            (hour == (rand_hour + 12) % 24 && minute == rand_minute)) {
+        // Cách lần trước ít nhất 1 phút để không đồng bộ 2 lần trong cùng phút
+        if (((hour == rand_hour && minute == rand_minute) ||
+             (hour == (rand_hour + 12) % 24 && minute == rand_minute)) &&
+            now - last_sync >= 60) {
             printf("Đang đồng bộ database học sinh...\n");
-            system("python3 ./scripts/create_db_fr_server.py");
-            sleep(60);
+            student_sync_run(sync);
+            last_sync = now;
+        } else if (student_sync_gallery_pending(sync)) {
+            // Gallery chưa được nạp (pipeline đang khởi tạo): đẩy thay đổi khi có
+            student_sync_push_gallery(sync);
         }
 
         sleep(10);
     }
     return NULL;
 }
-// Gọi hàm này ở đầu hàm main để khởi động thread nền
-void start_student_db_sync_thread() {
+// Gọi hàm này sau khi đọc file config để khởi động thread nền
+void start_student_db_sync_thread(const NvDsStudentSyncConfig *config) {
+    if (config->disabled)
+        return;
+    StudentSync *sync = student_sync_new(config);
+    if (!sync) {
+        printf("Không mở được database học sinh, bỏ qua đồng bộ\n");
+        return;
+    }
     pthread_t tid;
-    pthread_create(&tid, NULL, sync_student_db_thread, NULL);
+    pthread_create(&tid, NULL, sync_student_db_thread, sync);
     pthread_detach(tid);
 }
 
@@ -209,129 +227,40 @@ static void all_bbox_generated(AppCtx *appCtx,
 /////////////////
 /* Start Custom */
 /////////////////
-/// Will save an image cropped with the dimension specified by obj_meta
-/// If the path is too long, the save will not occur and an error message will
-/// be diplayed.
-/// @param [in] path Where the image will be saved. If no path are specified
-/// a generic one is filled. The save will be where the program was launched.
-/// @param [in] ctx Object containing the saving process which is launched
-/// asynchronously.
-/// @param [in] ip_surf Object containing the image to save.
-/// @param [in] obj_meta Object containing information about the area to crop
-/// in the full image.
-/// @param [in] frame_meta Object containing information about the current
-/// frame.
-/// @param [in, out] obj_counter Unsigned integer counting the number of objects
-/// saved.
-/// @return true if the image was saved false otherwise.
-static bool save_image(const std::string &path,
-                       NvBufSurface *ip_surf,
-                       NvDsObjectMeta *obj_meta,
-                       NvDsFrameMeta *frame_meta,
-                       unsigned &obj_counter)
-{
-
-    if (!ip_surf) {
-        std::cerr << "[ERROR] ip_surf is NULL\n";
-        return false;
+/// Buffers of the probe reused from frame to frame, one set per streaming
+/// thread, so that building the images of a frame does not allocate.
+struct FrameSaveArena {
+    /// Crops to save, in the order of their paths
+    std::vector<NvDsObjectMeta *> cropped_objs;
+    /// NUL-terminated paths of the images, the full frame (if any) comes last
+    std::vector<char> paths;
+    std::vector<size_t> path_offsets;
+    std::vector<ImageSaveRequest> requests;
+
+    void clear()
+    {
+        cropped_objs.clear();
+        paths.clear();
+        path_offsets.clear();
+        requests.clear();
     }
-    if (!obj_meta) {
-        std::cerr << "[ERROR] obj_meta is NULL\n";
-        return false;
-    }
-
-    NvDsObjEncUsrArgs userData = {0};
-    if (path.size() >= sizeof(userData.fileNameImg)) {
-        std::cerr << "[ERROR] Folder path too long (path: " << path << ", size: " << path.size()
-                  << ") could not save image.\n"
-                  << "Should be less than " << sizeof(userData.fileNameImg) << " characters.\n";
-        return false;
-    }
-    userData.saveImg = TRUE;
-    userData.attachUsrMeta = FALSE;
-    path.copy(userData.fileNameImg, path.size());
-    userData.fileNameImg[path.size()] = '\0';
-    userData.objNum = obj_counter++;
-    userData.quality = g_img_meta_consumer.get_quality();
-
-
-    g_img_meta_consumer.init_image_save_library_on_first_time();
-    nvds_obj_enc_process(g_img_meta_consumer.get_obj_ctx_handle(), &userData, ip_surf, obj_meta,
-                         frame_meta);
-    return true;
-}
-
-
-gpointer meta_copy_func(gpointer data, gpointer user_data)
-{
-    NvDsUserMeta *user_meta = (NvDsUserMeta *)data;
-    NvDsCustomMsgInfo *srcMeta = (NvDsCustomMsgInfo *)user_meta->user_meta_data;
-    NvDsCustomMsgInfo *dstMeta = NULL;
-
-    dstMeta = (NvDsCustomMsgInfo *)g_memdup((gpointer)srcMeta, sizeof(NvDsCustomMsgInfo));
-    dstMeta->message = (gpointer)g_memdup(srcMeta->message, srcMeta->size);
-    return dstMeta;
-}
-
-void meta_free_func(gpointer data, gpointer user_data)
-{
-    NvDsUserMeta *user_meta = (NvDsUserMeta *)data;
-    NvDsCustomMsgInfo *srcMeta = (NvDsCustomMsgInfo *)user_meta->user_meta_data;
-    g_free(srcMeta->message);
-    srcMeta->size = 0;
-    srcMeta->message = NULL;
-
-    g_free(user_meta->user_meta_data);
-    user_meta->user_meta_data = NULL;
-}
 
-gchar *generate_msg_meta_frame(gchar *uri,
-                               gulong frame_number,
-                               guint drop_frame_interval,
-                               std::string frameFilePath)
-{
-    JsonNode *rootNode;
-    JsonObject *rootObj;
-    gchar *message = NULL;
-    rootObj = json_object_new();
-
-    gchar *custom_msg = g_strdup(uri);
-
-    json_object_set_string_member(rootObj, "uri", custom_msg);
-    json_object_set_int_member(
-        rootObj, "frame_number",
-        (int)round((drop_frame_interval > 0) ? frame_number * drop_frame_interval : frame_number));
-
-    if (!frameFilePath.empty()) {
-        json_object_set_string_member(rootObj, "filePath", frameFilePath.c_str());
+    /// Formats the path of a new image of the source, false if it does not fit.
+    bool add_path(ImageMetaConsumer::ImageSizeType ist, unsigned source_id)
+    {
+        char buf[PATH_MAX];
+        size_t len = g_img_meta_consumer.make_img_path(buf, sizeof(buf), ist, source_id);
+        if (len == 0)
+            return false;
+        path_offsets.push_back(paths.size());
+        paths.insert(paths.end(), buf, buf + len + 1);
+        return true;
     }
 
-    rootNode = json_node_new(JSON_NODE_OBJECT);
-    json_node_set_object(rootNode, rootObj);
-    message = json_to_string(rootNode, TRUE);
-    json_node_free(rootNode);
-    json_object_unref(rootObj);
-
-    return message;
-}
-
-gchar *generate_msg_meta_object(std::string objectFilePath)
-{
-    JsonNode *rootNode;
-    JsonObject *rootObj;
-    gchar *message = NULL;
-    rootObj = json_object_new();
-
-    json_object_set_string_member(rootObj, "filePath", objectFilePath.c_str());
-
-    rootNode = json_node_new(JSON_NODE_OBJECT);
-    json_node_set_object(rootNode, rootObj);
-    message = json_to_string(rootNode, TRUE);
-    json_node_free(rootNode);
-    json_object_unref(rootObj);
+    const char *path(size_t i) const { return &paths[path_offsets[i]]; }
+};
 
-    return message;
-}
+static thread_local FrameSaveArena frame_save_arena;
 
 static void display_bad_confidence(float confidence)
 {
@@ -380,33 +309,23 @@ static void bbox_generated_probe_after_analytics(AppCtx *appCtx,
     NvBufSurface *ip_surf = (NvBufSurface *)inmap.data;
     gst_buffer_unmap(buf, &inmap);
 
-    guint32 stream_id = 0;
-
-    bool at_least_one_image_saved = false;
-
-    std::string frameFilePath;
+    FrameSaveArena &arena = frame_save_arena;
 
     for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
          l_frame = l_frame->next) {
         NvDsFrameMeta *frame_meta = static_cast<NvDsFrameMeta *>(l_frame->data);
-        stream_id = frame_meta->source_id;
+        guint32 stream_id = frame_meta->source_id;
+        const char *frame_file_path = NULL;
 
         if (!g_img_meta_consumer.get_is_stopped()) {
             unsigned source_number = frame_meta->pad_index;
 
-            if (!g_img_meta_consumer.should_save_data(source_number))
+            ImageMetaConsumer::SaveClaim save_claim;
+            if (!g_img_meta_consumer.claim_save_slot(source_number, save_claim))
                 continue;
 
-            /// required for `get_save_full_frame_enabled()`
-            std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-            std::ostringstream oss;
-            oss << std::put_time(std::localtime(&t), "%FT%T%z");
-            std::string image_full_frame_path_saved_ = g_img_meta_consumer.make_img_path(
-                ImageMetaConsumer::FULL_FRAME, frame_meta->pad_index, oss.str());
-
-            bool at_least_one_metadata_saved = false;
-            bool full_frame_written = false;
-            unsigned obj_counter = 0;
+            bool full_frame_requested = false;
+            arena.clear();
 
             bool at_least_one_confidence_is_within_range = false;
             /// first loop to check if it is usefull to save metadata for the current
@@ -430,98 +349,54 @@ static void bbox_generated_probe_after_analytics(AppCtx *appCtx,
                         !obj_meta_box_is_above_minimum_dimension(obj_meta))
                         continue;
 
-                    std::time_t t =
-                        std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-                    std::ostringstream oss;
-                    oss << std::put_time(std::localtime(&t), "%FT%T%z");
-
-                    std::string image_cropped_obj_path_saved = g_img_meta_consumer.make_img_path(
-                        ImageMetaConsumer::CROPPED_TO_OBJECT, frame_meta->pad_index, oss.str());
-
                     /// Save a cropped image if the option was enabled
                     // TODO: Filter by class
-                    if (g_img_meta_consumer.get_save_cropped_images_enabled()) {
-                        at_least_one_image_saved |=
-                            save_image(image_cropped_obj_path_saved, ip_surf, obj_meta, frame_meta,
-                                       obj_counter);
-
-                        // Add path into object metadata
-                        gchar *custom_msg = generate_msg_meta_object(image_cropped_obj_path_saved);
+                    if (g_img_meta_consumer.get_save_cropped_images_enabled() &&
+                        arena.add_path(ImageMetaConsumer::CROPPED_TO_OBJECT, source_number))
+                        arena.cropped_objs.push_back(obj_meta);
 
-                        NvDsCustomMsgInfo *custom_msg_info =
-                            (NvDsCustomMsgInfo *)g_malloc0(sizeof(NvDsCustomMsgInfo));
-
-                        custom_msg_info->message = (void *)custom_msg;
-                        custom_msg_info->size = strlen(custom_msg);
-
-                        NvDsUserMeta *user_meta = nvds_acquire_user_meta_from_pool(batch_meta);
-
-                        if (user_meta) {
-                            user_meta->user_meta_data = (void *)custom_msg_info;
-                            user_meta->base_meta.meta_type = NVDS_CUSTOM_MSG_BLOB;
-                            user_meta->base_meta.copy_func = (NvDsMetaCopyFunc)meta_copy_func;
-                            user_meta->base_meta.release_func = (NvDsMetaReleaseFunc)meta_free_func;
-                            nvds_add_user_meta_to_obj(obj_meta, user_meta);
-                        } else {
-                            g_print("Error in attaching event meta to buffer\n");
-                        }
-                    }
-
-                    if (!full_frame_written && g_img_meta_consumer.get_save_full_frame_enabled()) {
-                        unsigned dummy_counter = 0;
-                        /// Creating a special object meta in order to save a full frame
-                        NvDsObjectMeta dummy_obj_meta;
-                        dummy_obj_meta.rect_params.width =
-                            ip_surf->surfaceList[frame_meta->batch_id].width;
-                        dummy_obj_meta.rect_params.height =
-                            ip_surf->surfaceList[frame_meta->batch_id].height;
-                        dummy_obj_meta.rect_params.top = 0;
-                        dummy_obj_meta.rect_params.left = 0;
-                        at_least_one_image_saved |=
-                            save_image(image_full_frame_path_saved_, ip_surf, &dummy_obj_meta,
-                                       frame_meta, dummy_counter);
-                        full_frame_written = true;
-
-                        frameFilePath = image_full_frame_path_saved_;
-                    }
-                    at_least_one_metadata_saved |= true;
+                    if (g_img_meta_consumer.get_save_full_frame_enabled())
+                        full_frame_requested = true;
                 }
             }
-            /// Send information contained in the producer and empty it.
-            if (at_least_one_metadata_saved) {
-                g_img_meta_consumer.data_was_saved_for_source(source_number);
+            if (full_frame_requested &&
+                !arena.add_path(ImageMetaConsumer::FULL_FRAME, source_number))
+                full_frame_requested = false;
+
+            /// Only queued here: encoding and writing happen on the image saver threads, so
+            /// the buffer is not held until the files are on disk.
+            for (size_t i = 0; i < arena.path_offsets.size(); i++) {
+                ImageSaveRequest request;
+                request.rect =
+                    i < arena.cropped_objs.size() ? &arena.cropped_objs[i]->rect_params : NULL;
+                request.path = arena.path(i);
+                arena.requests.push_back(request);
+            }
+            bool images_queued =
+                !arena.requests.empty() &&
+                g_img_meta_consumer.save_images(ip_surf, frame_meta->batch_id,
+                                                arena.requests.data(), arena.requests.size());
+            if (images_queued) {
+                // Add path into object metadata
+                for (size_t i = 0; i < arena.cropped_objs.size(); i++)
+                    custom_msg_meta_attach_to_object(batch_meta, arena.cropped_objs[i],
+                                                     arena.path(i));
+                if (full_frame_requested)
+                    frame_file_path = arena.path(arena.path_offsets.size() - 1);
+            } else {
+                /// Nothing saved: let the next frame of this source try again
+                g_img_meta_consumer.release_save_slot(save_claim);
             }
         }
 
         // Add custom message to frame metadata
-        gchar *custom_msg = generate_msg_meta_frame(
-            appCtx->config.multi_source_config[stream_id].uri, frame_meta->frame_num,
-            appCtx->config.multi_source_config[stream_id].drop_frame_interval, frameFilePath);
-
-        NvDsCustomMsgInfo *custom_msg_info =
-            (NvDsCustomMsgInfo *)g_malloc0(sizeof(NvDsCustomMsgInfo));
-
-        custom_msg_info->message = (void *)custom_msg;
-        custom_msg_info->size = strlen(custom_msg);
-
-        NvDsUserMeta *user_meta = nvds_acquire_user_meta_from_pool(batch_meta);
-
-        if (user_meta) {
-            user_meta->user_meta_data = (void *)custom_msg_info;
-            user_meta->base_meta.meta_type = NVDS_CUSTOM_MSG_BLOB;
-            user_meta->base_meta.copy_func = (NvDsMetaCopyFunc)meta_copy_func;
-            user_meta->base_meta.release_func = (NvDsMetaReleaseFunc)meta_free_func;
-            nvds_add_user_meta_to_frame(frame_meta, user_meta);
-        } else {
-            g_print("Error in attaching event meta to buffer\n");
-        }
-    }
-
-    if (!g_img_meta_consumer.get_is_stopped()) {
-        /// Wait for all the thread writing jpg files to be finished. (joining a
-        /// thread list)
-        if (at_least_one_image_saved)
-            nvds_obj_enc_finish(g_img_meta_consumer.get_obj_ctx_handle());
+        NvDsSourceConfig *source_config = &appCtx->config.multi_source_config[stream_id];
+        guint drop_frame_interval = source_config->drop_frame_interval;
+        custom_msg_meta_attach_to_frame(
+            batch_meta, frame_meta, source_config->uri,
+            drop_frame_interval > 0 ? (gint64)frame_meta->frame_num * drop_frame_interval
+                                    : frame_meta->frame_num,
+            frame_file_path);
     }
 }
 
@@ -932,6 +807,58 @@ static gboolean overlay_graphics(AppCtx *appCtx,
     return TRUE;
 }
 
+/////////////////
+/* Start Custom */
+/////////////////
+static gboolean create_pipeline_task(gpointer data)
+{
+    return create_pipeline((AppCtx *)data, bbox_generated_probe_after_analytics,
+                           all_bbox_generated, perf_cb, overlay_graphics);
+}
+
+static gboolean start_engines_task(gpointer data)
+{
+    return start_inference_engines((AppCtx *)data);
+}
+
+static gboolean start_logging_task(gpointer data)
+{
+    initialize_logging_system((AppCtx *)data);
+    return TRUE;
+}
+
+/**
+ * Creates the pipelines of @ctx[0..@num) and brings them to READY with their
+ * inference engines loaded, concurrently with the logging system setup.
+ * Pipelines are created one after another, but the engines of one load while
+ * the next is being built.
+ */
+static gboolean start_instances(AppCtx **ctx, guint num)
+{
+    StartupPlan *plan = startup_plan_new("Startup");
+    gchar pipeline[32] = "";
+    gchar previous[32];
+    gchar engines[32];
+    gboolean ok;
+
+    startup_plan_add(plan, "logging", start_logging_task, ctx[0], NULL);
+    for (guint i = 0; i < num; i++) {
+        g_strlcpy(previous, pipeline, sizeof(previous));
+        g_snprintf(pipeline, sizeof(pipeline), "pipeline-%u", i);
+        g_snprintf(engines, sizeof(engines), "engines-%u", i);
+        startup_plan_add(plan, pipeline, create_pipeline_task, ctx[i], i ? previous : NULL, NULL);
+        startup_plan_add(plan, engines, start_engines_task, ctx[i], pipeline, NULL);
+    }
+    ok = startup_plan_run(plan);
+    startup_plan_free(plan);
+
+    g_print("Pipeline ready %.1f s after process start\n", startup_process_age());
+    return ok;
+}
+////////////////
+/* End Custom */
+////////////////
+
 static gboolean recreate_pipeline_thread_func(gpointer arg)
 {
     guint i;
@@ -946,8 +873,7 @@ static gboolean recreate_pipeline_thread_func(gpointer arg)
     /////////////////
     /* Start Custom */
     /////////////////
-    if (!create_pipeline(appCtx, bbox_generated_probe_after_analytics, all_bbox_generated, perf_cb,
-                         overlay_graphics)) {
+    if (!start_instances(&appCtx, 1)) {
         NVGSTDS_ERR_MSG_V("Failed to create pipeline");
         return_value = -1;
         return FALSE;
@@ -987,7 +913,6 @@ static gboolean recreate_pipeline_thread_func(gpointer arg)
 
 int main(int argc, char *argv[])
 {
-    start_student_db_sync_thread();
     system("python3 ./scripts/rtmp_url_config_change.py ./samples/configs/deepstream_app.txt");
     // --------------------------------------------
     g_print("Callback function assigned successfully\n");
@@ -1069,18 +994,13 @@ int main(int argc, char *argv[])
         /////////////////
         /* Start Custom */
         /////////////////
-        for (i = 0; i < num_instances; i++) {
-            if (!create_pipeline(appCtx[i], bbox_generated_probe_after_analytics,
-                                 all_bbox_generated, perf_cb, overlay_graphics)) {
-                NVGSTDS_ERR_MSG_V("Failed to create pipeline");
-                return_value = -1;
-                should_goto_done = true;
-                break;
-            }
-        }
+        start_student_db_sync_thread(&appCtx[0]->config.student_sync_config);
 
-        if (should_goto_done)
+        if (!start_instances(appCtx, num_instances)) {
+            NVGSTDS_ERR_MSG_V("Failed to create pipeline");
+            return_value = -1;
             break;
+        }
 
         NvDsImageSave nvds_imgsave = appCtx[0]->config.image_save_config;
         if (nvds_imgsave.enable) {
@@ -1097,12 +1017,24 @@ int main(int argc, char *argv[])
                 can_start = false;
             }
             if (can_start) {
+                ImageSaverConfig saver_config = {};
+                saver_config.policy = nvds_imgsave.drop_oldest ? IMAGE_SAVE_POLICY_DROP_OLDEST
+                                                               : IMAGE_SAVE_POLICY_SKIP;
+                saver_config.queue_depth = nvds_imgsave.queue_depth;
+                saver_config.max_pending_mb = nvds_imgsave.max_pending_mb;
+                saver_config.num_workers = nvds_imgsave.num_workers;
+                saver_config.direct_io = nvds_imgsave.direct_io;
+                saver_config.jpeg_quality = nvds_imgsave.quality;
+                /// Frames reach the probe at the muxer resolution
+                saver_config.width = appCtx[0]->config.streammux_config.pipeline_width;
+                saver_config.height = appCtx[0]->config.streammux_config.pipeline_height;
+                saver_config.gpu_id = appCtx[0]->config.streammux_config.gpu_id;
                 g_img_meta_consumer.init(
                     nvds_imgsave.output_folder_path, nvds_imgsave.frame_to_skip_rules_path,
                     nvds_imgsave.min_confidence, nvds_imgsave.max_confidence,
                     nvds_imgsave.min_box_width, nvds_imgsave.min_box_height,
                     nvds_imgsave.save_image_full_frame, nvds_imgsave.save_image_cropped_object,
-                    nvds_imgsave.second_to_skip_interval, nvds_imgsave.quality, MAX_SOURCE_BINS);
+                    nvds_imgsave.second_to_skip_interval, MAX_SOURCE_BINS, saver_config);
             }
             if (g_img_meta_consumer.get_is_stopped()) {
                 std::cerr << "Consumer could not be started => exiting...\n\n";
@@ -1263,6 +1195,15 @@ int main(int argc, char *argv[])
         g_free(appCtx[i]);
     }
 
+    /////////////////
+    /* Start Custom */
+    /////////////////
+    /// The pipelines are gone: write the images still queued and stop the saver threads
+    g_img_meta_consumer.stop();
+    ////////////////
+    /* End Custom */
+    ////////////////
+
     g_mutex_lock(&disp_lock);
     if (display)
         XCloseDisplay(display);
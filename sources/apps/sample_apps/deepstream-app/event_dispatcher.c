@@ -0,0 +1,886 @@
+/*
+ * Asynchronous delivery of recognition events, see event_dispatcher.h.
+ *
+ * Queue: bounded array of sequence-numbered cells (Vyukov). Producers and
+ * workers claim slots with a single CAS each, nothing ever sleeps on it.
+ *
+ * Workers: every worker owns a CURLM and up to max_connections easy
+ * handles. Handles are never destroyed between requests, so libcurl keeps
+ * the connection to the API open and reuses it. Idle workers sleep in
+ * curl_multi_wait() on their transfers plus a wake pipe the producers write
+ * to, so a new event is picked up immediately without polling.
+ *
+ * Batching: a worker takes a free transfer as its open batch and serializes
+ * events straight into its body as they are popped. The batch is closed
+ * (and compressed) when full or when its linger time is up; the worker's
+ * curl_multi_wait() timeout is cut to that deadline.
+ *
+ * Serialization: the event schema is fixed, so it is written directly into
+ * the transfer body without a JSON DOM (json_writer.h). Strings are copied
+ * in whole runs between escapes, which makes the (escape-free) base64
+ * images cost one memcpy each. The body is handed to curl in place.
+ *
+ * Drops: the queue fills up when the API is down, and the failed callback
+ * (the spool in the application) does disk I/O. Dropped events are therefore
+ * handed to a dispatcher thread that runs the callback, so enqueueing never
+ * waits on it.
+ */
+
+#include "event_dispatcher.h"
+
+#include <curl/curl.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <json-glib/json-glib.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "json_writer.h"
+
+#define DEFAULT_QUEUE_SIZE 256
+#define DEFAULT_NUM_WORKERS 2
+#define DEFAULT_MAX_CONNECTIONS 4
+#define DEFAULT_TIMEOUT_MS 10000
+#define MAX_NUM_WORKERS 16
+#define MAX_CONNECTIONS 64
+#define DEFAULT_BATCH_MAX_EVENTS 1
+#define DEFAULT_BATCH_MAX_KB 1024
+#define MAX_BATCH_EVENTS 1000
+
+/* Bodies smaller than this are not worth compressing. */
+#define GZIP_MIN_BYTES 1024
+/* Base64 JPEG barely compresses further; spend as little CPU as possible. */
+#define GZIP_LEVEL Z_BEST_SPEED
+/* Only per-item results are read from responses; bound what is kept. */
+#define MAX_RESPONSE_BYTES (256 * 1024)
+
+/* Upper bound of a curl_multi_wait() sleep, only matters if a wakeup is lost. */
+#define WORKER_IDLE_WAIT_MS 1000
+
+#define CACHE_LINE_SIZE 64
+
+typedef struct {
+    atomic_size_t sequence;
+    RecognitionEvent *event;
+} EventQueueCell;
+
+typedef struct {
+    EventQueueCell *cells;
+    size_t mask;
+    char pad0[CACHE_LINE_SIZE];
+    atomic_size_t enqueue_pos;
+    char pad1[CACHE_LINE_SIZE];
+    atomic_size_t dequeue_pos;
+    char pad2[CACHE_LINE_SIZE];
+} EventQueue;
+
+typedef struct _EventWorker EventWorker;
+
+typedef struct {
+    CURL *easy;
+    /* Events of the request, capacity batch_max_events. */
+    RecognitionEvent **events;
+    guint num_events;
+    /* JSON body, and its gzip'ed form when compressed. Both reused. */
+    GString *body;
+    GByteArray *gz_body;
+    GString *response;
+} EventTransfer;
+
+struct _EventWorker {
+    EventDispatcher *dispatcher;
+    GThread *thread;
+    CURLM *multi;
+    EventTransfer *transfers;
+    /* Indices into transfers[] that are not in use. */
+    guint *free_slots;
+    guint num_free;
+    guint in_flight;
+    /* Transfer being filled, not yet handed to curl. */
+    EventTransfer *batch;
+    gint64 batch_deadline;
+    int wake_fds[2];
+    atomic_int sleeping;
+};
+
+struct _EventDispatcher {
+    EventQueue queue;
+    EventWorker *workers;
+    guint num_workers;
+    guint max_connections;
+    guint timeout_ms;
+    EventDropPolicy drop_policy;
+    guint batch_max_events;
+    gsize batch_max_bytes;
+    gint64 batch_linger_us;
+    EventCompression compression;
+    gchar *api_url;
+    struct curl_slist *headers;
+    struct curl_slist *gzip_headers;
+
+    EventFailedCallback failed_cb;
+    EventDeliveredCallback delivered_cb;
+    gpointer user_data;
+
+    /* Dropped events waiting for failed_cb on drop_thread. */
+    GAsyncQueue *drops;
+    GThread *drop_thread;
+    guint64 drops_reported;
+
+    atomic_int stop;
+    atomic_uint next_worker;
+    atomic_uint_fast64_t enqueued;
+    atomic_uint_fast64_t dropped;
+    atomic_uint_fast64_t delivered;
+    atomic_uint_fast64_t failed;
+    atomic_uint_fast64_t requests;
+    atomic_uint_fast64_t bytes_sent;
+};
+
+static gboolean
+event_queue_init(EventQueue *queue, guint size)
+{
+    size_t capacity = 2;
+    while (capacity < size)
+        capacity <<= 1;
+
+    queue->cells = (EventQueueCell *)calloc(capacity, sizeof(EventQueueCell));
+    if (!queue->cells)
+        return FALSE;
+    for (size_t i = 0; i < capacity; i++)
+        atomic_init(&queue->cells[i].sequence, i);
+    queue->mask = capacity - 1;
+    atomic_init(&queue->enqueue_pos, 0);
+    atomic_init(&queue->dequeue_pos, 0);
+    return TRUE;
+}
+
+static gboolean
+event_queue_push(EventQueue *queue, RecognitionEvent *event)
+{
+    EventQueueCell *cell;
+    size_t pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+
+    for (;;) {
+        cell = &queue->cells[pos & queue->mask];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return FALSE;
+        } else {
+            pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->event = event;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    return TRUE;
+}
+
+static RecognitionEvent *
+event_queue_pop(EventQueue *queue)
+{
+    EventQueueCell *cell;
+    RecognitionEvent *event;
+    size_t pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+
+    for (;;) {
+        cell = &queue->cells[pos & queue->mask];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    event = cell->event;
+    cell->event = NULL;
+    atomic_store_explicit(&cell->sequence, pos + queue->mask + 1, memory_order_release);
+    return event;
+}
+
+static guint
+event_queue_length(EventQueue *queue)
+{
+    size_t head = atomic_load(&queue->dequeue_pos);
+    size_t tail = atomic_load(&queue->enqueue_pos);
+    return tail > head ? (guint)(tail - head) : 0;
+}
+
+RecognitionEvent *
+recognition_event_new(void)
+{
+    return (RecognitionEvent *)calloc(1, sizeof(RecognitionEvent));
+}
+
+void
+recognition_event_free(RecognitionEvent *event)
+{
+    if (!event)
+        return;
+    free(event->face_image);
+    free(event->context_image);
+    free(event);
+}
+
+/* Writes @event as a JSON object at the end of @out. */
+static void
+append_event_json(GString *out, const RecognitionEvent *event)
+{
+    char timestamp_str[64];
+    struct tm time_info;
+    gsize face_len = event->face_image ? strlen(event->face_image) : 0;
+    gsize context_len = event->context_image ? strlen(event->context_image) : 0;
+    gsize len = out->len;
+
+    localtime_r(&event->timestamp, &time_info);
+    strftime(timestamp_str, sizeof(timestamp_str), "%d-%m-%Y %H:%M:%S", &time_info);
+
+    /* Grow once up front; the body keeps its capacity across requests. */
+    g_string_set_size(out, len + face_len + context_len + 512);
+    g_string_truncate(out, len);
+
+    g_string_append_c(out, '{');
+    json_append_member(out, "student_id", event->student_id);
+    g_string_append_c(out, ',');
+    json_append_member(out, "ip_address", event->ip_address);
+    g_string_append_c(out, ',');
+    json_append_member(out, "mac_address", event->mac_address);
+    g_string_append_c(out, ',');
+    json_append_member(out, "face_image", event->face_image ? event->face_image : "");
+    if (event->context_image) {
+        g_string_append_c(out, ',');
+        json_append_member(out, "context_image", event->context_image);
+    }
+    g_string_append_c(out, ',');
+    json_append_member(out, "timestamp", timestamp_str);
+    g_string_append_c(out, '}');
+}
+
+static size_t
+collect_response(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    EventTransfer *t = (EventTransfer *)userdata;
+    size_t len = size * nmemb;
+
+    if (t->response->len < MAX_RESPONSE_BYTES)
+        g_string_append_len(t->response, ptr, MIN(len, MAX_RESPONSE_BYTES - t->response->len));
+    return len;
+}
+
+static void
+report_failed(EventDispatcher *d, RecognitionEvent *event)
+{
+    atomic_fetch_add(&d->failed, 1);
+    if (d->failed_cb)
+        d->failed_cb(event, d->user_data);
+    recognition_event_free(event);
+}
+
+/* Pushed to drops to make drop_thread exit. */
+static RecognitionEvent drop_stop_marker;
+
+/* Not queued (full queue) or evicted from it. Counted apart from failed
+ * deliveries but handed to failed_cb all the same, so the event is kept;
+ * that happens on drop_thread, the caller only queues it. */
+static void
+report_dropped(EventDispatcher *d, RecognitionEvent *event)
+{
+    atomic_fetch_add(&d->dropped, 1);
+    g_async_queue_push(d->drops, event);
+}
+
+/* failed_cb for a dropped event, on drop_thread (or at shutdown once it is
+ * joined). */
+static void
+run_dropped(EventDispatcher *d, RecognitionEvent *event)
+{
+    /* Log the first drop and every 100th after that. */
+    if (++d->drops_reported % 100 == 1)
+        g_printerr("Recognition event queue full, %" G_GUINT64_FORMAT
+                   " events dropped so far\n", d->drops_reported);
+    if (d->failed_cb)
+        d->failed_cb(event, d->user_data);
+    recognition_event_free(event);
+}
+
+static gpointer
+event_drop_loop(gpointer data)
+{
+    EventDispatcher *d = (EventDispatcher *)data;
+
+    for (;;) {
+        RecognitionEvent *event = (RecognitionEvent *)g_async_queue_pop(d->drops);
+        if (event == &drop_stop_marker)
+            break;
+        run_dropped(d, event);
+    }
+    return NULL;
+}
+
+static void
+report_delivered(EventDispatcher *d, RecognitionEvent *event)
+{
+    atomic_fetch_add(&d->delivered, 1);
+    g_print("Successfully sent log to API for student_id: %s\n", event->student_id);
+    if (d->delivered_cb)
+        d->delivered_cb(event, d->user_data);
+    recognition_event_free(event);
+}
+
+static void
+release_transfer(EventWorker *w, EventTransfer *t)
+{
+    g_string_truncate(t->body, 0);
+    g_string_truncate(t->response, 0);
+    t->num_events = 0;
+    w->free_slots[w->num_free++] = (guint)(t - w->transfers);
+}
+
+static gboolean
+batching(EventDispatcher *d)
+{
+    return d->batch_max_events > 1;
+}
+
+static void
+open_batch(EventWorker *w)
+{
+    w->batch = &w->transfers[w->free_slots[--w->num_free]];
+    w->batch_deadline = g_get_monotonic_time() + w->dispatcher->batch_linger_us;
+    if (batching(w->dispatcher))
+        g_string_append_c(w->batch->body, '[');
+}
+
+static void
+append_to_batch(EventWorker *w, RecognitionEvent *event)
+{
+    EventTransfer *t = w->batch;
+
+    if (t->num_events > 0)
+        g_string_append_c(t->body, ',');
+    append_event_json(t->body, event);
+    t->events[t->num_events++] = event;
+}
+
+static gboolean
+batch_full(EventWorker *w)
+{
+    EventDispatcher *d = w->dispatcher;
+    return w->batch->num_events >= d->batch_max_events ||
+           w->batch->body->len >= d->batch_max_bytes;
+}
+
+static gboolean
+gzip_body(EventTransfer *t)
+{
+    z_stream zs;
+    int ret;
+
+    memset(&zs, 0, sizeof(zs));
+    /* 15 + 16: gzip wrapper rather than zlib. */
+    if (deflateInit2(&zs, GZIP_LEVEL, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return FALSE;
+    g_byte_array_set_size(t->gz_body, deflateBound(&zs, t->body->len));
+    zs.next_in = (Bytef *)t->body->str;
+    zs.avail_in = t->body->len;
+    zs.next_out = t->gz_body->data;
+    zs.avail_out = t->gz_body->len;
+    ret = deflate(&zs, Z_FINISH);
+    g_byte_array_set_size(t->gz_body, zs.total_out);
+    deflateEnd(&zs);
+    return ret == Z_STREAM_END;
+}
+
+/* Closes the open batch and hands it to curl. */
+static void
+send_batch(EventWorker *w)
+{
+    EventDispatcher *d = w->dispatcher;
+    EventTransfer *t = w->batch;
+    gboolean gzipped = FALSE;
+
+    w->batch = NULL;
+    if (batching(d))
+        g_string_append_c(t->body, ']');
+
+    if (d->compression == EVENT_COMPRESSION_GZIP && t->body->len >= GZIP_MIN_BYTES)
+        gzipped = gzip_body(t);
+    if (gzipped) {
+        curl_easy_setopt(t->easy, CURLOPT_POSTFIELDS, t->gz_body->data);
+        curl_easy_setopt(t->easy, CURLOPT_POSTFIELDSIZE, (long)t->gz_body->len);
+        curl_easy_setopt(t->easy, CURLOPT_HTTPHEADER, d->gzip_headers);
+    } else {
+        curl_easy_setopt(t->easy, CURLOPT_POSTFIELDS, t->body->str);
+        curl_easy_setopt(t->easy, CURLOPT_POSTFIELDSIZE, (long)t->body->len);
+        curl_easy_setopt(t->easy, CURLOPT_HTTPHEADER, d->headers);
+    }
+
+    if (curl_multi_add_handle(w->multi, t->easy) != CURLM_OK) {
+        for (guint i = 0; i < t->num_events; i++)
+            report_failed(d, t->events[i]);
+        release_transfer(w, t);
+        return;
+    }
+    w->in_flight++;
+    atomic_fetch_add(&d->requests, 1);
+    atomic_fetch_add(&d->bytes_sent, gzipped ? t->gz_body->len : t->body->len);
+}
+
+/* Status of one per-item result entry; @batch_status (that of the HTTP
+ * response) if the entry carries none of its own. */
+static gint64
+item_status(JsonNode *node, gint64 batch_status)
+{
+    if (JSON_NODE_HOLDS_VALUE(node) && json_node_get_value_type(node) == G_TYPE_INT64)
+        return json_node_get_int(node);
+    if (JSON_NODE_HOLDS_OBJECT(node)) {
+        JsonObject *obj = json_node_get_object(node);
+        JsonNode *status = json_object_get_member(obj, "status");
+        if (status && JSON_NODE_HOLDS_VALUE(status) &&
+            json_node_get_value_type(status) == G_TYPE_INT64)
+            return json_node_get_int(status);
+    }
+    return batch_status;
+}
+
+/*
+ * Fills ok[] from the per-item results in the response body. FALSE if the
+ * body does not carry exactly one result per event, in which case the
+ * HTTP status applies to all of them. Entries without a status of their
+ * own take @response_code, so only an explicit non-2xx fails an event.
+ */
+static gboolean
+parse_item_results(EventTransfer *t, long response_code, gboolean *ok)
+{
+    JsonParser *parser;
+    JsonNode *root;
+    JsonArray *results = NULL;
+    gboolean ret = FALSE;
+
+    if (t->response->len == 0)
+        return FALSE;
+    parser = json_parser_new();
+    if (!json_parser_load_from_data(parser, t->response->str, t->response->len, NULL))
+        goto done;
+
+    root = json_parser_get_root(parser);
+    if (JSON_NODE_HOLDS_ARRAY(root)) {
+        results = json_node_get_array(root);
+    } else if (JSON_NODE_HOLDS_OBJECT(root)) {
+        JsonNode *member = json_object_get_member(json_node_get_object(root), "results");
+        if (member && JSON_NODE_HOLDS_ARRAY(member))
+            results = json_node_get_array(member);
+    }
+    if (!results || json_array_get_length(results) != t->num_events)
+        goto done;
+
+    for (guint i = 0; i < t->num_events; i++) {
+        gint64 status = item_status(json_array_get_element(results, i), response_code);
+        ok[i] = status >= 200 && status < 300;
+    }
+    ret = TRUE;
+
+done:
+    g_object_unref(parser);
+    return ret;
+}
+
+static void
+collect_finished_transfers(EventWorker *w)
+{
+    EventDispatcher *d = w->dispatcher;
+    CURLMsg *msg;
+    int msgs_left;
+
+    while ((msg = curl_multi_info_read(w->multi, &msgs_left))) {
+        EventTransfer *t = NULL;
+        long response_code = 0;
+
+        if (msg->msg != CURLMSG_DONE)
+            continue;
+
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&t);
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &response_code);
+        curl_multi_remove_handle(w->multi, t->easy);
+        w->in_flight--;
+
+        CURLcode res = msg->data.result;
+        gboolean sent = res == CURLE_OK && response_code >= 200 && response_code < 300;
+        gboolean ok[MAX_BATCH_EVENTS];
+
+        if (!sent) {
+            g_print("Failed to send %u log(s) to API: %s (HTTP: %ld)\n", t->num_events,
+                    curl_easy_strerror(res), response_code);
+        }
+        if (!sent || !batching(d) || !parse_item_results(t, response_code, ok)) {
+            for (guint i = 0; i < t->num_events; i++)
+                ok[i] = sent;
+        }
+        for (guint i = 0; i < t->num_events; i++) {
+            if (ok[i])
+                report_delivered(d, t->events[i]);
+            else
+                report_failed(d, t->events[i]);
+        }
+        release_transfer(w, t);
+    }
+}
+
+static void
+drain_wake_pipe(EventWorker *w)
+{
+    char buf[64];
+    while (read(w->wake_fds[0], buf, sizeof(buf)) > 0)
+        ;
+}
+
+/* Milliseconds to sleep in curl_multi_wait(). */
+static int
+worker_wait_ms(EventWorker *w)
+{
+    if (w->batch) {
+        gint64 left_us = w->batch_deadline - g_get_monotonic_time();
+        return (int)CLAMP((left_us + 999) / 1000, 0, WORKER_IDLE_WAIT_MS);
+    }
+    return WORKER_IDLE_WAIT_MS;
+}
+
+static gpointer
+event_worker_loop(gpointer data)
+{
+    EventWorker *w = (EventWorker *)data;
+    EventDispatcher *d = w->dispatcher;
+    gint64 stop_deadline = 0;
+
+    for (;;) {
+        gboolean stopping = atomic_load(&d->stop);
+        RecognitionEvent *event;
+        int running = 0;
+
+        if (stopping && !stop_deadline)
+            stop_deadline = g_get_monotonic_time() + (gint64)d->timeout_ms * 1000;
+
+        /* Queued events are left for event_dispatcher_free() once stopping. */
+        while (!stopping && (w->batch || w->num_free > 0) &&
+               (event = event_queue_pop(&d->queue))) {
+            if (!w->batch)
+                open_batch(w);
+            append_to_batch(w, event);
+            if (batch_full(w))
+                send_batch(w);
+        }
+        if (w->batch && (stopping || g_get_monotonic_time() >= w->batch_deadline))
+            send_batch(w);
+
+        if (w->in_flight > 0) {
+            curl_multi_perform(w->multi, &running);
+            collect_finished_transfers(w);
+        }
+
+        if (stopping && (w->in_flight == 0 || g_get_monotonic_time() >= stop_deadline))
+            break;
+
+        /* Publish that we are about to sleep, then re-check the queue so an
+         * event pushed in between is never missed (see
+         * event_dispatcher_enqueue). */
+        atomic_store(&w->sleeping, 1);
+        if (!stopping && (w->batch || w->num_free > 0) && event_queue_length(&d->queue) > 0) {
+            atomic_store(&w->sleeping, 0);
+            continue;
+        }
+
+        struct curl_waitfd wake = { w->wake_fds[0], CURL_WAIT_POLLIN, 0 };
+        curl_multi_wait(w->multi, &wake, 1, worker_wait_ms(w), NULL);
+        atomic_store(&w->sleeping, 0);
+        if (wake.revents)
+            drain_wake_pipe(w);
+    }
+
+    /* Requests that did not finish within the shutdown grace period. */
+    for (guint i = 0; i < d->max_connections; i++) {
+        EventTransfer *t = &w->transfers[i];
+        if (t->num_events > 0) {
+            curl_multi_remove_handle(w->multi, t->easy);
+            for (guint j = 0; j < t->num_events; j++)
+                report_failed(d, t->events[j]);
+            release_transfer(w, t);
+        }
+    }
+    w->in_flight = 0;
+    return NULL;
+}
+
+static void
+wake_worker(EventWorker *w)
+{
+    if (atomic_load(&w->sleeping)) {
+        char c = 0;
+        /* A full pipe already means a pending wakeup. */
+        if (write(w->wake_fds[1], &c, 1) < 0 && errno != EAGAIN)
+            g_printerr("event dispatcher: wake write failed: %s\n", g_strerror(errno));
+    }
+}
+
+gboolean
+event_dispatcher_enqueue(EventDispatcher *d, RecognitionEvent *event)
+{
+    if (!event_queue_push(&d->queue, event)) {
+        gboolean pushed = FALSE;
+
+        if (d->drop_policy == EVENT_DROP_OLDEST) {
+            RecognitionEvent *oldest = event_queue_pop(&d->queue);
+            if (oldest)
+                report_dropped(d, oldest);
+            pushed = event_queue_push(&d->queue, event);
+        }
+        if (!pushed) {
+            report_dropped(d, event);
+            return FALSE;
+        }
+    }
+    atomic_fetch_add(&d->enqueued, 1);
+
+    /* Pairs with the sleeping flag / queue re-check in event_worker_loop. */
+    atomic_thread_fence(memory_order_seq_cst);
+    /* Spread single events over the workers, but let batches fill up in one
+     * worker rather than one partial batch per worker. */
+    guint first = batching(d) ? 0 : atomic_fetch_add(&d->next_worker, 1) % d->num_workers;
+    for (guint i = 0; i < d->num_workers; i++) {
+        EventWorker *w = &d->workers[(first + i) % d->num_workers];
+        if (atomic_load(&w->sleeping)) {
+            wake_worker(w);
+            break;
+        }
+    }
+    return TRUE;
+}
+
+void
+event_dispatcher_get_stats(EventDispatcher *d, EventDispatcherStats *stats)
+{
+    stats->enqueued = atomic_load(&d->enqueued);
+    stats->dropped = atomic_load(&d->dropped);
+    stats->delivered = atomic_load(&d->delivered);
+    stats->failed = atomic_load(&d->failed);
+    stats->requests = atomic_load(&d->requests);
+    stats->bytes_sent = atomic_load(&d->bytes_sent);
+    stats->queued = event_queue_length(&d->queue);
+}
+
+static gpointer
+curl_global_init_once(gpointer data)
+{
+    (void)data;
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    return NULL;
+}
+
+static gboolean
+event_worker_init(EventDispatcher *d, EventWorker *w)
+{
+    w->dispatcher = d;
+    w->wake_fds[0] = w->wake_fds[1] = -1;
+    atomic_init(&w->sleeping, 0);
+
+    if (pipe(w->wake_fds) != 0)
+        return FALSE;
+    for (int i = 0; i < 2; i++) {
+        fcntl(w->wake_fds[i], F_SETFL, fcntl(w->wake_fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(w->wake_fds[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    w->multi = curl_multi_init();
+    if (!w->multi)
+        return FALSE;
+    curl_multi_setopt(w->multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)d->max_connections);
+    curl_multi_setopt(w->multi, CURLMOPT_MAXCONNECTS, (long)d->max_connections);
+
+    w->transfers = g_new0(EventTransfer, d->max_connections);
+    w->free_slots = g_new(guint, d->max_connections);
+    for (guint i = 0; i < d->max_connections; i++) {
+        EventTransfer *t = &w->transfers[i];
+        t->easy = curl_easy_init();
+        if (!t->easy)
+            return FALSE;
+        t->events = g_new0(RecognitionEvent *, d->batch_max_events);
+        t->body = g_string_new(NULL);
+        t->gz_body = g_byte_array_new();
+        t->response = g_string_new(NULL);
+        curl_easy_setopt(t->easy, CURLOPT_URL, d->api_url);
+        curl_easy_setopt(t->easy, CURLOPT_POST, 1L);
+        curl_easy_setopt(t->easy, CURLOPT_TIMEOUT_MS, (long)d->timeout_ms);
+        curl_easy_setopt(t->easy, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(t->easy, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(t->easy, CURLOPT_WRITEFUNCTION, collect_response);
+        curl_easy_setopt(t->easy, CURLOPT_WRITEDATA, t);
+        curl_easy_setopt(t->easy, CURLOPT_PRIVATE, t);
+        w->free_slots[i] = i;
+    }
+    w->num_free = d->max_connections;
+    return TRUE;
+}
+
+static void
+event_worker_deinit(EventWorker *w)
+{
+    EventDispatcher *d = w->dispatcher;
+
+    if (w->transfers) {
+        for (guint i = 0; i < d->max_connections; i++) {
+            EventTransfer *t = &w->transfers[i];
+            if (t->easy)
+                curl_easy_cleanup(t->easy);
+            g_free(t->events);
+            if (t->body)
+                g_string_free(t->body, TRUE);
+            if (t->gz_body)
+                g_byte_array_unref(t->gz_body);
+            if (t->response)
+                g_string_free(t->response, TRUE);
+        }
+    }
+    if (w->multi)
+        curl_multi_cleanup(w->multi);
+    g_free(w->transfers);
+    g_free(w->free_slots);
+    for (int i = 0; i < 2; i++) {
+        if (w->wake_fds[i] >= 0)
+            close(w->wake_fds[i]);
+    }
+}
+
+EventDispatcher *
+event_dispatcher_new(const NvDsRecognitionEventConfig *config, EventFailedCallback failed_cb,
+                     EventDeliveredCallback delivered_cb, gpointer user_data)
+{
+    static GOnce curl_once = G_ONCE_INIT;
+    EventDispatcher *d;
+    guint i;
+
+    g_once(&curl_once, curl_global_init_once, NULL);
+
+    d = g_new0(EventDispatcher, 1);
+    d->num_workers = config->num_workers ? config->num_workers : DEFAULT_NUM_WORKERS;
+    d->num_workers = MIN(d->num_workers, MAX_NUM_WORKERS);
+    d->max_connections = config->max_connections ? config->max_connections
+                                                 : DEFAULT_MAX_CONNECTIONS;
+    d->max_connections = MIN(d->max_connections, MAX_CONNECTIONS);
+    d->timeout_ms = config->timeout_ms ? config->timeout_ms : DEFAULT_TIMEOUT_MS;
+    d->drop_policy = config->drop_policy;
+    d->batch_max_events = config->batch_max_events ? config->batch_max_events
+                                                   : DEFAULT_BATCH_MAX_EVENTS;
+    d->batch_max_events = MIN(d->batch_max_events, MAX_BATCH_EVENTS);
+    d->batch_max_bytes =
+        (gsize)(config->batch_max_kb ? config->batch_max_kb : DEFAULT_BATCH_MAX_KB) * 1024;
+    d->batch_linger_us = (gint64)config->batch_linger_ms * 1000;
+    d->compression = config->compression;
+    d->api_url = g_strdup(config->api_url ? config->api_url : EVENT_DISPATCHER_DEFAULT_API_URL);
+    d->headers = curl_slist_append(NULL, "Content-Type: application/json");
+    /* Bodies above 1 KiB would otherwise cost a 100-continue round trip. */
+    d->headers = curl_slist_append(d->headers, "Expect:");
+    d->gzip_headers = curl_slist_append(NULL, "Content-Type: application/json");
+    d->gzip_headers = curl_slist_append(d->gzip_headers, "Expect:");
+    d->gzip_headers = curl_slist_append(d->gzip_headers, "Content-Encoding: gzip");
+    d->failed_cb = failed_cb;
+    d->delivered_cb = delivered_cb;
+    d->user_data = user_data;
+    d->drops = g_async_queue_new();
+
+    if (!event_queue_init(&d->queue, config->queue_size ? config->queue_size
+                                                         : DEFAULT_QUEUE_SIZE)) {
+        g_printerr("Failed to allocate recognition event queue\n");
+        goto error;
+    }
+
+    d->workers = g_new0(EventWorker, d->num_workers);
+    for (i = 0; i < d->num_workers; i++) {
+        if (!event_worker_init(d, &d->workers[i])) {
+            g_printerr("Failed to initialize recognition event worker %u\n", i);
+            goto error;
+        }
+    }
+    for (i = 0; i < d->num_workers; i++) {
+        gchar *name = g_strdup_printf("event-worker-%u", i);
+        d->workers[i].thread = g_thread_new(name, event_worker_loop, &d->workers[i]);
+        g_free(name);
+    }
+    d->drop_thread = g_thread_new("event-drops", event_drop_loop, d);
+
+    g_print("Recognition event dispatcher: %u workers x %u connections, queue %lu, "
+            "batch %u events / %u ms%s -> %s\n",
+            d->num_workers, d->max_connections, (unsigned long)(d->queue.mask + 1),
+            d->batch_max_events, config->batch_linger_ms,
+            d->compression == EVENT_COMPRESSION_GZIP ? ", gzip" : "", d->api_url);
+    return d;
+
+error:
+    event_dispatcher_free(d);
+    return NULL;
+}
+
+void
+event_dispatcher_free(EventDispatcher *d)
+{
+    RecognitionEvent *event;
+    guint i;
+
+    if (!d)
+        return;
+
+    atomic_store(&d->stop, 1);
+    if (d->workers) {
+        for (i = 0; i < d->num_workers; i++) {
+            if (d->workers[i].thread) {
+                atomic_store(&d->workers[i].sleeping, 1);
+                wake_worker(&d->workers[i]);
+                g_thread_join(d->workers[i].thread);
+            }
+        }
+    }
+
+    if (d->queue.cells) {
+        while ((event = event_queue_pop(&d->queue)))
+            report_failed(d, event);
+        free(d->queue.cells);
+    }
+
+    /* After the workers, whose callbacks may still drop events. */
+    if (d->drop_thread) {
+        g_async_queue_push(d->drops, &drop_stop_marker);
+        g_thread_join(d->drop_thread);
+    }
+    if (d->drops) {
+        while ((event = (RecognitionEvent *)g_async_queue_try_pop(d->drops)))
+            run_dropped(d, event);
+        g_async_queue_unref(d->drops);
+    }
+
+    if (d->workers) {
+        for (i = 0; i < d->num_workers; i++) {
+            if (d->workers[i].dispatcher)
+                event_worker_deinit(&d->workers[i]);
+        }
+        g_free(d->workers);
+    }
+    curl_slist_free_all(d->headers);
+    curl_slist_free_all(d->gzip_headers);
+    g_free(d->api_url);
+    g_free(d);
+}
@@ -0,0 +1,133 @@
+/*
+ * Asynchronous delivery of recognition events to the attendance API.
+ *
+ * The streaming thread only fills a compact RecognitionEvent and enqueues it
+ * on a bounded lock-free queue; it never blocks on the network. A small pool
+ * of worker threads drains the queue, each driving a libcurl multi handle
+ * with reused easy handles so connections (and TLS sessions) stay alive
+ * between events.
+ *
+ * Optionally events are coalesced into batches, sent as one (gzip
+ * compressed) JSON array per request. A batch is sent once it holds
+ * batch_max_events events or batch_max_kb KiB, or batch_linger_ms after its
+ * first event. The API answers 2xx for the request and may report a result
+ * per item, as a JSON array with one entry per event (or such an array in a
+ * "results" member). An entry is an HTTP-like status code or an object with
+ * a "status" member; entries with neither take the status of the response.
+ * Only entries with an explicit non-2xx status are reported as failed.
+ */
+
+#ifndef __EVENT_DISPATCHER_H__
+#define __EVENT_DISPATCHER_H__
+
+#include <glib.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EVENT_DISPATCHER_DEFAULT_API_URL "https://topcam.ai.vn/apis/aiFaceRecognitionLogAPI"
+
+/** What to do when an event is enqueued while the queue is full. */
+typedef enum {
+    /** Reject the new event. */
+    EVENT_DROP_NEWEST = 0,
+    /** Evict the oldest queued event to make room for the new one. */
+    EVENT_DROP_OLDEST = 1,
+} EventDropPolicy;
+
+typedef enum {
+    EVENT_COMPRESSION_NONE = 0,
+    EVENT_COMPRESSION_GZIP = 1,
+} EventCompression;
+
+/** [recognition-event] group of the application config file. */
+typedef struct {
+    gchar *api_url;
+    /** Queue capacity in events, rounded up to a power of two. */
+    guint queue_size;
+    guint num_workers;
+    /** Concurrent requests per worker. */
+    guint max_connections;
+    guint timeout_ms;
+    EventDropPolicy drop_policy;
+    /** 1 (default) sends every event on its own as a JSON object. */
+    guint batch_max_events;
+    guint batch_max_kb;
+    guint batch_linger_ms;
+    EventCompression compression;
+} NvDsRecognitionEventConfig;
+
+typedef struct {
+    gchar student_id[32];
+    guint source_id;
+    time_t timestamp;
+    gchar ip_address[64];
+    gchar mac_address[64];
+    /** Snapshots as data URIs, malloc'ed, owned by the event. May be NULL. */
+    gchar *face_image;
+    /** Downscaled whole frame, sent only when present. */
+    gchar *context_image;
+} RecognitionEvent;
+
+typedef struct {
+    guint64 enqueued;
+    guint64 dropped;
+    guint64 delivered;
+    guint64 failed;
+    guint queued;
+    /** HTTP requests made and request body bytes sent. */
+    guint64 requests;
+    guint64 bytes_sent;
+} EventDispatcherStats;
+
+typedef struct _EventDispatcher EventDispatcher;
+
+/**
+ * Called on a worker thread once for every event that could not be
+ * delivered (network error or non-2xx response, and events still queued at
+ * shutdown). Also called, on a dispatcher thread of its own, for events
+ * dropped because the queue is full or evicted under EVENT_DROP_OLDEST, so
+ * a slow callback never holds up event_dispatcher_enqueue(); these are
+ * counted in EventDispatcherStats.dropped, not in failed. The event is freed
+ * after the callback returns.
+ */
+typedef void (*EventFailedCallback)(const RecognitionEvent *event, gpointer user_data);
+
+/** Called on a worker thread after an event was delivered. */
+typedef void (*EventDeliveredCallback)(const RecognitionEvent *event, gpointer user_data);
+
+RecognitionEvent *recognition_event_new(void);
+void recognition_event_free(RecognitionEvent *event);
+
+/**
+ * Starts the worker threads. Zero / NULL fields of @config get defaults.
+ */
+EventDispatcher *event_dispatcher_new(const NvDsRecognitionEventConfig *config,
+                                      EventFailedCallback failed_cb,
+                                      EventDeliveredCallback delivered_cb,
+                                      gpointer user_data);
+
+/**
+ * Hands @event over to the dispatcher. Never blocks. Returns FALSE when the
+ * event was dropped because the queue is full; it is then passed to the
+ * failed callback later. Ownership of @event is taken in both cases.
+ */
+gboolean event_dispatcher_enqueue(EventDispatcher *dispatcher, RecognitionEvent *event);
+
+void event_dispatcher_get_stats(EventDispatcher *dispatcher, EventDispatcherStats *stats);
+
+/**
+ * Stops the workers. In-flight requests get up to the request timeout to
+ * complete, events still queued after that are reported as failed. The
+ * callbacks may still enqueue while this runs; such events are reported as
+ * failed too.
+ */
+void event_dispatcher_free(EventDispatcher *dispatcher);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EVENT_DISPATCHER_H__ */
@@ -0,0 +1,687 @@
+/*
+ * Segmented append-only spool for undelivered recognition events, see
+ * event_spool.h.
+ *
+ * Segment layout: a sequence of records, each
+ *   SpoolRecordHeader | payload
+ * where the payload is the fixed part of a RecognitionEvent followed by its
+ * strings. A record that does not fit in the current segment starts a new
+ * one, so records never straddle files and a torn write can only affect the
+ * tail of the newest segment.
+ */
+
+#include "event_spool.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "fd_util.h"
+
+#define SPOOL_RECORD_MAGIC 0x52535645u /* "EVSR" */
+#define SPOOL_SEGMENT_SUFFIX ".seg"
+#define SPOOL_CURSOR_FILE "cursor"
+
+#define DEFAULT_SPOOL_DIR "spool"
+#define DEFAULT_SEGMENT_SIZE_KB (16 * 1024)
+#define DEFAULT_SYNC_INTERVAL_MS 1000
+#define DEFAULT_RETENTION_DAYS 3
+
+/* Anything larger is treated as corruption rather than allocated. */
+#define SPOOL_MAX_RECORD_SIZE (64 * 1024 * 1024)
+
+typedef struct {
+    guint32 magic;
+    /** Payload bytes following the header. */
+    guint32 length;
+    /** crc32 of the payload. */
+    guint32 crc;
+    guint32 reserved;
+} SpoolRecordHeader;
+
+typedef struct {
+    gint64 timestamp;
+    guint32 source_id;
+    guint16 student_id_len;
+    guint16 ip_address_len;
+    guint16 mac_address_len;
+    guint16 reserved;
+    guint32 face_image_len;
+    /* The context image, if any, takes the rest of the payload. */
+} SpoolRecordFixed;
+
+struct _EventSpool {
+    GMutex lock;
+    gchar *dir;
+    guint64 segment_size;
+    gint64 sync_interval_us;
+    guint retention_days;
+
+    /* Write side: the newest segment. */
+    guint32 write_seq;
+    int write_fd;
+    guint64 write_offset;
+    gboolean write_dirty;
+    gint64 last_sync_time;
+
+    /* Read side: the persisted cursor. */
+    guint32 read_seq;
+    guint64 read_offset;
+    int read_fd;
+    gboolean cursor_dirty;
+    /* Record returned by event_spool_peek(), ends at peek_end. */
+    gboolean peeked;
+    guint32 peek_seq;
+    guint64 peek_offset;
+    guint64 peek_end;
+
+    guint64 pending;
+
+    guint8 *buf;
+    gsize buf_size;
+};
+
+static gchar *
+segment_path(EventSpool *spool, guint32 seq)
+{
+    gchar name[32];
+    g_snprintf(name, sizeof(name), "%010u" SPOOL_SEGMENT_SUFFIX, seq);
+    return g_build_filename(spool->dir, name, NULL);
+}
+
+static gint
+compare_seq(gconstpointer a, gconstpointer b)
+{
+    guint32 x = *(const guint32 *)a;
+    guint32 y = *(const guint32 *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Sorted sequence numbers of the segment files in the spool directory. */
+static GArray *
+list_segments(EventSpool *spool)
+{
+    GArray *seqs = g_array_new(FALSE, FALSE, sizeof(guint32));
+    DIR *dir = opendir(spool->dir);
+    struct dirent *entry;
+
+    if (!dir)
+        return seqs;
+    while ((entry = readdir(dir))) {
+        guint32 seq;
+        char suffix[8];
+        if (sscanf(entry->d_name, "%10u%7s", &seq, suffix) == 2 &&
+            !strcmp(suffix, SPOOL_SEGMENT_SUFFIX))
+            g_array_append_val(seqs, seq);
+    }
+    closedir(dir);
+    g_array_sort(seqs, compare_seq);
+    return seqs;
+}
+
+static gboolean
+ensure_buffer(EventSpool *spool, gsize size)
+{
+    if (spool->buf_size >= size)
+        return TRUE;
+    guint8 *buf = (guint8 *)g_try_realloc(spool->buf, size);
+    if (!buf)
+        return FALSE;
+    spool->buf = buf;
+    spool->buf_size = size;
+    return TRUE;
+}
+
+static gboolean
+read_exact(int fd, guint64 offset, void *data, gsize size)
+{
+    guint8 *p = (guint8 *)data;
+    while (size > 0) {
+        ssize_t n = pread(fd, p, size, offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return FALSE;
+        p += n;
+        offset += n;
+        size -= n;
+    }
+    return TRUE;
+}
+
+/*
+ * Walks the record headers of a segment starting at @offset. Returns the
+ * offset just past the last complete record and counts the records.
+ */
+static guint64
+scan_segment(int fd, guint64 offset, guint64 *num_records)
+{
+    struct stat st;
+    SpoolRecordHeader header;
+
+    if (fstat(fd, &st) != 0)
+        return offset;
+    while (offset + sizeof(header) <= (guint64)st.st_size &&
+           read_exact(fd, offset, &header, sizeof(header)) &&
+           header.magic == SPOOL_RECORD_MAGIC && header.length <= SPOOL_MAX_RECORD_SIZE &&
+           offset + sizeof(header) + header.length <= (guint64)st.st_size) {
+        offset += sizeof(header) + header.length;
+        if (num_records)
+            (*num_records)++;
+    }
+    return offset;
+}
+
+static void
+persist_cursor(EventSpool *spool)
+{
+    gchar *path = g_build_filename(spool->dir, SPOOL_CURSOR_FILE, NULL);
+    gchar *contents = g_strdup_printf("%u %" G_GUINT64_FORMAT "\n", spool->read_seq,
+                                      spool->read_offset);
+    GError *error = NULL;
+
+    /* g_file_set_contents writes a temporary file and renames it over. */
+    if (!g_file_set_contents(path, contents, -1, &error)) {
+        g_printerr("Event spool: failed to write cursor: %s\n", error->message);
+        g_error_free(error);
+    } else {
+        spool->cursor_dirty = FALSE;
+    }
+    g_free(contents);
+    g_free(path);
+}
+
+static void
+load_cursor(EventSpool *spool)
+{
+    gchar *path = g_build_filename(spool->dir, SPOOL_CURSOR_FILE, NULL);
+    gchar *contents = NULL;
+    guint32 seq;
+    guint64 offset;
+
+    if (g_file_get_contents(path, &contents, NULL, NULL) &&
+        sscanf(contents, "%u %" G_GUINT64_FORMAT, &seq, &offset) == 2) {
+        spool->read_seq = seq;
+        spool->read_offset = offset;
+    }
+    g_free(contents);
+    g_free(path);
+}
+
+static int
+open_segment(EventSpool *spool, guint32 seq, int flags)
+{
+    gchar *path = segment_path(spool, seq);
+    int fd = open(path, flags | O_CLOEXEC, 0644);
+    g_free(path);
+    return fd;
+}
+
+static void
+sync_write_segment(EventSpool *spool)
+{
+    if (spool->write_dirty && spool->write_fd >= 0) {
+        fdatasync(spool->write_fd);
+        spool->write_dirty = FALSE;
+    }
+    spool->last_sync_time = g_get_monotonic_time();
+}
+
+static gboolean
+start_segment(EventSpool *spool, guint32 seq)
+{
+    int fd = open_segment(spool, seq, O_WRONLY | O_CREAT | O_APPEND);
+    if (fd < 0) {
+        g_printerr("Event spool: cannot create segment %u: %s\n", seq, g_strerror(errno));
+        return FALSE;
+    }
+    spool->write_fd = fd;
+    spool->write_seq = seq;
+    spool->write_offset = 0;
+    return TRUE;
+}
+
+static gboolean
+rotate_segment(EventSpool *spool)
+{
+    sync_write_segment(spool);
+    close(spool->write_fd);
+    spool->write_fd = -1;
+    return start_segment(spool, spool->write_seq + 1);
+}
+
+/* First existing segment after @seq, or the write segment. */
+static guint32
+next_segment(EventSpool *spool, guint32 seq)
+{
+    GArray *seqs = list_segments(spool);
+    guint32 next = spool->write_seq;
+
+    for (guint i = 0; i < seqs->len; i++) {
+        guint32 s = g_array_index(seqs, guint32, i);
+        if (s > seq) {
+            next = MIN(s, next);
+            break;
+        }
+    }
+    g_array_free(seqs, TRUE);
+    return next;
+}
+
+static void
+close_read_segment(EventSpool *spool)
+{
+    if (spool->read_fd >= 0) {
+        close(spool->read_fd);
+        spool->read_fd = -1;
+    }
+}
+
+/* Moves the cursor past a fully consumed (or expired) segment and deletes it. */
+static void
+retire_read_segment(EventSpool *spool)
+{
+    gchar *path = segment_path(spool, spool->read_seq);
+
+    close_read_segment(spool);
+    g_unlink(path);
+    g_free(path);
+    spool->read_seq = next_segment(spool, spool->read_seq);
+    spool->read_offset = 0;
+    persist_cursor(spool);
+}
+
+EventSpool *
+event_spool_open(const NvDsEventSpoolConfig *config)
+{
+    EventSpool *spool = g_new0(EventSpool, 1);
+    GArray *seqs;
+    guint64 valid_end;
+
+    g_mutex_init(&spool->lock);
+    spool->dir = g_strdup(config->dir ? config->dir : DEFAULT_SPOOL_DIR);
+    spool->segment_size =
+        (guint64)(config->segment_size_kb ? config->segment_size_kb : DEFAULT_SEGMENT_SIZE_KB) *
+        1024;
+    spool->sync_interval_us =
+        (gint64)(config->sync_interval_ms ? config->sync_interval_ms : DEFAULT_SYNC_INTERVAL_MS) *
+        1000;
+    spool->retention_days =
+        config->retention_days ? config->retention_days : DEFAULT_RETENTION_DAYS;
+    spool->write_fd = -1;
+    spool->read_fd = -1;
+    spool->last_sync_time = g_get_monotonic_time();
+
+    if (g_mkdir_with_parents(spool->dir, 0755) != 0) {
+        g_printerr("Event spool: cannot create %s: %s\n", spool->dir, g_strerror(errno));
+        goto error;
+    }
+
+    seqs = list_segments(spool);
+    if (seqs->len == 0) {
+        g_array_free(seqs, TRUE);
+        if (!start_segment(spool, 1))
+            goto error;
+        spool->read_seq = 1;
+        spool->read_offset = 0;
+        persist_cursor(spool);
+        return spool;
+    }
+
+    spool->write_seq = g_array_index(seqs, guint32, seqs->len - 1);
+    spool->read_seq = g_array_index(seqs, guint32, 0);
+    load_cursor(spool);
+
+    /* A cursor pointing at a deleted segment continues with the next one. */
+    if (spool->read_seq < g_array_index(seqs, guint32, 0) || spool->read_seq > spool->write_seq) {
+        spool->read_seq = g_array_index(seqs, guint32, 0);
+        spool->read_offset = 0;
+    }
+
+    /* Drop a torn record left by a crash in the middle of an append. */
+    spool->write_fd = open_segment(spool, spool->write_seq, O_RDWR | O_APPEND);
+    if (spool->write_fd < 0) {
+        g_array_free(seqs, TRUE);
+        goto error;
+    }
+    valid_end = scan_segment(spool->write_fd, 0, NULL);
+    struct stat st;
+    if (fstat(spool->write_fd, &st) == 0 && (guint64)st.st_size > valid_end) {
+        g_printerr("Event spool: truncating %" G_GUINT64_FORMAT " bytes of partial record\n",
+                   (guint64)st.st_size - valid_end);
+        if (ftruncate(spool->write_fd, valid_end) != 0)
+            g_printerr("Event spool: truncate failed: %s\n", g_strerror(errno));
+    }
+    spool->write_offset = valid_end;
+
+    /* Records still to be replayed, counted from the headers only. */
+    for (guint i = 0; i < seqs->len; i++) {
+        guint32 seq = g_array_index(seqs, guint32, i);
+        if (seq < spool->read_seq)
+            continue;
+        int fd = open_segment(spool, seq, O_RDONLY);
+        if (fd < 0)
+            continue;
+        scan_segment(fd, seq == spool->read_seq ? spool->read_offset : 0, &spool->pending);
+        close(fd);
+    }
+    g_array_free(seqs, TRUE);
+
+    if (spool->pending)
+        g_print("Event spool: %" G_GUINT64_FORMAT " undelivered events in %s\n", spool->pending,
+                spool->dir);
+    return spool;
+
+error:
+    event_spool_close(spool);
+    return NULL;
+}
+
+gboolean
+event_spool_append(EventSpool *spool, const RecognitionEvent *event)
+{
+    SpoolRecordFixed fixed = {0};
+    SpoolRecordHeader header = {0};
+    gboolean ret = FALSE;
+
+    fixed.timestamp = event->timestamp;
+    fixed.source_id = event->source_id;
+    fixed.student_id_len = strnlen(event->student_id, sizeof(event->student_id));
+    fixed.ip_address_len = strnlen(event->ip_address, sizeof(event->ip_address));
+    fixed.mac_address_len = strnlen(event->mac_address, sizeof(event->mac_address));
+    fixed.face_image_len = event->face_image ? strlen(event->face_image) : 0;
+    gsize context_image_len = event->context_image ? strlen(event->context_image) : 0;
+
+    header.magic = SPOOL_RECORD_MAGIC;
+    header.length = sizeof(fixed) + fixed.student_id_len + fixed.ip_address_len +
+                    fixed.mac_address_len + fixed.face_image_len + context_image_len;
+
+    g_mutex_lock(&spool->lock);
+
+    gsize record_size = sizeof(header) + header.length;
+    if (spool->write_fd < 0 || !ensure_buffer(spool, record_size))
+        goto done;
+
+    guint8 *p = spool->buf + sizeof(header);
+    memcpy(p, &fixed, sizeof(fixed));
+    p += sizeof(fixed);
+    memcpy(p, event->student_id, fixed.student_id_len);
+    p += fixed.student_id_len;
+    memcpy(p, event->ip_address, fixed.ip_address_len);
+    p += fixed.ip_address_len;
+    memcpy(p, event->mac_address, fixed.mac_address_len);
+    p += fixed.mac_address_len;
+    if (fixed.face_image_len)
+        memcpy(p, event->face_image, fixed.face_image_len);
+    p += fixed.face_image_len;
+    if (context_image_len)
+        memcpy(p, event->context_image, context_image_len);
+    header.crc = crc32(0L, spool->buf + sizeof(header), header.length);
+    memcpy(spool->buf, &header, sizeof(header));
+
+    if (spool->write_offset > 0 && spool->write_offset + record_size > spool->segment_size &&
+        !rotate_segment(spool))
+        goto done;
+
+    if (!fd_write_all(spool->write_fd, spool->buf, record_size)) {
+        g_printerr("Event spool: append failed: %s\n", g_strerror(errno));
+        /* Do not leave a partial record behind. */
+        if (ftruncate(spool->write_fd, spool->write_offset) != 0)
+            g_printerr("Event spool: truncate failed: %s\n", g_strerror(errno));
+        goto done;
+    }
+    spool->write_offset += record_size;
+    spool->write_dirty = TRUE;
+    spool->pending++;
+
+    if (g_get_monotonic_time() - spool->last_sync_time >= spool->sync_interval_us)
+        sync_write_segment(spool);
+    ret = TRUE;
+
+done:
+    g_mutex_unlock(&spool->lock);
+    return ret;
+}
+
+static RecognitionEvent *
+decode_record(const guint8 *payload, guint32 length)
+{
+    SpoolRecordFixed fixed;
+    RecognitionEvent *event;
+    guint64 used;
+
+    if (length < sizeof(fixed))
+        return NULL;
+    memcpy(&fixed, payload, sizeof(fixed));
+    used = (guint64)sizeof(fixed) + fixed.student_id_len + fixed.ip_address_len +
+           fixed.mac_address_len + fixed.face_image_len;
+    if (used > length)
+        return NULL;
+    event = recognition_event_new();
+    if (!event)
+        return NULL;
+
+    const guint8 *p = payload + sizeof(fixed);
+    event->timestamp = fixed.timestamp;
+    event->source_id = fixed.source_id;
+    memcpy(event->student_id, p, MIN(fixed.student_id_len, sizeof(event->student_id) - 1));
+    p += fixed.student_id_len;
+    memcpy(event->ip_address, p, MIN(fixed.ip_address_len, sizeof(event->ip_address) - 1));
+    p += fixed.ip_address_len;
+    memcpy(event->mac_address, p, MIN(fixed.mac_address_len, sizeof(event->mac_address) - 1));
+    p += fixed.mac_address_len;
+    if (fixed.face_image_len) {
+        event->face_image = (gchar *)malloc(fixed.face_image_len + 1);
+        if (event->face_image) {
+            memcpy(event->face_image, p, fixed.face_image_len);
+            event->face_image[fixed.face_image_len] = '\0';
+        }
+        p += fixed.face_image_len;
+    }
+    if (length > used) {
+        event->context_image = (gchar *)malloc(length - used + 1);
+        if (event->context_image) {
+            memcpy(event->context_image, p, length - used);
+            event->context_image[length - used] = '\0';
+        }
+    }
+    return event;
+}
+
+/* Moves the cursor past the record at the cursor, ending at @end. */
+static void
+skip_record(EventSpool *spool, guint64 end)
+{
+    spool->read_offset = end;
+    spool->cursor_dirty = TRUE;
+    if (spool->pending)
+        spool->pending--;
+}
+
+RecognitionEvent *
+event_spool_peek(EventSpool *spool)
+{
+    RecognitionEvent *event = NULL;
+    SpoolRecordHeader header;
+
+    g_mutex_lock(&spool->lock);
+    spool->peeked = FALSE;
+
+    while (!event) {
+        gboolean in_write_segment = spool->read_seq == spool->write_seq;
+
+        if (in_write_segment && spool->read_offset >= spool->write_offset)
+            break;
+
+        if (spool->read_fd < 0) {
+            spool->read_fd = open_segment(spool, spool->read_seq, O_RDONLY);
+            if (spool->read_fd < 0) {
+                if (in_write_segment)
+                    break;
+                /* Deleted by retention in the meantime. */
+                spool->read_seq = next_segment(spool, spool->read_seq);
+                spool->read_offset = 0;
+                spool->cursor_dirty = TRUE;
+                continue;
+            }
+        }
+
+        if (!read_exact(spool->read_fd, spool->read_offset, &header, sizeof(header)) ||
+            header.magic != SPOOL_RECORD_MAGIC || header.length > SPOOL_MAX_RECORD_SIZE) {
+            if (in_write_segment) {
+                g_printerr("Event spool: corrupt record in active segment, skipping to end\n");
+                spool->read_offset = spool->write_offset;
+                spool->cursor_dirty = TRUE;
+                continue;
+            }
+            retire_read_segment(spool);
+            continue;
+        }
+
+        guint64 record_offset = spool->read_offset;
+        guint64 record_end = record_offset + sizeof(header) + header.length;
+
+        if (!ensure_buffer(spool, header.length) ||
+            !read_exact(spool->read_fd, record_offset + sizeof(header), spool->buf,
+                        header.length)) {
+            g_printerr("Event spool: short record at %u:%" G_GUINT64_FORMAT "\n",
+                       spool->read_seq, record_offset);
+            skip_record(spool, record_end);
+            continue;
+        }
+        if (crc32(0L, spool->buf, header.length) != header.crc) {
+            g_printerr("Event spool: checksum mismatch at %u:%" G_GUINT64_FORMAT ", skipped\n",
+                       spool->read_seq, record_offset);
+            skip_record(spool, record_end);
+            continue;
+        }
+        event = decode_record(spool->buf, header.length);
+        if (!event) {
+            skip_record(spool, record_end);
+            continue;
+        }
+        /* The cursor stays on the record until event_spool_advance(). */
+        spool->peeked = TRUE;
+        spool->peek_seq = spool->read_seq;
+        spool->peek_offset = record_offset;
+        spool->peek_end = record_end;
+    }
+
+    g_mutex_unlock(&spool->lock);
+    return event;
+}
+
+void
+event_spool_advance(EventSpool *spool)
+{
+    g_mutex_lock(&spool->lock);
+    /* Unless retention removed the segment in the meantime. */
+    if (spool->peeked && spool->peek_seq == spool->read_seq &&
+        spool->peek_offset == spool->read_offset)
+        skip_record(spool, spool->peek_end);
+    spool->peeked = FALSE;
+    g_mutex_unlock(&spool->lock);
+}
+
+guint64
+event_spool_pending(EventSpool *spool)
+{
+    guint64 pending;
+    g_mutex_lock(&spool->lock);
+    pending = spool->pending;
+    g_mutex_unlock(&spool->lock);
+    return pending;
+}
+
+void
+event_spool_sync(EventSpool *spool)
+{
+    g_mutex_lock(&spool->lock);
+    sync_write_segment(spool);
+    if (spool->cursor_dirty)
+        persist_cursor(spool);
+    g_mutex_unlock(&spool->lock);
+}
+
+void
+event_spool_expire(EventSpool *spool)
+{
+    time_t cutoff = time(NULL) - (time_t)spool->retention_days * 24 * 60 * 60;
+    guint removed = 0;
+    GArray *seqs;
+
+    g_mutex_lock(&spool->lock);
+
+    seqs = list_segments(spool);
+    for (guint i = 0; i < seqs->len; i++) {
+        guint32 seq = g_array_index(seqs, guint32, i);
+        gchar *path = segment_path(spool, seq);
+        GStatBuf st;
+
+        /* The mtime of a segment is the time of its newest record. */
+        if (g_stat(path, &st) != 0 || st.st_mtime >= cutoff) {
+            g_free(path);
+            continue;
+        }
+        if (seq == spool->write_seq) {
+            if (spool->write_offset == 0 || !rotate_segment(spool)) {
+                g_free(path);
+                continue;
+            }
+        }
+        if (seq >= spool->read_seq) {
+            /* Unreplayed records go with it. */
+            int fd = open_segment(spool, seq, O_RDONLY);
+            guint64 lost = 0;
+            if (fd >= 0) {
+                scan_segment(fd, seq == spool->read_seq ? spool->read_offset : 0, &lost);
+                close(fd);
+            }
+            spool->pending -= MIN(lost, spool->pending);
+        }
+        if (seq == spool->read_seq) {
+            close_read_segment(spool);
+            spool->read_seq = next_segment(spool, seq);
+            spool->read_offset = 0;
+            spool->cursor_dirty = TRUE;
+        }
+        g_unlink(path);
+        g_free(path);
+        removed++;
+    }
+    g_array_free(seqs, TRUE);
+
+    if (spool->cursor_dirty)
+        persist_cursor(spool);
+    g_mutex_unlock(&spool->lock);
+
+    if (removed)
+        g_print("Event spool: removed %u segments older than %u days\n", removed,
+                spool->retention_days);
+}
+
+void
+event_spool_close(EventSpool *spool)
+{
+    if (!spool)
+        return;
+
+    if (spool->write_fd >= 0) {
+        sync_write_segment(spool);
+        close(spool->write_fd);
+    }
+    if (spool->cursor_dirty)
+        persist_cursor(spool);
+    close_read_segment(spool);
+    g_mutex_clear(&spool->lock);
+    g_free(spool->buf);
+    g_free(spool->dir);
+    g_free(spool);
+}
@@ -0,0 +1,67 @@
+/*
+ * On-disk spool for recognition events the API did not accept.
+ *
+ * Events are appended as length-prefixed, CRC-checked records to fixed-size
+ * segment files (<dir>/<seq>.seg). A persisted cursor (<dir>/cursor) marks
+ * how far replay has progressed; segments behind the cursor or older than
+ * the retention period are deleted as a whole. Appends are O(1) and replay
+ * streams one record at a time, so an outage of any length never requires
+ * loading the backlog into memory.
+ */
+
+#ifndef __EVENT_SPOOL_H__
+#define __EVENT_SPOOL_H__
+
+#include "event_dispatcher.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Spool keys of the [recognition-event] config group. */
+typedef struct {
+    gchar *dir;
+    /** Segment rotation threshold in KiB. */
+    guint segment_size_kb;
+    /** Upper bound on how long appended records may stay un-fsync'ed. */
+    guint sync_interval_ms;
+    guint retention_days;
+} NvDsEventSpoolConfig;
+
+typedef struct _EventSpool EventSpool;
+
+/**
+ * Opens (creating if needed) the spool directory, recovers the cursor and
+ * truncates a torn record at the tail of the newest segment.
+ */
+EventSpool *event_spool_open(const NvDsEventSpoolConfig *config);
+
+/** Appends @event. Safe to call from any thread. */
+gboolean event_spool_append(EventSpool *spool, const RecognitionEvent *event);
+
+/**
+ * Reads the record at the cursor without moving the cursor, so a record that
+ * could not be handed on is read again. Returns NULL when the spool is
+ * drained. Corrupt records are skipped.
+ */
+RecognitionEvent *event_spool_peek(EventSpool *spool);
+
+/** Moves the cursor past the record returned by the last event_spool_peek(). */
+void event_spool_advance(EventSpool *spool);
+
+/** Number of records appended but not yet replayed (approximate). */
+guint64 event_spool_pending(EventSpool *spool);
+
+/** fsyncs outstanding appends and persists the cursor. */
+void event_spool_sync(EventSpool *spool);
+
+/** Deletes whole segments last written more than the retention period ago. */
+void event_spool_expire(EventSpool *spool);
+
+void event_spool_close(EventSpool *spool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EVENT_SPOOL_H__ */
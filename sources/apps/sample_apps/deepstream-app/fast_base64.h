@@ -0,0 +1,34 @@
+/*
+ * Table-driven base64 encoder writing into caller-provided memory, so an
+ * encoded image can be produced directly inside its final buffer (data URI,
+ * request body) without intermediate copies.
+ */
+
+#ifndef __FAST_BASE64_H__
+#define __FAST_BASE64_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of characters produced for @len input bytes (with padding). */
+static inline size_t
+base64_encoded_length(size_t len)
+{
+    return 4 * ((len + 2) / 3);
+}
+
+/**
+ * Encodes @len bytes of @src into @dst, which must have room for
+ * base64_encoded_length(@len) characters. No terminator is written.
+ * Returns the number of characters written.
+ */
+size_t base64_encode_to(char *dst, const unsigned char *src, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FAST_BASE64_H__ */
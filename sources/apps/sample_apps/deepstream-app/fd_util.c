@@ -0,0 +1,26 @@
+/*
+ * File descriptor helpers, see fd_util.h.
+ */
+
+#include "fd_util.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+gboolean
+fd_write_all(int fd, const void *data, gsize size)
+{
+    const guint8 *p = (const guint8 *)data;
+
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return FALSE;
+        }
+        p += n;
+        size -= n;
+    }
+    return TRUE;
+}
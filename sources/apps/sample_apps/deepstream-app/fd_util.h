@@ -0,0 +1,22 @@
+/*
+ * Small helpers on raw file descriptors, shared by the event spool and the
+ * image saver.
+ */
+
+#ifndef __FD_UTIL_H__
+#define __FD_UTIL_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Writes all @size bytes of @data to @fd, retrying on EINTR and short writes. */
+gboolean fd_write_all(int fd, const void *data, gsize size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FD_UTIL_H__ */
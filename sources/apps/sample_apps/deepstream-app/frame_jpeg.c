@@ -0,0 +1,128 @@
+/*
+ * JPEG encoding of RGBA surfaces, see frame_jpeg.h.
+ */
+
+#include "frame_jpeg.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Rows handed to libjpeg per jpeg_write_scanlines() call. */
+#define JPEG_ROWS_PER_CALL 16
+
+static void
+frame_jpeg_error_exit(j_common_ptr cinfo)
+{
+    FrameJpegError *err = (FrameJpegError *)cinfo->err;
+    char message[JMSG_LENGTH_MAX];
+
+    (*cinfo->err->format_message)(cinfo, message);
+    g_printerr("%s: JPEG error: %s\n", err->owner, message);
+    longjmp(err->jump, 1);
+}
+
+void
+frame_jpeg_init(FrameJpeg *jpeg, const gchar *owner, unsigned long buf_size)
+{
+    memset(jpeg, 0, sizeof(*jpeg));
+    jpeg->cinfo.err = jpeg_std_error(&jpeg->jerr.pub);
+    jpeg->jerr.pub.error_exit = frame_jpeg_error_exit;
+    jpeg->jerr.owner = owner;
+    jpeg_create_compress(&jpeg->cinfo);
+    jpeg->buf_size = buf_size;
+    jpeg->buf = (unsigned char *)malloc(buf_size);
+}
+
+void
+frame_jpeg_clear(FrameJpeg *jpeg)
+{
+    jpeg_destroy_compress(&jpeg->cinfo);
+    free(jpeg->buf);
+    jpeg->buf = NULL;
+    jpeg->buf_size = 0;
+}
+
+unsigned long
+frame_jpeg_encode(FrameJpeg *jpeg, const guint8 *pixels, guint pitch, guint width,
+                  guint height, guint quality)
+{
+    JSAMPROW rows[JPEG_ROWS_PER_CALL];
+
+    if (!jpeg->buf)
+        return 0;
+
+    jpeg->out = jpeg->buf;
+    jpeg->out_size = jpeg->buf_size;
+    if (setjmp(jpeg->jerr.jump)) {
+        jpeg_abort_compress(&jpeg->cinfo);
+        if (jpeg->out != jpeg->buf)
+            free(jpeg->out);
+        return 0;
+    }
+
+    jpeg_mem_dest(&jpeg->cinfo, &jpeg->out, &jpeg->out_size);
+    jpeg->cinfo.image_width = width;
+    jpeg->cinfo.image_height = height;
+    jpeg->cinfo.input_components = 4;
+    jpeg->cinfo.in_color_space = JCS_EXT_RGBA;
+    jpeg_set_defaults(&jpeg->cinfo);
+    jpeg_set_quality(&jpeg->cinfo, quality, TRUE);
+    jpeg_start_compress(&jpeg->cinfo, TRUE);
+
+    while (jpeg->cinfo.next_scanline < jpeg->cinfo.image_height) {
+        guint n = MIN(JPEG_ROWS_PER_CALL, jpeg->cinfo.image_height - jpeg->cinfo.next_scanline);
+        for (guint i = 0; i < n; i++)
+            rows[i] = (JSAMPROW)(pixels + (gsize)(jpeg->cinfo.next_scanline + i) * pitch);
+        jpeg_write_scanlines(&jpeg->cinfo, rows, n);
+    }
+    jpeg_finish_compress(&jpeg->cinfo);
+
+    /* libjpeg allocated a larger buffer: keep it for the next images. */
+    if (jpeg->out != jpeg->buf) {
+        free(jpeg->buf);
+        jpeg->buf = jpeg->out;
+        jpeg->buf_size = jpeg->out_size;
+    }
+    return jpeg->out_size;
+}
+
+NvBufSurface *
+frame_jpeg_surface_new(const gchar *owner, guint gpu_id, guint width, guint height)
+{
+    NvBufSurfaceCreateParams create_params;
+    NvBufSurface *surface = NULL;
+
+    memset(&create_params, 0, sizeof(create_params));
+    create_params.gpuId = gpu_id;
+    create_params.width = width;
+    create_params.height = height;
+    create_params.colorFormat = NVBUF_COLOR_FORMAT_RGBA;
+    create_params.layout = NVBUF_LAYOUT_PITCH;
+#ifdef __aarch64__
+    create_params.memType = NVBUF_MEM_DEFAULT;
+#else
+    create_params.memType = NVBUF_MEM_CUDA_UNIFIED;
+#endif
+
+    if (NvBufSurfaceCreate(&surface, 1, &create_params) != 0) {
+        g_printerr("%s: failed to allocate %ux%u surface\n", owner, width, height);
+        return NULL;
+    }
+    surface->numFilled = 1;
+    if (NvBufSurfaceMap(surface, 0, 0, NVBUF_MAP_READ_WRITE) != 0) {
+        g_printerr("%s: failed to map surface\n", owner);
+        NvBufSurfaceDestroy(surface);
+        return NULL;
+    }
+    return surface;
+}
+
+void
+frame_jpeg_surface_free(NvBufSurface *surface)
+{
+    if (surface) {
+        NvBufSurfaceUnMap(surface, 0, 0);
+        NvBufSurfaceDestroy(surface);
+    }
+}
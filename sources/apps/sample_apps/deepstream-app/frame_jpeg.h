@@ -0,0 +1,68 @@
+/*
+ * JPEG encoding of CPU-mapped RGBA surfaces, shared by the snapshot encoder
+ * and the image saver.
+ *
+ * Each worker thread owns a FrameJpeg: a libjpeg compressor whose errors
+ * return to the encode call instead of exiting, and an output buffer reused
+ * from image to image. The surfaces it reads are allocated with
+ * frame_jpeg_surface_new(), which maps them for the CPU once.
+ */
+
+#ifndef __FRAME_JPEG_H__
+#define __FRAME_JPEG_H__
+
+#include <glib.h>
+#include <jpeglib.h>
+#include <setjmp.h>
+
+#include "nvbufsurface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    struct jpeg_error_mgr pub;
+    jmp_buf jump;
+    const gchar *owner;
+} FrameJpegError;
+
+typedef struct {
+    struct jpeg_compress_struct cinfo;
+    FrameJpegError jerr;
+    /** Output of the last successful encode, kept for the next one. */
+    unsigned char *buf;
+    unsigned long buf_size;
+    /* Destination of the encode in progress. libjpeg updates them after the
+     * setjmp() of frame_jpeg_encode(), so they live here. */
+    unsigned char *out;
+    unsigned long out_size;
+} FrameJpeg;
+
+/**
+ * Creates the compressor and a @buf_size output buffer (grown by libjpeg
+ * when an image does not fit). @owner prefixes the error messages.
+ */
+void frame_jpeg_init(FrameJpeg *jpeg, const gchar *owner, unsigned long buf_size);
+
+void frame_jpeg_clear(FrameJpeg *jpeg);
+
+/**
+ * Compresses the @width x @height RGBA pixels at @pixels (rows @pitch bytes
+ * apart) into jpeg->buf. Returns the encoded size, or 0 on error.
+ */
+unsigned long frame_jpeg_encode(FrameJpeg *jpeg, const guint8 *pixels, guint pitch,
+                                guint width, guint height, guint quality);
+
+/** Allocates a CPU-mapped RGBA surface of one @width x @height image. */
+NvBufSurface *frame_jpeg_surface_new(const gchar *owner, guint gpu_id, guint width,
+                                     guint height);
+
+/** Unmaps and destroys a surface of frame_jpeg_surface_new(), NULL is ignored. */
+void frame_jpeg_surface_free(NvBufSurface *surface);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAME_JPEG_H__ */
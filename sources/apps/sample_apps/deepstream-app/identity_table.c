@@ -0,0 +1,176 @@
+/*
+ * Identity table, see identity_table.h.
+ *
+ * A loaded file is an immutable snapshot: id -> name in a GHashTable whose
+ * strings live in one GStringChunk. A reload builds a new snapshot and swaps
+ * it in under the write lock, so readers only ever hold the read lock for
+ * one lookup and copy.
+ */
+
+#include "identity_table.h"
+
+#include <string.h>
+#include <sys/stat.h>
+
+typedef struct {
+    GHashTable *names;
+    GStringChunk *strings;
+} IdentitySnapshot;
+
+struct _IdentityTable {
+    gchar *labels_file;
+    GRWLock lock;
+    IdentitySnapshot *snapshot;
+
+    /* Identity of the loaded file, to notice when it is rewritten. */
+    gint64 mtime;
+    gint64 size;
+    guint64 inode;
+};
+
+static void
+snapshot_free(IdentitySnapshot *snapshot)
+{
+    if (!snapshot)
+        return;
+    g_hash_table_destroy(snapshot->names);
+    g_string_chunk_free(snapshot->strings);
+    g_free(snapshot);
+}
+
+/* Parses "student_id,name[,...]" lines; lines without a numeric id are skipped. */
+static IdentitySnapshot *
+snapshot_load(const gchar *path)
+{
+    IdentitySnapshot *snapshot;
+    gchar *contents = NULL;
+    gchar *line;
+    gchar *next;
+    guint skipped = 0;
+
+    if (!g_file_get_contents(path, &contents, NULL, NULL))
+        return NULL;
+
+    snapshot = g_new0(IdentitySnapshot, 1);
+    snapshot->names = g_hash_table_new(g_direct_hash, g_direct_equal);
+    snapshot->strings = g_string_chunk_new(4096);
+
+    for (line = contents; line && *line; line = next) {
+        gchar *end;
+        gchar *name;
+        guint64 id;
+
+        next = strchr(line, '\n');
+        if (next)
+            *next++ = '\0';
+        g_strstrip(line);
+        if (*line == '\0')
+            continue;
+
+        id = g_ascii_strtoull(line, &end, 10);
+        if (end == line || *end != ',' || id > G_MAXUINT32) {
+            skipped++;
+            continue;
+        }
+        name = g_strstrip(end + 1);
+        g_hash_table_insert(snapshot->names, GUINT_TO_POINTER((guint32)id),
+                            g_string_chunk_insert(snapshot->strings, name));
+    }
+    g_free(contents);
+
+    if (skipped)
+        g_print("Warning: %u lines of %s have no numeric student id\n", skipped, path);
+    return snapshot;
+}
+
+static gint64
+mtime_ns(const struct stat *st)
+{
+    return (gint64)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+}
+
+static gboolean
+file_changed(IdentityTable *table, struct stat *st)
+{
+    if (stat(table->labels_file, st) != 0)
+        return FALSE;
+    return mtime_ns(st) != table->mtime || st->st_size != table->size ||
+           (guint64)st->st_ino != table->inode;
+}
+
+gboolean
+identity_table_refresh(IdentityTable *table)
+{
+    IdentitySnapshot *snapshot;
+    IdentitySnapshot *old;
+    struct stat st;
+
+    if (!file_changed(table, &st))
+        return FALSE;
+
+    snapshot = snapshot_load(table->labels_file);
+    if (!snapshot)
+        return FALSE;
+    table->mtime = mtime_ns(&st);
+    table->size = st.st_size;
+    table->inode = st.st_ino;
+
+    g_rw_lock_writer_lock(&table->lock);
+    old = table->snapshot;
+    table->snapshot = snapshot;
+    g_rw_lock_writer_unlock(&table->lock);
+
+    snapshot_free(old);
+    g_print("Loaded %u identities from %s\n", g_hash_table_size(snapshot->names),
+            table->labels_file);
+    return TRUE;
+}
+
+IdentityTable *
+identity_table_new(const gchar *labels_file)
+{
+    IdentityTable *table = g_new0(IdentityTable, 1);
+
+    table->labels_file = g_strdup(labels_file ? labels_file : IDENTITY_DEFAULT_LABELS_FILE);
+    g_rw_lock_init(&table->lock);
+    table->mtime = -1;
+    if (!identity_table_refresh(table))
+        g_print("Warning: cannot load identities from %s\n", table->labels_file);
+    return table;
+}
+
+gboolean
+identity_table_get_name(IdentityTable *table, guint32 student_id, gchar *buf, gsize size)
+{
+    const gchar *name = NULL;
+
+    g_rw_lock_reader_lock(&table->lock);
+    if (table->snapshot)
+        name = g_hash_table_lookup(table->snapshot->names, GUINT_TO_POINTER(student_id));
+    if (name)
+        g_strlcpy(buf, name, size);
+    g_rw_lock_reader_unlock(&table->lock);
+    return name != NULL;
+}
+
+guint
+identity_table_size(IdentityTable *table)
+{
+    guint size;
+
+    g_rw_lock_reader_lock(&table->lock);
+    size = table->snapshot ? g_hash_table_size(table->snapshot->names) : 0;
+    g_rw_lock_reader_unlock(&table->lock);
+    return size;
+}
+
+void
+identity_table_free(IdentityTable *table)
+{
+    if (!table)
+        return;
+    snapshot_free(table->snapshot);
+    g_rw_lock_clear(&table->lock);
+    g_free(table->labels_file);
+    g_free(table);
+}
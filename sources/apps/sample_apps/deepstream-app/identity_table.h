@@ -0,0 +1,54 @@
+/*
+ * Identities known to the face recognizer.
+ *
+ * The recognition parser reports a match as the integer student id in
+ * NvDsLabelInfo.label_id; names are resolved here only where text is shown.
+ * The table is read from the labels file the faiss index was built with
+ * ("student_id,name" per line) and reloaded when that file changes.
+ */
+
+#ifndef __IDENTITY_TABLE_H__
+#define __IDENTITY_TABLE_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IDENTITY_DEFAULT_LABELS_FILE "labels.txt"
+#define IDENTITY_DEFAULT_GIE_ID 2
+
+/** [recognition-identity] group of the application config file. */
+typedef struct {
+    /** Labels file of the faiss index, "labels.txt" if NULL. */
+    gchar *labels_file;
+    /** gie-unique-id of the recognition classifier; its label_id is a student id. */
+    guint gie_id;
+} NvDsIdentityConfig;
+
+typedef struct _IdentityTable IdentityTable;
+
+/** Loads @labels_file (NULL: the default). Never NULL; a missing file gives an empty table. */
+IdentityTable *identity_table_new(const gchar *labels_file);
+
+/** Reloads the labels file if it changed on disk. Returns TRUE if it was reloaded. */
+gboolean identity_table_refresh(IdentityTable *table);
+
+/**
+ * Copies the name of @student_id into @buf (truncated to @size). Returns
+ * FALSE, leaving @buf untouched, if the id is not in the table. Safe to call
+ * from any thread, also during a reload.
+ */
+gboolean identity_table_get_name(IdentityTable *table, guint32 student_id, gchar *buf,
+                                 gsize size);
+
+guint identity_table_size(IdentityTable *table);
+
+void identity_table_free(IdentityTable *table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IDENTITY_TABLE_H__ */
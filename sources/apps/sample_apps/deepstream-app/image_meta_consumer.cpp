@@ -22,8 +22,38 @@
 
 #include "image_meta_consumer.h"
 
+#include <stdio.h>
+#include <time.h>
+
 constexpr unsigned seconds_in_one_day = 86400;
 
+static int64_t steady_now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/// ISO 8601 local time of the current second, formatted again only when the
+/// second changes (per thread, so no locking).
+static const char *current_timestamp()
+{
+    struct Cache {
+        time_t second = -1;
+        char text[32];
+    };
+    static thread_local Cache cache;
+
+    time_t now = time(nullptr);
+    if (now != cache.second) {
+        struct tm tm_now;
+        localtime_r(&now, &tm_now);
+        strftime(cache.text, sizeof(cache.text), "%FT%T%z", &tm_now);
+        cache.second = now;
+    }
+    return cache.text;
+}
+
 static int is_dir(const char *path)
 {
     struct stat path_stat;
@@ -33,7 +63,7 @@ static int is_dir(const char *path)
 
 ImageMetaConsumer::ImageMetaConsumer()
     : is_stopped_(true), save_full_frame_enabled_(true), save_cropped_obj_enabled_(false),
-      obj_ctx_handle_((NvDsObjEncCtxHandle)0), image_saving_library_is_init_(false)
+      image_saver_(nullptr)
 {
 }
 
@@ -44,10 +74,7 @@ ImageMetaConsumer::~ImageMetaConsumer()
 
 unsigned int ImageMetaConsumer::get_unique_id()
 {
-    mutex_unique_index_.lock();
-    auto res = unique_index_++;
-    mutex_unique_index_.unlock();
-    return res;
+    return unique_index_.fetch_add(1, std::memory_order_relaxed);
 }
 
 void ImageMetaConsumer::stop()
@@ -55,8 +82,21 @@ void ImageMetaConsumer::stop()
     if (is_stopped_)
         return;
     is_stopped_ = true;
-    if (image_saving_library_is_init_)
-        nvds_obj_enc_destroy_context(obj_ctx_handle_);
+    if (!image_saver_)
+        return;
+
+    ImageSaverStats stats;
+    image_saver_get_stats(image_saver_, &stats);
+    image_saver_free(image_saver_);
+    image_saver_ = nullptr;
+    std::cout << "Image saver: " << stats.images_written << " images ("
+              << stats.bytes_written / std::max<guint64>(stats.images_written, 1)
+              << " bytes avg) from " << stats.frames_submitted << " frames, "
+              << stats.frames_skipped << " frames skipped, " << stats.frames_dropped
+              << " dropped, " << stats.writes_dropped << " writes dropped, " << stats.failed
+              << " failed; copy "
+              << stats.copy_us / std::max<guint64>(stats.frames_submitted, 1)
+              << " us per frame on the streaming thread\n";
 }
 
 void ImageMetaConsumer::init(const std::string &output_folder_path,
@@ -68,8 +108,8 @@ void ImageMetaConsumer::init(const std::string &output_folder_path,
                              const bool save_full_frame_enabled,
                              const bool save_cropped_obj_enabled,
                              const unsigned seconds_to_skip_interval,
-                             const unsigned quality,
-                             const unsigned source_nb)
+                             const unsigned source_nb,
+                             const ImageSaverConfig &saver_config)
 {
     if (!is_stopped_) {
         std::cerr << "Consummer already running.\n";
@@ -101,11 +141,20 @@ void ImageMetaConsumer::init(const std::string &output_folder_path,
     min_box_height_ = min_box_height;
     save_full_frame_enabled_ = save_full_frame_enabled;
     save_cropped_obj_enabled_ = save_cropped_obj_enabled;
-    quality_ = quality;
 
-    auto stsi = std::chrono::seconds(seconds_in_one_day);
-    for (unsigned i = 0; i < source_nb; ++i)
-        time_last_frame_saved_list_.push_back(std::chrono::system_clock::now() - stsi);
+    if (save_cropped_obj_enabled_ || save_full_frame_enabled_) {
+        image_saver_ = image_saver_new(&saver_config);
+        if (!image_saver_) {
+            std::cerr << "Unable to create the image saver\n";
+            return;
+        }
+    }
+
+    /// Longer ago than any interval, so the first frame of each source is saved
+    int64_t never_saved_ns = steady_now_ns() - int64_t(seconds_in_one_day) * 1000000000;
+    source_nb_ = std::min<unsigned>(source_nb, MAX_SOURCE_BINS);
+    for (unsigned i = 0; i < source_nb_; ++i)
+        source_states_[i].last_save_ns.store(never_saved_ns, std::memory_order_relaxed);
 
     is_stopped_ = false;
 }
@@ -121,30 +170,16 @@ bool ImageMetaConsumer::setup_folders()
            is_dir(images_full_frame_output_folder_.c_str());
 }
 
-std::string ImageMetaConsumer::make_img_path(const ImageMetaConsumer::ImageSizeType ist,
-                                             const unsigned stream_source_id,
-                                             const std::string &datetime_iso8601)
-{
-    unsigned long id = get_unique_id();
-    std::stringstream ss;
-    switch (ist) {
-    case FULL_FRAME:
-        ss << images_full_frame_output_folder_;
-        break;
-    case CROPPED_TO_OBJECT:
-        ss << images_cropped_obj_output_folder_;
-        break;
-    }
-    ss << "camera-" << stream_source_id << "_";
-    ss << datetime_iso8601 << "_";
-    ss << std::setw(10) << std::setfill('0') << id;
-    ss << ".jpg";
-    return ss.str();
-}
-
-NvDsObjEncCtxHandle ImageMetaConsumer::get_obj_ctx_handle()
+size_t ImageMetaConsumer::make_img_path(char *buf,
+                                        const size_t size,
+                                        const ImageMetaConsumer::ImageSizeType ist,
+                                        const unsigned stream_source_id)
 {
-    return obj_ctx_handle_;
+    const std::string &folder = ist == FULL_FRAME ? images_full_frame_output_folder_
+                                                  : images_cropped_obj_output_folder_;
+    int len = snprintf(buf, size, "%scamera-%u_%s_%010u.jpg", folder.c_str(), stream_source_id,
+                       current_timestamp(), get_unique_id());
+    return len > 0 && size_t(len) < size ? size_t(len) : 0;
 }
 
 float ImageMetaConsumer::get_min_confidence() const
@@ -182,39 +217,42 @@ bool ImageMetaConsumer::get_save_cropped_images_enabled() const
     return save_cropped_obj_enabled_;
 }
 
-unsigned ImageMetaConsumer::get_quality() const
+bool ImageMetaConsumer::save_images(NvBufSurface *surface,
+                                    const unsigned batch_id,
+                                    const ImageSaveRequest *images,
+                                    const unsigned n_images)
 {
-    return quality_;
+    return image_saver_ && image_saver_submit(image_saver_, surface, batch_id, images, n_images);
 }
 
-void ImageMetaConsumer::init_image_save_library_on_first_time()
+bool ImageMetaConsumer::claim_save_slot(unsigned source_id, SaveClaim &claim)
 {
-    if (!image_saving_library_is_init_) {
-        if (!image_saving_library_is_init_ &&
-            (save_cropped_obj_enabled_ || save_full_frame_enabled_)) {
-            obj_ctx_handle_ = nvds_obj_enc_create_context();
-            if (obj_ctx_handle_)
-                image_saving_library_is_init_ = true;
-            else
-                std::cerr << "Unable to create encoding context\n";
-        }
-    }
-}
+    if (source_id >= source_nb_)
+        return false;
 
-bool ImageMetaConsumer::should_save_data(unsigned source_id)
-{
-    auto time_interval = ctr_.getCurrentTimeInterval();
-    auto now = std::chrono::system_clock::now();
-    if (now < time_last_frame_saved_list_[source_id]) {
-        std::cerr << "The current time seems to have moved to the past\n"
-                  << "Reseting time for last frame save for source" << source_id << "\n";
-        time_last_frame_saved_list_[source_id] = now;
-    }
+    std::atomic<int64_t> &last_save_ns = source_states_[source_id].last_save_ns;
+    int64_t interval_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(ctr_.getCurrentTimeInterval())
+            .count();
+    int64_t now_ns = steady_now_ns();
+    int64_t previous_ns = last_save_ns.load(std::memory_order_relaxed);
+
+    if (now_ns - previous_ns <= interval_ns)
+        return false;
+    /// Fails if another thread claimed (or gave back) the slot meanwhile
+    if (!last_save_ns.compare_exchange_strong(previous_ns, now_ns, std::memory_order_relaxed))
+        return false;
 
-    return now > time_interval + time_last_frame_saved_list_[source_id];
+    claim.source_id = source_id;
+    claim.previous_ns = previous_ns;
+    claim.claimed_ns = now_ns;
+    return true;
 }
 
-void ImageMetaConsumer::data_was_saved_for_source(unsigned source_id)
+void ImageMetaConsumer::release_save_slot(const SaveClaim &claim)
 {
-    time_last_frame_saved_list_[source_id] = std::chrono::system_clock::now();
+    int64_t expected = claim.claimed_ns;
+    /// Only if no newer claim happened in between
+    source_states_[claim.source_id].last_save_ns.compare_exchange_strong(
+        expected, claim.previous_ns, std::memory_order_relaxed);
 }
@@ -27,13 +27,14 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <fstream>
 #include <iomanip>
 #include <ios>
 #include <iostream>
-#include <mutex>
 #include <sstream>
 #include <string>
 #include <thread>
@@ -41,8 +42,8 @@
 #include "capture_time_rules.h"
 #include "gst-nvmessage.h"
 #include "gstnvdsmeta.h"
+#include "image_saver.h"
 #include "nvbufsurface.h"
-#include "nvds_obj_encode.h"
 
 class ImageMetaConsumer {
 public:
@@ -73,9 +74,9 @@ public:
     /// images
     /// @param [in] seconds_to_skip_interval Unsigned integer giving the number of
     /// seconds to skip.
-    /// @param [in] quality Quality.
     /// @param [in] source_nb Unsigned integer giving the number of sources that
     /// are currently giving a stream.
+    /// @param [in] saver_config Encoding and queueing of the saved images.
     void init(const std::string &output_folder_path,
               const std::string &frame_to_skip_rules_path,
               float min_box_confidence,
@@ -85,10 +86,10 @@ public:
               bool save_full_frame_enabled,
               bool save_cropped_obj_enabled,
               unsigned seconds_to_skip_interval,
-              unsigned quality,
-              unsigned source_nb);
+              unsigned source_nb,
+              const ImageSaverConfig &saver_config);
 
-    /// End the job of the current thread reading from the queue.
+    /// Write the images still queued and stop the saving threads.
     void stop();
 
     /// Min confidence getter.
@@ -119,35 +120,49 @@ public:
     /// @return If cropped images must be saved.
     bool get_save_cropped_images_enabled() const;
 
-    /// Quality getter.
-    /// @return The quality required save image.
-    unsigned get_quality() const;
-
-    /// Image Save Thread Handler
-    /// @return the thread handler
-    NvDsObjEncCtxHandle get_obj_ctx_handle();
-
-    /// Metadata writer for a unique file (Json or Csv)
-    /// @param extension of file requested (Json or Csv)
+    /// Queue images of one frame for saving, without waiting for the encoding
+    /// or the disk.
+    /// @param [in] surface Batch containing the frame.
+    /// @param [in] batch_id Index of the frame in the batch.
+    /// @param [in] images Regions to save and their paths.
+    /// @param [in] n_images Number of entries in images.
+    /// @return false if the images will not be saved (queue full, copy failed).
+    bool save_images(NvBufSurface *surface,
+                     unsigned batch_id,
+                     const ImageSaveRequest *images,
+                     unsigned n_images);
+
+    /// Unique path of an image to save, stamped with the current local time.
+    /// @param [out] buf Receives the NUL-terminated path.
+    /// @param size Size of buf.
+    /// @param ist Full frame or object crop, selects the folder.
     /// @param stream_source_id Unique number identifying the stream source
-    /// @param datetime_iso8601 current datetime formatted to iso 8601
-    std::string make_img_path(ImageMetaConsumer::ImageSizeType ist,
-                              unsigned stream_source_id,
-                              const std::string &datetime_iso8601);
-
-    /// Create image saving context if needed
-    void init_image_save_library_on_first_time();
-
-    /// This function checks if a certain amount of time passed before the
-    /// last image was saved.
+    /// @return Length of the path, 0 if it does not fit in buf.
+    size_t make_img_path(char *buf,
+                         size_t size,
+                         ImageMetaConsumer::ImageSizeType ist,
+                         unsigned stream_source_id);
+
+    /// A successful claim_save_slot(), to hand back if nothing gets saved.
+    struct SaveClaim {
+        unsigned source_id;
+        int64_t previous_ns;
+        int64_t claimed_ns;
+    };
+
+    /// Checks that the interval of the time rules has passed since the last
+    /// save of the source and, if so, atomically records now as its last
+    /// save. Of several threads claiming the same source at once only one
+    /// succeeds.
     /// \param source_id video stream number to check
-    /// \return True if the required amount of time has passed before last
-    /// the image was saved.
-    bool should_save_data(unsigned source_id);
+    /// \param [out] claim Filled when the slot is claimed.
+    /// \return True if the caller may save images of this source now.
+    bool claim_save_slot(unsigned source_id, SaveClaim &claim);
 
-    /// If an image was saved, then the timestamp of the last image saved is
-    /// stored. \param source_id Stream number for which the timestamp is saved.
-    void data_was_saved_for_source(unsigned source_id);
+    /// Gives a claimed slot back when nothing was saved after all, so the
+    /// next frame of the source can try again.
+    /// \param claim Filled by claim_save_slot().
+    void release_save_slot(const SaveClaim &claim);
 
 private:
     /// Creates folder for images and metadata output.
@@ -156,22 +171,26 @@ private:
     /// Creates a unique id for the current consumer.
     unsigned int get_unique_id();
 
+    /// Last save of one source on the steady clock, alone on its cache line
+    /// so that sources saved from different threads do not contend.
+    struct alignas(64) SourceSaveState {
+        std::atomic<int64_t> last_save_ns;
+    };
+
     std::atomic<bool> is_stopped_;
     std::string output_folder_path_;
     std::string images_cropped_obj_output_folder_;
     std::string images_full_frame_output_folder_;
-    std::mutex mutex_unique_index_;
-    unsigned int unique_index_ = 0;
+    std::atomic<unsigned int> unique_index_{0};
     float min_confidence_;
     float max_confidence_;
     unsigned min_box_width_;
     unsigned min_box_height_;
     bool save_full_frame_enabled_;
     bool save_cropped_obj_enabled_;
-    unsigned quality_;
-    std::vector<std::chrono::_V2::system_clock::time_point> time_last_frame_saved_list_;
-    std::array<std::mutex, MAX_SOURCE_BINS> mutex_frame_saved_list_;
+    /// Fixed array: C++14 new[] does not honour the cache-line alignment
+    std::array<SourceSaveState, MAX_SOURCE_BINS> source_states_;
+    unsigned source_nb_ = 0;
     CaptureTimeRules ctr_;
-    NvDsObjEncCtxHandle obj_ctx_handle_;
-    bool image_saving_library_is_init_;
+    ImageSaver *image_saver_;
 };
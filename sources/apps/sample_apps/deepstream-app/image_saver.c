@@ -0,0 +1,572 @@
+/*
+ * Asynchronous image saving, see image_saver.h.
+ *
+ * A slot is one preallocated, CPU-mapped RGBA frame copy plus the list of
+ * files to cut from it, encoded with frame_jpeg. Free slots and filled
+ * slots waiting for a worker live in two GAsyncQueues. Encoded files go to a
+ * third queue read by the I/O thread, which takes them a batch at a time;
+ * their data is kept in page-aligned buffers so they can be written with
+ * O_DIRECT and bypass the page cache. Every queued file counts towards a
+ * fence until it is written, failed or dropped.
+ */
+
+#include "image_saver.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fd_util.h"
+#include "frame_jpeg.h"
+#include "nvbufsurftransform.h"
+
+#define DEFAULT_QUEUE_DEPTH 4
+#define DEFAULT_MAX_PENDING_MB 64
+#define DEFAULT_NUM_WORKERS 2
+#define DEFAULT_JPEG_QUALITY 80
+#define DEFAULT_WIDTH 1920
+#define DEFAULT_HEIGHT 1080
+
+/* Files the I/O thread takes from the queue per wake-up. */
+#define IO_BATCH 16
+/* Alignment of buffer address and length for O_DIRECT. */
+#define IO_ALIGN 4096
+
+/* Prefix of the messages of the shared JPEG helpers. */
+#define SAVE_OWNER "Image saver"
+
+typedef struct {
+    /* Region of the frame copy. */
+    guint left;
+    guint top;
+    guint width;
+    guint height;
+    /* Offset of the path in SaveSlot.paths. */
+    gsize path;
+} SaveImage;
+
+typedef struct {
+    NvBufSurface *surface;
+    GArray *images;
+    /* NUL-separated paths of the images, reused from frame to frame. */
+    GString *paths;
+} SaveSlot;
+
+typedef struct {
+    gchar *path;
+    /* IO_ALIGN-aligned, zero-padded to aligned_size. */
+    guint8 *data;
+    gsize size;
+    gsize aligned_size;
+} SaveWrite;
+
+struct _ImageSaver {
+    ImageSavePolicy policy;
+    guint queue_depth;
+    gsize max_pending_bytes;
+    guint num_workers;
+    gboolean direct_io;
+    guint jpeg_quality;
+    guint width;
+    guint height;
+
+    SaveSlot *slots;
+    GAsyncQueue *free_slots;
+    GAsyncQueue *jobs;
+    GThread **workers;
+
+    /* Encoded bytes in the queue or being written, under the queue lock. */
+    GAsyncQueue *writes;
+    gsize pending_bytes;
+    GThread *io_thread;
+
+    /* Fence: files queued and not yet written, failed or dropped. */
+    GMutex fence_lock;
+    GCond fence_cond;
+    guint pending;
+
+    atomic_uint_fast64_t frames_submitted;
+    atomic_uint_fast64_t frames_skipped;
+    atomic_uint_fast64_t frames_dropped;
+    atomic_uint_fast64_t images_written;
+    atomic_uint_fast64_t bytes_written;
+    atomic_uint_fast64_t writes_dropped;
+    atomic_uint_fast64_t failed;
+    atomic_uint_fast64_t copy_us;
+    atomic_uint_fast64_t encode_us;
+    atomic_uint_fast64_t write_us;
+};
+
+/* Pushed once per worker, then once to the I/O thread, to make them exit. */
+static SaveSlot save_stop_slot;
+static SaveWrite save_stop_write;
+
+static void
+fence_release(ImageSaver *saver, guint count)
+{
+    if (count == 0)
+        return;
+    g_mutex_lock(&saver->fence_lock);
+    saver->pending -= count;
+    if (saver->pending == 0)
+        g_cond_broadcast(&saver->fence_cond);
+    g_mutex_unlock(&saver->fence_lock);
+}
+
+/* Forgets the files of @slot; returns how many there were. */
+static guint
+slot_clear(SaveSlot *slot)
+{
+    guint count = slot->images->len;
+
+    g_array_set_size(slot->images, 0);
+    g_string_truncate(slot->paths, 0);
+    return count;
+}
+
+static void
+write_free(SaveWrite *write)
+{
+    g_free(write->path);
+    free(write->data);
+    g_free(write);
+}
+
+/* Copies frame @batch_id of @surface, scaled to the slot size if needed. */
+static gboolean
+copy_frame(NvBufSurface *surface, guint batch_id, NvBufSurface *dst_surface)
+{
+    NvBufSurfaceParams *src = &surface->surfaceList[batch_id];
+    NvBufSurfaceParams *dst = &dst_surface->surfaceList[0];
+    NvBufSurfTransformConfigParams session_params;
+    NvBufSurfTransformParams transform_params;
+    NvBufSurfTransformRect src_rect = {0, 0, src->width, src->height};
+    NvBufSurfTransformRect dst_rect = {0, 0, dst->width, dst->height};
+    NvBufSurface frame;
+
+    memset(&session_params, 0, sizeof(session_params));
+    session_params.compute_mode = NvBufSurfTransformCompute_Default;
+    session_params.gpu_id = surface->gpuId;
+    NvBufSurfTransformSetSessionParams(&session_params);
+
+    /* The transform takes whole surfaces: a one-frame batch over batch_id. */
+    frame = *surface;
+    frame.surfaceList = src;
+    frame.numFilled = frame.batchSize = 1;
+
+    memset(&transform_params, 0, sizeof(transform_params));
+    transform_params.transform_flag = NVBUFSURF_TRANSFORM_FILTER |
+                                      NVBUFSURF_TRANSFORM_CROP_SRC | NVBUFSURF_TRANSFORM_CROP_DST;
+    transform_params.transform_filter = NvBufSurfTransformInter_Default;
+    transform_params.src_rect = &src_rect;
+    transform_params.dst_rect = &dst_rect;
+
+    if (NvBufSurfTransform(&frame, dst_surface, &transform_params) ==
+        NvBufSurfTransformError_Success)
+        return TRUE;
+
+    /* CPU fallback, only for RGBA frames of the slot size. */
+    if (src->colorFormat != NVBUF_COLOR_FORMAT_RGBA || src->width != dst->width ||
+        src->height != dst->height)
+        return FALSE;
+    if (NvBufSurfaceMap(surface, batch_id, 0, NVBUF_MAP_READ) != 0)
+        return FALSE;
+    NvBufSurfaceSyncForCpu(surface, batch_id, 0);
+    for (guint y = 0; y < src->height; y++) {
+        memcpy((guint8 *)dst->mappedAddr.addr[0] + (gsize)y * dst->planeParams.pitch[0],
+               (const guint8 *)src->mappedAddr.addr[0] + (gsize)y * src->planeParams.pitch[0],
+               (gsize)src->width * 4);
+    }
+    NvBufSurfaceUnMap(surface, batch_id, 0);
+    NvBufSurfaceSyncForDevice(dst_surface, 0, 0);
+    return TRUE;
+}
+
+/* @rect scaled by @sx, @sy to the frame copy and clipped to it. */
+static gboolean
+image_region(ImageSaver *saver, const NvOSD_RectParams *rect, gdouble sx, gdouble sy,
+             SaveImage *image)
+{
+    gdouble left, top, right, bottom;
+
+    if (!rect) {
+        image->left = image->top = 0;
+        image->width = saver->width;
+        image->height = saver->height;
+        return TRUE;
+    }
+    left = CLAMP(rect->left * sx, 0.0, (gdouble)saver->width);
+    top = CLAMP(rect->top * sy, 0.0, (gdouble)saver->height);
+    right = CLAMP((rect->left + rect->width) * sx, 0.0, (gdouble)saver->width);
+    bottom = CLAMP((rect->top + rect->height) * sy, 0.0, (gdouble)saver->height);
+    image->left = (guint)left;
+    image->top = (guint)top;
+    image->width = (guint)(right + 0.5) - image->left;
+    image->height = (guint)(bottom + 0.5) - image->top;
+    return image->width > 0 && image->height > 0;
+}
+
+gboolean
+image_saver_submit(ImageSaver *saver, NvBufSurface *surface, guint batch_id,
+                   const ImageSaveRequest *images, guint n_images)
+{
+    gint64 start = g_get_monotonic_time();
+    NvBufSurfaceParams *params;
+    SaveSlot *slot;
+    guint count;
+    gdouble sx, sy;
+
+    atomic_fetch_add(&saver->frames_submitted, 1);
+    if (!surface || batch_id >= surface->numFilled || n_images == 0)
+        return FALSE;
+
+    slot = (SaveSlot *)g_async_queue_try_pop(saver->free_slots);
+    if (!slot && saver->policy == IMAGE_SAVE_POLICY_DROP_OLDEST) {
+        /* Oldest frame not yet taken by a worker. */
+        slot = (SaveSlot *)g_async_queue_try_pop(saver->jobs);
+        if (slot) {
+            atomic_fetch_add(&saver->frames_dropped, 1);
+            fence_release(saver, slot_clear(slot));
+        }
+    }
+    if (!slot) {
+        atomic_fetch_add(&saver->frames_skipped, 1);
+        return FALSE;
+    }
+
+    if (!copy_frame(surface, batch_id, slot->surface)) {
+        g_async_queue_push(saver->free_slots, slot);
+        atomic_fetch_add(&saver->failed, 1);
+        return FALSE;
+    }
+
+    params = &surface->surfaceList[batch_id];
+    sx = (gdouble)saver->width / params->width;
+    sy = (gdouble)saver->height / params->height;
+    for (guint i = 0; i < n_images; i++) {
+        SaveImage image;
+
+        if (!image_region(saver, images[i].rect, sx, sy, &image)) {
+            atomic_fetch_add(&saver->failed, 1);
+            continue;
+        }
+        image.path = slot->paths->len;
+        g_string_append_len(slot->paths, images[i].path, strlen(images[i].path) + 1);
+        g_array_append_val(slot->images, image);
+    }
+    count = slot->images->len;
+    if (count == 0) {
+        g_async_queue_push(saver->free_slots, slot);
+        return FALSE;
+    }
+
+    g_mutex_lock(&saver->fence_lock);
+    saver->pending += count;
+    g_mutex_unlock(&saver->fence_lock);
+
+    atomic_fetch_add(&saver->copy_us, g_get_monotonic_time() - start);
+    g_async_queue_push(saver->jobs, slot);
+    return TRUE;
+}
+
+/* Hands @write to the I/O thread, making room in the queue by the policy. */
+static void
+queue_write(ImageSaver *saver, SaveWrite *write)
+{
+    guint dropped = 0;
+
+    g_async_queue_lock(saver->writes);
+    while (saver->pending_bytes + write->size > saver->max_pending_bytes) {
+        SaveWrite *oldest = NULL;
+
+        if (saver->policy == IMAGE_SAVE_POLICY_DROP_OLDEST)
+            oldest = (SaveWrite *)g_async_queue_try_pop_unlocked(saver->writes);
+        if (!oldest)
+            break;
+        saver->pending_bytes -= oldest->size;
+        write_free(oldest);
+        dropped++;
+    }
+    if (saver->pending_bytes + write->size > saver->max_pending_bytes) {
+        write_free(write);
+        dropped++;
+    } else {
+        saver->pending_bytes += write->size;
+        g_async_queue_push_unlocked(saver->writes, write);
+    }
+    g_async_queue_unlock(saver->writes);
+
+    atomic_fetch_add(&saver->writes_dropped, dropped);
+    fence_release(saver, dropped);
+}
+
+static gpointer
+save_worker_loop(gpointer data)
+{
+    ImageSaver *saver = (ImageSaver *)data;
+    FrameJpeg jpeg;
+
+    frame_jpeg_init(&jpeg, SAVE_OWNER, (unsigned long)saver->width * saver->height / 2);
+
+    for (;;) {
+        SaveSlot *slot = (SaveSlot *)g_async_queue_pop(saver->jobs);
+        if (slot == &save_stop_slot)
+            break;
+
+        gint64 start = g_get_monotonic_time();
+        guint failed = 0;
+
+        NvBufSurfaceParams *params = &slot->surface->surfaceList[0];
+        guint pitch = params->planeParams.pitch[0];
+
+        NvBufSurfaceSyncForCpu(slot->surface, 0, 0);
+        for (guint i = 0; i < slot->images->len; i++) {
+            SaveImage *image = &g_array_index(slot->images, SaveImage, i);
+            const guint8 *pixels = (const guint8 *)params->mappedAddr.addr[0] +
+                                   (gsize)image->top * pitch + (gsize)image->left * 4;
+            unsigned long size = frame_jpeg_encode(&jpeg, pixels, pitch, image->width,
+                                                   image->height, saver->jpeg_quality);
+            SaveWrite *write;
+
+            if (size == 0) {
+                failed++;
+                continue;
+            }
+            write = g_new0(SaveWrite, 1);
+            write->size = size;
+            write->aligned_size = (size + IO_ALIGN - 1) & ~(gsize)(IO_ALIGN - 1);
+            if (posix_memalign((void **)&write->data, IO_ALIGN, write->aligned_size) != 0) {
+                g_free(write);
+                failed++;
+                continue;
+            }
+            memcpy(write->data, jpeg.buf, size);
+            memset(write->data + size, 0, write->aligned_size - size);
+            write->path = g_strdup(slot->paths->str + image->path);
+            queue_write(saver, write);
+        }
+        slot_clear(slot);
+        /* Every file of the frame is encoded: the copy can be reused. */
+        g_async_queue_push(saver->free_slots, slot);
+        atomic_fetch_add(&saver->encode_us, g_get_monotonic_time() - start);
+
+        atomic_fetch_add(&saver->failed, failed);
+        fence_release(saver, failed);
+    }
+
+    frame_jpeg_clear(&jpeg);
+    return NULL;
+}
+
+/*
+ * Writes to "<path>.part" and renames it, so readers never see a partial
+ * image. With O_DIRECT the padded buffer is written and the file truncated
+ * to the JPEG size afterwards.
+ */
+static gboolean
+write_file(ImageSaver *saver, const SaveWrite *write)
+{
+    gchar *tmp_path = g_strconcat(write->path, ".part", NULL);
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    gboolean direct = saver->direct_io;
+    gboolean ok = FALSE;
+    int fd = -1;
+
+    if (direct) {
+        fd = open(tmp_path, flags | O_DIRECT, 0644);
+        ok = fd >= 0 && fd_write_all(fd, write->data, write->aligned_size) &&
+             ftruncate(fd, write->size) == 0;
+        if (!ok && errno == EINVAL) {
+            /* Filesystem without O_DIRECT support (tmpfs, some FUSE). */
+            g_printerr("Image saver: O_DIRECT not supported for %s, using buffered writes\n",
+                       write->path);
+            saver->direct_io = direct = FALSE;
+            if (fd >= 0)
+                close(fd);
+            fd = -1;
+        }
+    }
+    if (!direct) {
+        fd = open(tmp_path, flags, 0644);
+        ok = fd >= 0 && fd_write_all(fd, write->data, write->size);
+    }
+    if (fd >= 0 && close(fd) != 0)
+        ok = FALSE;
+    if (ok && rename(tmp_path, write->path) != 0)
+        ok = FALSE;
+    if (!ok) {
+        g_printerr("Image saver: cannot write %s: %s\n", write->path, g_strerror(errno));
+        unlink(tmp_path);
+    }
+    g_free(tmp_path);
+    return ok;
+}
+
+static gpointer
+save_io_loop(gpointer data)
+{
+    ImageSaver *saver = (ImageSaver *)data;
+    SaveWrite *batch[IO_BATCH];
+    gboolean stop = FALSE;
+
+    while (!stop) {
+        guint n = 0;
+
+        /* Block for one file, then take whatever else is already queued. */
+        batch[n++] = (SaveWrite *)g_async_queue_pop(saver->writes);
+        while (n < IO_BATCH &&
+               (batch[n] = (SaveWrite *)g_async_queue_try_pop(saver->writes)) != NULL)
+            n++;
+
+        gint64 start = g_get_monotonic_time();
+        gsize bytes = 0;
+        guint done = 0;
+
+        for (guint i = 0; i < n; i++) {
+            SaveWrite *write = batch[i];
+
+            if (write == &save_stop_write) {
+                stop = TRUE;
+                continue;
+            }
+            if (write_file(saver, write)) {
+                atomic_fetch_add(&saver->images_written, 1);
+                atomic_fetch_add(&saver->bytes_written, write->size);
+            } else {
+                atomic_fetch_add(&saver->failed, 1);
+            }
+            bytes += write->size;
+            done++;
+            write_free(write);
+        }
+        atomic_fetch_add(&saver->write_us, g_get_monotonic_time() - start);
+
+        g_async_queue_lock(saver->writes);
+        saver->pending_bytes -= bytes;
+        g_async_queue_unlock(saver->writes);
+        fence_release(saver, done);
+    }
+    return NULL;
+}
+
+ImageSaver *
+image_saver_new(const ImageSaverConfig *config)
+{
+    ImageSaver *saver = g_new0(ImageSaver, 1);
+    guint i;
+
+    saver->policy = config->policy;
+    saver->queue_depth = config->queue_depth ? config->queue_depth : DEFAULT_QUEUE_DEPTH;
+    saver->max_pending_bytes =
+        (gsize)(config->max_pending_mb ? config->max_pending_mb : DEFAULT_MAX_PENDING_MB)
+        << 20;
+    saver->num_workers = config->num_workers ? config->num_workers : DEFAULT_NUM_WORKERS;
+    saver->direct_io = config->direct_io;
+    saver->jpeg_quality = config->jpeg_quality ? MIN(config->jpeg_quality, 100)
+                                               : DEFAULT_JPEG_QUALITY;
+    saver->width = config->width ? config->width : DEFAULT_WIDTH;
+    saver->height = config->height ? config->height : DEFAULT_HEIGHT;
+    saver->free_slots = g_async_queue_new();
+    saver->jobs = g_async_queue_new();
+    saver->writes = g_async_queue_new();
+    g_mutex_init(&saver->fence_lock);
+    g_cond_init(&saver->fence_cond);
+
+    saver->slots = g_new0(SaveSlot, saver->queue_depth);
+    for (i = 0; i < saver->queue_depth; i++) {
+        SaveSlot *slot = &saver->slots[i];
+
+        slot->images = g_array_new(FALSE, FALSE, sizeof(SaveImage));
+        slot->paths = g_string_sized_new(1024);
+        slot->surface =
+            frame_jpeg_surface_new(SAVE_OWNER, config->gpu_id, saver->width, saver->height);
+        if (!slot->surface)
+            goto error;
+        g_async_queue_push(saver->free_slots, slot);
+    }
+
+    saver->workers = g_new0(GThread *, saver->num_workers);
+    for (i = 0; i < saver->num_workers; i++) {
+        gchar *name = g_strdup_printf("img-save-%u", i);
+        saver->workers[i] = g_thread_new(name, save_worker_loop, saver);
+        g_free(name);
+    }
+    saver->io_thread = g_thread_new("img-save-io", save_io_loop, saver);
+
+    g_print("Image saver: %ux%u, JPEG q%u, %u workers, %u frames in flight, %u MiB write "
+            "queue, %s when full%s\n",
+            saver->width, saver->height, saver->jpeg_quality, saver->num_workers,
+            saver->queue_depth, (guint)(saver->max_pending_bytes >> 20),
+            saver->policy == IMAGE_SAVE_POLICY_DROP_OLDEST ? "drop oldest" : "skip",
+            saver->direct_io ? ", O_DIRECT" : "");
+    return saver;
+
+error:
+    image_saver_free(saver);
+    return NULL;
+}
+
+void
+image_saver_flush(ImageSaver *saver)
+{
+    g_mutex_lock(&saver->fence_lock);
+    while (saver->pending > 0)
+        g_cond_wait(&saver->fence_cond, &saver->fence_lock);
+    g_mutex_unlock(&saver->fence_lock);
+}
+
+void
+image_saver_get_stats(ImageSaver *saver, ImageSaverStats *stats)
+{
+    stats->frames_submitted = atomic_load(&saver->frames_submitted);
+    stats->frames_skipped = atomic_load(&saver->frames_skipped);
+    stats->frames_dropped = atomic_load(&saver->frames_dropped);
+    stats->images_written = atomic_load(&saver->images_written);
+    stats->bytes_written = atomic_load(&saver->bytes_written);
+    stats->writes_dropped = atomic_load(&saver->writes_dropped);
+    stats->failed = atomic_load(&saver->failed);
+    stats->copy_us = atomic_load(&saver->copy_us);
+    stats->encode_us = atomic_load(&saver->encode_us);
+    stats->write_us = atomic_load(&saver->write_us);
+}
+
+void
+image_saver_free(ImageSaver *saver)
+{
+    guint i;
+
+    if (!saver)
+        return;
+
+    if (saver->workers) {
+        image_saver_flush(saver);
+        for (i = 0; i < saver->num_workers; i++)
+            g_async_queue_push(saver->jobs, &save_stop_slot);
+        for (i = 0; i < saver->num_workers; i++)
+            g_thread_join(saver->workers[i]);
+        g_free(saver->workers);
+        g_async_queue_push(saver->writes, &save_stop_write);
+        g_thread_join(saver->io_thread);
+    }
+
+    for (i = 0; i < saver->queue_depth; i++) {
+        SaveSlot *slot = &saver->slots[i];
+
+        frame_jpeg_surface_free(slot->surface);
+        if (slot->images) {
+            g_array_free(slot->images, TRUE);
+            g_string_free(slot->paths, TRUE);
+        }
+    }
+    g_free(saver->slots);
+    g_async_queue_unref(saver->free_slots);
+    g_async_queue_unref(saver->jobs);
+    g_async_queue_unref(saver->writes);
+    g_mutex_clear(&saver->fence_lock);
+    g_cond_clear(&saver->fence_cond);
+    g_free(saver);
+}
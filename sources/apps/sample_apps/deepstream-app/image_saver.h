@@ -0,0 +1,100 @@
+/*
+ * Asynchronous image saving for [img-save].
+ *
+ * On the streaming thread a frame is only copied (NvBufSurfTransform) into a
+ * pooled RGBA surface. Worker threads JPEG-encode the full frame and/or the
+ * object crops cut from that copy, and one I/O thread writes the files, so
+ * a slow disk never holds a buffer of the pipeline. Both the frame copies and
+ * the encoded data waiting for the disk are bounded; when a bound is reached
+ * the newest or the oldest work is dropped, depending on the policy.
+ */
+
+#ifndef __IMAGE_SAVER_H__
+#define __IMAGE_SAVER_H__
+
+#include <glib.h>
+
+#include "nvbufsurface.h"
+#include "nvll_osd_struct.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** What happens to new work when a queue is full. */
+typedef enum {
+    /** The new frame (or file) is not saved (default). */
+    IMAGE_SAVE_POLICY_SKIP,
+    /** The oldest frame (or file) still waiting is given up for it. */
+    IMAGE_SAVE_POLICY_DROP_OLDEST,
+} ImageSavePolicy;
+
+typedef struct {
+    ImageSavePolicy policy;
+    /** Frame copies in flight, waiting for or being encoded. */
+    guint queue_depth;
+    /** Encoded bytes waiting for the I/O thread, MiB. */
+    guint max_pending_mb;
+    guint num_workers;
+    /** Write with O_DIRECT, falls back to buffered writes where unsupported. */
+    gboolean direct_io;
+    /** libjpeg quality, 1-100. */
+    guint jpeg_quality;
+    /** Size of the frame copies, normally the muxer output. */
+    guint width;
+    guint height;
+    guint gpu_id;
+} ImageSaverConfig;
+
+/** One file to produce from a frame. */
+typedef struct {
+    /** Region in frame coordinates, NULL for the whole frame. */
+    const NvOSD_RectParams *rect;
+    const gchar *path;
+} ImageSaveRequest;
+
+typedef struct {
+    guint64 frames_submitted;
+    /** Frames rejected because every copy was in flight (skip policy). */
+    guint64 frames_skipped;
+    /** Queued frames given up for a newer one (drop-oldest policy). */
+    guint64 frames_dropped;
+    guint64 images_written;
+    guint64 bytes_written;
+    /** Encoded images not written because the I/O queue was full. */
+    guint64 writes_dropped;
+    /** Copy, encode or write errors. */
+    guint64 failed;
+    /** Total time spent on the streaming thread / in workers / writing, microseconds. */
+    guint64 copy_us;
+    guint64 encode_us;
+    guint64 write_us;
+} ImageSaverStats;
+
+typedef struct _ImageSaver ImageSaver;
+
+/** Zero fields of @config get defaults. */
+ImageSaver *image_saver_new(const ImageSaverConfig *config);
+
+/**
+ * Copies frame @batch_id of @surface and queues @n_images files cut from it.
+ * Never waits for encoding or the disk. FALSE if nothing was queued: the
+ * frame could not be copied, or every copy is in flight and the policy is
+ * to skip.
+ */
+gboolean image_saver_submit(ImageSaver *saver, NvBufSurface *surface, guint batch_id,
+                            const ImageSaveRequest *images, guint n_images);
+
+/** Waits until everything submitted so far is written, failed or dropped. */
+void image_saver_flush(ImageSaver *saver);
+
+void image_saver_get_stats(ImageSaver *saver, ImageSaverStats *stats);
+
+/** Flushes and stops the threads. */
+void image_saver_free(ImageSaver *saver);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IMAGE_SAVER_H__ */
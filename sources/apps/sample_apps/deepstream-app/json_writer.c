@@ -0,0 +1,125 @@
+/*
+ * JSON writer, see json_writer.h.
+ */
+
+#include "json_writer.h"
+
+#include <string.h>
+
+#define SWAR_ONES G_GUINT64_CONSTANT(0x0101010101010101)
+#define SWAR_HIGHS G_GUINT64_CONSTANT(0x8080808080808080)
+
+static inline gboolean
+json_needs_escape(guchar c)
+{
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+/* Non-zero iff some byte of @v is below 0x20, '"' or '\\'. */
+static inline guint64
+swar_needs_escape(guint64 v)
+{
+    guint64 quote = v ^ (SWAR_ONES * '"');
+    guint64 backslash = v ^ (SWAR_ONES * '\\');
+
+    return (((v - SWAR_ONES * 0x20) & ~v) | ((quote - SWAR_ONES) & ~quote) |
+            ((backslash - SWAR_ONES) & ~backslash)) &
+           SWAR_HIGHS;
+}
+
+/* Length of the prefix of @s[0..len) that can be copied without escaping. */
+static gsize
+json_plain_span(const gchar *s, gsize len)
+{
+    gsize i = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        guint64 v;
+        memcpy(&v, s + i, 8);
+        if (swar_needs_escape(v))
+            break;
+    }
+    for (; i < len; i++) {
+        if (json_needs_escape((guchar)s[i]))
+            break;
+    }
+    return i;
+}
+
+void
+json_append_string(GString *out, const gchar *s)
+{
+    static const gchar hex[] = "0123456789abcdef";
+    gsize len = strlen(s);
+
+    g_string_append_c(out, '"');
+    while (len > 0) {
+        gsize span = json_plain_span(s, len);
+        g_string_append_len(out, s, span);
+        if (span == len)
+            break;
+
+        guchar c = (guchar)s[span];
+        gchar esc[6] = {'\\', (gchar)c, 0, 0, 0, 0};
+        gsize esc_len = 2;
+        switch (c) {
+        case '"':
+        case '\\':
+            break;
+        case '\b':
+            esc[1] = 'b';
+            break;
+        case '\f':
+            esc[1] = 'f';
+            break;
+        case '\n':
+            esc[1] = 'n';
+            break;
+        case '\r':
+            esc[1] = 'r';
+            break;
+        case '\t':
+            esc[1] = 't';
+            break;
+        default:
+            memcpy(esc + 1, "u00", 3);
+            esc[4] = hex[c >> 4];
+            esc[5] = hex[c & 0xF];
+            esc_len = 6;
+            break;
+        }
+        g_string_append_len(out, esc, esc_len);
+        s += span + 1;
+        len -= span + 1;
+    }
+    g_string_append_c(out, '"');
+}
+
+void
+json_append_member(GString *out, const gchar *name, const gchar *value)
+{
+    g_string_append_c(out, '"');
+    g_string_append(out, name);
+    g_string_append_len(out, "\":", 2);
+    json_append_string(out, value);
+}
+
+void
+json_append_int_member(GString *out, const gchar *name, gint64 value)
+{
+    gchar digits[24];
+    gchar *p = digits + sizeof(digits);
+    guint64 v = value < 0 ? -(guint64)value : (guint64)value;
+
+    do {
+        *--p = (gchar)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    if (value < 0)
+        *--p = '-';
+
+    g_string_append_c(out, '"');
+    g_string_append(out, name);
+    g_string_append_len(out, "\":", 2);
+    g_string_append_len(out, p, digits + sizeof(digits) - p);
+}
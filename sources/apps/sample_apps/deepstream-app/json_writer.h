@@ -0,0 +1,32 @@
+/*
+ * Minimal JSON writer for payloads with a fixed schema.
+ *
+ * Values are appended straight to a GString, which callers reuse so that
+ * steady-state serialization does not allocate. Strings are scanned for
+ * characters that need escaping eight bytes at a time and copied in whole
+ * runs.
+ */
+
+#ifndef __JSON_WRITER_H__
+#define __JSON_WRITER_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Appends @s as a JSON string literal. */
+void json_append_string(GString *out, const gchar *s);
+
+/** Appends "name":"value"; @name is not escaped. */
+void json_append_member(GString *out, const gchar *name, const gchar *value);
+
+/** Appends "name":value. */
+void json_append_int_member(GString *out, const gchar *name, gint64 value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSON_WRITER_H__ */
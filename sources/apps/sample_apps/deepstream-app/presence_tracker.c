@@ -0,0 +1,333 @@
+/*
+ * Presence tracker, see presence_tracker.h.
+ *
+ * Entries live in a pool and are addressed by index. The hash table holds
+ * pool indices (linear probing, backward-shift deletion, so no tombstones
+ * pile up) keyed by (source + 1) << 32 | id; source PRESENCE_ANY_SOURCE
+ * wraps to 0 and gives the cross-camera entry of a person.
+ *
+ * Timer wheel: three levels of 64 one-second slots (~73 hours). A sighting
+ * only stamps last_seen; the entry stays filed under its old deadline and is
+ * re-filed lazily when that slot comes up, so the per-detection path never
+ * touches the wheel.
+ */
+
+#include "presence_tracker.h"
+
+#include <string.h>
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 3
+#define WHEEL_SPAN ((gint64)1 << (WHEEL_BITS * WHEEL_LEVELS))
+
+#define INITIAL_CAPACITY 1024
+#define NO_ENTRY G_MAXUINT32
+
+typedef struct {
+    guint64 key;
+    gint64 last_seen;
+    /* Tick of the wheel slot the entry is filed under. */
+    gint64 deadline;
+    /* Next entry in the wheel slot, or in the free list. */
+    guint32 next;
+} PresenceEntry;
+
+struct _PresenceTracker {
+    GMutex lock;
+    gint64 timeout;
+    PresenceExpiredCallback expired_cb;
+    gpointer user_data;
+
+    PresenceEntry *entries;
+    guint32 num_entries;
+    guint32 entries_capacity;
+    guint32 free_entries;
+
+    guint32 *table;
+    guint32 table_mask;
+    guint32 table_count;
+
+    guint32 wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+    /* Last tick processed; -1 until the first call. */
+    gint64 now;
+
+    guint present;
+    guint present_at_sources;
+    guint64 arrivals;
+    guint64 departures;
+};
+
+static inline guint64
+presence_key(guint32 id, guint source_id)
+{
+    return ((guint64)(guint32)(source_id + 1) << 32) | id;
+}
+
+static inline guint32
+key_hash(guint64 key)
+{
+    /* murmur3 finalizer */
+    key ^= key >> 33;
+    key *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+    key ^= key >> 33;
+    key *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+    key ^= key >> 33;
+    return (guint32)key;
+}
+
+/* Position of @key in the table, or of the empty slot where it would go. */
+static guint32
+table_find(PresenceTracker *t, guint64 key)
+{
+    guint32 pos = key_hash(key) & t->table_mask;
+
+    while (t->table[pos] != NO_ENTRY && t->entries[t->table[pos]].key != key)
+        pos = (pos + 1) & t->table_mask;
+    return pos;
+}
+
+static void
+table_resize(PresenceTracker *t, guint32 capacity)
+{
+    guint32 *old_table = t->table;
+    guint32 old_capacity = t->table ? t->table_mask + 1 : 0;
+
+    t->table = g_new(guint32, capacity);
+    memset(t->table, 0xff, sizeof(guint32) * capacity);
+    t->table_mask = capacity - 1;
+    for (guint32 i = 0; i < old_capacity; i++) {
+        if (old_table[i] != NO_ENTRY)
+            t->table[table_find(t, t->entries[old_table[i]].key)] = old_table[i];
+    }
+    g_free(old_table);
+}
+
+/* Empties @pos, shifting back later members of its probe run. */
+static void
+table_remove_at(PresenceTracker *t, guint32 pos)
+{
+    guint32 hole = pos;
+    guint32 next = pos;
+
+    for (;;) {
+        next = (next + 1) & t->table_mask;
+        if (t->table[next] == NO_ENTRY)
+            break;
+        guint32 home = key_hash(t->entries[t->table[next]].key) & t->table_mask;
+        /* Move it into the hole unless its home lies cyclically in (hole, next]. */
+        gboolean stays = hole <= next ? (hole < home && home <= next)
+                                      : (hole < home || home <= next);
+        if (!stays) {
+            t->table[hole] = t->table[next];
+            hole = next;
+        }
+    }
+    t->table[hole] = NO_ENTRY;
+    t->table_count--;
+}
+
+static guint32
+entry_alloc(PresenceTracker *t)
+{
+    guint32 index;
+
+    if (t->free_entries != NO_ENTRY) {
+        index = t->free_entries;
+        t->free_entries = t->entries[index].next;
+        return index;
+    }
+    if (t->num_entries == t->entries_capacity) {
+        t->entries_capacity *= 2;
+        t->entries = g_renew(PresenceEntry, t->entries, t->entries_capacity);
+    }
+    return t->num_entries++;
+}
+
+static void
+entry_release(PresenceTracker *t, guint32 index)
+{
+    t->entries[index].next = t->free_entries;
+    t->free_entries = index;
+}
+
+static void
+wheel_insert(PresenceTracker *t, guint32 index)
+{
+    PresenceEntry *e = &t->entries[index];
+    gint64 delta;
+    guint level;
+    guint slot;
+
+    /* deadline == now only happens while cascading in wheel_tick(), before
+     * the level 0 slot of now is processed. */
+    delta = CLAMP(e->deadline - t->now, 0, WHEEL_SPAN - 1);
+    e->deadline = t->now + delta;
+
+    for (level = 0; level < WHEEL_LEVELS - 1; level++) {
+        if (delta < ((gint64)1 << (WHEEL_BITS * (level + 1))))
+            break;
+    }
+    slot = (guint)(e->deadline >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    e->next = t->wheel[level][slot];
+    t->wheel[level][slot] = index;
+}
+
+static void
+expire_entry(PresenceTracker *t, guint32 index)
+{
+    guint64 key = t->entries[index].key;
+    guint source_id = (guint)(key >> 32) - 1;
+
+    table_remove_at(t, table_find(t, key));
+    entry_release(t, index);
+    if (source_id == PRESENCE_ANY_SOURCE) {
+        t->present--;
+        t->departures++;
+    } else {
+        t->present_at_sources--;
+    }
+    if (t->expired_cb)
+        t->expired_cb((guint32)key, source_id, t->user_data);
+}
+
+/* Processes tick t->now + 1. */
+static void
+wheel_tick(PresenceTracker *t)
+{
+    guint32 index, next;
+
+    t->now++;
+
+    /* Bring the next block of higher-level slots down, coarsest first. */
+    for (guint level = WHEEL_LEVELS - 1; level > 0; level--) {
+        if (t->now & (((gint64)1 << (WHEEL_BITS * level)) - 1))
+            continue;
+        guint slot = (guint)(t->now >> (WHEEL_BITS * level)) & WHEEL_MASK;
+        index = t->wheel[level][slot];
+        t->wheel[level][slot] = NO_ENTRY;
+        for (; index != NO_ENTRY; index = next) {
+            next = t->entries[index].next;
+            wheel_insert(t, index);
+        }
+    }
+
+    index = t->wheel[0][t->now & WHEEL_MASK];
+    t->wheel[0][t->now & WHEEL_MASK] = NO_ENTRY;
+    for (; index != NO_ENTRY; index = next) {
+        PresenceEntry *e = &t->entries[index];
+        next = e->next;
+        if (e->last_seen + t->timeout > t->now) {
+            e->deadline = e->last_seen + t->timeout;
+            wheel_insert(t, index);
+        } else {
+            expire_entry(t, index);
+        }
+    }
+}
+
+static void
+advance_to(PresenceTracker *t, gint64 now_s)
+{
+    if (t->now < 0 || (t->table_count == 0 && now_s > t->now)) {
+        t->now = now_s;
+        return;
+    }
+    while (t->now < now_s)
+        wheel_tick(t);
+}
+
+/* Refreshes or creates the entry for @key; TRUE if it was created. */
+static gboolean
+touch(PresenceTracker *t, guint64 key, gint64 now_s)
+{
+    guint32 pos = table_find(t, key);
+    guint32 index;
+
+    if (t->table[pos] != NO_ENTRY) {
+        t->entries[t->table[pos]].last_seen = now_s;
+        return FALSE;
+    }
+
+    if ((t->table_count + 1) * 2 > t->table_mask + 1) {
+        table_resize(t, (t->table_mask + 1) * 2);
+        pos = table_find(t, key);
+    }
+    index = entry_alloc(t);
+    t->entries[index].key = key;
+    t->entries[index].last_seen = now_s;
+    t->entries[index].deadline = now_s + t->timeout;
+    t->table[pos] = index;
+    t->table_count++;
+    wheel_insert(t, index);
+    return TRUE;
+}
+
+guint
+presence_tracker_observe(PresenceTracker *t, guint32 id, guint source_id, gint64 now_s)
+{
+    guint change = PRESENCE_STILL_PRESENT;
+
+    g_mutex_lock(&t->lock);
+    advance_to(t, now_s);
+    if (touch(t, presence_key(id, source_id), now_s)) {
+        change |= PRESENCE_ARRIVED_AT_SOURCE;
+        t->present_at_sources++;
+    }
+    if (touch(t, presence_key(id, PRESENCE_ANY_SOURCE), now_s)) {
+        change |= PRESENCE_ARRIVED;
+        t->present++;
+        t->arrivals++;
+    }
+    g_mutex_unlock(&t->lock);
+    return change;
+}
+
+void
+presence_tracker_expire(PresenceTracker *t, gint64 now_s)
+{
+    g_mutex_lock(&t->lock);
+    advance_to(t, now_s);
+    g_mutex_unlock(&t->lock);
+}
+
+void
+presence_tracker_get_stats(PresenceTracker *t, PresenceTrackerStats *stats)
+{
+    g_mutex_lock(&t->lock);
+    stats->present = t->present;
+    stats->present_at_sources = t->present_at_sources;
+    stats->arrivals = t->arrivals;
+    stats->departures = t->departures;
+    g_mutex_unlock(&t->lock);
+}
+
+PresenceTracker *
+presence_tracker_new(guint timeout_s, PresenceExpiredCallback expired_cb, gpointer user_data)
+{
+    PresenceTracker *t = g_new0(PresenceTracker, 1);
+
+    g_mutex_init(&t->lock);
+    t->timeout = CLAMP((gint64)timeout_s, 1, WHEEL_SPAN - 1);
+    t->expired_cb = expired_cb;
+    t->user_data = user_data;
+    t->entries_capacity = INITIAL_CAPACITY;
+    t->entries = g_new(PresenceEntry, t->entries_capacity);
+    t->free_entries = NO_ENTRY;
+    table_resize(t, INITIAL_CAPACITY * 2);
+    memset(t->wheel, 0xff, sizeof(t->wheel));
+    t->now = -1;
+    return t;
+}
+
+void
+presence_tracker_free(PresenceTracker *t)
+{
+    if (!t)
+        return;
+    g_mutex_clear(&t->lock);
+    g_free(t->entries);
+    g_free(t->table);
+    g_free(t);
+}
@@ -0,0 +1,72 @@
+/*
+ * Presence of recognised people, per camera and across all cameras.
+ *
+ * People are keyed by integer identity in an open-addressing hash table, so
+ * the per-detection lookup costs the same with ten or ten thousand enrolled
+ * students. Absence is detected by a hierarchical timer wheel: only entries
+ * whose deadline comes up are looked at, never the whole population.
+ */
+
+#ifndef __PRESENCE_TRACKER_H__
+#define __PRESENCE_TRACKER_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Source id passed to the expiry callback for presence across all cameras. */
+#define PRESENCE_ANY_SOURCE G_MAXUINT
+
+/** Returned by presence_tracker_observe(). */
+typedef enum {
+    /** Already present; only the last-seen time was refreshed. */
+    PRESENCE_STILL_PRESENT = 0,
+    /** Not present on this camera before. */
+    PRESENCE_ARRIVED_AT_SOURCE = 1 << 0,
+    /** Not present on any camera before. */
+    PRESENCE_ARRIVED = 1 << 1,
+} PresenceChange;
+
+typedef struct {
+    /** People currently present on at least one camera. */
+    guint present;
+    /** (person, camera) pairs currently present. */
+    guint present_at_sources;
+    guint64 arrivals;
+    guint64 departures;
+} PresenceTrackerStats;
+
+typedef struct _PresenceTracker PresenceTracker;
+
+/**
+ * Called when @id has not been seen on @source_id (PRESENCE_ANY_SOURCE: on
+ * any camera) for the timeout. Runs with the tracker locked, so it must not
+ * call back into it.
+ */
+typedef void (*PresenceExpiredCallback)(guint32 id, guint source_id, gpointer user_data);
+
+/** @timeout_s: seconds without a sighting after which a person is absent. */
+PresenceTracker *presence_tracker_new(guint timeout_s, PresenceExpiredCallback expired_cb,
+                                      gpointer user_data);
+
+/**
+ * Records a sighting of @id on @source_id at monotonic time @now_s and
+ * returns the PresenceChange flags. O(1); safe to call from any thread.
+ */
+guint presence_tracker_observe(PresenceTracker *tracker, guint32 id, guint source_id,
+                               gint64 now_s);
+
+/** Ends the presence of everyone not seen for the timeout as of @now_s. */
+void presence_tracker_expire(PresenceTracker *tracker, gint64 now_s);
+
+void presence_tracker_get_stats(PresenceTracker *tracker, PresenceTrackerStats *stats);
+
+void presence_tracker_free(PresenceTracker *tracker);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PRESENCE_TRACKER_H__ */
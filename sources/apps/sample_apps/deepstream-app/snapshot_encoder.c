@@ -0,0 +1,464 @@
+/*
+ * Snapshot service, see snapshot_encoder.h.
+ *
+ * A slot holds a preallocated RGBA surface per image the policy asks for
+ * (face crop, context frame), mapped for the CPU once at startup. Free
+ * slots and filled slots waiting for a worker live in two GAsyncQueues; a
+ * slot returns to the free queue once its JPEGs have been produced, so the
+ * number of slots bounds both GPU memory and the encode backlog.
+ */
+
+#include "snapshot_encoder.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fast_base64.h"
+#include "frame_jpeg.h"
+#include "nvbufsurftransform.h"
+
+#define DEFAULT_FACE_WIDTH 256
+#define DEFAULT_FACE_HEIGHT 256
+#define DEFAULT_FACE_MARGIN 25
+#define DEFAULT_SNAPSHOT_WIDTH 640
+#define DEFAULT_SNAPSHOT_HEIGHT 360
+#define DEFAULT_JPEG_QUALITY 85
+#define DEFAULT_NUM_WORKERS 2
+#define DEFAULT_POOL_SIZE 4
+
+#define DATA_URI_PREFIX "data:image/jpeg;base64,"
+
+/* Prefix of the messages of the shared JPEG helpers. */
+#define SNAPSHOT_OWNER "Snapshot encoder"
+
+typedef struct {
+    /* NULL when the policy does not produce that image. */
+    NvBufSurface *face;
+    NvBufSurface *context;
+    /* Which of them were filled for the current event. */
+    gboolean has_face;
+    gboolean has_context;
+    RecognitionEvent *event;
+} SnapshotSlot;
+
+struct _SnapshotEncoder {
+    SnapshotPolicy policy;
+    guint face_width;
+    guint face_height;
+    guint face_margin;
+    guint width;
+    guint height;
+    guint jpeg_quality;
+    guint num_workers;
+    guint pool_size;
+
+    SnapshotSlot *slots;
+    GAsyncQueue *free_slots;
+    GAsyncQueue *jobs;
+    GThread **workers;
+
+    SnapshotDoneCallback done_cb;
+    gpointer user_data;
+
+    atomic_uint_fast64_t submitted;
+    atomic_uint_fast64_t busy;
+    atomic_uint_fast64_t captured;
+    atomic_uint_fast64_t failed;
+    atomic_uint_fast64_t encoded;
+    atomic_uint_fast64_t encoded_bytes;
+    atomic_uint_fast64_t capture_us;
+    atomic_uint_fast64_t encode_us;
+};
+
+/* Pushed once per worker to make it exit. */
+static SnapshotSlot snapshot_stop_marker;
+
+/*
+ * CPU fallback scaler for when NvBufSurfTransform cannot handle the source:
+ * 8.8 fixed-point bilinear with per-column taps computed once, the vertical
+ * blend done a whole row at a time so both passes vectorize.
+ */
+static void
+snapshot_resize_rgba(const guint8 *src, guint src_pitch, guint src_width, guint src_height,
+                     guint8 *dst, guint dst_pitch, guint dst_width, guint dst_height)
+{
+    guint32 *x_offset = g_new(guint32, dst_width);
+    guint16 *x_weight = g_new(guint16, dst_width);
+    guint16 *row = g_new(guint16, (gsize)src_width * 4 + 4);
+    guint x, y, c;
+
+    for (x = 0; x < dst_width; x++) {
+        /* Pixel centres aligned: src = (dst + 0.5) * ratio - 0.5 */
+        gint64 fx = (((gint64)x * 2 + 1) * src_width * 256) / (dst_width * 2) - 128;
+        if (fx < 0)
+            fx = 0;
+        guint sx = (guint)(fx >> 8);
+        if (sx >= src_width - 1) {
+            sx = src_width - 1;
+            fx = (gint64)sx << 8;
+        }
+        x_offset[x] = sx * 4;
+        x_weight[x] = (guint16)(fx & 0xFF);
+    }
+
+    for (y = 0; y < dst_height; y++) {
+        gint64 fy = (((gint64)y * 2 + 1) * src_height * 256) / (dst_height * 2) - 128;
+        if (fy < 0)
+            fy = 0;
+        guint sy = (guint)(fy >> 8);
+        guint wy = (guint)(fy & 0xFF);
+        if (sy >= src_height - 1) {
+            sy = src_height - 1;
+            wy = 0;
+        }
+        const guint8 *r0 = src + (gsize)sy * src_pitch;
+        const guint8 *r1 = src + (gsize)MIN(sy + 1, src_height - 1) * src_pitch;
+
+        for (x = 0; x < src_width * 4; x++)
+            row[x] = (guint16)((r0[x] * (256 - wy) + r1[x] * wy) >> 8);
+        /* Duplicate the last pixel so the right tap never reads past the row. */
+        for (c = 0; c < 4; c++)
+            row[src_width * 4 + c] = row[(src_width - 1) * 4 + c];
+
+        guint8 *out = dst + (gsize)y * dst_pitch;
+        for (x = 0; x < dst_width; x++) {
+            const guint16 *p = row + x_offset[x];
+            guint wx = x_weight[x];
+            for (c = 0; c < 4; c++)
+                out[x * 4 + c] = (guint8)((p[c] * (256 - wx) + p[c + 4] * wx + 128) >> 8);
+        }
+    }
+
+    g_free(x_offset);
+    g_free(x_weight);
+    g_free(row);
+}
+
+static gboolean
+capture_region_cpu(NvBufSurface *surface, guint batch_id, const NvBufSurfTransformRect *rect,
+                   NvBufSurface *dst_surface)
+{
+    NvBufSurfaceParams *src = &surface->surfaceList[batch_id];
+    NvBufSurfaceParams *dst = &dst_surface->surfaceList[0];
+    guint pitch = src->planeParams.pitch[0];
+
+    if (src->colorFormat != NVBUF_COLOR_FORMAT_RGBA)
+        return FALSE;
+    if (NvBufSurfaceMap(surface, batch_id, 0, NVBUF_MAP_READ) != 0)
+        return FALSE;
+    NvBufSurfaceSyncForCpu(surface, batch_id, 0);
+
+    /* Only the rows and columns of the region are read. */
+    snapshot_resize_rgba((const guint8 *)src->mappedAddr.addr[0] + (gsize)rect->top * pitch +
+                             (gsize)rect->left * 4,
+                         pitch, rect->width, rect->height, (guint8 *)dst->mappedAddr.addr[0],
+                         dst->planeParams.pitch[0], dst->width, dst->height);
+
+    NvBufSurfaceUnMap(surface, batch_id, 0);
+    NvBufSurfaceSyncForDevice(dst_surface, 0, 0);
+    return TRUE;
+}
+
+/* Scales (and converts to RGBA) @rect of frame @batch_id into @dst_surface. */
+static gboolean
+capture_region(NvBufSurface *surface, guint batch_id, const NvBufSurfTransformRect *rect,
+               NvBufSurface *dst_surface)
+{
+    NvBufSurfaceParams *params = &surface->surfaceList[batch_id];
+    NvBufSurfTransformParams transform_params;
+    NvBufSurfTransformRect src_rect = *rect;
+    NvBufSurfTransformRect dst_rect = {0, 0, dst_surface->surfaceList[0].width,
+                                       dst_surface->surfaceList[0].height};
+    NvBufSurface frame;
+
+    /* View of the single frame batch_id. */
+    frame = *surface;
+    frame.surfaceList = params;
+    frame.numFilled = frame.batchSize = 1;
+
+    memset(&transform_params, 0, sizeof(transform_params));
+    transform_params.transform_flag =
+        NVBUFSURF_TRANSFORM_FILTER | NVBUFSURF_TRANSFORM_CROP_SRC | NVBUFSURF_TRANSFORM_CROP_DST;
+    /* Super-sampling on GPU, 10-tap on VIC: proper area filtering for downscales. */
+    transform_params.transform_filter = NvBufSurfTransformInter_Algo2;
+    transform_params.src_rect = &src_rect;
+    transform_params.dst_rect = &dst_rect;
+
+    if (NvBufSurfTransform(&frame, dst_surface, &transform_params) ==
+        NvBufSurfTransformError_Success)
+        return TRUE;
+
+    return capture_region_cpu(surface, batch_id, rect, dst_surface);
+}
+
+/*
+ * Detector box grown by the margin, widened or heightened to the aspect
+ * ratio of the face snapshot so the crop is not distorted, and shifted /
+ * clipped to stay inside the frame. FALSE if nothing of it is visible.
+ */
+static gboolean
+face_crop_rect(SnapshotEncoder *enc, const NvBufSurfaceParams *params,
+               const NvOSD_RectParams *box, NvBufSurfTransformRect *crop)
+{
+    gdouble aspect = (gdouble)enc->face_width / enc->face_height;
+    gdouble margin = enc->face_margin / 100.0;
+    gdouble w = box->width * (1.0 + 2.0 * margin);
+    gdouble h = box->height * (1.0 + 2.0 * margin);
+    gdouble cx = box->left + box->width / 2.0;
+    gdouble cy = box->top + box->height / 2.0;
+    gdouble left, top;
+
+    if (box->width <= 0 || box->height <= 0)
+        return FALSE;
+
+    if (w < h * aspect)
+        w = h * aspect;
+    else
+        h = w / aspect;
+    w = MIN(w, params->width);
+    h = MIN(h, params->height);
+
+    left = CLAMP(cx - w / 2.0, 0.0, params->width - w);
+    top = CLAMP(cy - h / 2.0, 0.0, params->height - h);
+    crop->left = (guint)left;
+    crop->top = (guint)top;
+    crop->width = MIN((guint)(w + 0.5), params->width - crop->left);
+    crop->height = MIN((guint)(h + 0.5), params->height - crop->top);
+    return crop->width >= 2 && crop->height >= 2;
+}
+
+gboolean
+snapshot_encoder_submit(SnapshotEncoder *enc, NvBufSurface *surface, guint batch_id,
+                        const NvOSD_RectParams *face_rect, RecognitionEvent *event)
+{
+    gint64 start = g_get_monotonic_time();
+    NvBufSurfTransformConfigParams session_params;
+    NvBufSurfTransformRect crop, whole;
+    NvBufSurfaceParams *params;
+    SnapshotSlot *slot;
+    gboolean want_face;
+
+    atomic_fetch_add(&enc->submitted, 1);
+    if (!surface || surface->numFilled == 0) {
+        atomic_fetch_add(&enc->failed, 1);
+        return FALSE;
+    }
+    if (batch_id >= surface->numFilled)
+        batch_id = 0;
+    params = &surface->surfaceList[batch_id];
+    whole = (NvBufSurfTransformRect){0, 0, params->width, params->height};
+    want_face = enc->policy != SNAPSHOT_POLICY_CONTEXT && face_rect &&
+                face_crop_rect(enc, params, face_rect, &crop);
+    if (!want_face && enc->policy == SNAPSHOT_POLICY_FACE)
+        return FALSE;
+
+    slot = (SnapshotSlot *)g_async_queue_try_pop(enc->free_slots);
+    if (!slot) {
+        atomic_fetch_add(&enc->busy, 1);
+        return FALSE;
+    }
+
+    memset(&session_params, 0, sizeof(session_params));
+    session_params.compute_mode = NvBufSurfTransformCompute_Default;
+    session_params.gpu_id = surface->gpuId;
+    NvBufSurfTransformSetSessionParams(&session_params);
+
+    slot->has_face = want_face && capture_region(surface, batch_id, &crop, slot->face);
+    slot->has_context = slot->context && capture_region(surface, batch_id, &whole, slot->context);
+    if (!slot->has_face && !slot->has_context) {
+        g_async_queue_push(enc->free_slots, slot);
+        atomic_fetch_add(&enc->failed, 1);
+        return FALSE;
+    }
+
+    slot->event = event;
+    atomic_fetch_add(&enc->captured, 1);
+    atomic_fetch_add(&enc->capture_us, g_get_monotonic_time() - start);
+    g_async_queue_push(enc->jobs, slot);
+    return TRUE;
+}
+
+static gchar *
+jpeg_to_data_uri(const unsigned char *jpeg, unsigned long size)
+{
+    const size_t prefix_len = sizeof(DATA_URI_PREFIX) - 1;
+    gchar *uri = (gchar *)malloc(prefix_len + base64_encoded_length(size) + 1);
+
+    if (!uri)
+        return NULL;
+    memcpy(uri, DATA_URI_PREFIX, prefix_len);
+    size_t n = base64_encode_to(uri + prefix_len, jpeg, size);
+    uri[prefix_len + n] = '\0';
+    return uri;
+}
+
+static gchar *
+encode_image(SnapshotEncoder *enc, FrameJpeg *jpeg, NvBufSurface *surface)
+{
+    NvBufSurfaceParams *params = &surface->surfaceList[0];
+    unsigned long size;
+    gchar *uri;
+
+    NvBufSurfaceSyncForCpu(surface, 0, 0);
+    size = frame_jpeg_encode(jpeg, (const guint8 *)params->mappedAddr.addr[0],
+                             params->planeParams.pitch[0], params->width, params->height,
+                             enc->jpeg_quality);
+    uri = size > 0 ? jpeg_to_data_uri(jpeg->buf, size) : NULL;
+
+    if (uri) {
+        atomic_fetch_add(&enc->encoded, 1);
+        atomic_fetch_add(&enc->encoded_bytes, size);
+    } else {
+        atomic_fetch_add(&enc->failed, 1);
+    }
+    return uri;
+}
+
+static gpointer
+snapshot_worker_loop(gpointer data)
+{
+    SnapshotEncoder *enc = (SnapshotEncoder *)data;
+    FrameJpeg jpeg;
+
+    /* A JPEG of a camera frame is far below 1 byte per pixel at sane qualities. */
+    frame_jpeg_init(
+        &jpeg, SNAPSHOT_OWNER,
+        (unsigned long)MAX(enc->width * enc->height, enc->face_width * enc->face_height) / 2);
+
+    for (;;) {
+        SnapshotSlot *slot = (SnapshotSlot *)g_async_queue_pop(enc->jobs);
+        if (slot == &snapshot_stop_marker)
+            break;
+
+        gint64 start = g_get_monotonic_time();
+        RecognitionEvent *event = slot->event;
+
+        if (slot->has_face)
+            event->face_image = encode_image(enc, &jpeg, slot->face);
+        if (slot->has_context)
+            event->context_image = encode_image(enc, &jpeg, slot->context);
+        slot->event = NULL;
+        /* Both images are compressed: the slot can take the next event. */
+        g_async_queue_push(enc->free_slots, slot);
+        atomic_fetch_add(&enc->encode_us, g_get_monotonic_time() - start);
+
+        enc->done_cb(event, enc->user_data);
+    }
+
+    frame_jpeg_clear(&jpeg);
+    return NULL;
+}
+
+static const gchar *
+snapshot_policy_name(SnapshotPolicy policy)
+{
+    switch (policy) {
+    case SNAPSHOT_POLICY_CONTEXT:
+        return "context";
+    case SNAPSHOT_POLICY_BOTH:
+        return "face+context";
+    default:
+        return "face";
+    }
+}
+
+SnapshotEncoder *
+snapshot_encoder_new(const NvDsSnapshotConfig *config, SnapshotDoneCallback done_cb,
+                     gpointer user_data)
+{
+    SnapshotEncoder *enc = g_new0(SnapshotEncoder, 1);
+    guint i;
+
+    enc->policy = config->policy;
+    enc->face_width = config->face_width ? config->face_width : DEFAULT_FACE_WIDTH;
+    enc->face_height = config->face_height ? config->face_height : DEFAULT_FACE_HEIGHT;
+    enc->face_margin = config->face_margin ? config->face_margin : DEFAULT_FACE_MARGIN;
+    enc->width = config->width ? config->width : DEFAULT_SNAPSHOT_WIDTH;
+    enc->height = config->height ? config->height : DEFAULT_SNAPSHOT_HEIGHT;
+    enc->jpeg_quality = config->jpeg_quality ? MIN(config->jpeg_quality, 100)
+                                             : DEFAULT_JPEG_QUALITY;
+    enc->num_workers = config->num_workers ? config->num_workers : DEFAULT_NUM_WORKERS;
+    enc->pool_size = config->pool_size ? config->pool_size : DEFAULT_POOL_SIZE;
+    enc->done_cb = done_cb;
+    enc->user_data = user_data;
+    enc->free_slots = g_async_queue_new();
+    enc->jobs = g_async_queue_new();
+
+    enc->slots = g_new0(SnapshotSlot, enc->pool_size);
+    for (i = 0; i < enc->pool_size; i++) {
+        SnapshotSlot *slot = &enc->slots[i];
+        if (enc->policy != SNAPSHOT_POLICY_CONTEXT) {
+            slot->face = frame_jpeg_surface_new(SNAPSHOT_OWNER, config->gpu_id, enc->face_width,
+                                                enc->face_height);
+            if (!slot->face)
+                goto error;
+        }
+        if (enc->policy != SNAPSHOT_POLICY_FACE) {
+            slot->context =
+                frame_jpeg_surface_new(SNAPSHOT_OWNER, config->gpu_id, enc->width, enc->height);
+            if (!slot->context)
+                goto error;
+        }
+        g_async_queue_push(enc->free_slots, slot);
+    }
+
+    enc->workers = g_new0(GThread *, enc->num_workers);
+    for (i = 0; i < enc->num_workers; i++) {
+        gchar *name = g_strdup_printf("snapshot-%u", i);
+        enc->workers[i] = g_thread_new(name, snapshot_worker_loop, enc);
+        g_free(name);
+    }
+
+    g_print("Snapshot encoder: %s (face %ux%u +%u%%, context %ux%u), JPEG q%u, %u workers, "
+            "%u buffers\n",
+            snapshot_policy_name(enc->policy), enc->face_width, enc->face_height,
+            enc->face_margin, enc->width, enc->height, enc->jpeg_quality, enc->num_workers,
+            enc->pool_size);
+    return enc;
+
+error:
+    snapshot_encoder_free(enc);
+    return NULL;
+}
+
+void
+snapshot_encoder_get_stats(SnapshotEncoder *enc, SnapshotEncoderStats *stats)
+{
+    stats->submitted = atomic_load(&enc->submitted);
+    stats->busy = atomic_load(&enc->busy);
+    stats->captured = atomic_load(&enc->captured);
+    stats->failed = atomic_load(&enc->failed);
+    stats->encoded = atomic_load(&enc->encoded);
+    stats->encoded_bytes = atomic_load(&enc->encoded_bytes);
+    stats->capture_us = atomic_load(&enc->capture_us);
+    stats->encode_us = atomic_load(&enc->encode_us);
+}
+
+void
+snapshot_encoder_free(SnapshotEncoder *enc)
+{
+    guint i;
+
+    if (!enc)
+        return;
+
+    if (enc->workers) {
+        /* Queued after every pending job, so those still get encoded. */
+        for (i = 0; i < enc->num_workers; i++)
+            g_async_queue_push(enc->jobs, &snapshot_stop_marker);
+        for (i = 0; i < enc->num_workers; i++)
+            g_thread_join(enc->workers[i]);
+        g_free(enc->workers);
+    }
+
+    for (i = 0; enc->slots && i < enc->pool_size; i++) {
+        frame_jpeg_surface_free(enc->slots[i].face);
+        frame_jpeg_surface_free(enc->slots[i].context);
+    }
+    g_free(enc->slots);
+    g_async_queue_unref(enc->free_slots);
+    g_async_queue_unref(enc->jobs);
+    g_free(enc);
+}
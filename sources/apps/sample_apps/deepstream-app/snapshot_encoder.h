@@ -0,0 +1,98 @@
+/*
+ * Snapshot service for recognition events.
+ *
+ * On the streaming thread the face region and/or the whole frame are only
+ * scaled (NvBufSurfTransform, GPU or VIC) into preallocated CPU-mappable
+ * surfaces. JPEG encoding (libjpeg-turbo) and base64 run on worker threads,
+ * after which the event, now carrying its images, is handed to the
+ * completion callback.
+ */
+
+#ifndef __SNAPSHOT_ENCODER_H__
+#define __SNAPSHOT_ENCODER_H__
+
+#include "event_dispatcher.h"
+#include "nvbufsurface.h"
+#include "nvll_osd_struct.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** What is attached to a recognition event. */
+typedef enum {
+    /** Crop around the detected face (default). */
+    SNAPSHOT_POLICY_FACE,
+    /** Downscaled whole frame. */
+    SNAPSHOT_POLICY_CONTEXT,
+    SNAPSHOT_POLICY_BOTH,
+} SnapshotPolicy;
+
+/** [recognition-snapshot] group of the application config file. */
+typedef struct {
+    SnapshotPolicy policy;
+    guint face_width;
+    guint face_height;
+    /** Added around the detector box on every side, percent of its size. */
+    guint face_margin;
+    /** Size of the context frame. */
+    guint width;
+    guint height;
+    /** libjpeg quality, 1-100. */
+    guint jpeg_quality;
+    guint num_workers;
+    /** Snapshots that can be in flight at once. */
+    guint pool_size;
+    guint gpu_id;
+} NvDsSnapshotConfig;
+
+typedef struct {
+    guint64 submitted;
+    /** Submissions rejected because every pooled surface was busy. */
+    guint64 busy;
+    /** Events handed to the workers. */
+    guint64 captured;
+    /** Images that failed to capture or encode. */
+    guint64 failed;
+    /** Images encoded; an event carries up to two. */
+    guint64 encoded;
+    guint64 encoded_bytes;
+    /** Total time spent on the streaming thread / in workers, microseconds. */
+    guint64 capture_us;
+    guint64 encode_us;
+} SnapshotEncoderStats;
+
+typedef struct _SnapshotEncoder SnapshotEncoder;
+
+/**
+ * Called on a worker thread with ownership of @event. event->face_image and
+ * event->context_image hold the data URIs the policy asks for; either is
+ * NULL if it was not requested or encoding failed.
+ */
+typedef void (*SnapshotDoneCallback)(RecognitionEvent *event, gpointer user_data);
+
+/** Zero fields of @config get defaults. */
+SnapshotEncoder *snapshot_encoder_new(const NvDsSnapshotConfig *config,
+                                      SnapshotDoneCallback done_cb, gpointer user_data);
+
+/**
+ * Scales @face_rect (in @surface coordinates, may be NULL) and/or the whole
+ * frame @batch_id of @surface (frame 0 if @batch_id is not filled) into
+ * pooled surfaces and queues the encode. Never blocks on the workers. On
+ * success ownership of @event moves to the encoder; on FALSE (pool exhausted,
+ * nothing to capture, unsupported surface) the caller keeps it.
+ */
+gboolean snapshot_encoder_submit(SnapshotEncoder *encoder, NvBufSurface *surface,
+                                 guint batch_id, const NvOSD_RectParams *face_rect,
+                                 RecognitionEvent *event);
+
+void snapshot_encoder_get_stats(SnapshotEncoder *encoder, SnapshotEncoderStats *stats);
+
+/** Finishes queued snapshots (their callbacks run) and stops the workers. */
+void snapshot_encoder_free(SnapshotEncoder *encoder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SNAPSHOT_ENCODER_H__ */
@@ -0,0 +1,225 @@
+/*
+ * Startup plan, see startup_plan.h.
+ *
+ * Plans hold a handful of tasks, so scheduling is a scan over all of them
+ * under one lock each time a task finishes.
+ */
+
+#include "startup_plan.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef enum {
+    TASK_PENDING,
+    TASK_RUNNING,
+    TASK_DONE,
+    TASK_FAILED,
+    TASK_SKIPPED,
+} StartupTaskState;
+
+typedef struct {
+    StartupPlan *plan;
+    gchar *name;
+    StartupTaskFunc func;
+    gpointer data;
+    GArray *deps;
+
+    StartupTaskState state;
+    GThread *thread;
+    gint64 started;
+    gint64 finished;
+} StartupTask;
+
+struct _StartupPlan {
+    gchar *name;
+    GPtrArray *tasks;
+    GMutex lock;
+    GCond done_cond;
+    guint running;
+};
+
+StartupPlan *
+startup_plan_new(const gchar *name)
+{
+    StartupPlan *plan = g_new0(StartupPlan, 1);
+
+    plan->name = g_strdup(name);
+    plan->tasks = g_ptr_array_new();
+    g_mutex_init(&plan->lock);
+    g_cond_init(&plan->done_cond);
+    return plan;
+}
+
+static gint
+find_task(StartupPlan *plan, const gchar *name)
+{
+    for (guint i = 0; i < plan->tasks->len; i++) {
+        StartupTask *task = g_ptr_array_index(plan->tasks, i);
+        if (strcmp(task->name, name) == 0)
+            return (gint)i;
+    }
+    return -1;
+}
+
+void
+startup_plan_add(StartupPlan *plan, const gchar *name, StartupTaskFunc func, gpointer data,
+                 ...)
+{
+    StartupTask *task = g_new0(StartupTask, 1);
+    const gchar *dep;
+    va_list args;
+
+    task->plan = plan;
+    task->name = g_strdup(name);
+    task->func = func;
+    task->data = data;
+    task->deps = g_array_new(FALSE, FALSE, sizeof(guint));
+
+    va_start(args, data);
+    while ((dep = va_arg(args, const gchar *))) {
+        gint index = find_task(plan, dep);
+        if (index < 0) {
+            g_critical("Startup task %s depends on unknown task %s", name, dep);
+            continue;
+        }
+        g_array_append_val(task->deps, index);
+    }
+    va_end(args);
+
+    g_ptr_array_add(plan->tasks, task);
+}
+
+static gpointer
+task_thread(gpointer data)
+{
+    StartupTask *task = (StartupTask *)data;
+    StartupPlan *plan = task->plan;
+    gboolean ok = task->func(task->data);
+
+    g_mutex_lock(&plan->lock);
+    task->finished = g_get_monotonic_time();
+    task->state = ok ? TASK_DONE : TASK_FAILED;
+    plan->running--;
+    g_cond_signal(&plan->done_cond);
+    g_mutex_unlock(&plan->lock);
+    return NULL;
+}
+
+/* Starts or skips the pending tasks whose dependencies have finished. */
+static void
+schedule(StartupPlan *plan)
+{
+    for (guint i = 0; i < plan->tasks->len; i++) {
+        StartupTask *task = g_ptr_array_index(plan->tasks, i);
+        gboolean ready = TRUE;
+
+        if (task->state != TASK_PENDING)
+            continue;
+        for (guint d = 0; d < task->deps->len; d++) {
+            StartupTask *dep = g_ptr_array_index(plan->tasks, g_array_index(task->deps, guint, d));
+            if (dep->state == TASK_FAILED || dep->state == TASK_SKIPPED) {
+                task->state = TASK_SKIPPED;
+                break;
+            }
+            if (dep->state != TASK_DONE)
+                ready = FALSE;
+        }
+        if (task->state == TASK_SKIPPED || !ready)
+            continue;
+
+        task->state = TASK_RUNNING;
+        task->started = g_get_monotonic_time();
+        plan->running++;
+        task->thread = g_thread_new(task->name, task_thread, task);
+    }
+}
+
+gboolean
+startup_plan_run(StartupPlan *plan)
+{
+    gint64 start = g_get_monotonic_time();
+    gint64 end;
+    gint64 busy = 0;
+    gboolean ok = TRUE;
+
+    g_mutex_lock(&plan->lock);
+    for (;;) {
+        schedule(plan);
+        if (plan->running == 0)
+            break;
+        g_cond_wait(&plan->done_cond, &plan->lock);
+    }
+    g_mutex_unlock(&plan->lock);
+    end = g_get_monotonic_time();
+
+    for (guint i = 0; i < plan->tasks->len; i++) {
+        StartupTask *task = g_ptr_array_index(plan->tasks, i);
+        if (task->thread) {
+            g_thread_join(task->thread);
+            task->thread = NULL;
+            busy += task->finished - task->started;
+        }
+    }
+
+    g_print("%s: %.3f s (%.3f s if run one after another)\n", plan->name, (end - start) / 1e6,
+            busy / 1e6);
+    for (guint i = 0; i < plan->tasks->len; i++) {
+        StartupTask *task = g_ptr_array_index(plan->tasks, i);
+        if (task->state == TASK_SKIPPED) {
+            g_print("  %-24s skipped\n", task->name);
+        } else {
+            g_print("  %-24s %7.3f -> %7.3f s%s\n", task->name, (task->started - start) / 1e6,
+                    (task->finished - start) / 1e6,
+                    task->state == TASK_FAILED ? "  FAILED" : "");
+        }
+        if (task->state != TASK_DONE)
+            ok = FALSE;
+    }
+    return ok;
+}
+
+void
+startup_plan_free(StartupPlan *plan)
+{
+    if (!plan)
+        return;
+    for (guint i = 0; i < plan->tasks->len; i++) {
+        StartupTask *task = g_ptr_array_index(plan->tasks, i);
+        g_array_free(task->deps, TRUE);
+        g_free(task->name);
+        g_free(task);
+    }
+    g_ptr_array_free(plan->tasks, TRUE);
+    g_mutex_clear(&plan->lock);
+    g_cond_clear(&plan->done_cond);
+    g_free(plan->name);
+    g_free(plan);
+}
+
+gdouble
+startup_process_age(void)
+{
+    gchar *stat_line = NULL;
+    gchar *uptime = NULL;
+    gdouble age = -1;
+
+    /* Field 22 of /proc/self/stat is the start time in clock ticks after
+     * boot; the command name before it may contain spaces, so count from
+     * the closing parenthesis. */
+    if (g_file_get_contents("/proc/self/stat", &stat_line, NULL, NULL) &&
+        g_file_get_contents("/proc/uptime", &uptime, NULL, NULL)) {
+        const gchar *p = strrchr(stat_line, ')');
+        guint64 start_ticks;
+
+        if (p && sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d "
+                               "%*d %*d %*d %" G_GUINT64_FORMAT, &start_ticks) == 1) {
+            age = g_ascii_strtod(uptime, NULL) - (gdouble)start_ticks / sysconf(_SC_CLK_TCK);
+        }
+    }
+    g_free(stat_line);
+    g_free(uptime);
+    return age;
+}
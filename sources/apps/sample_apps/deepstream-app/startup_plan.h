@@ -0,0 +1,45 @@
+/*
+ * Concurrent startup.
+ *
+ * A plan is a set of named initialisation tasks with explicit dependencies.
+ * Running it starts every task on its own thread as soon as the tasks it
+ * depends on have succeeded, waits for all of them and prints when each one
+ * ran, so a slow phase shows up in the log of every (re)start.
+ */
+
+#ifndef __STARTUP_PLAN_H__
+#define __STARTUP_PLAN_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A task; returns FALSE on failure, which skips the tasks depending on it. */
+typedef gboolean (*StartupTaskFunc)(gpointer data);
+
+typedef struct _StartupPlan StartupPlan;
+
+StartupPlan *startup_plan_new(const gchar *name);
+
+/**
+ * Adds task @name running @func(@data) after the tasks named in the
+ * NULL-terminated argument list, which must have been added before.
+ */
+void startup_plan_add(StartupPlan *plan, const gchar *name, StartupTaskFunc func,
+                      gpointer data, ...) G_GNUC_NULL_TERMINATED;
+
+/** Runs all tasks and prints the timing report. TRUE if every task succeeded. */
+gboolean startup_plan_run(StartupPlan *plan);
+
+void startup_plan_free(StartupPlan *plan);
+
+/** Seconds since the process was started (exec), or -1 if unknown. */
+gdouble startup_process_age(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STARTUP_PLAN_H__ */
@@ -0,0 +1,763 @@
+/*
+ * Student database sync, see student_sync.h.
+ *
+ * Schema, on top of the students table of scripts/create_db_fr_server.py:
+ *   students.sync_seq                  sync that last wrote the row
+ *   student_deletions(id, sync_seq)    tombstones, dropped once the gallery
+ *                                      has taken them
+ *   sync_state(key, value)             watermark, sync_seq, gallery_seq
+ *
+ * A full list from the server is merged with the table in id order, so only
+ * the rows that differ are written, and pushed to the gallery.
+ *
+ * The gallery lives in the recognition parser library, which nvinfer loads
+ * with RTLD_LOCAL; face_gallery_apply() is looked up in every loaded object
+ * at push time, so pushes follow the library across pipeline re-creations.
+ */
+
+#define _GNU_SOURCE
+
+#include "student_sync.h"
+
+#include <curl/curl.h>
+#include <dlfcn.h>
+#include <json-glib/json-glib.h>
+#include <link.h>
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "face_gallery.h"
+#include "json_writer.h"
+
+#define DEFAULT_TIMEOUT_MS 30000
+#define DEFAULT_FEATURE_DIM 512
+/* The full list carries every face vector as text. */
+#define MAX_RESPONSE_BYTES (512 * 1024 * 1024)
+/* The Python scripts may still write the database now and then. */
+#define DB_BUSY_TIMEOUT_MS 10000
+
+#define STATE_WATERMARK "watermark"
+#define STATE_SYNC_SEQ "sync_seq"
+#define STATE_GALLERY_SEQ "gallery_seq"
+
+struct _StudentSync {
+    gchar *sync_url;
+    gchar *last_updated_url;
+    gchar *token;
+    guint timeout_ms;
+    guint feature_dim;
+
+    sqlite3 *db;
+    CURL *curl;
+    /* Last applied sync, and the last one pushed to the gallery. */
+    gint64 sync_seq;
+    gint64 gallery_seq;
+    gboolean gallery_missing_reported;
+};
+
+typedef struct {
+    gint64 id;
+    const gchar *label;
+    /* vector_face as stored: text of a JSON array, NULL if none. */
+    gchar *vector;
+} StudentRow;
+
+static const gchar *kSchema =
+    "CREATE TABLE IF NOT EXISTS students (id INTEGER PRIMARY KEY, label TEXT, vector_face TEXT,"
+    " sync_seq INTEGER NOT NULL DEFAULT 0);"
+    "CREATE TABLE IF NOT EXISTS student_deletions (id INTEGER PRIMARY KEY,"
+    " sync_seq INTEGER NOT NULL);"
+    "CREATE TABLE IF NOT EXISTS sync_state (key TEXT PRIMARY KEY, value TEXT);";
+
+static gboolean db_exec(sqlite3 *db, const gchar *sql)
+{
+    gchar *err = NULL;
+
+    if (sqlite3_exec(db, sql, NULL, NULL, &err) != SQLITE_OK) {
+        g_printerr("Student sync: %s: %s\n", sql, err ? err : sqlite3_errmsg(db));
+        sqlite3_free(err);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static sqlite3_stmt *db_prepare(sqlite3 *db, const gchar *sql)
+{
+    sqlite3_stmt *stmt = NULL;
+
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        g_printerr("Student sync: %s: %s\n", sql, sqlite3_errmsg(db));
+        return NULL;
+    }
+    return stmt;
+}
+
+static gchar *state_get(sqlite3 *db, const gchar *key)
+{
+    sqlite3_stmt *stmt = db_prepare(db, "SELECT value FROM sync_state WHERE key = ?");
+    gchar *value = NULL;
+
+    if (!stmt)
+        return NULL;
+    sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0))
+        value = g_strdup((const gchar *)sqlite3_column_text(stmt, 0));
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+static gint64 state_get_int(sqlite3 *db, const gchar *key)
+{
+    gchar *value = state_get(db, key);
+    gint64 result = value ? g_ascii_strtoll(value, NULL, 10) : 0;
+
+    g_free(value);
+    return result;
+}
+
+static gboolean state_set(sqlite3 *db, const gchar *key, const gchar *value)
+{
+    sqlite3_stmt *stmt =
+        db_prepare(db, "INSERT OR REPLACE INTO sync_state (key, value) VALUES (?, ?)");
+    gboolean ok;
+
+    if (!stmt)
+        return FALSE;
+    sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, value, -1, SQLITE_STATIC);
+    ok = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!ok)
+        g_printerr("Student sync: cannot store %s: %s\n", key, sqlite3_errmsg(db));
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+static gboolean state_set_int(sqlite3 *db, const gchar *key, gint64 value)
+{
+    gchar buf[32];
+
+    g_snprintf(buf, sizeof(buf), "%" G_GINT64_FORMAT, value);
+    return state_set(db, key, buf);
+}
+
+/* Databases created by the Python scripts lack students.sync_seq. */
+static gboolean has_sync_seq_column(sqlite3 *db)
+{
+    sqlite3_stmt *stmt = db_prepare(db, "PRAGMA table_info(students)");
+    gboolean found = FALSE;
+
+    if (!stmt)
+        return FALSE;
+    while (!found && sqlite3_step(stmt) == SQLITE_ROW)
+        found = !g_strcmp0((const gchar *)sqlite3_column_text(stmt, 1), "sync_seq");
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+static gboolean open_database(StudentSync *sync, const gchar *path)
+{
+    if (sqlite3_open(path, &sync->db) != SQLITE_OK) {
+        g_printerr("Student sync: cannot open %s: %s\n", path, sqlite3_errmsg(sync->db));
+        return FALSE;
+    }
+    sqlite3_busy_timeout(sync->db, DB_BUSY_TIMEOUT_MS);
+
+    if (!db_exec(sync->db, kSchema))
+        return FALSE;
+    if (!has_sync_seq_column(sync->db) &&
+        !db_exec(sync->db,
+                 "ALTER TABLE students ADD COLUMN sync_seq INTEGER NOT NULL DEFAULT 0"))
+        return FALSE;
+    if (!db_exec(sync->db,
+                 "CREATE INDEX IF NOT EXISTS students_sync_seq ON students (sync_seq)"))
+        return FALSE;
+
+    sync->sync_seq = state_get_int(sync->db, STATE_SYNC_SEQ);
+    sync->gallery_seq = state_get_int(sync->db, STATE_GALLERY_SEQ);
+    return TRUE;
+}
+
+StudentSync *student_sync_new(const NvDsStudentSyncConfig *config)
+{
+    StudentSync *sync = g_new0(StudentSync, 1);
+
+    sync->sync_url = g_strdup(config->sync_url ? config->sync_url : STUDENT_SYNC_DEFAULT_URL);
+    sync->last_updated_url =
+        g_strdup(config->last_updated_url ? config->last_updated_url
+                                          : STUDENT_SYNC_DEFAULT_LAST_UPDATED_URL);
+    sync->token = g_strdup(config->token ? config->token : STUDENT_SYNC_DEFAULT_TOKEN);
+    sync->timeout_ms = config->timeout_ms ? config->timeout_ms : DEFAULT_TIMEOUT_MS;
+    sync->feature_dim = config->feature_dim ? config->feature_dim : DEFAULT_FEATURE_DIM;
+
+    if (!open_database(sync, config->db_file ? config->db_file : STUDENT_SYNC_DEFAULT_DB_FILE)) {
+        student_sync_free(sync);
+        return NULL;
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    sync->curl = curl_easy_init();
+    if (!sync->curl) {
+        student_sync_free(sync);
+        return NULL;
+    }
+    return sync;
+}
+
+void student_sync_free(StudentSync *sync)
+{
+    if (!sync)
+        return;
+    if (sync->curl)
+        curl_easy_cleanup(sync->curl);
+    sqlite3_close(sync->db);
+    g_free(sync->sync_url);
+    g_free(sync->last_updated_url);
+    g_free(sync->token);
+    g_free(sync);
+}
+
+static size_t collect_response(char *data, size_t size, size_t nmemb, void *user_data)
+{
+    GString *response = (GString *)user_data;
+
+    if (response->len + size * nmemb > MAX_RESPONSE_BYTES)
+        return 0;
+    g_string_append_len(response, data, size * nmemb);
+    return size * nmemb;
+}
+
+/* POSTs @body (JSON; an empty body if NULL) and parses the answer. The easy
+ * handle is reused, so the connection to the server is too. */
+static JsonParser *post_json(StudentSync *sync, const gchar *url, const GString *body)
+{
+    GString *response = g_string_new(NULL);
+    struct curl_slist *headers = NULL;
+    JsonParser *parser = NULL;
+    GError *error = NULL;
+    long status = 0;
+    CURLcode res;
+
+    curl_easy_reset(sync->curl);
+    curl_easy_setopt(sync->curl, CURLOPT_URL, url);
+    curl_easy_setopt(sync->curl, CURLOPT_POST, 1L);
+    if (body) {
+        headers = curl_slist_append(headers, "Content-Type: application/json");
+        curl_easy_setopt(sync->curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(sync->curl, CURLOPT_POSTFIELDS, body->str);
+        curl_easy_setopt(sync->curl, CURLOPT_POSTFIELDSIZE, (long)body->len);
+    } else {
+        curl_easy_setopt(sync->curl, CURLOPT_POSTFIELDS, "");
+        curl_easy_setopt(sync->curl, CURLOPT_POSTFIELDSIZE, 0L);
+    }
+    curl_easy_setopt(sync->curl, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(sync->curl, CURLOPT_TIMEOUT_MS, (long)sync->timeout_ms);
+    curl_easy_setopt(sync->curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(sync->curl, CURLOPT_WRITEFUNCTION, collect_response);
+    curl_easy_setopt(sync->curl, CURLOPT_WRITEDATA, response);
+
+    res = curl_easy_perform(sync->curl);
+    curl_easy_getinfo(sync->curl, CURLINFO_RESPONSE_CODE, &status);
+    if (res != CURLE_OK) {
+        g_printerr("Student sync: %s: %s\n", url, curl_easy_strerror(res));
+    } else if (status / 100 != 2) {
+        g_printerr("Student sync: %s: HTTP %ld\n", url, status);
+    } else {
+        parser = json_parser_new();
+        if (!json_parser_load_from_data(parser, response->str, response->len, &error)) {
+            g_printerr("Student sync: %s: %s\n", url, error->message);
+            g_error_free(error);
+            g_object_unref(parser);
+            parser = NULL;
+        }
+    }
+
+    curl_slist_free_all(headers);
+    g_string_free(response, TRUE);
+    return parser;
+}
+
+/* Scalar JSON value as text, NULL for null and non-scalars. */
+static gchar *node_to_text(JsonNode *node)
+{
+    if (!node || JSON_NODE_TYPE(node) != JSON_NODE_VALUE)
+        return NULL;
+    switch (json_node_get_value_type(node)) {
+    case G_TYPE_STRING:
+        return g_strdup(json_node_get_string(node));
+    case G_TYPE_INT64:
+        return g_strdup_printf("%" G_GINT64_FORMAT, json_node_get_int(node));
+    case G_TYPE_DOUBLE: {
+        gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+        return g_strdup(g_ascii_dtostr(buf, sizeof(buf), json_node_get_double(node)));
+    }
+    default:
+        return NULL;
+    }
+}
+
+/* Student id, as a number or a numeric string; 0 if there is none. */
+static gint64 node_to_id(JsonNode *node)
+{
+    gchar *text = node_to_text(node);
+    gchar *end = NULL;
+    gint64 id = text ? g_ascii_strtoll(text, &end, 10) : 0;
+
+    if (!text || end == text || *end)
+        id = 0;
+    g_free(text);
+    return id;
+}
+
+/* last_updated_at of the server, in data[0] or data. */
+static gchar *fetch_last_updated(StudentSync *sync)
+{
+    JsonParser *parser = post_json(sync, sync->last_updated_url, NULL);
+    JsonNode *root;
+    JsonNode *data = NULL;
+    JsonObject *object = NULL;
+    gchar *last_updated = NULL;
+
+    if (!parser)
+        return NULL;
+    root = json_parser_get_root(parser);
+    if (root && JSON_NODE_HOLDS_OBJECT(root))
+        data = json_object_get_member(json_node_get_object(root), "data");
+    if (data && JSON_NODE_HOLDS_ARRAY(data) && json_array_get_length(json_node_get_array(data)))
+        data = json_array_get_element(json_node_get_array(data), 0);
+    if (data && JSON_NODE_HOLDS_OBJECT(data))
+        object = json_node_get_object(data);
+    if (object && json_object_has_member(object, "last_updated_at"))
+        last_updated = node_to_text(json_object_get_member(object, "last_updated_at"));
+
+    g_object_unref(parser);
+    return last_updated;
+}
+
+static void row_clear(gpointer data)
+{
+    g_free(((StudentRow *)data)->vector);
+}
+
+static void add_row(GArray *rows, JsonNode *node)
+{
+    JsonObject *object;
+    JsonNode *vector;
+    StudentRow row = {0};
+
+    if (!JSON_NODE_HOLDS_OBJECT(node))
+        return;
+    object = json_node_get_object(node);
+    row.id = node_to_id(json_object_get_member(object, "id"));
+    if (row.id <= 0)
+        return;
+    if (json_object_has_member(object, "label"))
+        row.label = json_object_get_string_member(object, "label");
+
+    vector = json_object_get_member(object, "vector_face");
+    if (vector && JSON_NODE_HOLDS_ARRAY(vector))
+        row.vector = json_to_string(vector, FALSE);
+    else if (vector && JSON_NODE_HOLDS_VALUE(vector) &&
+             json_node_get_value_type(vector) == G_TYPE_STRING)
+        row.vector = g_strdup(json_node_get_string(vector));
+    if (row.vector && (!row.vector[0] || !strcmp(row.vector, "null"))) {
+        g_free(row.vector);
+        row.vector = NULL;
+    }
+    g_array_append_val(rows, row);
+}
+
+static gint compare_rows(gconstpointer a, gconstpointer b)
+{
+    gint64 ia = ((const StudentRow *)a)->id;
+    gint64 ib = ((const StudentRow *)b)->id;
+
+    return ia < ib ? -1 : ia > ib;
+}
+
+/* Rows whose label or vector differ from the table, and ids of the table
+ * missing from @rows (sorted by id, without duplicates). */
+static gboolean diff_full_list(sqlite3 *db, GArray *rows, GPtrArray *upserts, GArray *deletes)
+{
+    sqlite3_stmt *stmt =
+        db_prepare(db, "SELECT id, label, vector_face FROM students ORDER BY id");
+    guint i = 0;
+    int rc;
+
+    if (!stmt)
+        return FALSE;
+    rc = sqlite3_step(stmt);
+    while (rc == SQLITE_ROW || i < rows->len) {
+        StudentRow *row = i < rows->len ? &g_array_index(rows, StudentRow, i) : NULL;
+        gint64 id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : G_MAXINT64;
+
+        if (row && row->id < id) {
+            g_ptr_array_add(upserts, row);
+            i++;
+            continue;
+        }
+        if (!row || id < row->id) {
+            g_array_append_val(deletes, id);
+        } else {
+            if (g_strcmp0(row->label, (const gchar *)sqlite3_column_text(stmt, 1)) ||
+                g_strcmp0(row->vector, (const gchar *)sqlite3_column_text(stmt, 2)))
+                g_ptr_array_add(upserts, row);
+            i++;
+        }
+        rc = sqlite3_step(stmt);
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        g_printerr("Student sync: cannot read students: %s\n", sqlite3_errmsg(db));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Writes the changes as sync sync_seq + 1 and the new watermark, all or
+ * nothing. */
+static gboolean store_changes(StudentSync *sync, GPtrArray *upserts, GArray *deletes,
+                              const gchar *watermark, guint *num_deleted)
+{
+    sqlite3 *db = sync->db;
+    gint64 seq = sync->sync_seq + 1;
+    sqlite3_stmt *upsert = db_prepare(db,
+                                      "INSERT OR REPLACE INTO students (id, label, vector_face, "
+                                      "sync_seq) VALUES (?, ?, ?, ?)");
+    sqlite3_stmt *untomb = db_prepare(db, "DELETE FROM student_deletions WHERE id = ?");
+    sqlite3_stmt *remove = db_prepare(db, "DELETE FROM students WHERE id = ?");
+    sqlite3_stmt *tomb =
+        db_prepare(db, "INSERT OR REPLACE INTO student_deletions (id, sync_seq) VALUES (?, ?)");
+    gboolean ok = upsert && untomb && remove && tomb && db_exec(db, "BEGIN IMMEDIATE");
+    gboolean begun = ok;
+    guint i;
+
+    *num_deleted = 0;
+    for (i = 0; ok && i < upserts->len; i++) {
+        StudentRow *row = (StudentRow *)g_ptr_array_index(upserts, i);
+
+        sqlite3_bind_int64(upsert, 1, row->id);
+        sqlite3_bind_text(upsert, 2, row->label, -1, SQLITE_STATIC);
+        sqlite3_bind_text(upsert, 3, row->vector, -1, SQLITE_STATIC);
+        sqlite3_bind_int64(upsert, 4, seq);
+        sqlite3_bind_int64(untomb, 1, row->id);
+        ok = sqlite3_step(upsert) == SQLITE_DONE && sqlite3_step(untomb) == SQLITE_DONE;
+        sqlite3_reset(upsert);
+        sqlite3_reset(untomb);
+    }
+    for (i = 0; ok && i < deletes->len; i++) {
+        gint64 id = g_array_index(deletes, gint64, i);
+
+        sqlite3_bind_int64(remove, 1, id);
+        ok = sqlite3_step(remove) == SQLITE_DONE;
+        sqlite3_reset(remove);
+        /* Unknown ids need no push. */
+        if (ok && sqlite3_changes(db) > 0) {
+            sqlite3_bind_int64(tomb, 1, id);
+            sqlite3_bind_int64(tomb, 2, seq);
+            ok = sqlite3_step(tomb) == SQLITE_DONE;
+            sqlite3_reset(tomb);
+            (*num_deleted)++;
+        }
+    }
+
+    if (!ok && begun)
+        g_printerr("Student sync: cannot store changes: %s\n", sqlite3_errmsg(db));
+    if (ok && (upserts->len || *num_deleted))
+        ok = state_set_int(db, STATE_SYNC_SEQ, seq);
+    if (ok && watermark)
+        ok = state_set(db, STATE_WATERMARK, watermark);
+    if (ok)
+        ok = db_exec(db, "COMMIT");
+    if (!ok && begun)
+        db_exec(db, "ROLLBACK");
+    else if (ok && (upserts->len || *num_deleted))
+        sync->sync_seq = seq;
+
+    sqlite3_finalize(upsert);
+    sqlite3_finalize(untomb);
+    sqlite3_finalize(remove);
+    sqlite3_finalize(tomb);
+    return ok;
+}
+
+gboolean student_sync_run(StudentSync *sync)
+{
+    gchar *watermark = state_get(sync->db, STATE_WATERMARK);
+    gchar *last_updated = fetch_last_updated(sync);
+    GString *body;
+    JsonParser *parser;
+    JsonNode *root;
+    JsonObject *object = NULL;
+    JsonNode *data;
+    JsonNode *deleted;
+    GArray *rows;
+    GPtrArray *upserts;
+    GArray *deletes;
+    gboolean full;
+    gboolean ok;
+    guint num_deleted = 0;
+    guint i;
+
+    if (last_updated && watermark && !strcmp(last_updated, watermark)) {
+        g_print("Student sync: up to date (%s)\n", watermark);
+        g_free(watermark);
+        g_free(last_updated);
+        student_sync_push_gallery(sync);
+        return TRUE;
+    }
+
+    body = g_string_new("{");
+    json_append_member(body, "token", sync->token);
+    if (watermark) {
+        g_string_append_c(body, ',');
+        json_append_member(body, "updated_since", watermark);
+    }
+    g_string_append_c(body, '}');
+    parser = post_json(sync, sync->sync_url, body);
+    g_string_free(body, TRUE);
+    g_free(watermark);
+    if (!parser) {
+        g_free(last_updated);
+        return FALSE;
+    }
+
+    root = json_parser_get_root(parser);
+    if (root && JSON_NODE_HOLDS_OBJECT(root))
+        object = json_node_get_object(root);
+    data = object ? json_object_get_member(object, "data") : NULL;
+    deleted = object ? json_object_get_member(object, "deleted") : NULL;
+    full = !deleted;
+
+    rows = g_array_new(FALSE, FALSE, sizeof(StudentRow));
+    g_array_set_clear_func(rows, row_clear);
+    if (data && JSON_NODE_HOLDS_ARRAY(data)) {
+        JsonArray *array = json_node_get_array(data);
+        for (i = 0; i < json_array_get_length(array); i++)
+            add_row(rows, json_array_get_element(array, i));
+    } else if (data) {
+        add_row(rows, data);
+    }
+
+    upserts = g_ptr_array_new();
+    deletes = g_array_new(FALSE, FALSE, sizeof(gint64));
+    if (full && !rows->len) {
+        /* Same as the Python sync: an empty list is taken as a failed request,
+         * not as every student being removed. */
+        g_printerr("Student sync: no students received\n");
+        ok = FALSE;
+    } else if (full) {
+        g_array_sort(rows, compare_rows);
+        for (i = 1; i < rows->len;) {
+            if (g_array_index(rows, StudentRow, i).id == g_array_index(rows, StudentRow, i - 1).id)
+                g_array_remove_index(rows, i);
+            else
+                i++;
+        }
+        ok = diff_full_list(sync->db, rows, upserts, deletes);
+    } else {
+        for (i = 0; i < rows->len; i++)
+            g_ptr_array_add(upserts, &g_array_index(rows, StudentRow, i));
+        if (JSON_NODE_HOLDS_ARRAY(deleted)) {
+            JsonArray *array = json_node_get_array(deleted);
+            for (i = 0; i < json_array_get_length(array); i++) {
+                gint64 id = node_to_id(json_array_get_element(array, i));
+                if (id > 0)
+                    g_array_append_val(deletes, id);
+            }
+        }
+        ok = TRUE;
+    }
+
+    if (!last_updated && object && json_object_has_member(object, "last_updated_at"))
+        last_updated = node_to_text(json_object_get_member(object, "last_updated_at"));
+    if (ok)
+        ok = store_changes(sync, upserts, deletes, last_updated, &num_deleted);
+    if (ok)
+        g_print("Student sync: %s, %u students added or changed, %u removed (watermark %s)\n",
+                full ? "full list" : "changes", upserts->len, num_deleted,
+                last_updated ? last_updated : "unchanged");
+
+    g_ptr_array_free(upserts, TRUE);
+    g_array_free(deletes, TRUE);
+    g_array_free(rows, TRUE);
+    g_object_unref(parser);
+    g_free(last_updated);
+
+    student_sync_push_gallery(sync);
+    return ok;
+}
+
+/* Parses the JSON array @text into @out; FALSE unless it holds @dim numbers. */
+static gboolean parse_vector(const gchar *text, gfloat *out, guint dim)
+{
+    const gchar *p = text;
+    gchar *end;
+    guint n = 0;
+
+    while (g_ascii_isspace(*p))
+        p++;
+    if (*p++ != '[')
+        return FALSE;
+    for (;;) {
+        while (g_ascii_isspace(*p))
+            p++;
+        if (*p == ']')
+            break;
+        if (n == dim)
+            return FALSE;
+        out[n++] = (gfloat)g_ascii_strtod(p, &end);
+        if (end == p)
+            return FALSE;
+        p = end;
+        while (g_ascii_isspace(*p))
+            p++;
+        if (*p == ',')
+            p++;
+        else if (*p != ']')
+            return FALSE;
+    }
+    return n == dim;
+}
+
+static int collect_object_name(struct dl_phdr_info *info, size_t size, void *data)
+{
+    if (info->dlpi_name && info->dlpi_name[0])
+        g_ptr_array_add((GPtrArray *)data, g_strdup(info->dlpi_name));
+    return 0;
+}
+
+/* face_gallery_apply() of the loaded parser library, with a reference on the
+ * library in @handle; NULL if it is not loaded. Objects are only opened after
+ * the iteration, which holds the loader lock. */
+static FaceGalleryApplyFunc find_gallery(void **handle)
+{
+    GPtrArray *names = g_ptr_array_new_with_free_func(g_free);
+    FaceGalleryApplyFunc apply = NULL;
+    guint i;
+
+    dl_iterate_phdr(collect_object_name, names);
+    for (i = 0; !apply && i < names->len; i++) {
+        *handle = dlopen((const gchar *)g_ptr_array_index(names, i), RTLD_LAZY | RTLD_NOLOAD);
+        if (!*handle)
+            continue;
+        apply = (FaceGalleryApplyFunc)dlsym(*handle, FACE_GALLERY_APPLY_SYMBOL);
+        if (!apply) {
+            dlclose(*handle);
+            *handle = NULL;
+        }
+    }
+    g_ptr_array_free(names, TRUE);
+    return apply;
+}
+
+gboolean student_sync_gallery_pending(StudentSync *sync)
+{
+    return sync->gallery_seq < sync->sync_seq;
+}
+
+/* Tombstones the gallery has taken are no longer needed. */
+static void prune_deletions(sqlite3 *db, gint64 seq)
+{
+    sqlite3_stmt *stmt = db_prepare(db, "DELETE FROM student_deletions WHERE sync_seq <= ?");
+
+    if (!stmt)
+        return;
+    sqlite3_bind_int64(stmt, 1, seq);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+}
+
+gboolean student_sync_push_gallery(StudentSync *sync)
+{
+    GArray *changes;
+    GArray *vectors;
+    GArray *has_vector;
+    GPtrArray *labels;
+    sqlite3_stmt *stmt;
+    FaceGalleryApplyFunc apply;
+    void *handle = NULL;
+    gint64 seq = sync->sync_seq;
+    guint dim = sync->feature_dim;
+    gboolean ok = TRUE;
+    guint i;
+    int rc;
+
+    if (!student_sync_gallery_pending(sync))
+        return TRUE;
+    apply = find_gallery(&handle);
+    if (!apply) {
+        if (!sync->gallery_missing_reported)
+            g_print("Student sync: face gallery not loaded yet, changes kept for later\n");
+        sync->gallery_missing_reported = TRUE;
+        return FALSE;
+    }
+    sync->gallery_missing_reported = FALSE;
+
+    /* The vector of change i is row i of @vectors, if has_vector[i]. */
+    changes = g_array_new(FALSE, TRUE, sizeof(FaceGalleryChange));
+    vectors = g_array_new(FALSE, FALSE, sizeof(gfloat));
+    has_vector = g_array_new(FALSE, FALSE, sizeof(gboolean));
+    labels = g_ptr_array_new_with_free_func(g_free);
+
+    stmt = db_prepare(sync->db,
+                      "SELECT id, label, vector_face FROM students WHERE sync_seq > ? "
+                      "UNION ALL SELECT id, NULL, NULL FROM student_deletions WHERE sync_seq > ?");
+    if (!stmt) {
+        ok = FALSE;
+    } else {
+        sqlite3_bind_int64(stmt, 1, sync->gallery_seq);
+        sqlite3_bind_int64(stmt, 2, sync->gallery_seq);
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            FaceGalleryChange change = {0};
+            const gchar *label = (const gchar *)sqlite3_column_text(stmt, 1);
+            const gchar *vector = (const gchar *)sqlite3_column_text(stmt, 2);
+            gboolean parsed = FALSE;
+
+            change.student_id = (uint32_t)sqlite3_column_int64(stmt, 0);
+            if (vector) {
+                g_array_set_size(vectors, (changes->len + 1) * dim);
+                parsed = parse_vector(
+                    vector, &g_array_index(vectors, gfloat, changes->len * dim), dim);
+                if (!parsed)
+                    g_printerr("Student sync: vector_face of student %u is not %u floats\n",
+                               change.student_id, dim);
+            }
+            if (label) {
+                change.label = g_strdup(label);
+                g_ptr_array_add(labels, (gpointer)change.label);
+            }
+            g_array_append_val(changes, change);
+            g_array_append_val(has_vector, parsed);
+        }
+        ok = rc == SQLITE_DONE;
+        if (!ok)
+            g_printerr("Student sync: cannot read changes: %s\n", sqlite3_errmsg(sync->db));
+        sqlite3_finalize(stmt);
+    }
+
+    if (ok && changes->len) {
+        for (i = 0; i < changes->len; i++) {
+            if (g_array_index(has_vector, gboolean, i))
+                g_array_index(changes, FaceGalleryChange, i).vector =
+                    &g_array_index(vectors, gfloat, i * dim);
+        }
+        ok = apply((const FaceGalleryChange *)changes->data, changes->len, dim) == 0;
+    }
+    dlclose(handle);
+
+    if (ok) {
+        sync->gallery_seq = seq;
+        state_set_int(sync->db, STATE_GALLERY_SEQ, seq);
+        prune_deletions(sync->db, seq);
+        g_print("Student sync: %u changes pushed to the face gallery\n", changes->len);
+    } else {
+        g_printerr("Student sync: face gallery update failed, will retry\n");
+    }
+
+    g_array_free(changes, TRUE);
+    g_array_free(vectors, TRUE);
+    g_array_free(has_vector, TRUE);
+    g_ptr_array_free(labels, TRUE);
+    return ok;
+}
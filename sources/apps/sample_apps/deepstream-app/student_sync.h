@@ -0,0 +1,82 @@
+/*
+ * Incremental sync of the student database with the enrolment server.
+ *
+ * The local SQLite database (students_local.db) keeps the server's
+ * last_updated_at of the last sync as a watermark. A sync first asks the
+ * server for its current last_updated_at and stops there if nothing changed.
+ * Otherwise it asks for the students changed since the watermark and applies
+ * the upserts and deletions in one transaction, then pushes the same rows into
+ * the running face gallery (face_gallery.h). No process is spawned and
+ * nothing is reloaded in full.
+ *
+ * Server contract: sync-url is POSTed {"token": ..., "updated_since": ...}
+ * ("updated_since" absent on the first sync) and answers
+ * {"data": [{"id", "label", "vector_face"}, ...], "deleted": [id, ...]},
+ * "vector_face" being a JSON array of floats or a string holding one. An
+ * answer without a "deleted" member is taken as the full list of students
+ * (servers ignoring "updated_since"); it is compared with the database by id
+ * and only the differences are applied.
+ *
+ * Every applied sync gets a sequence number stored with the rows it wrote
+ * (and with tombstones of the deleted ids). The gallery is brought up to date
+ * from the rows newer than the last sequence it took, so changes not yet
+ * pushed when the parser library was not loaded, or the application stopped,
+ * are pushed later.
+ */
+
+#ifndef __STUDENT_SYNC_H__
+#define __STUDENT_SYNC_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STUDENT_SYNC_DEFAULT_URL "https://topcam.ai.vn/apis/syncStudentsAPI"
+#define STUDENT_SYNC_DEFAULT_LAST_UPDATED_URL "https://topcam.ai.vn/apis/lastUpdatedStudentAPI"
+#define STUDENT_SYNC_DEFAULT_TOKEN "P8Hg4ukCiRI3NUMDvKmscEFnL0OtzT1752552517"
+#define STUDENT_SYNC_DEFAULT_DB_FILE "students_local.db"
+
+/** [student-sync] group of the application config file. */
+typedef struct {
+    /** enable=0: no sync at all. */
+    gboolean disabled;
+    gchar *sync_url;
+    gchar *last_updated_url;
+    gchar *token;
+    gchar *db_file;
+    guint timeout_ms;
+    /** Length of the face feature vectors, 512 if 0. */
+    guint feature_dim;
+} NvDsStudentSyncConfig;
+
+typedef struct _StudentSync StudentSync;
+
+/** Opens (creating or upgrading) the database. NULL on failure. */
+StudentSync *student_sync_new(const NvDsStudentSyncConfig *config);
+
+/**
+ * Syncs the database with the server, then pushes the changes to the gallery.
+ * Returns FALSE if the server could not be reached or the changes could not
+ * be stored; the watermark then stays where it was.
+ */
+gboolean student_sync_run(StudentSync *sync);
+
+/**
+ * Pushes the stored changes the gallery has not taken yet. Returns TRUE if the
+ * gallery is up to date; FALSE if changes are left, e.g. because the parser
+ * library is not loaded yet.
+ */
+gboolean student_sync_push_gallery(StudentSync *sync);
+
+/** TRUE if stored changes still have to be pushed to the gallery. */
+gboolean student_sync_gallery_pending(StudentSync *sync);
+
+void student_sync_free(StudentSync *sync);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STUDENT_SYNC_H__ */
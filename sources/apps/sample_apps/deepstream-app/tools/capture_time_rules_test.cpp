@@ -0,0 +1,339 @@
+/*
+ * Checks of the capture time rules (capture_time_rules.cpp), without the
+ * pipeline.
+ *
+ * Each scenario writes a rules file to a temporary directory, compiles it
+ * with CaptureTimeRules::init() and checks the interval of chosen minutes of
+ * the week: rules running over midnight and over the end of the week, day
+ * lists and ranges (also wrapping, "fri-mon"), the first rule of the file
+ * winning over later ones, and rejection of malformed lines. The validity
+ * window that getCurrentTimeInterval() caches is checked with fixed times in
+ * fixed time zones: it starts on the local minute, ends where the interval
+ * changes, and is cut at a DST change, spring and autumn.
+ *
+ *   capture_time_rules_test [--verbose]
+ *
+ * Exit status 0 if every check passes, 1 otherwise.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+#include "capture_time_rules.h"
+
+namespace {
+
+const unsigned kDefaultInterval = 600;
+
+enum Day { MON, TUE, WED, THU, FRI, SAT, SUN };
+
+std::string tmp_dir;
+bool verbose = false;
+unsigned checks = 0;
+unsigned failures = 0;
+
+void check(bool ok, const std::string &what)
+{
+    checks++;
+    if (!ok) {
+        failures++;
+        printf("FAIL %s\n", what.c_str());
+    } else if (verbose) {
+        printf("ok   %s\n", what.c_str());
+    }
+}
+
+/* Compiles rules given without the header line. */
+bool load(CaptureTimeRules &rules, const std::string &name, const std::string &lines)
+{
+    std::string path = tmp_dir + "/" + name + ".csv";
+    std::ofstream(path) << "begin,end,skip,days\n" << lines;
+    rules.init(path, kDefaultInterval);
+    unlink(path.c_str());
+    return rules.is_init_();
+}
+
+unsigned minute_of_week(Day day, unsigned hour, unsigned minute)
+{
+    return day * 24 * 60 + hour * 60 + minute;
+}
+
+void expect_at(CaptureTimeRules &rules,
+               const char *scenario,
+               Day day,
+               unsigned hour,
+               unsigned minute,
+               unsigned expected)
+{
+    static const char *day_names[] = {"mon", "tue", "wed", "thu", "fri", "sat", "sun"};
+    unsigned got = rules.getTimeIntervalAt(minute_of_week(day, hour, minute)).count();
+    char what[160];
+
+    snprintf(what, sizeof(what), "%s: %s %02u:%02u is %u s, expected %u s", scenario,
+             day_names[day], hour, minute, got, expected);
+    check(got == expected, what);
+}
+
+void test_midnight_wrap()
+{
+    CaptureTimeRules rules;
+    const char *s = "midnight wrap";
+
+    check(load(rules, "midnight", "22:00,06:00,00:00:30\n"), "midnight wrap: rules load");
+    expect_at(rules, s, MON, 21, 59, kDefaultInterval);
+    expect_at(rules, s, MON, 22, 0, 30);
+    expect_at(rules, s, MON, 23, 59, 30);
+    expect_at(rules, s, TUE, 0, 0, 30);
+    expect_at(rules, s, TUE, 5, 59, 30);
+    expect_at(rules, s, TUE, 6, 0, kDefaultInterval);
+    /* Sunday's night runs into Monday morning. */
+    expect_at(rules, s, MON, 0, 0, 30);
+    expect_at(rules, s, MON, 5, 59, 30);
+}
+
+void test_week_wrap()
+{
+    CaptureTimeRules rules;
+    const char *s = "week wrap";
+
+    check(load(rules, "week", "23:30,00:30,00:00:05,sun\n"), "week wrap: rules load");
+    expect_at(rules, s, SUN, 23, 29, kDefaultInterval);
+    expect_at(rules, s, SUN, 23, 30, 5);
+    expect_at(rules, s, MON, 0, 0, 5);
+    expect_at(rules, s, MON, 0, 29, 5);
+    expect_at(rules, s, MON, 0, 30, kDefaultInterval);
+    /* Only begins on Sunday. */
+    expect_at(rules, s, SAT, 23, 45, kDefaultInterval);
+    expect_at(rules, s, SUN, 0, 15, kDefaultInterval);
+}
+
+void test_full_day()
+{
+    CaptureTimeRules rules;
+    const char *s = "begin == end";
+
+    /* An end equal to the begin is 24 hours later. */
+    check(load(rules, "fullday", "08:00,08:00,00:00:30,sat\n"), "begin == end: rules load");
+    expect_at(rules, s, SAT, 7, 59, kDefaultInterval);
+    expect_at(rules, s, SAT, 8, 0, 30);
+    expect_at(rules, s, SUN, 7, 59, 30);
+    expect_at(rules, s, SUN, 8, 0, kDefaultInterval);
+}
+
+void test_day_ranges()
+{
+    CaptureTimeRules rules;
+    const char *s = "day ranges";
+
+    check(load(rules, "days",
+               "12:00,13:00,00:01:00,mon-fri\n"
+               "12:00,13:00,00:00:20,sat sun\n"
+               "07:00,09:00,00:00:10,fri-mon\n"
+               "18:00,19:00,00:00:15,tue thu\n"),
+          "day ranges: rules load");
+    expect_at(rules, s, MON, 12, 30, 60);
+    expect_at(rules, s, FRI, 12, 30, 60);
+    expect_at(rules, s, SAT, 12, 30, 20);
+    expect_at(rules, s, SUN, 12, 59, 20);
+    expect_at(rules, s, SUN, 13, 0, kDefaultInterval);
+    /* fri-mon wraps over the end of the week. */
+    expect_at(rules, s, FRI, 7, 30, 10);
+    expect_at(rules, s, SAT, 7, 30, 10);
+    expect_at(rules, s, SUN, 7, 30, 10);
+    expect_at(rules, s, MON, 7, 30, 10);
+    expect_at(rules, s, TUE, 7, 30, kDefaultInterval);
+    expect_at(rules, s, THU, 7, 30, kDefaultInterval);
+    expect_at(rules, s, TUE, 18, 30, 15);
+    expect_at(rules, s, WED, 18, 30, kDefaultInterval);
+    expect_at(rules, s, THU, 18, 30, 15);
+}
+
+void test_precedence()
+{
+    CaptureTimeRules rules;
+    const char *s = "precedence";
+
+    /* Overlapping rules: the one earlier in the file wins where they
+     * overlap, including over the rules running into the next day. */
+    check(load(rules, "precedence",
+               "22:00,06:00,00:10:00\n"
+               "08:00,08:00,00:00:30,sat sun\n"
+               "12:00,13:00,00:01:00\n"
+               "11:00,14:00,00:00:02\n"),
+          "precedence: rules load");
+    expect_at(rules, s, SAT, 8, 0, 30);
+    expect_at(rules, s, SAT, 21, 59, 30);
+    expect_at(rules, s, SAT, 22, 0, 600);
+    expect_at(rules, s, SUN, 5, 59, 600);
+    expect_at(rules, s, SUN, 6, 0, 30);
+    expect_at(rules, s, MON, 7, 59, 30);
+    expect_at(rules, s, MON, 8, 0, kDefaultInterval);
+    expect_at(rules, s, WED, 11, 59, 2);
+    expect_at(rules, s, WED, 12, 0, 60);
+    expect_at(rules, s, WED, 12, 59, 60);
+    expect_at(rules, s, WED, 13, 0, 2);
+    /* The weekend rule comes before the lunch rules. */
+    expect_at(rules, s, SAT, 12, 30, 30);
+}
+
+void test_rejected_lines()
+{
+    CaptureTimeRules rules;
+
+    check(!load(rules, "badday", "08:00,09:00,00:00:10,monday\n"),
+          "rejected: day name \"monday\"");
+    check(!load(rules, "badrange", "08:00,09:00,00:00:10,mon-\n"),
+          "rejected: open day range");
+    check(!load(rules, "badchain", "08:00,09:00,00:00:10,mon-tue-wed\n"),
+          "rejected: chained day range");
+    check(!load(rules, "badtime", "25:00,09:00,00:00:10\n"), "rejected: hour 25");
+    check(!load(rules, "badfields", "08:00,09:00\n"), "rejected: missing interval");
+}
+
+void set_time_zone(const char *tz)
+{
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+time_t utc(int year, int month, int day, int hour, int minute, int second)
+{
+    tm t = {};
+    t.tm_year = year - 1900;
+    t.tm_mon = month - 1;
+    t.tm_mday = day;
+    t.tm_hour = hour;
+    t.tm_min = minute;
+    t.tm_sec = second;
+    return timegm(&t);
+}
+
+void expect_window(CaptureTimeRules &rules,
+                   const char *what,
+                   time_t now,
+                   unsigned expected_interval,
+                   time_t expected_from,
+                   time_t expected_until)
+{
+    CaptureTimeRules::t_time_pt from, until;
+    unsigned interval =
+        rules.getTimeIntervalAt(std::chrono::system_clock::from_time_t(now), from, until).count();
+    time_t from_s = std::chrono::system_clock::to_time_t(from);
+    time_t until_s = std::chrono::system_clock::to_time_t(until);
+    char msg[200];
+
+    snprintf(msg, sizeof(msg), "%s: %u s from %ld until %ld, expected %u s from %ld until %ld",
+             what, interval, (long)from_s, (long)until_s, expected_interval, (long)expected_from,
+             (long)expected_until);
+    check(interval == expected_interval && from_s == expected_from && until_s == expected_until,
+          msg);
+}
+
+void test_validity_window()
+{
+    CaptureTimeRules rules;
+
+    set_time_zone("UTC");
+    check(load(rules, "window", "22:00,06:00,00:00:30\n"), "window: rules load");
+    /* 2026-10-19 is a Monday. The window starts on the minute and ends at
+     * the next rule boundary. */
+    expect_window(rules, "window before a rule", utc(2026, 10, 19, 21, 58, 42), kDefaultInterval,
+                  utc(2026, 10, 19, 21, 58, 0), utc(2026, 10, 19, 22, 0, 0));
+    expect_window(rules, "window in a rule over midnight", utc(2026, 10, 19, 23, 10, 5), 30,
+                  utc(2026, 10, 19, 23, 10, 0), utc(2026, 10, 20, 6, 0, 0));
+
+    /* Same rule in UTC+7: 22:00 local is 15:00 UTC. */
+    set_time_zone("Asia/Ho_Chi_Minh");
+    expect_window(rules, "window in UTC+7", utc(2026, 10, 19, 14, 30, 0), kDefaultInterval,
+                  utc(2026, 10, 19, 14, 30, 0), utc(2026, 10, 19, 15, 0, 0));
+}
+
+void test_dst_cut_off()
+{
+    CaptureTimeRules rules;
+
+    set_time_zone("Europe/Paris");
+    check(load(rules, "dst", "12:00,13:00,00:00:30\n"), "DST: rules load");
+
+    /* Spring forward: 2026-03-29 01:00 UTC, 02:00 CET becomes 03:00 CEST.
+     * Local 01:58 has the default interval until noon, but the window must
+     * stop at the change since the local minutes shift there. */
+    time_t spring = utc(2026, 3, 29, 1, 0, 0);
+    expect_window(rules, "DST spring cut-off", spring - 90, kDefaultInterval,
+                  utc(2026, 3, 29, 0, 58, 0), spring);
+    /* After the change noon is 10:00 UTC. */
+    expect_window(rules, "DST spring after", spring, kDefaultInterval, spring,
+                  utc(2026, 3, 29, 10, 0, 0));
+
+    /* Fall back: 2026-10-25 01:00 UTC, 03:00 CEST becomes 02:00 CET. */
+    time_t autumn = utc(2026, 10, 25, 1, 0, 0);
+    expect_window(rules, "DST autumn cut-off", autumn - 30, kDefaultInterval,
+                  utc(2026, 10, 25, 0, 59, 0), autumn);
+    /* After the change noon is 11:00 UTC. */
+    expect_window(rules, "DST autumn after", autumn, kDefaultInterval, autumn,
+                  utc(2026, 10, 25, 11, 0, 0));
+
+    /* Inside the rule the window ends at the rule's end, no DST change in
+     * between. */
+    expect_window(rules, "DST inside a rule", utc(2026, 3, 30, 10, 15, 0), 30,
+                  utc(2026, 3, 30, 10, 15, 0), utc(2026, 3, 30, 11, 0, 0));
+}
+
+void test_current_interval()
+{
+    CaptureTimeRules rules;
+    CaptureTimeRules::t_time_pt from, until;
+
+    set_time_zone("UTC");
+    check(load(rules, "current",
+               "00:00,12:00,00:00:30\n"
+               "12:00,00:00,00:00:45\n"),
+          "current: rules load");
+    auto now = std::chrono::system_clock::now();
+    unsigned expected = rules.getTimeIntervalAt(now, from, until).count();
+    unsigned got = rules.getCurrentTimeInterval().count();
+    /* Allow for the clock crossing noon or midnight between the calls. */
+    check(got == expected || got == 30 + 45 - expected,
+          "current: getCurrentTimeInterval() matches the table");
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    char dir_template[] = "/tmp/capture_time_rules_XXXXXX";
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--verbose") || !strcmp(argv[i], "-v")) {
+            verbose = true;
+        } else {
+            fprintf(stderr, "usage: %s [--verbose]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!mkdtemp(dir_template)) {
+        perror("mkdtemp");
+        return 2;
+    }
+    tmp_dir = dir_template;
+
+    test_midnight_wrap();
+    test_week_wrap();
+    test_full_day();
+    test_day_ranges();
+    test_precedence();
+    test_rejected_lines();
+    test_validity_window();
+    test_dst_cut_off();
+    test_current_interval();
+
+    rmdir(tmp_dir.c_str());
+    printf("%u of %u checks passed\n", checks - failures, checks);
+    return failures ? 1 : 0;
+}
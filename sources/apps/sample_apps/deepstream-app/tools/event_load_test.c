@@ -0,0 +1,848 @@
+/*
+ * Load test for the recognition event path, without the attendance API.
+ *
+ * Runs the real event_dispatcher and event_spool against an embedded
+ * HTTP/1.1 stand-in for the API on 127.0.0.1. The stand-in can add latency,
+ * answer a share of requests with 503, leave a share unanswered (the client
+ * times out) and go down for scheduled outages (connections refused, open
+ * ones dropped). A generator thread plays the streaming thread: it enqueues
+ * synthetic events at a fixed rate and times every enqueue call.
+ *
+ * Failed events go to the spool and are replayed the way deepstream_app.c
+ * does it: a batch of LOG_RETRY_BATCH events whenever a delivery succeeds,
+ * and on a retry timer.
+ *
+ * The tool's own output goes to stdout with printf(), so that it is not
+ * lost among the dispatcher's g_print() messages (hidden unless --verbose).
+ *
+ * Reported: delivery latency percentiles (direct and via the spool), time
+ * the generator spent blocked in enqueue, spool growth and how fast the
+ * spool drained after each outage.
+ *
+ *   event_load_test --rate 200 --duration 120 --outage 30:40 --latency-ms 50
+ */
+
+#include "event_dispatcher.h"
+#include "event_spool.h"
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <errno.h>
+#include <glib/gstdio.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#define LOG_RETRY_BATCH 32
+#define MAX_OUTAGES 16
+#define POLL_MS 100
+/* Distinct images cycled through, so gzip cannot match one against the last. */
+#define NUM_IMAGES 16
+
+/* ---------------------------------------------------------------------- */
+/* Options                                                                  */
+/* ---------------------------------------------------------------------- */
+
+static gint duration_s = 60;
+static gdouble rate = 50;
+static gint image_kb = 8;
+static gint drain_s = 60;
+static gint retry_interval_s = 180;
+
+static gint latency_ms = 20;
+static gint jitter_ms = 10;
+static gdouble error_rate = 0;
+static gdouble timeout_rate = 0;
+static gchar **outage_specs = NULL;
+
+static gint num_workers = 0;
+static gint max_connections = 0;
+static gint queue_size = 0;
+static gint timeout_ms = 2000;
+static gint batch_max_events = 0;
+static gint batch_linger_ms = 0;
+static gboolean gzip_batches = FALSE;
+static gchar *spool_dir = NULL;
+static gboolean verbose = FALSE;
+
+static GOptionEntry entries[] = {
+    {"duration", 'd', 0, G_OPTION_ARG_INT, &duration_s, "Seconds of event generation (60)", "S"},
+    {"rate", 'r', 0, G_OPTION_ARG_DOUBLE, &rate, "Events per second (50)", "N"},
+    {"image-kb", 0, 0, G_OPTION_ARG_INT, &image_kb, "Face image size per event in KiB (8)", "KB"},
+    {"drain", 0, 0, G_OPTION_ARG_INT, &drain_s,
+     "Seconds to wait for queue and spool to empty afterwards (60)", "S"},
+    {"retry-interval", 0, 0, G_OPTION_ARG_INT, &retry_interval_s,
+     "Spool retry timer in seconds, as LOG_RETRY_INTERVAL (180)", "S"},
+    {"latency-ms", 0, 0, G_OPTION_ARG_INT, &latency_ms, "Server response latency (20)", "MS"},
+    {"jitter-ms", 0, 0, G_OPTION_ARG_INT, &jitter_ms, "Uniform extra latency up to (10)", "MS"},
+    {"error-rate", 0, 0, G_OPTION_ARG_DOUBLE, &error_rate, "Share of requests answered 503", "P"},
+    {"timeout-rate", 0, 0, G_OPTION_ARG_DOUBLE, &timeout_rate,
+     "Share of requests never answered", "P"},
+    {"outage", 0, 0, G_OPTION_ARG_STRING_ARRAY, &outage_specs,
+     "Server down from START for LENGTH seconds (repeatable)", "START:LENGTH"},
+    {"workers", 0, 0, G_OPTION_ARG_INT, &num_workers, "Dispatcher num-workers", "N"},
+    {"connections", 0, 0, G_OPTION_ARG_INT, &max_connections, "Dispatcher max-connections", "N"},
+    {"queue-size", 0, 0, G_OPTION_ARG_INT, &queue_size, "Dispatcher queue-size", "N"},
+    {"timeout-ms", 0, 0, G_OPTION_ARG_INT, &timeout_ms, "Dispatcher timeout-ms (2000)", "MS"},
+    {"batch", 0, 0, G_OPTION_ARG_INT, &batch_max_events, "Dispatcher batch-max-events", "N"},
+    {"linger-ms", 0, 0, G_OPTION_ARG_INT, &batch_linger_ms, "Dispatcher batch-linger-ms", "MS"},
+    {"gzip", 0, 0, G_OPTION_ARG_NONE, &gzip_batches, "Gzip batch bodies", NULL},
+    {"spool-dir", 0, 0, G_OPTION_ARG_FILENAME, &spool_dir,
+     "Spool directory (default: a fresh temporary one)", "DIR"},
+    {"verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
+     "Show the per-event messages of the dispatcher", NULL},
+    {NULL},
+};
+
+static gint64
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (gint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Stand-in API server                                                      */
+/* ---------------------------------------------------------------------- */
+
+typedef struct {
+    guint16 port;
+    int listen_fd;
+    pthread_t acceptor;
+    atomic_int down;
+    atomic_int stop;
+    atomic_int connections;
+
+    atomic_ulong requests;
+    atomic_ulong events;
+    atomic_ulong errors_injected;
+    atomic_ulong timeouts_injected;
+    atomic_ulong connections_dropped;
+} StandInServer;
+
+typedef struct {
+    StandInServer *server;
+    int fd;
+} StandInConnection;
+
+static int
+listen_on(guint16 port, guint16 *bound_port)
+{
+    struct sockaddr_in addr = {0};
+    socklen_t len = sizeof(addr);
+    int one = 1;
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0)
+        return -1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 128) != 0) {
+        close(fd);
+        return -1;
+    }
+    getsockname(fd, (struct sockaddr *)&addr, &len);
+    *bound_port = ntohs(addr.sin_port);
+    return fd;
+}
+
+/* Waits up to POLL_MS for @fd to become readable; -1 once the connection must go. */
+static int
+wait_readable(StandInConnection *c)
+{
+    struct pollfd pfd = {c->fd, POLLIN, 0};
+
+    if (atomic_load(&c->server->stop))
+        return -1;
+    if (atomic_load(&c->server->down)) {
+        atomic_fetch_add(&c->server->connections_dropped, 1);
+        return -1;
+    }
+    return poll(&pfd, 1, POLL_MS);
+}
+
+/* Appends more bytes from the connection to @buf; FALSE on close or error. */
+static gboolean
+read_more(StandInConnection *c, GString *buf)
+{
+    char chunk[16384];
+    ssize_t n;
+    int ready;
+
+    while ((ready = wait_readable(c)) == 0)
+        ;
+    if (ready < 0)
+        return FALSE;
+    n = recv(c->fd, chunk, sizeof(chunk), 0);
+    if (n <= 0)
+        return FALSE;
+    g_string_append_len(buf, chunk, n);
+    return TRUE;
+}
+
+static gboolean
+send_all(int fd, const gchar *data, gsize len)
+{
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0)
+            return FALSE;
+        data += n;
+        len -= (gsize)n;
+    }
+    return TRUE;
+}
+
+/* Value of header @name in the header block @headers, or NULL. */
+static gchar *
+header_value(const gchar *headers, const gchar *name)
+{
+    gsize name_len = strlen(name);
+    const gchar *line = strstr(headers, "\r\n");
+
+    while (line && line[2] != '\r') {
+        line += 2;
+        if (g_ascii_strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const gchar *end = strstr(line, "\r\n");
+            gchar *value = g_strndup(line + name_len + 1, end - line - name_len - 1);
+            return g_strstrip(value);
+        }
+        line = strstr(line, "\r\n");
+    }
+    return NULL;
+}
+
+/* Number of events in a request body: one object, or an array of them. */
+static guint
+count_events(const gchar *body, gsize len, gboolean gzipped)
+{
+    GString *plain = NULL;
+    const gchar *p;
+    guint n = 0;
+
+    if (gzipped) {
+        z_stream zs = {0};
+        gchar out[65536];
+        int ret = Z_OK;
+
+        plain = g_string_new(NULL);
+        inflateInit2(&zs, 16 + MAX_WBITS);
+        zs.next_in = (Bytef *)body;
+        zs.avail_in = (uInt)len;
+        while (ret == Z_OK) {
+            zs.next_out = (Bytef *)out;
+            zs.avail_out = sizeof(out);
+            ret = inflate(&zs, Z_NO_FLUSH);
+            g_string_append_len(plain, out, sizeof(out) - zs.avail_out);
+        }
+        inflateEnd(&zs);
+        body = plain->str;
+        len = plain->len;
+    }
+
+    if (len > 0 && body[0] != '[') {
+        n = 1;
+    } else {
+        for (p = body; (p = g_strstr_len(p, len - (p - body), "\"student_id\":")); p++)
+            n++;
+    }
+    if (plain)
+        g_string_free(plain, TRUE);
+    return n;
+}
+
+/* Answers one request according to the configured behaviour; FALSE to close. */
+static gboolean
+respond(StandInConnection *c, guint num_events, gboolean batch)
+{
+    StandInServer *s = c->server;
+    gdouble dice = g_random_double();
+    GString *reply;
+    gboolean ok;
+
+    if (dice < timeout_rate) {
+        /* Hold the request until the client gives up and closes. */
+        GString *sink = g_string_new(NULL);
+        atomic_fetch_add(&s->timeouts_injected, 1);
+        while (read_more(c, sink))
+            g_string_truncate(sink, 0);
+        g_string_free(sink, TRUE);
+        return FALSE;
+    }
+
+    g_usleep((gulong)(latency_ms + (jitter_ms > 0 ? g_random_int_range(0, jitter_ms + 1) : 0)) *
+             1000);
+    if (atomic_load(&s->down)) {
+        atomic_fetch_add(&s->connections_dropped, 1);
+        return FALSE;
+    }
+
+    reply = g_string_new(NULL);
+    if (dice < timeout_rate + error_rate) {
+        atomic_fetch_add(&s->errors_injected, 1);
+        g_string_append(reply, "HTTP/1.1 503 Service Unavailable\r\n"
+                               "Content-Type: application/json\r\n"
+                               "Content-Length: 20\r\n\r\n"
+                               "{\"status\":\"error\"}\r\n");
+    } else {
+        GString *body = g_string_new(batch ? "[" : "{\"status\":\"ok\"}");
+        if (batch) {
+            for (guint i = 0; i < num_events; i++)
+                g_string_append(body, i ? ",200" : "200");
+            g_string_append_c(body, ']');
+        }
+        atomic_fetch_add(&s->events, num_events);
+        g_string_append_printf(reply,
+                               "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: application/json\r\n"
+                               "Content-Length: %u\r\n\r\n%s",
+                               (guint)body->len, body->str);
+        g_string_free(body, TRUE);
+    }
+    ok = send_all(c->fd, reply->str, reply->len);
+    g_string_free(reply, TRUE);
+    return ok;
+}
+
+static void *
+connection_loop(void *data)
+{
+    StandInConnection *c = (StandInConnection *)data;
+    GString *buf = g_string_new(NULL);
+
+    for (;;) {
+        const gchar *head_end;
+        gchar *value;
+        gsize head_len;
+        gsize body_len = 0;
+        gboolean gzipped;
+
+        while (!(head_end = strstr(buf->str, "\r\n\r\n"))) {
+            if (!read_more(c, buf))
+                goto done;
+        }
+        head_len = head_end + 4 - buf->str;
+
+        value = header_value(buf->str, "Content-Length");
+        if (value)
+            body_len = g_ascii_strtoull(value, NULL, 10);
+        g_free(value);
+        value = header_value(buf->str, "Content-Encoding");
+        gzipped = value && g_ascii_strcasecmp(value, "gzip") == 0;
+        g_free(value);
+
+        while (buf->len < head_len + body_len) {
+            if (!read_more(c, buf))
+                goto done;
+        }
+
+        atomic_fetch_add(&c->server->requests, 1);
+        guint num_events = count_events(buf->str + head_len, body_len, gzipped);
+        if (!respond(c, num_events, buf->str[head_len] == '[' || gzipped))
+            goto done;
+        g_string_erase(buf, 0, head_len + body_len);
+    }
+
+done:
+    close(c->fd);
+    g_string_free(buf, TRUE);
+    atomic_fetch_sub(&c->server->connections, 1);
+    g_free(c);
+    return NULL;
+}
+
+/* Accepts connections; closes the listening socket while the server is down. */
+static void *
+acceptor_loop(void *data)
+{
+    StandInServer *s = (StandInServer *)data;
+    pthread_attr_t attr;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    while (!atomic_load(&s->stop)) {
+        struct pollfd pfd;
+        guint16 port;
+        pthread_t thread;
+
+        if (atomic_load(&s->down)) {
+            if (s->listen_fd >= 0) {
+                close(s->listen_fd);
+                s->listen_fd = -1;
+            }
+            g_usleep(POLL_MS * 1000);
+            continue;
+        }
+        if (s->listen_fd < 0 && (s->listen_fd = listen_on(s->port, &port)) < 0) {
+            g_usleep(POLL_MS * 1000);
+            continue;
+        }
+
+        pfd.fd = s->listen_fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, POLL_MS) <= 0)
+            continue;
+
+        int fd = accept(s->listen_fd, NULL, NULL);
+        if (fd < 0)
+            continue;
+        StandInConnection *c = g_new0(StandInConnection, 1);
+        c->server = s;
+        c->fd = fd;
+        atomic_fetch_add(&s->connections, 1);
+        if (pthread_create(&thread, &attr, connection_loop, c) != 0) {
+            atomic_fetch_sub(&s->connections, 1);
+            close(fd);
+            g_free(c);
+        }
+    }
+    pthread_attr_destroy(&attr);
+    if (s->listen_fd >= 0)
+        close(s->listen_fd);
+    return NULL;
+}
+
+static StandInServer *
+stand_in_server_start(void)
+{
+    StandInServer *s = g_new0(StandInServer, 1);
+
+    s->listen_fd = listen_on(0, &s->port);
+    if (s->listen_fd < 0) {
+        g_printerr("Cannot listen on 127.0.0.1: %s\n", g_strerror(errno));
+        g_free(s);
+        return NULL;
+    }
+    pthread_create(&s->acceptor, NULL, acceptor_loop, s);
+    return s;
+}
+
+static void
+stand_in_server_stop(StandInServer *s)
+{
+    atomic_store(&s->stop, 1);
+    pthread_join(s->acceptor, NULL);
+    while (atomic_load(&s->connections) > 0)
+        g_usleep(POLL_MS * 1000);
+    g_free(s);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Event path under test                                                    */
+/* ---------------------------------------------------------------------- */
+
+typedef struct {
+    gint start_s;
+    gint length_s;
+    /* Filled in as the run goes. */
+    gboolean over;
+    guint64 pending_at_end;
+    gboolean drained;
+    gint64 drained_us;
+} Outage;
+
+static EventDispatcher *dispatcher;
+static EventSpool *spool;
+static gint spool_replaying;
+
+static guint num_outages;
+static Outage outages[MAX_OUTAGES];
+
+/* Per generated event, indexed by its sequence number (sent as student_id). */
+static guint64 capacity;
+static gint64 *enqueued_at_us;
+static guint8 *was_spooled;
+static atomic_ulong generated;
+
+static GMutex results_lock;
+static GArray *enqueue_ns;
+static GArray *direct_latency_us;
+static GArray *spooled_latency_us;
+static atomic_ulong spool_failures;
+
+/* Same policy as replay_spooled_events() in deepstream_app.c. */
+static void
+replay_spooled_events(void)
+{
+    EventDispatcherStats stats;
+    gint budget;
+
+    if (!g_atomic_int_compare_and_exchange(&spool_replaying, 0, 1))
+        return;
+
+    event_dispatcher_get_stats(dispatcher, &stats);
+    budget = LOG_RETRY_BATCH - (gint)stats.queued;
+    while (budget-- > 0) {
+        RecognitionEvent *event = event_spool_peek(spool);
+        if (!event)
+            break;
+        /* A rejected event is spooled again by on_failed(). */
+        gboolean queued = event_dispatcher_enqueue(dispatcher, event);
+        event_spool_advance(spool);
+        if (!queued)
+            break;
+    }
+    g_atomic_int_set(&spool_replaying, 0);
+}
+
+static guint64
+event_seq(const RecognitionEvent *event)
+{
+    return g_ascii_strtoull(event->student_id, NULL, 10);
+}
+
+static void
+on_failed(const RecognitionEvent *event, gpointer user_data)
+{
+    guint64 seq = event_seq(event);
+
+    if (seq < capacity)
+        was_spooled[seq] = 1;
+    if (!event_spool_append(spool, event))
+        atomic_fetch_add(&spool_failures, 1);
+}
+
+static void
+on_delivered(const RecognitionEvent *event, gpointer user_data)
+{
+    guint64 seq = event_seq(event);
+
+    if (seq < capacity) {
+        gint64 latency = g_get_monotonic_time() - enqueued_at_us[seq];
+        g_mutex_lock(&results_lock);
+        g_array_append_val(was_spooled[seq] ? spooled_latency_us : direct_latency_us, latency);
+        g_mutex_unlock(&results_lock);
+    }
+    if (event_spool_pending(spool) > 0)
+        replay_spooled_events();
+}
+
+/* The streaming thread: one event every 1/rate seconds. */
+static gpointer
+generator_loop(gpointer data)
+{
+    gchar **images = (gchar **)data;
+    gint64 start = g_get_monotonic_time();
+    guint64 total = (guint64)(rate * duration_s);
+
+    for (guint64 seq = 0; seq < total; seq++) {
+        gint64 due = start + (gint64)(seq * 1e6 / rate);
+        gint64 wait = due - g_get_monotonic_time();
+        if (wait > 0)
+            g_usleep((gulong)wait);
+
+        RecognitionEvent *event = recognition_event_new();
+        g_snprintf(event->student_id, sizeof(event->student_id), "%" G_GUINT64_FORMAT, seq);
+        event->source_id = (guint)(seq % 4);
+        event->timestamp = time(NULL);
+        g_strlcpy(event->ip_address, "192.168.1.10", sizeof(event->ip_address));
+        g_strlcpy(event->mac_address, "00:04:4b:aa:bb:cc", sizeof(event->mac_address));
+        event->face_image = g_strdup(images[seq % NUM_IMAGES]);
+        enqueued_at_us[seq] = g_get_monotonic_time();
+        gint64 t0 = now_ns();
+        event_dispatcher_enqueue(dispatcher, event);
+        gint64 spent = now_ns() - t0;
+
+        g_mutex_lock(&results_lock);
+        g_array_append_val(enqueue_ns, spent);
+        g_mutex_unlock(&results_lock);
+        atomic_store(&generated, seq + 1);
+    }
+    return NULL;
+}
+
+/* The dispatcher and the spool report every event with g_print(). */
+static void
+discard_print(const gchar *message)
+{
+}
+
+static gchar *
+make_image(gsize kb)
+{
+    static const gchar alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    GString *s = g_string_new("data:image/jpeg;base64,");
+
+    for (gsize i = 0; i < kb * 1024; i++)
+        g_string_append_c(s, alphabet[g_random_int_range(0, 64)]);
+    return g_string_free(s, FALSE);
+}
+
+static guint64
+dir_size(const gchar *path)
+{
+    guint64 total = 0;
+    struct dirent *entry;
+    DIR *dir = opendir(path);
+
+    if (!dir)
+        return 0;
+    while ((entry = readdir(dir))) {
+        struct stat st;
+        gchar *file = g_build_filename(path, entry->d_name, NULL);
+        if (stat(file, &st) == 0 && S_ISREG(st.st_mode))
+            total += (guint64)st.st_size;
+        g_free(file);
+    }
+    closedir(dir);
+    return total;
+}
+
+static void
+remove_dir(const gchar *path)
+{
+    struct dirent *entry;
+    DIR *dir = opendir(path);
+
+    if (!dir)
+        return;
+    while ((entry = readdir(dir))) {
+        gchar *file = g_build_filename(path, entry->d_name, NULL);
+        if (entry->d_name[0] != '.')
+            g_remove(file);
+        g_free(file);
+    }
+    closedir(dir);
+    g_rmdir(path);
+}
+
+static gboolean
+parse_outages(void)
+{
+    for (gchar **spec = outage_specs; spec && *spec; spec++) {
+        Outage *o = &outages[num_outages];
+        if (num_outages == MAX_OUTAGES || sscanf(*spec, "%d:%d", &o->start_s, &o->length_s) != 2 ||
+            o->start_s < 0 || o->length_s <= 0) {
+            g_printerr("Bad --outage %s (START:LENGTH, at most %d)\n", *spec, MAX_OUTAGES);
+            return FALSE;
+        }
+        num_outages++;
+    }
+    return TRUE;
+}
+
+static gint
+compare_int64(gconstpointer a, gconstpointer b)
+{
+    gint64 x = *(const gint64 *)a;
+    gint64 y = *(const gint64 *)b;
+    return x < y ? -1 : x > y;
+}
+
+static gint64
+percentile(GArray *sorted, gdouble p)
+{
+    if (sorted->len == 0)
+        return 0;
+    return g_array_index(sorted, gint64, (guint)MIN(sorted->len - 1, p * sorted->len));
+}
+
+static void
+print_distribution(const gchar *name, GArray *values, gdouble scale, const gchar *unit)
+{
+    g_array_sort(values, compare_int64);
+    printf("%-24s n=%-8u p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  max %.2f %s\n", name,
+           values->len, percentile(values, 0.5) / scale, percentile(values, 0.9) / scale,
+           percentile(values, 0.99) / scale, percentile(values, 0.999) / scale,
+           values->len ? g_array_index(values, gint64, values->len - 1) / scale : 0, unit);
+}
+
+int
+main(int argc, char *argv[])
+{
+    GOptionContext *ctx = g_option_context_new("- load test of the recognition event path");
+    GError *error = NULL;
+    NvDsRecognitionEventConfig config = {0};
+    NvDsEventSpoolConfig spool_config = {0};
+    StandInServer *server;
+    EventDispatcherStats stats;
+    GThread *generator;
+    gchar *images[NUM_IMAGES];
+    gchar *tmp_dir = NULL;
+    guint64 spool_peak_events = 0;
+    guint64 spool_peak_bytes = 0;
+    gint64 start, end, last_print, last_retry;
+    gint64 generation_end = 0;
+    gboolean ok;
+
+    g_option_context_add_main_entries(ctx, entries, NULL);
+    if (!g_option_context_parse(ctx, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        return 1;
+    }
+    g_option_context_free(ctx);
+    if (rate <= 0 || duration_s <= 0 || !parse_outages())
+        return 1;
+    if (!verbose)
+        g_set_print_handler(discard_print);
+
+    server = stand_in_server_start();
+    if (!server)
+        return 1;
+
+    if (!spool_dir)
+        spool_dir = tmp_dir = g_dir_make_tmp("event_load_test_XXXXXX", NULL);
+    spool_config.dir = spool_dir;
+    spool = event_spool_open(&spool_config);
+    if (!spool) {
+        g_printerr("Cannot open spool in %s\n", spool_dir);
+        return 1;
+    }
+
+    config.api_url = g_strdup_printf("http://127.0.0.1:%u/apis/aiFaceRecognitionLogAPI",
+                                     server->port);
+    config.num_workers = (guint)num_workers;
+    config.max_connections = (guint)max_connections;
+    config.queue_size = (guint)queue_size;
+    config.timeout_ms = (guint)timeout_ms;
+    config.batch_max_events = (guint)batch_max_events;
+    config.batch_linger_ms = (guint)batch_linger_ms;
+    config.compression = gzip_batches ? EVENT_COMPRESSION_GZIP : EVENT_COMPRESSION_NONE;
+    dispatcher = event_dispatcher_new(&config, on_failed, on_delivered, NULL);
+
+    capacity = (guint64)(rate * duration_s) + 1;
+    enqueued_at_us = g_new0(gint64, capacity);
+    was_spooled = g_new0(guint8, capacity);
+    g_mutex_init(&results_lock);
+    enqueue_ns = g_array_new(FALSE, FALSE, sizeof(gint64));
+    direct_latency_us = g_array_new(FALSE, FALSE, sizeof(gint64));
+    spooled_latency_us = g_array_new(FALSE, FALSE, sizeof(gint64));
+    for (guint i = 0; i < NUM_IMAGES; i++)
+        images[i] = make_image((gsize)image_kb);
+
+    printf("Stand-in API at %s, spool in %s\n", config.api_url, spool_dir);
+    printf("%6s %-6s %9s %9s %9s %8s %7s %9s %10s\n", "t(s)", "api", "generated", "delivered",
+           "failed", "dropped", "queued", "spooled", "spool(KiB)");
+
+    start = last_print = last_retry = g_get_monotonic_time();
+    generator = g_thread_new("generator", generator_loop, images);
+
+    for (;;) {
+        gint64 now = g_get_monotonic_time();
+        gdouble t = (now - start) / 1e6;
+        gboolean down = FALSE;
+        guint64 pending;
+
+        g_usleep(POLL_MS * 1000);
+
+        for (guint i = 0; i < num_outages; i++) {
+            Outage *o = &outages[i];
+            if (t >= o->start_s && t < o->start_s + o->length_s)
+                down = TRUE;
+        }
+        atomic_store(&server->down, down);
+
+        pending = event_spool_pending(spool);
+        event_dispatcher_get_stats(dispatcher, &stats);
+        for (guint i = 0; i < num_outages; i++) {
+            Outage *o = &outages[i];
+            if (!o->over && t >= o->start_s + o->length_s) {
+                o->over = TRUE;
+                o->pending_at_end = pending;
+            }
+            if (o->over && !o->drained && pending == 0) {
+                o->drained = TRUE;
+                o->drained_us = now - start - (gint64)(o->start_s + o->length_s) * 1000000;
+            }
+        }
+
+        event_spool_sync(spool);
+        spool_peak_events = MAX(spool_peak_events, pending);
+        if (retry_interval_s > 0 && now - last_retry >= (gint64)retry_interval_s * 1000000) {
+            replay_spooled_events();
+            last_retry = now;
+        }
+
+        if (now - last_print >= 1000000) {
+            guint64 bytes = dir_size(spool_dir);
+            spool_peak_bytes = MAX(spool_peak_bytes, bytes);
+            printf("%6.1f %-6s %9lu %9" G_GUINT64_FORMAT " %9" G_GUINT64_FORMAT
+                   " %8" G_GUINT64_FORMAT " %7u %9" G_GUINT64_FORMAT " %10" G_GUINT64_FORMAT
+                   "\n",
+                   t, down ? "DOWN" : "up", atomic_load(&generated), stats.delivered,
+                   stats.failed, stats.dropped, stats.queued, pending, bytes / 1024);
+            last_print = now;
+        }
+
+        if (!generation_end && atomic_load(&generated) >= (guint64)(rate * duration_s))
+            generation_end = now;
+        if (generation_end && stats.queued == 0 && pending == 0 &&
+            stats.delivered >= atomic_load(&generated))
+            break;
+        if (generation_end && now - generation_end > (gint64)drain_s * 1000000)
+            break;
+    }
+    end = g_get_monotonic_time();
+    g_thread_join(generator);
+
+    event_dispatcher_get_stats(dispatcher, &stats);
+    event_dispatcher_free(dispatcher);
+    event_spool_sync(spool);
+
+    printf("\n== %.1f s, %.0f events/s of %d KiB for %d s ==\n", (end - start) / 1e6, rate,
+           image_kb, duration_s);
+    printf("Events: generated %lu, dropped at enqueue (spooled) %" G_GUINT64_FORMAT
+           ", delivered %u directly + %u via spool, still spooled %" G_GUINT64_FORMAT
+           ", spool write errors %lu\n",
+           atomic_load(&generated), stats.dropped, direct_latency_us->len,
+           spooled_latency_us->len, event_spool_pending(spool), atomic_load(&spool_failures));
+    printf("Dispatcher: %" G_GUINT64_FORMAT " requests, %" G_GUINT64_FORMAT
+           " KiB sent, %" G_GUINT64_FORMAT " failed deliveries\n",
+           stats.requests, stats.bytes_sent / 1024, stats.failed);
+    printf("Stand-in: %lu requests, %lu events accepted, %lu x 503, %lu unanswered, "
+           "%lu connections dropped\n",
+           atomic_load(&server->requests), atomic_load(&server->events),
+           atomic_load(&server->errors_injected), atomic_load(&server->timeouts_injected),
+           atomic_load(&server->connections_dropped));
+    print_distribution("Enqueue (streaming)", enqueue_ns, 1e3, "us");
+    print_distribution("Delivery, direct", direct_latency_us, 1e3, "ms");
+    print_distribution("Delivery, via spool", spooled_latency_us, 1e6, "s");
+    printf("Spool peak: %" G_GUINT64_FORMAT " events, %" G_GUINT64_FORMAT " KiB\n",
+           spool_peak_events, spool_peak_bytes / 1024);
+    for (guint i = 0; i < num_outages; i++) {
+        Outage *o = &outages[i];
+        if (!o->over) {
+            printf("Outage %u (%d s at %d s): not over before the end of the run\n", i + 1,
+                   o->length_s, o->start_s);
+        } else if (!o->drained) {
+            printf("Outage %u (%d s at %d s): %" G_GUINT64_FORMAT
+                   " spooled events, spool not drained\n",
+                   i + 1, o->length_s, o->start_s, o->pending_at_end);
+        } else {
+            printf("Outage %u (%d s at %d s): %" G_GUINT64_FORMAT
+                   " spooled events drained in %.1f s (%.0f events/s)\n",
+                   i + 1, o->length_s, o->start_s, o->pending_at_end, o->drained_us / 1e6,
+                   o->pending_at_end / MAX(o->drained_us / 1e6, POLL_MS / 1e3));
+        }
+    }
+
+    ok = stats.delivered >= atomic_load(&generated) && event_spool_pending(spool) == 0;
+    event_spool_close(spool);
+    stand_in_server_stop(server);
+    if (tmp_dir)
+        remove_dir(tmp_dir);
+    g_free(config.api_url);
+    for (guint i = 0; i < NUM_IMAGES; i++)
+        g_free(images[i]);
+    g_free(enqueued_at_us);
+    g_free(was_spooled);
+    g_array_free(enqueue_ns, TRUE);
+    g_array_free(direct_latency_us, TRUE);
+    g_array_free(spooled_latency_us, TRUE);
+    g_free(tmp_dir);
+    return ok ? 0 : 2;
+}
@@ -59,6 +59,11 @@ GST_DEBUG_CATEGORY(gst_nvinfer_debug);
 #define PROCESS_MODEL_FULL_FRAME 1
 #define PROCESS_MODEL_OBJECTS 2
 
+/* Size of the GRAY8 frame thumbnails compared for motion-gated full-frame
+ * processing. */
+#define MOTION_THUMBNAIL_WIDTH 64
+#define MOTION_THUMBNAIL_HEIGHT 36
+
 /* Warn about untracked objects in async mode every 5 minutes. */
 #define UNTRACKED_OBJECT_WARN_INTERVAL (GST_SECOND * 60 * 5)
 
@@ -100,6 +105,10 @@ static GQuark _dsmeta_quark = 0;
 #define DEFAULT_OUTPUT_INSTANCE_MASK FALSE
 #define DEFAULT_OUTPUT_FACE_DETECTION_LANDMARK FALSE
 #define DEFAULT_INPUT_TENSOR_META FALSE
+#define DEFAULT_OBJECT_BATCH_TIMEOUT 0
+#define DEFAULT_MOTION_GATING_THRESHOLD 0
+#define DEFAULT_MOTION_GATING_MIN_INTERVAL 0
+#define DEFAULT_MOTION_GATING_MAX_INTERVAL 30
 
 static float DEFAULT_REFERENCE_5PTS[5][2] = {{38.2946f + 8.0f, 51.6963f},
                                              {73.5318f + 8.0f, 51.5014f},
@@ -152,6 +161,9 @@ static GstFlowReturn gst_nvinfer_generate_output(GstBaseTransform *btrans, GstBu
 
 static gpointer gst_nvinfer_input_queue_loop(gpointer data);
 static gpointer gst_nvinfer_output_loop(gpointer data);
+static gpointer gst_nvinfer_obj_batch_timer_loop(gpointer data);
+
+static gboolean flush_pending_object_batch(GstNvInfer *nvinfer);
 
 static void gst_nvinfer_reset_init_params(GstNvInfer *nvinfer);
 
@@ -364,6 +376,15 @@ static void gst_nvinfer_class_init(GstNvInferClass *klass)
             DEFAULT_INPUT_TENSOR_META,
             (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
 
+    g_object_class_install_property(
+        gobject_class, PROP_OBJECT_BATCH_TIMEOUT,
+        g_param_spec_uint(
+            "object-batch-timeout-ms", "Object Batch Timeout",
+            "Maximum time in milliseconds a partially filled object batch waits for objects "
+            "from following buffers before it is inferred (0 = infer at the end of each buffer)",
+            0, G_MAXUINT, DEFAULT_OBJECT_BATCH_TIMEOUT,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+
     /** install signal MODEL_UPDATED */
     gst_nvinfer_signals[SIGNAL_MODEL_UPDATED] =
         g_signal_new("model-updated", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST,
@@ -410,6 +431,10 @@ static void gst_nvinfer_init(GstNvInfer *nvinfer)
 
     nvinfer->max_batch_size = impl->m_InitParams->maxBatchSize = DEFAULT_BATCH_SIZE;
     nvinfer->interval = DEFAULT_INTERVAL;
+    nvinfer->object_batch_timeout_ms = DEFAULT_OBJECT_BATCH_TIMEOUT;
+    nvinfer->motion_gating_threshold = DEFAULT_MOTION_GATING_THRESHOLD;
+    nvinfer->motion_gating_min_interval = DEFAULT_MOTION_GATING_MIN_INTERVAL;
+    nvinfer->motion_gating_max_interval = DEFAULT_MOTION_GATING_MAX_INTERVAL;
     nvinfer->operate_on_gie_id = DEFAULT_OPERATE_ON_GIE_ID;
     nvinfer->gpu_id = impl->m_InitParams->gpuID = DEFAULT_GPU_DEVICE_ID;
     nvinfer->is_prop_set = new std::vector<gboolean>(PROP_LAST, FALSE);
@@ -423,6 +448,8 @@ static void gst_nvinfer_init(GstNvInfer *nvinfer)
     /* Create processing lock and condition for synchronization.*/
     g_mutex_init(&nvinfer->process_lock);
     g_cond_init(&nvinfer->process_cond);
+    g_mutex_init(&nvinfer->obj_batch_lock);
+    g_cond_init(&nvinfer->obj_batch_cond);
 
     /* This quark is required to identify NvDsMeta when iterating through
      * the buffer metadatas */
@@ -437,6 +464,8 @@ static void gst_nvinfer_finalize(GObject *object)
 
     g_mutex_clear(&nvinfer->process_lock);
     g_cond_clear(&nvinfer->process_cond);
+    g_mutex_clear(&nvinfer->obj_batch_lock);
+    g_cond_clear(&nvinfer->obj_batch_cond);
 
     delete nvinfer->perClassDetectionFilterParams;
     delete nvinfer->perClassColorParams;
@@ -564,6 +593,9 @@ static void gst_nvinfer_set_property(GObject *object,
         nvinfer->input_tensor_from_meta = g_value_get_boolean(value);
         impl->m_InitParams->inputFromPreprocessedTensor = g_value_get_boolean(value);
         break;
+    case PROP_OBJECT_BATCH_TIMEOUT:
+        nvinfer->object_batch_timeout_ms = g_value_get_uint(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -645,6 +677,9 @@ static void gst_nvinfer_get_property(GObject *object,
     case PROP_INPUT_TENSOR_META:
         g_value_set_boolean(value, nvinfer->input_tensor_from_meta);
         break;
+    case PROP_OBJECT_BATCH_TIMEOUT:
+        g_value_set_uint(value, nvinfer->object_batch_timeout_ms);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -704,6 +739,7 @@ static void gst_nvinfer_reset_init_params(GstNvInfer *nvinfer)
     delete prev_params->perClassDetectionParams;
     g_strfreev(prev_params->outputLayerNames);
     g_strfreev(prev_params->outputIOFormats);
+    g_strfreev(prev_params->inputIOFormats);
     g_strfreev(prev_params->layerDevicePrecisions);
 }
 
@@ -734,6 +770,13 @@ static gboolean gst_nvinfer_sink_event(GstBaseTransform *trans, GstEvent *event)
      * the buffers are already pushed downstream. */
     if (GST_EVENT_IS_SERIALIZED(event) && !ignore_serialized_event &&
         !nvinfer->classifier_async_mode) {
+        /* Objects held back for cross-buffer batching must be inferred and
+         * their buffers pushed before the event. */
+        if (nvinfer->pending_obj_batch) {
+            LockGMutex batch_locker(nvinfer->obj_batch_lock);
+            flush_pending_object_batch(nvinfer);
+        }
+
         GstNvInferBatch *batch = new GstNvInferBatch;
         batch->event_marker = TRUE;
 
@@ -775,8 +818,11 @@ static gboolean gst_nvinfer_sink_event(GstBaseTransform *trans, GstEvent *event)
         guint source_id;
         gst_nvevent_parse_stream_eos(event, &source_id);
         auto result = nvinfer->source_info->find(source_id);
-        if (result != nvinfer->source_info->end())
+        if (result != nvinfer->source_info->end()) {
             result->second.object_history_map.clear();
+            result->second.motion_ref_thumbnail.clear();
+            result->second.motion_skipped_frames = 0;
+        }
     }
 
     if (GST_EVENT_TYPE(event) == GST_EVENT_EOS) {
@@ -1031,6 +1077,15 @@ static gboolean gst_nvinfer_start(GstBaseTransform *btrans)
         }
     }
 
+    if (nvinfer->motion_gating_threshold > 0 &&
+        (!nvinfer->process_full_frame || nvinfer->input_tensor_from_meta)) {
+        GST_ELEMENT_WARNING(nvinfer, LIBRARY, SETTINGS,
+                            ("NvInfer motion gating is applicable for primary mode only. "
+                             "Turning off motion gating"),
+                            (nullptr));
+        nvinfer->motion_gating_threshold = 0;
+    }
+
     /* Start a thread which will pop output from the algorithm, form NvDsMeta and
      * push buffers to the next element. */
     nvinfer->output_thread =
@@ -1044,6 +1099,23 @@ static gboolean gst_nvinfer_start(GstBaseTransform *btrans)
             g_thread_new("nvinfer-input-queue-thread", gst_nvinfer_input_queue_loop, nvinfer);
     }
 
+    /* Start a thread which will submit partially filled object batches carried
+     * across input buffers once their deadline expires. */
+    if (nvinfer->object_batch_timeout_ms > 0) {
+        if (nvinfer->process_full_frame || nvinfer->classifier_async_mode ||
+            nvinfer->input_tensor_from_meta) {
+            GST_ELEMENT_WARNING(nvinfer, LIBRARY, SETTINGS,
+                                ("NvInfer cross-buffer object batching is applicable for "
+                                 "synchronous secondary mode only. Turning it off"),
+                                (nullptr));
+            nvinfer->object_batch_timeout_ms = 0;
+        } else {
+            nvinfer->pending_obj_batch = new GstNvInferPendingObjBatch;
+            nvinfer->obj_batch_timer_thread = g_thread_new(
+                "nvinfer-obj-batch-timer-thread", gst_nvinfer_obj_batch_timer_loop, nvinfer);
+        }
+    }
+
     /* nvinfer internal resource start for loading models */
     impl->m_InferCtx = std::move(ctx_ptr);
     if (impl->start() != NVDSINFER_SUCCESS) {
@@ -1068,6 +1140,19 @@ static gboolean gst_nvinfer_stop(GstBaseTransform *btrans)
     GstNvInfer *nvinfer = GST_NVINFER(btrans);
     DsNvInferImpl *impl = DS_NVINFER_IMPL(nvinfer);
 
+    /* Submit the objects still waiting for a batch and stop the batch timer
+     * thread. */
+    if (nvinfer->pending_obj_batch) {
+        LockGMutex batch_locker(nvinfer->obj_batch_lock);
+        flush_pending_object_batch(nvinfer);
+        nvinfer->pending_obj_batch->stop = TRUE;
+        g_cond_broadcast(&nvinfer->obj_batch_cond);
+        batch_locker.unlock();
+
+        g_thread_join(nvinfer->obj_batch_timer_thread);
+        nvinfer->obj_batch_timer_thread = nullptr;
+    }
+
     LockGMutex locker(nvinfer->process_lock);
     /* Wait till all the items in the two queues are handled. */
     while (!g_queue_is_empty(nvinfer->input_queue)) {
@@ -1089,6 +1174,9 @@ static gboolean gst_nvinfer_stop(GstBaseTransform *btrans)
 
     nvinfer->stop = FALSE;
 
+    delete nvinfer->pending_obj_batch;
+    nvinfer->pending_obj_batch = nullptr;
+
     delete nvinfer->source_info;
     delete nvinfer->layers_info;
     delete nvinfer->output_layers_info;
@@ -1097,6 +1185,11 @@ static gboolean gst_nvinfer_stop(GstBaseTransform *btrans)
     delete[] nvinfer->transform_params.dst_rect;
     delete[] nvinfer->tmp_surf.surfaceList;
 
+    if (nvinfer->motion_surf) {
+        NvBufSurfaceDestroy(nvinfer->motion_surf);
+        nvinfer->motion_surf = nullptr;
+    }
+
     cudaSetDevice(nvinfer->gpu_id);
 
     if (nvinfer->convertStream)
@@ -1662,6 +1755,109 @@ static gboolean convert_batch_and_push_to_input_thread(GstNvInfer *nvinfer,
     return TRUE;
 }
 
+/* Scale all the frames of the input batch to GRAY8 thumbnails in
+ * nvinfer->motion_surf and map them for CPU access. */
+static gboolean create_motion_thumbnails(GstNvInfer *nvinfer, NvBufSurface *in_surf)
+{
+    NvBufSurfTransformParams params = {0};
+    NvBufSurfTransform_Error err;
+
+    /* (Re)allocate the thumbnail surface when the input batch size grows. */
+    if (!nvinfer->motion_surf || nvinfer->motion_surf->batchSize < in_surf->batchSize) {
+        NvBufSurfaceCreateParams create_params = {0};
+        create_params.gpuId = nvinfer->gpu_id;
+        create_params.width = MOTION_THUMBNAIL_WIDTH;
+        create_params.height = MOTION_THUMBNAIL_HEIGHT;
+        create_params.colorFormat = NVBUF_COLOR_FORMAT_GRAY8;
+        create_params.layout = NVBUF_LAYOUT_PITCH;
+#ifdef __aarch64__
+        create_params.memType = NVBUF_MEM_DEFAULT;
+#else
+        create_params.memType = NVBUF_MEM_CUDA_UNIFIED;
+#endif
+
+        if (nvinfer->motion_surf)
+            NvBufSurfaceDestroy(nvinfer->motion_surf);
+        nvinfer->motion_surf = nullptr;
+        if (NvBufSurfaceCreate(&nvinfer->motion_surf, in_surf->batchSize, &create_params) != 0) {
+            GST_ELEMENT_ERROR(nvinfer, RESOURCE, FAILED,
+                              ("Failed to create motion gating thumbnail surface"), (NULL));
+            nvinfer->motion_surf = nullptr;
+            return FALSE;
+        }
+    }
+    nvinfer->motion_surf->numFilled = in_surf->numFilled;
+
+    err = NvBufSurfTransformSetSessionParams(&nvinfer->transform_config_params);
+    if (err != NvBufSurfTransformError_Success) {
+        GST_ELEMENT_ERROR(nvinfer, STREAM, FAILED,
+                          ("NvBufSurfTransformSetSessionParams failed with error %d", err), (NULL));
+        return FALSE;
+    }
+
+    params.transform_flag = NVBUFSURF_TRANSFORM_FILTER;
+    params.transform_filter = NvBufSurfTransformInter_Bilinear;
+    err = NvBufSurfTransform(in_surf, nvinfer->motion_surf, &params);
+    if (err != NvBufSurfTransformError_Success) {
+        GST_ELEMENT_ERROR(nvinfer, STREAM, FAILED,
+                          ("NvBufSurfTransform failed with error %d while creating thumbnails", err),
+                          (NULL));
+        return FALSE;
+    }
+
+    if (NvBufSurfaceMap(nvinfer->motion_surf, -1, 0, NVBUF_MAP_READ) != 0) {
+        GST_ELEMENT_ERROR(nvinfer, STREAM, FAILED,
+                          ("%s:buffer map to be accessed by CPU failed", __func__), (NULL));
+        return FALSE;
+    }
+    if (nvinfer->motion_surf->memType == NVBUF_MEM_SURFACE_ARRAY)
+        NvBufSurfaceSyncForCpu(nvinfer->motion_surf, -1, 0);
+
+    return TRUE;
+}
+
+/* Decide whether a frame of the source should be inferred on based on the
+ * change of its thumbnail since the last inferred frame of the source. */
+static gboolean motion_gate_should_infer(GstNvInfer *nvinfer,
+                                         GstNvInferSourceInfo *source_info,
+                                         NvBufSurfaceParams *thumbnail)
+{
+    const guint thumbnail_size = MOTION_THUMBNAIL_WIDTH * MOTION_THUMBNAIL_HEIGHT;
+    std::vector<guint8> &ref = source_info->motion_ref_thumbnail;
+    const guint8 *data = (const guint8 *)thumbnail->mappedAddr.addr[0];
+    const guint pitch = thumbnail->pitch;
+    gboolean infer;
+
+    if (ref.size() != thumbnail_size) {
+        infer = TRUE;
+    } else if (source_info->motion_skipped_frames < nvinfer->motion_gating_min_interval) {
+        infer = FALSE;
+    } else if (source_info->motion_skipped_frames >= nvinfer->motion_gating_max_interval) {
+        infer = TRUE;
+    } else {
+        /* Mean absolute luma difference to the last inferred frame. */
+        guint64 sad = 0;
+        for (guint y = 0; y < MOTION_THUMBNAIL_HEIGHT; y++) {
+            const guint8 *row = data + y * pitch;
+            const guint8 *ref_row = ref.data() + y * MOTION_THUMBNAIL_WIDTH;
+            for (guint x = 0; x < MOTION_THUMBNAIL_WIDTH; x++)
+                sad += ABS((gint)row[x] - (gint)ref_row[x]);
+        }
+        infer = ((gdouble)sad / thumbnail_size) >= nvinfer->motion_gating_threshold;
+    }
+
+    if (!infer) {
+        source_info->motion_skipped_frames++;
+        return FALSE;
+    }
+
+    ref.resize(thumbnail_size);
+    for (guint y = 0; y < MOTION_THUMBNAIL_HEIGHT; y++)
+        memcpy(ref.data() + y * MOTION_THUMBNAIL_WIDTH, data + y * pitch, MOTION_THUMBNAIL_WIDTH);
+    source_info->motion_skipped_frames = 0;
+    return TRUE;
+}
+
 /* Process entire frames in the batched buffer. */
 static GstFlowReturn gst_nvinfer_process_full_frame(GstNvInfer *nvinfer,
                                                     GstBuffer *inbuf,
@@ -1677,6 +1873,7 @@ static GstFlowReturn gst_nvinfer_process_full_frame(GstNvInfer *nvinfer,
     gdouble scale_ratio_x, scale_ratio_y;
     guint offset_left = 0, offset_top = 0;
     gboolean skip_batch;
+    std::vector<gboolean> skip_frames;
 
     /* Process batch only when interval_counter is 0. */
     skip_batch = (nvinfer->interval_counter++ % (nvinfer->interval + 1) > 0);
@@ -1706,11 +1903,32 @@ static GstFlowReturn gst_nvinfer_process_full_frame(GstNvInfer *nvinfer,
     }
     num_filled = batch_meta->num_frames_in_batch;
 
+    /* Motion gating. Mark the frames of sources whose scene has not changed
+     * enough since their last inferred frame to be skipped. */
+    if (nvinfer->motion_gating_threshold > 0) {
+        if (!create_motion_thumbnails(nvinfer, in_surf))
+            return GST_FLOW_ERROR;
+
+        skip_frames.resize(num_filled, FALSE);
+        for (guint i = 0; i < num_filled; i++) {
+            NvDsFrameMeta *frame_meta = nvds_get_nth_frame_meta(batch_meta->frame_meta_list, i);
+            auto iter = nvinfer->source_info->find(frame_meta->pad_index);
+            if (iter == nvinfer->source_info->end())
+                continue;
+            skip_frames[i] = !motion_gate_should_infer(
+                nvinfer, &iter->second, nvinfer->motion_surf->surfaceList + frame_meta->batch_id);
+        }
+        NvBufSurfaceUnMap(nvinfer->motion_surf, -1, 0);
+    }
+
     /* Processing on full frames. Iterate through all the frames in the batched
      * input buffer. */
     for (guint i = 0; i < num_filled; i++) {
         guint idx;
 
+        if (!skip_frames.empty() && skip_frames[i])
+            continue;
+
         /* No existing GstNvInferBatch structure. Allocate a new structure,
          * acquire a buffer from our internal pool for conversions. */
         if (batch == nullptr) {
@@ -1761,9 +1979,8 @@ static GstFlowReturn gst_nvinfer_process_full_frame(GstNvInfer *nvinfer,
         frame.input_surf_params = in_surf->surfaceList + i;
         batch->frames.push_back(frame);
 
-        /* Submit batch if the batch size has reached max_batch_size or
-         * if this is the last frame in the input batched buffer. */
-        if (batch->frames.size() == nvinfer->max_batch_size || i == num_filled - 1) {
+        /* Submit batch if the batch size has reached max_batch_size. */
+        if (batch->frames.size() == nvinfer->max_batch_size) {
             if (!convert_batch_and_push_to_input_thread(nvinfer, batch.get(), memory)) {
                 return GST_FLOW_ERROR;
             }
@@ -1775,6 +1992,16 @@ static GstFlowReturn gst_nvinfer_process_full_frame(GstNvInfer *nvinfer,
             nvinfer->tmp_surf.numFilled = 0;
         }
     }
+
+    /* Submit the last non-full batch of the input batched buffer. */
+    if (batch) {
+        if (!convert_batch_and_push_to_input_thread(nvinfer, batch.get(), memory)) {
+            return GST_FLOW_ERROR;
+        }
+        batch.release();
+        conv_gst_buf = nullptr;
+        nvinfer->tmp_surf.numFilled = 0;
+    }
     return GST_FLOW_OK;
 }
 
@@ -1870,6 +2097,105 @@ static inline gboolean should_infer_object(GstNvInfer *nvinfer,
     return TRUE;
 }
 
+/* Cross-buffer object batching (object-batch-timeout-ms > 0). A partially
+ * filled object batch is not submitted at the end of an input buffer but kept in
+ * nvinfer->pending_obj_batch and topped up with objects from the following
+ * buffers. The push-buffer markers of the buffers with objects in the pending
+ * batch are held back so that buffers are still pushed downstream in order and
+ * only after all their objects have been inferred. The batch is submitted when
+ * it is full, when its deadline expires or when a serialized event / stop
+ * requires all queued data to be flushed. All of this state is protected by
+ * obj_batch_lock, which is always taken before process_lock. */
+
+/* Queue the push-buffer markers held back for the submitted pending batch. */
+static void queue_deferred_push_batches(GstNvInfer *nvinfer)
+{
+    std::vector<GstNvInferBatch *> &deferred = nvinfer->pending_obj_batch->deferred_push_batches;
+    if (deferred.empty())
+        return;
+
+    LockGMutex locker(nvinfer->process_lock);
+    for (GstNvInferBatch *buf_push_batch : deferred) {
+        if (nvinfer->input_queue_thread)
+            g_queue_push_tail(nvinfer->input_queue, buf_push_batch);
+        else
+            g_queue_push_tail(nvinfer->process_queue, buf_push_batch);
+    }
+    g_cond_broadcast(&nvinfer->process_cond);
+    deferred.clear();
+}
+
+/* Drop an object batch that could not be built or submitted. Its conversion
+ * buffer goes back to the pool and its objects can be inferred again. The
+ * held back push-buffer markers are still queued so that the buffers already
+ * accepted are pushed instead of stalling the pipeline. Must be called without
+ * process_lock held. */
+static void drop_object_batch(GstNvInfer *nvinfer, std::unique_ptr<GstNvInferBatch> batch)
+{
+    if (batch) {
+        LockGMutex locker(nvinfer->process_lock);
+        for (GstNvInferFrame &frame : batch->frames) {
+            std::shared_ptr<GstNvInferObjectHistory> history = frame.history.lock();
+            if (history)
+                history->under_inference = FALSE;
+        }
+        locker.unlock();
+        if (batch->conv_buf)
+            gst_buffer_unref(batch->conv_buf);
+    }
+    nvinfer->tmp_surf.numFilled = 0;
+
+    if (nvinfer->pending_obj_batch)
+        queue_deferred_push_batches(nvinfer);
+}
+
+/* Submit the pending object batch, if any, and release the held back buffers.
+ * Must be called with obj_batch_lock held. */
+static gboolean flush_pending_object_batch(GstNvInfer *nvinfer)
+{
+    GstNvInferPendingObjBatch *pending = nvinfer->pending_obj_batch;
+
+    if (pending->batch) {
+        std::unique_ptr<GstNvInferBatch> batch = std::move(pending->batch);
+        GstNvInferMemory *memory = gst_nvinfer_buffer_get_memory(batch->conv_buf);
+
+        if (!convert_batch_and_push_to_input_thread(nvinfer, batch.get(), memory)) {
+            drop_object_batch(nvinfer, std::move(batch));
+            return FALSE;
+        }
+        batch.release();
+        nvinfer->tmp_surf.numFilled = 0;
+    }
+
+    queue_deferred_push_batches(nvinfer);
+    return TRUE;
+}
+
+/* Thread submitting the pending object batch once its deadline expires. */
+static gpointer gst_nvinfer_obj_batch_timer_loop(gpointer data)
+{
+    GstNvInfer *nvinfer = (GstNvInfer *)data;
+    GstNvInferPendingObjBatch *pending = nvinfer->pending_obj_batch;
+
+    /* Set the cuda device for the conversions executed in this thread. */
+    cudaSetDevice(nvinfer->gpu_id);
+
+    LockGMutex locker(nvinfer->obj_batch_lock);
+    while (!pending->stop) {
+        if (!pending->batch) {
+            locker.wait(nvinfer->obj_batch_cond);
+            continue;
+        }
+        if (g_get_monotonic_time() < pending->deadline) {
+            locker.wait_until(nvinfer->obj_batch_cond, pending->deadline);
+            continue;
+        }
+        flush_pending_object_batch(nvinfer);
+    }
+
+    return nullptr;
+}
+
 /* Process on objects detected by upstream detectors.
  *
  * Secondary classifiers can work in asynchronous mode as well. In this mode,
@@ -1898,6 +2224,13 @@ static GstFlowReturn gst_nvinfer_process_objects(GstNvInfer *nvinfer,
         return GST_FLOW_ERROR;
     }
 
+    /* Continue filling the batch carried over from the previous buffers. */
+    if (nvinfer->pending_obj_batch && nvinfer->pending_obj_batch->batch) {
+        batch = std::move(nvinfer->pending_obj_batch->batch);
+        conv_gst_buf = batch->conv_buf;
+        memory = gst_nvinfer_buffer_get_memory(conv_gst_buf);
+    }
+
     for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
          l_frame = l_frame->next) {
         NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)(l_frame->data);
@@ -1972,15 +2305,19 @@ static GstFlowReturn gst_nvinfer_process_objects(GstNvInfer *nvinfer,
                             locker.unlock();
                             flow_ret = gst_buffer_pool_acquire_buffer(nvinfer->pool, &conv_gst_buf,
                                                                       nullptr);
-                            locker.lock();
                             if (flow_ret != GST_FLOW_OK) {
+                                drop_object_batch(nvinfer, std::move(batch));
                                 return flow_ret;
                             }
+                            batch->conv_buf = conv_gst_buf;
                             memory = gst_nvinfer_buffer_get_memory(conv_gst_buf);
                             if (!memory) {
+                                GST_ELEMENT_ERROR(nvinfer, STREAM, FAILED,
+                                                  ("Conversion buffer memory not found"), (NULL));
+                                drop_object_batch(nvinfer, std::move(batch));
                                 return GST_FLOW_ERROR;
                             }
-                            batch->conv_buf = conv_gst_buf;
+                            locker.lock();
                         }
                         obj_history->last_accessed_frame_num = frame_meta->frame_num;
                         /* Let the output thread know to attach latest available classifier
@@ -2034,13 +2371,17 @@ static GstFlowReturn gst_nvinfer_process_objects(GstNvInfer *nvinfer,
 
                 flow_ret = gst_buffer_pool_acquire_buffer(nvinfer->pool, &conv_gst_buf, nullptr);
                 if (flow_ret != GST_FLOW_OK) {
+                    drop_object_batch(nvinfer, std::move(batch));
                     return flow_ret;
                 }
+                batch->conv_buf = conv_gst_buf;
                 memory = gst_nvinfer_buffer_get_memory(conv_gst_buf);
                 if (!memory) {
+                    GST_ELEMENT_ERROR(nvinfer, STREAM, FAILED,
+                                      ("Conversion buffer memory not found"), (NULL));
+                    drop_object_batch(nvinfer, std::move(batch));
                     return GST_FLOW_ERROR;
                 }
-                batch->conv_buf = conv_gst_buf;
             }
             idx = batch->frames.size();
 
@@ -2051,6 +2392,11 @@ static GstFlowReturn gst_nvinfer_process_objects(GstNvInfer *nvinfer,
                                      offset_left, offset_top,
                                      memory->frame_memory_ptrs[idx]) != GST_FLOW_OK) {
                 GST_ELEMENT_ERROR(nvinfer, STREAM, FAILED, ("Buffer conversion failed"), (NULL));
+                if (obj_history != nullptr) {
+                    LockGMutex history_locker(nvinfer->process_lock);
+                    obj_history->under_inference = FALSE;
+                }
+                drop_object_batch(nvinfer, std::move(batch));
                 return GST_FLOW_ERROR;
             }
 
@@ -2074,6 +2420,7 @@ static GstFlowReturn gst_nvinfer_process_objects(GstNvInfer *nvinfer,
             /* Submit batch if the batch size has reached max_batch_size. */
             if (batch->frames.size() == nvinfer->max_batch_size) {
                 if (!convert_batch_and_push_to_input_thread(nvinfer, batch.get(), memory)) {
+                    drop_object_batch(nvinfer, std::move(batch));
                     return GST_FLOW_ERROR;
                 }
                 /* Batch submitted. Set batch to nullptr so that a new GstNvInferBatch
@@ -2081,10 +2428,25 @@ static GstFlowReturn gst_nvinfer_process_objects(GstNvInfer *nvinfer,
                 batch.release();
                 conv_gst_buf = nullptr;
                 nvinfer->tmp_surf.numFilled = 0;
+
+                /* Objects of the held back buffers have all been submitted. */
+                if (nvinfer->pending_obj_batch)
+                    queue_deferred_push_batches(nvinfer);
             }
         }
     }
 
+    /* Keep a non-full batch with objects to infer for the following buffers.
+     * The deadline is counted from the buffer the first object came from. */
+    if (batch && batch->frames.size() > 0 && nvinfer->pending_obj_batch) {
+        if (nvinfer->pending_obj_batch->deferred_push_batches.empty()) {
+            nvinfer->pending_obj_batch->deadline =
+                g_get_monotonic_time() + nvinfer->object_batch_timeout_ms * G_TIME_SPAN_MILLISECOND;
+        }
+        nvinfer->pending_obj_batch->batch = std::move(batch);
+        g_cond_broadcast(&nvinfer->obj_batch_cond);
+    }
+
     /* Submit a non-full batch. */
     if (batch) {
         /* No frames to infer in this batch. It might contain objects that
@@ -2094,6 +2456,9 @@ static GstFlowReturn gst_nvinfer_process_objects(GstNvInfer *nvinfer,
             gst_buffer_unref(batch->conv_buf);
 
         if (!convert_batch_and_push_to_input_thread(nvinfer, batch.get(), memory)) {
+            if (batch->frames.size() == 0)
+                batch->conv_buf = nullptr;
+            drop_object_batch(nvinfer, std::move(batch));
             return GST_FLOW_ERROR;
         }
         conv_gst_buf = nullptr;
@@ -2334,6 +2699,11 @@ static GstFlowReturn gst_nvinfer_submit_input_buffer(GstBaseTransform *btrans,
 
     nvds_set_input_system_timestamp(inbuf, GST_ELEMENT_NAME(nvinfer));
 
+    /* Keep the batch timer thread from submitting the pending object batch
+     * until this buffer's objects and push-buffer marker are accounted for. */
+    if (nvinfer->pending_obj_batch)
+        g_mutex_lock(&nvinfer->obj_batch_lock);
+
     if (nvinfer->input_tensor_from_meta) {
         flow_ret = gst_nvinfer_process_tensor_input(nvinfer, inbuf, in_surf);
     } else if (nvinfer->process_full_frame) {
@@ -2346,8 +2716,11 @@ static GstFlowReturn gst_nvinfer_submit_input_buffer(GstBaseTransform *btrans,
     if (in_map_info.data)
         gst_buffer_unmap(inbuf, &in_map_info);
 
-    if (flow_ret == GST_FLOW_ERROR)
+    if (flow_ret == GST_FLOW_ERROR) {
+        if (nvinfer->pending_obj_batch)
+            g_mutex_unlock(&nvinfer->obj_batch_lock);
         return GST_FLOW_ERROR;
+    }
 
     if (nvinfer->classifier_async_mode) {
         /* Asynchronous mode. Push the buffer immediately instead of waiting for
@@ -2385,13 +2758,22 @@ static GstFlowReturn gst_nvinfer_submit_input_buffer(GstBaseTransform *btrans,
         buf_push_batch->push_buffer = TRUE;
         buf_push_batch->nvtx_complete_buf_range = buf_process_range;
 
-        g_mutex_lock(&nvinfer->process_lock);
-        if (nvinfer->input_queue_thread)
-            g_queue_push_tail(nvinfer->input_queue, buf_push_batch);
-        else
-            g_queue_push_tail(nvinfer->process_queue, buf_push_batch);
-        g_cond_broadcast(&nvinfer->process_cond);
-        g_mutex_unlock(&nvinfer->process_lock);
+        if (nvinfer->pending_obj_batch && nvinfer->pending_obj_batch->batch) {
+            /* Some objects of this buffer are still waiting in the pending
+             * batch. Hold back the marker until the batch is submitted. */
+            nvinfer->pending_obj_batch->deferred_push_batches.push_back(buf_push_batch);
+        } else {
+            g_mutex_lock(&nvinfer->process_lock);
+            if (nvinfer->input_queue_thread)
+                g_queue_push_tail(nvinfer->input_queue, buf_push_batch);
+            else
+                g_queue_push_tail(nvinfer->process_queue, buf_push_batch);
+            g_cond_broadcast(&nvinfer->process_cond);
+            g_mutex_unlock(&nvinfer->process_lock);
+        }
+
+        if (nvinfer->pending_obj_batch)
+            g_mutex_unlock(&nvinfer->obj_batch_lock);
     }
 
     return GST_FLOW_OK;
@@ -2456,6 +2838,9 @@ static void gst_nvinfer_tensoroutput_free(GstMiniObject *obj)
     assert(output_obj->infer_context.get());
     output_obj->infer_context->releaseBatchOutput(output_obj->batch_output);
     output_obj->infer_context.reset();
+    delete[] output_obj->tensor_metas;
+    delete[] output_obj->tensor_meta_buf_ptrs;
+    delete[] output_obj->tensor_meta_layers_info;
     delete output_obj;
 }
 
@@ -46,6 +46,7 @@ G_BEGIN_DECLS
 typedef struct _GstNvInfer GstNvInfer;
 typedef struct _GstNvInferClass GstNvInferClass;
 typedef struct _GstNvInferImpl GstNvInferImpl;
+typedef struct _GstNvInferPendingObjBatch GstNvInferPendingObjBatch;
 
 /* Standard GStreamer boilerplate */
 #define GST_TYPE_NVINFER (gst_nvinfer_get_type())
@@ -81,6 +82,7 @@ enum {
     PROP_OUTPUT_INSTANCE_MASK,
     PROP_OUTPUT_FACE_DETECTION_LANDMARK,
     PROP_INPUT_TENSOR_META,
+    PROP_OBJECT_BATCH_TIMEOUT,
     PROP_LAST
 };
 
@@ -168,6 +170,11 @@ typedef struct {
     gulong last_cleanup_frame_num;
     /** Frame number of the frame which . */
     gulong last_seen_frame_num;
+    /** GRAY8 thumbnail of the frame last inferred on. Reference for the change
+     * score of motion-gated full-frame processing. */
+    std::vector<guint8> motion_ref_thumbnail;
+    /** Number of frames skipped by motion gating since the last inference. */
+    guint motion_skipped_frames;
 } GstNvInferSourceInfo;
 
 /**
@@ -251,6 +258,17 @@ struct _GstNvInfer {
     guint interval;
     guint interval_counter;
 
+    /** Motion-gated adaptive interval for full-frame processing. A source is
+     * inferred on only when the mean absolute luma difference of its frame
+     * thumbnail to the last inferred one reaches motion_gating_threshold, but
+     * never more often than every motion_gating_min_interval + 1 frames and at
+     * least every motion_gating_max_interval + 1 frames. 0 threshold disables. */
+    gdouble motion_gating_threshold;
+    guint motion_gating_min_interval;
+    guint motion_gating_max_interval;
+    /** Batched GRAY8 thumbnails of the input frames for the change score. */
+    NvBufSurface *motion_surf;
+
     /** Frame interval after which objects should be reinferred on. */
     guint secondary_reinfer_interval;
 
@@ -275,6 +293,18 @@ struct _GstNvInfer {
     /** Boolean indicating if the secondary classifier should run in asynchronous mode. */
     gboolean classifier_async_mode;
 
+    /** Maximum time in milliseconds a partially filled object batch may wait
+     * for objects from following input buffers. 0 disables cross-buffer
+     * batching. */
+    guint object_batch_timeout_ms;
+
+    /** Object batch carried across input buffers and the synchronization
+     * structures of the thread flushing it on deadline expiry. */
+    GstNvInferPendingObjBatch *pending_obj_batch;
+    GMutex obj_batch_lock;
+    GCond obj_batch_cond;
+    GThread *obj_batch_timer_thread;
+
     /** String containing the type of classifier */
     gchar *classifier_type;
 
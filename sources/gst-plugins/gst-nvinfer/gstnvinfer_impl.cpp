@@ -48,6 +48,14 @@ void LockGMutex::wait(GCond &cond)
         g_cond_wait(&cond, &m);
 }
 
+gboolean LockGMutex::wait_until(GCond &cond, gint64 end_time)
+{
+    assert(locked);
+    if (locked)
+        return g_cond_wait_until(&cond, &m, end_time);
+    return FALSE;
+}
+
 DsNvInferImpl::DsNvInferImpl(GstNvInfer *infer)
     : m_InitParams(new NvDsInferContextInitParams), m_GstInfer(infer)
 {
@@ -60,6 +68,7 @@ DsNvInferImpl::~DsNvInferImpl()
         delete[] m_InitParams->perClassDetectionParams;
         g_strfreev(m_InitParams->outputLayerNames);
         g_strfreev(m_InitParams->outputIOFormats);
+        g_strfreev(m_InitParams->inputIOFormats);
         g_strfreev(m_InitParams->layerDevicePrecisions);
     }
 }
@@ -24,6 +24,7 @@
 #include <thread>
 #include <vector>
 
+#include "gstnvdsinfer.h"
 #include "nvbufsurftransform.h"
 #include "nvdsinfer_context.h"
 #include "nvdsinfer_func_utils.h"
@@ -118,6 +119,22 @@ typedef struct {
     std::vector<GstNvInferObjHistory_MetaPair> objs_pending_meta_attach;
 } GstNvInferBatch;
 
+/**
+ * Holds the partially filled object batch carried across input buffers when
+ * cross-buffer object batching is enabled. Accessed with obj_batch_lock held.
+ */
+struct _GstNvInferPendingObjBatch {
+    /** Batch waiting for more objects. nullptr if nothing is pending. */
+    std::unique_ptr<GstNvInferBatch> batch;
+    /** Monotonic time (us) at which the batch must be submitted. */
+    gint64 deadline = 0;
+    /** Push-buffer markers of the input buffers whose objects are in the
+     * pending batch. Queued once the batch has been submitted. */
+    std::vector<GstNvInferBatch *> deferred_push_batches;
+    /** Boolean to signal the batch timer thread to stop. */
+    gboolean stop = FALSE;
+};
+
 /**
  * Data type used for the refcounting and managing the usage of NvDsInferContext's
  * batch output and the output buffers contained in it. This is especially required
@@ -138,6 +155,13 @@ typedef struct {
      * sent as meta data. This batch output will be released back to the
      * NvDsInferContext when the last ref on the mini_object is removed. */
     NvDsInferContextBatchOutput batch_output;
+    /** NvDsInferTensorMeta structures attached for this batch output, their
+     * layer buffer pointer arrays and the output layers info they refer to.
+     * Allocated once per batch and freed together with the mini_object. */
+    NvDsInferTensorMeta *tensor_metas = nullptr;
+    guint num_tensor_metas = 0;
+    void **tensor_meta_buf_ptrs = nullptr;
+    NvDsInferLayerInfo *tensor_meta_layers_info = nullptr;
 } GstNvInferTensorOutputObject;
 
 namespace gstnvinfer {
@@ -164,6 +188,7 @@ public:
     void lock();
     void unlock();
     void wait(GCond &cond);
+    gboolean wait_until(GCond &cond, gint64 end_time);
 
 private:
     GMutex &m;
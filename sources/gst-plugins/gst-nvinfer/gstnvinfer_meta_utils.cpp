@@ -11,6 +11,7 @@
 
 #include "gstnvinfer_meta_utils.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 
@@ -315,6 +316,10 @@ void attach_metadata_classifier(GstNvInfer *nvinfer,
             g_strlcpy(label_info->result_label, attr.attributeLabel, MAX_LABEL_SIZE);
             if (object_info.label.length() == 0)
                 string_label.append(attr.attributeLabel).append(" ");
+        } else {
+            /* Pooled label metas are reused; id-only results (face recognition)
+             * must not show a stale label. */
+            label_info->result_label[0] = '\0';
         }
 
         nvds_add_label_info_meta_to_classifier(classifier_meta, label_info);
@@ -467,13 +472,24 @@ void attach_metadata_segmentation(GstNvInfer *nvinfer,
 }
 
 /* Called when NvDsUserMeta for each frame/object is released. Reduce the
- * refcount of the mini_object by 1 and free other memory. */
+ * refcount of the mini_object by 1 and free other memory. Metas carved from the
+ * per-batch block of GstNvInferTensorOutputObject are freed with the object. */
 static void release_tensor_output_meta(gpointer data, gpointer user_data)
 {
     NvDsUserMeta *user_meta = (NvDsUserMeta *)data;
     NvDsInferTensorMeta *meta = (NvDsInferTensorMeta *)user_meta->user_meta_data;
     if (meta->priv_data) {
-        gst_mini_object_unref(GST_MINI_OBJECT(meta->priv_data));
+        GstNvInferTensorOutputObject *tensor_out_object =
+            (GstNvInferTensorOutputObject *)meta->priv_data;
+        gboolean in_block = meta >= tensor_out_object->tensor_metas &&
+                            meta < tensor_out_object->tensor_metas +
+                                       tensor_out_object->num_tensor_metas;
+        /* Copies share the layer pointer arrays of the block, only the meta
+         * structure itself is owned. */
+        if (!in_block)
+            delete meta;
+        gst_mini_object_unref(GST_MINI_OBJECT(tensor_out_object));
+        return;
     } else {
         if (cudaSetDevice(meta->gpu_id) != cudaSuccess)
             g_print("Unable to set gpu device id during memory release.\n");
@@ -500,6 +516,15 @@ static gpointer copy_tensor_output_meta(gpointer data, gpointer user_data)
     NvDsInferTensorMeta *src_meta = (NvDsInferTensorMeta *)src_user_meta->user_meta_data;
     NvDsInferTensorMeta *tensor_output_meta = new NvDsInferTensorMeta;
 
+    /* The tensor output is still owned by a GstNvInferTensorOutputObject. Its
+     * buffers stay valid as long as a ref is held on it, so share them instead
+     * of copying every layer. */
+    if (src_meta->priv_data) {
+        *tensor_output_meta = *src_meta;
+        tensor_output_meta->priv_data = gst_mini_object_ref(GST_MINI_OBJECT(src_meta->priv_data));
+        return tensor_output_meta;
+    }
+
     tensor_output_meta->unique_id = src_meta->unique_id;
     tensor_output_meta->num_output_layers = src_meta->num_output_layers;
     tensor_output_meta->output_layers_info = (NvDsInferLayerInfo *)g_memdup(
@@ -551,42 +576,66 @@ static gpointer copy_tensor_output_meta(gpointer data, gpointer user_data)
     return tensor_output_meta;
 }
 
-/* Attaches the raw tensor output to the GstBuffer as metadata. */
+/* Attaches the raw tensor output to the GstBuffer as metadata. The
+ * NvDsInferTensorMeta structures and their layer pointer arrays for the whole
+ * batch are allocated in one block owned by the GstNvInferTensorOutputObject. */
 void attach_tensor_output_meta(GstNvInfer *nvinfer,
                                GstMiniObject *tensor_out_object,
                                GstNvInferBatch *batch,
                                NvDsInferContextBatchOutput *batch_output)
 {
+    GstNvInferTensorOutputObject *output_obj = (GstNvInferTensorOutputObject *)tensor_out_object;
     NvDsBatchMeta *batch_meta = (nvinfer->process_full_frame || nvinfer->input_tensor_from_meta)
                                     ? batch->frames[0].frame_meta->base_meta.batch_meta
                                     : batch->frames[0].obj_meta->base_meta.batch_meta;
-
-    /* Create and attach NvDsInferTensorMeta for each frame/object. Also
-     * increment the refcount of GstNvInferTensorOutputObject. */
-    for (size_t j = 0; j < batch->frames.size(); j++) {
-        GstNvInferFrame &frame = batch->frames[j];
-
-        /* Processing on ROIs (not frames or objects) skip attaching tensor output
-         * to frames or objects. */
-        NvDsInferTensorMeta *meta = new NvDsInferTensorMeta;
+    guint num_layers = nvinfer->output_layers_info->size();
+    /* One extra meta at batch level when input is received from tensor meta. */
+    guint num_metas = batch->frames.size() + (nvinfer->input_tensor_from_meta ? 1 : 0);
+
+    output_obj->tensor_metas = new NvDsInferTensorMeta[num_metas];
+    output_obj->num_tensor_metas = num_metas;
+    output_obj->tensor_meta_buf_ptrs = new void *[2 * num_metas * num_layers];
+    output_obj->tensor_meta_layers_info = new NvDsInferLayerInfo[num_layers];
+    std::copy(nvinfer->output_layers_info->begin(), nvinfer->output_layers_info->end(),
+              output_obj->tensor_meta_layers_info);
+
+    /* Fill the j-th NvDsInferTensorMeta of the block. Layer buffers of the
+     * frame/object are at offset `index` in the batched output. */
+    auto init_meta = [&](guint j, guint index) {
+        NvDsInferTensorMeta *meta = &output_obj->tensor_metas[j];
         meta->unique_id = nvinfer->unique_id;
-        meta->num_output_layers = nvinfer->output_layers_info->size();
-        meta->output_layers_info = nvinfer->output_layers_info->data();
-        meta->out_buf_ptrs_host = new void *[meta->num_output_layers];
-        meta->out_buf_ptrs_dev = new void *[meta->num_output_layers];
+        meta->num_output_layers = num_layers;
+        meta->output_layers_info = output_obj->tensor_meta_layers_info;
+        meta->out_buf_ptrs_host = output_obj->tensor_meta_buf_ptrs + 2 * j * num_layers;
+        meta->out_buf_ptrs_dev = meta->out_buf_ptrs_host + num_layers;
         meta->gpu_id = nvinfer->gpu_id;
         meta->priv_data = gst_mini_object_ref(tensor_out_object);
         meta->network_info = nvinfer->network_info;
 
-        for (unsigned int i = 0; i < meta->num_output_layers; i++) {
+        for (unsigned int i = 0; i < num_layers; i++) {
             NvDsInferLayerInfo &info = meta->output_layers_info[i];
             meta->out_buf_ptrs_dev[i] =
                 (uint8_t *)batch_output->outputDeviceBuffers[i] +
-                info.inferDims.numElements * get_element_size(info.dataType) * j;
+                info.inferDims.numElements * get_element_size(info.dataType) * index;
             meta->out_buf_ptrs_host[i] =
                 (uint8_t *)batch_output->hostBuffers[info.bindingIndex] +
-                info.inferDims.numElements * get_element_size(info.dataType) * j;
+                info.inferDims.numElements * get_element_size(info.dataType) * index;
         }
+        return meta;
+    };
+
+    /* Create and attach NvDsInferTensorMeta for each frame/object. Also
+     * increment the refcount of GstNvInferTensorOutputObject. */
+    for (size_t j = 0; j < batch->frames.size(); j++) {
+        GstNvInferFrame &frame = batch->frames[j];
+
+        /* Objects of one batch may belong to different input buffers when
+         * cross-buffer object batching is enabled. Use the batch meta of the
+         * buffer the object belongs to. */
+        if (!nvinfer->process_full_frame && !nvinfer->input_tensor_from_meta)
+            batch_meta = frame.obj_meta->base_meta.batch_meta;
+
+        NvDsInferTensorMeta *meta = init_meta(j, j);
 
         NvDsUserMeta *user_meta = nvds_acquire_user_meta_from_pool(batch_meta);
         user_meta->user_meta_data = meta;
@@ -607,21 +656,7 @@ void attach_tensor_output_meta(GstNvInfer *nvinfer,
     /* NvInfer is receiving input from tensor meta, also attach output tensor meta
      * at batch level. */
     if (nvinfer->input_tensor_from_meta) {
-        NvDsInferTensorMeta *meta = new NvDsInferTensorMeta;
-        meta->unique_id = nvinfer->unique_id;
-        meta->num_output_layers = nvinfer->output_layers_info->size();
-        meta->output_layers_info = nvinfer->output_layers_info->data();
-        meta->out_buf_ptrs_host = new void *[meta->num_output_layers];
-        meta->out_buf_ptrs_dev = new void *[meta->num_output_layers];
-        meta->gpu_id = nvinfer->gpu_id;
-        meta->priv_data = gst_mini_object_ref(tensor_out_object);
-        meta->network_info = nvinfer->network_info;
-
-        for (unsigned int i = 0; i < meta->num_output_layers; i++) {
-            NvDsInferLayerInfo &info = meta->output_layers_info[i];
-            meta->out_buf_ptrs_dev[i] = (uint8_t *)batch_output->outputDeviceBuffers[i];
-            meta->out_buf_ptrs_host[i] = (uint8_t *)batch_output->hostBuffers[info.bindingIndex];
-        }
+        NvDsInferTensorMeta *meta = init_meta(num_metas - 1, 0);
 
         NvDsUserMeta *user_meta = nvds_acquire_user_meta_from_pool(batch_meta);
         user_meta->user_meta_data = meta;
@@ -335,6 +335,48 @@ static gboolean gst_nvinfer_parse_other_attribute(GstNvInfer *nvinfer,
             g_printerr("Error: Negative value (%d) specified for interval\n", nvinfer->interval);
             goto done;
         }
+    } else if (!g_strcmp0(key, CONFIG_GROUP_INFER_MOTION_GATING_THRESHOLD)) {
+        nvinfer->motion_gating_threshold = g_key_file_get_double(
+            key_file, group_name, CONFIG_GROUP_INFER_MOTION_GATING_THRESHOLD, &error);
+        CHECK_ERROR(error);
+        if (nvinfer->motion_gating_threshold < 0) {
+            g_printerr("Error: Negative value (%f) specified for %s\n",
+                       nvinfer->motion_gating_threshold,
+                       CONFIG_GROUP_INFER_MOTION_GATING_THRESHOLD);
+            goto done;
+        }
+    } else if (!g_strcmp0(key, CONFIG_GROUP_INFER_MOTION_GATING_MIN_INTERVAL)) {
+        nvinfer->motion_gating_min_interval = g_key_file_get_integer(
+            key_file, group_name, CONFIG_GROUP_INFER_MOTION_GATING_MIN_INTERVAL, &error);
+        CHECK_ERROR(error);
+        if ((gint)nvinfer->motion_gating_min_interval < 0) {
+            g_printerr("Error: Negative value (%d) specified for %s\n",
+                       nvinfer->motion_gating_min_interval,
+                       CONFIG_GROUP_INFER_MOTION_GATING_MIN_INTERVAL);
+            goto done;
+        }
+    } else if (!g_strcmp0(key, CONFIG_GROUP_INFER_MOTION_GATING_MAX_INTERVAL)) {
+        nvinfer->motion_gating_max_interval = g_key_file_get_integer(
+            key_file, group_name, CONFIG_GROUP_INFER_MOTION_GATING_MAX_INTERVAL, &error);
+        CHECK_ERROR(error);
+        if ((gint)nvinfer->motion_gating_max_interval < 0) {
+            g_printerr("Error: Negative value (%d) specified for %s\n",
+                       nvinfer->motion_gating_max_interval,
+                       CONFIG_GROUP_INFER_MOTION_GATING_MAX_INTERVAL);
+            goto done;
+        }
+    } else if (!g_strcmp0(key, CONFIG_GROUP_INFER_OBJECT_BATCH_TIMEOUT)) {
+        if ((*nvinfer->is_prop_set)[PROP_OBJECT_BATCH_TIMEOUT])
+            return TRUE;
+        gint timeout = g_key_file_get_integer(key_file, group_name,
+                                              CONFIG_GROUP_INFER_OBJECT_BATCH_TIMEOUT, &error);
+        CHECK_ERROR(error);
+        if (timeout < 0) {
+            g_printerr("Error: Negative value (%d) specified for object-batch-timeout-ms\n",
+                       timeout);
+            goto done;
+        }
+        nvinfer->object_batch_timeout_ms = timeout;
     } else if (!g_strcmp0(key, CONFIG_GROUP_INFER_OUTPUT_TENSOR_META)) {
         if (g_key_file_get_boolean(key_file, group_name, CONFIG_GROUP_INFER_OUTPUT_TENSOR_META,
                                    &error))
@@ -695,6 +737,13 @@ static gboolean gst_nvinfer_parse_props(GstNvInfer *nvinfer,
                                            CONFIG_GROUP_INFER_OUTPUT_IO_FORMATS, &length, &error);
             init_params->numOutputIOFormats = length;
             CHECK_ERROR(error);
+        } else if (!g_strcmp0(*key, CONFIG_GROUP_INFER_INPUT_IO_FORMATS)) {
+            gsize length;
+            init_params->inputIOFormats =
+                g_key_file_get_string_list(key_file, CONFIG_GROUP_PROPERTY,
+                                           CONFIG_GROUP_INFER_INPUT_IO_FORMATS, &length, &error);
+            init_params->numInputIOFormats = length;
+            CHECK_ERROR(error);
         } else if (!g_strcmp0(*key, CONFIG_GROUP_INFER_LAYER_DEVICE_PRECISION)) {
             gsize length;
             init_params->layerDevicePrecisions = g_key_file_get_string_list(
@@ -37,6 +37,10 @@
 #define CONFIG_GROUP_INFER_LABEL "labelfile-path"
 #define CONFIG_GROUP_INFER_GPU_ID "gpu-id"
 #define CONFIG_GROUP_INFER_SECONDARY_REINFER_INTERVAL "secondary-reinfer-interval"
+#define CONFIG_GROUP_INFER_OBJECT_BATCH_TIMEOUT "object-batch-timeout-ms"
+#define CONFIG_GROUP_INFER_MOTION_GATING_THRESHOLD "motion-gating-threshold"
+#define CONFIG_GROUP_INFER_MOTION_GATING_MIN_INTERVAL "motion-gating-min-interval"
+#define CONFIG_GROUP_INFER_MOTION_GATING_MAX_INTERVAL "motion-gating-max-interval"
 #define CONFIG_GROUP_INFER_OUTPUT_TENSOR_META "output-tensor-meta"
 #define CONFIG_GROUP_INFER_FACE_ALIGNMENT "face-alignment"
 
@@ -58,6 +62,7 @@
 #define CONFIG_GROUP_INFER_FORCE_IMPLICIT_BATCH_DIM "force-implicit-batch-dim"
 #define CONFIG_GROUP_INFER_INFER_DIMENSIONS "infer-dims"
 #define CONFIG_GROUP_INFER_OUTPUT_IO_FORMATS "output-io-formats"
+#define CONFIG_GROUP_INFER_INPUT_IO_FORMATS "input-io-formats"
 #define CONFIG_GROUP_INFER_LAYER_DEVICE_PRECISION "layer-device-precision"
 
 /** Preprocessing parameters. */
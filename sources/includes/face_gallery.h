@@ -0,0 +1,48 @@
+/*
+ * Live updates of the face recognition gallery.
+ *
+ * The gallery (faiss index plus the student id of each row) belongs to the
+ * recognition parser library, which nvinfer dlopens privately. It exports
+ * face_gallery_apply() so that the application can push enrolment changes
+ * into the running gallery instead of rebuilding faiss.index and having it
+ * reloaded. The application finds the function among the loaded libraries
+ * (FACE_GALLERY_APPLY_SYMBOL) rather than linking against the parser.
+ */
+
+#ifndef __FACE_GALLERY_H__
+#define __FACE_GALLERY_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FACE_GALLERY_APPLY_SYMBOL "face_gallery_apply"
+
+typedef struct {
+    uint32_t student_id;
+    /** Name written to the labels file, may be NULL when @vector is NULL. */
+    const char *label;
+    /** Feature vector of @dim floats, not necessarily normalized. NULL removes
+     * the student from the gallery. */
+    const float *vector;
+} FaceGalleryChange;
+
+/**
+ * Applies @count changes, each replacing or removing every row of its student,
+ * and saves the gallery files the parser loads at startup. Unknown students in
+ * removals are ignored, so a batch can be applied again. Returns 0 on success,
+ * a negative value if the gallery cannot be updated in place (not a flat
+ * index, @dim mismatch) or its files could not be written.
+ */
+int face_gallery_apply(const FaceGalleryChange *changes, unsigned int count, unsigned int dim);
+
+typedef int (*FaceGalleryApplyFunc)(const FaceGalleryChange *changes, unsigned int count,
+                                    unsigned int dim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FACE_GALLERY_H__ */
@@ -408,6 +408,14 @@ typedef struct _NvDsInferContextInitParams {
     /** Holds number of output IO formats specified. */
     unsigned int numOutputIOFormats;
 
+    /** Can be used to specify the datatype of the network input layer when
+     * building the engine, e.g. "<layer-name>:fp16:chw" to have the
+     * preprocessor write FP16 input directly. Only the "chw" format is
+     * supported for inputs. */
+    char **inputIOFormats;
+    /** Holds number of input IO formats specified. */
+    unsigned int numInputIOFormats;
+
     /**Can be used to specify the device type and inference precision of layers.
      * For each layer specified the format is
      * "<layer-name>:<device-type>:<precision>" */
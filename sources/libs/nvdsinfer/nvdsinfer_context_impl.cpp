@@ -135,16 +135,20 @@ bool InferPreprocessor::setInputOrder(const NvDsInferTensorOrder order)
     return true;
 }
 
-/* Read the mean image ppm file and copy the mean image data to the mean
- * data buffer allocated on the device memory.
- */
+bool InferPreprocessor::setInt8InputScale(float scale)
+{
+    if (!(scale > 0.0f))
+        return false;
+    m_Int8InputScale = scale;
+    return true;
+}
+
+/* Read the mean image ppm file into the host mean data. */
 NvDsInferStatus InferPreprocessor::readMeanImageFile()
 {
     std::ifstream infile(m_MeanFile, std::ifstream::binary);
     size_t size = m_NetworkInfo.width * m_NetworkInfo.height * m_NetworkInfo.channels;
     uint8_t tempMeanDataChar[size];
-    float tempMeanDataFloat[size];
-    cudaError_t cudaReturn;
 
     if (!infile.good()) {
         printError("Could not open mean image file '%s'", safeStr(m_MeanFile));
@@ -175,17 +179,9 @@ NvDsInferStatus InferPreprocessor::readMeanImageFile()
         return NVDSINFER_CONFIG_FAILED;
     }
 
+    m_MeanData.resize(size);
     for (size_t i = 0; i < size; i++) {
-        tempMeanDataFloat[i] = (float)tempMeanDataChar[i];
-    }
-
-    assert(m_MeanDataBuffer);
-    cudaReturn = cudaMemcpy(m_MeanDataBuffer->ptr(), tempMeanDataFloat, size * sizeof(float),
-                            cudaMemcpyHostToDevice);
-    if (cudaReturn != cudaSuccess) {
-        printError("Failed to copy mean data to mean data buffer (%s)",
-                   cudaGetErrorName(cudaReturn));
-        return NVDSINFER_CUDA_ERROR;
+        m_MeanData[i] = (float)tempMeanDataChar[i];
     }
 
     return NVDSINFER_SUCCESS;
@@ -193,21 +189,15 @@ NvDsInferStatus InferPreprocessor::readMeanImageFile()
 
 NvDsInferStatus InferPreprocessor::allocateResource()
 {
-    if (!m_MeanFile.empty() || m_ChannelMeans.size() > 0) {
-        /* Mean Image File specified. Allocate the mean image buffer on device
-         * memory. */
-        m_MeanDataBuffer =
-            std::make_unique<CudaDeviceBuffer>((size_t)m_NetworkInfo.width * m_NetworkInfo.height *
-                                               m_NetworkInfo.channels * sizeof(float));
-
-        if (!m_MeanDataBuffer || !m_MeanDataBuffer->ptr()) {
-            printError("Failed to allocate cuda buffer for mean image");
-            return NVDSINFER_CUDA_ERROR;
-        }
+    /* Without a cuda device the conversions run on the CPU. */
+    int numDevices = 0;
+    if (cudaGetDeviceCount(&numDevices) != cudaSuccess || numDevices == 0) {
+        cudaGetLastError();
+        m_CpuConversion = true;
+        printInfo("No cuda device found, pre-processing runs on the CPU");
     }
 
-    /* Read the mean image file (PPM format) if specified and copy the
-     * contents into the buffer. */
+    /* Read the mean image file (PPM format) if specified. */
     if (!m_MeanFile.empty()) {
         if (!file_accessible(m_MeanFile)) {
             printError("Cannot access mean image file '%s'", safeStr(m_MeanFile));
@@ -219,7 +209,7 @@ NvDsInferStatus InferPreprocessor::allocateResource()
             return status;
         }
     }
-    /* Create the mean data buffer from per-channel offsets. */
+    /* Create the mean data from per-channel offsets. */
     else if (m_ChannelMeans.size() > 0) {
         /* Make sure the number of offsets are equal to the number of input
          * channels. */
@@ -231,16 +221,28 @@ NvDsInferStatus InferPreprocessor::allocateResource()
             return NVDSINFER_CONFIG_FAILED;
         }
 
-        std::vector<float> meanData(m_NetworkInfo.channels * m_NetworkInfo.width *
-                                    m_NetworkInfo.height);
+        m_MeanData.resize(m_NetworkInfo.channels * m_NetworkInfo.width * m_NetworkInfo.height);
         for (size_t j = 0; j < m_NetworkInfo.width * m_NetworkInfo.height; j++) {
             for (size_t i = 0; i < m_NetworkInfo.channels; i++) {
-                meanData[j * m_NetworkInfo.channels + i] = m_ChannelMeans[i];
+                m_MeanData[j * m_NetworkInfo.channels + i] = m_ChannelMeans[i];
             }
         }
+    }
+
+    if (m_CpuConversion)
+        return NVDSINFER_SUCCESS;
+
+    if (!m_MeanData.empty()) {
+        /* Copy the mean data to a buffer on device memory. */
+        m_MeanDataBuffer = std::make_unique<CudaDeviceBuffer>(m_MeanData.size() * sizeof(float));
+
+        if (!m_MeanDataBuffer || !m_MeanDataBuffer->ptr()) {
+            printError("Failed to allocate cuda buffer for mean image");
+            return NVDSINFER_CUDA_ERROR;
+        }
         cudaError_t cudaReturn =
-            cudaMemcpy(m_MeanDataBuffer->ptr(), meanData.data(), meanData.size() * sizeof(float),
-                       cudaMemcpyHostToDevice);
+            cudaMemcpy(m_MeanDataBuffer->ptr(), m_MeanData.data(),
+                       m_MeanData.size() * sizeof(float), cudaMemcpyHostToDevice);
         if (cudaReturn != cudaSuccess) {
             printError("Failed to copy mean data to mean data cuda buffer(%s)",
                        cudaGetErrorName(cudaReturn));
@@ -290,7 +292,7 @@ NvDsInferStatus InferPreprocessor::transform(NvDsInferContextBatchInput &batchIn
 
     /* Make the future jobs on the stream wait till the infer engine consumes
      * the previous contents of the input binding buffer. */
-    if (waitingEvent) {
+    if (waitingEvent && !m_CpuConversion) {
         RETURN_CUDA_ERR(cudaStreamWaitEvent(*m_PreProcessStream, *waitingEvent, 0),
                         "Failed to make stream wait on event");
     }
@@ -426,26 +428,115 @@ NvDsInferStatus InferPreprocessor::transform(NvDsInferContextBatchInput &batchIn
         return NVDSINFER_INVALID_PARAMS;
     }
 
+    /* Write reduced precision input directly when the engine input binding
+     * is not FLOAT. The INT8 quantization scale is folded into the
+     * normalization factor. */
+    NvDsInferDataType inputDataType = m_NetworkInputLayer.dataType;
+    NvDsInferConvertFcnTyped convertFcnTyped = nullptr;
+    NvDsInferConvertFcnTypedFloat convertFcnTypedFloat = nullptr;
+    float scaleFactor = m_Scale;
+    if (inputDataType != FLOAT) {
+        if (convertFcn)
+            convertFcnTyped = NvDsInferConvert_GetTypedFcn(convertFcn, inputDataType);
+        else if (convertFcnFloat)
+            convertFcnTypedFloat =
+                NvDsInferConvert_GetTypedFcnFloat(convertFcnFloat, inputDataType);
+        if (!convertFcnTyped && !convertFcnTypedFloat) {
+            printError("Unsupported network input data type %d", (int)inputDataType);
+            return NVDSINFER_INVALID_PARAMS;
+        }
+        if (inputDataType == INT8) {
+            if (!(m_Int8InputScale > 0.0f)) {
+                printError("No INT8 quantization scale for network input layer");
+                return NVDSINFER_INVALID_PARAMS;
+            }
+            scaleFactor = m_Scale / m_Int8InputScale;
+        }
+    }
+
+    if (m_CpuConversion) {
+        return transformOnCpu(batchInput, devBuf, convertFcn, convertFcnFloat, inputDataType,
+                              scaleFactor);
+    }
+
+    size_t frameBytes =
+        (size_t)m_NetworkInputLayer.inferDims.numElements * getElementSize(inputDataType);
+
     /* For each frame in the input batch convert/copy to the input binding
      * buffer. */
     for (unsigned int i = 0; i < batchSize; i++) {
-        float *outPtr = (float *)devBuf + i * m_NetworkInputLayer.inferDims.numElements;
+        void *outPtr = (uint8_t *)devBuf + i * frameBytes;
 
-        if (convertFcn) {
+        if (convertFcnTyped) {
+            convertFcnTyped(outPtr, (unsigned char *)batchInput.inputFrames[i],
+                            m_NetworkInfo.width, m_NetworkInfo.height, batchInput.inputPitch,
+                            scaleFactor,
+                            m_MeanDataBuffer.get() ? m_MeanDataBuffer->ptr<float>() : nullptr,
+                            *m_PreProcessStream);
+        } else if (convertFcnTypedFloat) {
+            convertFcnTypedFloat(outPtr, (float *)batchInput.inputFrames[i], m_NetworkInfo.width,
+                                 m_NetworkInfo.height, batchInput.inputPitch, scaleFactor,
+                                 m_MeanDataBuffer.get() ? m_MeanDataBuffer->ptr<float>() : nullptr,
+                                 *m_PreProcessStream);
+        } else if (convertFcn) {
             /* Input needs to be pre-processed. */
-            convertFcn(outPtr, (unsigned char *)batchInput.inputFrames[i], m_NetworkInfo.width,
-                       m_NetworkInfo.height, batchInput.inputPitch, m_Scale,
+            convertFcn((float *)outPtr, (unsigned char *)batchInput.inputFrames[i],
+                       m_NetworkInfo.width, m_NetworkInfo.height, batchInput.inputPitch, m_Scale,
                        m_MeanDataBuffer.get() ? m_MeanDataBuffer->ptr<float>() : nullptr,
                        *m_PreProcessStream);
         } else if (convertFcnFloat) {
             /* Input needs to be pre-processed. */
-            convertFcnFloat(outPtr, (float *)batchInput.inputFrames[i], m_NetworkInfo.width,
-                            m_NetworkInfo.height, batchInput.inputPitch, m_Scale,
+            convertFcnFloat((float *)outPtr, (float *)batchInput.inputFrames[i],
+                            m_NetworkInfo.width, m_NetworkInfo.height, batchInput.inputPitch, m_Scale,
                             m_MeanDataBuffer.get() ? m_MeanDataBuffer->ptr<float>() : nullptr,
                             *m_PreProcessStream);
         }
     }
 
+#ifdef VERIFY_CPU_CONVERSION
+    /* Conformance check of the CPU conversion functions. Convert every frame
+     * again on the CPU and compare bit-for-bit with the cuda kernel output. */
+    {
+        RETURN_CUDA_ERR(cudaStreamSynchronize(*m_PreProcessStream),
+                        "Failed to synchronize preprocess stream");
+
+        size_t numElements = m_NetworkInputLayer.inferDims.numElements;
+        size_t inSize = convertFcn ? (size_t)batchInput.inputPitch * m_NetworkInfo.height
+                                   : numElements * sizeof(float);
+        std::vector<uint8_t> hostIn(inSize);
+        std::vector<uint8_t> hostOut(frameBytes), cpuOut(frameBytes);
+        std::vector<float> cpuOutFloat(numElements);
+        float *meanPtr = m_MeanData.empty() ? nullptr : m_MeanData.data();
+
+        for (unsigned int i = 0; i < batchSize; i++) {
+            RETURN_CUDA_ERR(cudaMemcpy(hostIn.data(), batchInput.inputFrames[i], inSize,
+                                       cudaMemcpyDefault),
+                            "Failed to copy input frame to host");
+            RETURN_CUDA_ERR(cudaMemcpy(hostOut.data(), (uint8_t *)devBuf + i * frameBytes,
+                                       frameBytes, cudaMemcpyDefault),
+                            "Failed to copy converted frame to host");
+            if (convertFcn) {
+                NvDsInferConvert_GetCpuFcn(convertFcn)(
+                    cpuOutFloat.data(), hostIn.data(), m_NetworkInfo.width, m_NetworkInfo.height,
+                    batchInput.inputPitch, scaleFactor, meanPtr, nullptr);
+            } else {
+                NvDsInferConvert_GetCpuFcnFloat(convertFcnFloat)(
+                    cpuOutFloat.data(), (float *)hostIn.data(), m_NetworkInfo.width,
+                    m_NetworkInfo.height, batchInput.inputPitch, scaleFactor, meanPtr, nullptr);
+            }
+            if (inputDataType == FLOAT) {
+                memcpy(cpuOut.data(), cpuOutFloat.data(), frameBytes);
+            } else {
+                NvDsInferConvert_ToDataTypeCpu(cpuOut.data(), cpuOutFloat.data(), numElements,
+                                               inputDataType);
+            }
+            if (memcmp(hostOut.data(), cpuOut.data(), frameBytes)) {
+                printError("CPU and cuda pre-processing outputs differ for frame %d", i);
+            }
+        }
+    }
+#endif
+
     /* Inputs can be returned back once pre-processing is complete. */
     if (batchInput.returnInputFunc) {
         RETURN_CUDA_ERR(
@@ -466,6 +557,55 @@ NvDsInferStatus InferPreprocessor::transform(NvDsInferContextBatchInput &batchIn
     return NVDSINFER_SUCCESS;
 }
 
+/* Pre-processing without a cuda device, with the CPU versions of the
+ * conversion functions. The input frames and the input binding buffer must be
+ * host accessible. The inputs are returned as soon as the frames are
+ * converted. */
+NvDsInferStatus InferPreprocessor::transformOnCpu(NvDsInferContextBatchInput &batchInput,
+                                                  void *outBuf,
+                                                  NvDsInferConvertFcn convertFcn,
+                                                  NvDsInferConvertFcnFloat convertFcnFloat,
+                                                  NvDsInferDataType dataType,
+                                                  float scaleFactor)
+{
+    NvDsInferConvertFcn cpuFcn = convertFcn ? NvDsInferConvert_GetCpuFcn(convertFcn) : nullptr;
+    NvDsInferConvertFcnFloat cpuFcnFloat =
+        convertFcnFloat ? NvDsInferConvert_GetCpuFcnFloat(convertFcnFloat) : nullptr;
+    if (!cpuFcn && !cpuFcnFloat) {
+        printError("No CPU implementation of the input conversion");
+        return NVDSINFER_INVALID_PARAMS;
+    }
+
+    size_t numElements = m_NetworkInputLayer.inferDims.numElements;
+    size_t frameBytes = numElements * getElementSize(dataType);
+    float *meanPtr = m_MeanData.empty() ? nullptr : m_MeanData.data();
+    /* Reduced precision inputs are converted to float first. */
+    std::vector<float> floatOut(dataType == FLOAT ? 0 : numElements);
+
+    for (unsigned int i = 0; i < batchInput.numInputFrames; i++) {
+        void *outPtr = (uint8_t *)outBuf + i * frameBytes;
+        float *floatPtr = (dataType == FLOAT) ? (float *)outPtr : floatOut.data();
+
+        if (cpuFcn) {
+            cpuFcn(floatPtr, (unsigned char *)batchInput.inputFrames[i], m_NetworkInfo.width,
+                   m_NetworkInfo.height, batchInput.inputPitch, scaleFactor, meanPtr, nullptr);
+        } else {
+            cpuFcnFloat(floatPtr, (float *)batchInput.inputFrames[i], m_NetworkInfo.width,
+                        m_NetworkInfo.height, batchInput.inputPitch, scaleFactor, meanPtr,
+                        nullptr);
+        }
+        if (dataType != FLOAT &&
+            !NvDsInferConvert_ToDataTypeCpu(outPtr, floatPtr, numElements, dataType)) {
+            printError("Unsupported network input data type %d", (int)dataType);
+            return NVDSINFER_INVALID_PARAMS;
+        }
+    }
+
+    if (batchInput.returnInputFunc)
+        batchInput.returnInputFunc(batchInput.returnFuncData);
+    return NVDSINFER_SUCCESS;
+}
+
 /* Parse the labels file and extract the class label strings. For format of
  * the labels file, please refer to the custom models section in the
  * DeepStreamSDK documentation.
@@ -957,6 +1097,18 @@ NvDsInferStatus NvDsInferContextImpl::preparePreprocess(
         return NVDSINFER_CONFIG_FAILED;
     }
 
+    if (m_InputImageLayerInfo.dataType == INT8) {
+        float int8Scale = 0.0f;
+        if (string_empty(initParams.int8CalibrationFilePath) ||
+            !readInt8CalibrationScale(initParams.int8CalibrationFilePath,
+                                      safeStr(m_InputImageLayerInfo.layerName), int8Scale) ||
+            !processor->setInt8InputScale(int8Scale)) {
+            printError("INT8 network input '%s' requires its scale in int8-calib-file",
+                       safeStr(m_InputImageLayerInfo.layerName));
+            return NVDSINFER_CONFIG_FAILED;
+        }
+    }
+
     NvDsInferStatus status = processor->allocateResource();
     if (status != NVDSINFER_SUCCESS) {
         printError("preprocessor allocate resource failed");
@@ -1144,6 +1296,11 @@ NvDsInferStatus NvDsInferContextImpl::initialize(NvDsInferContextInitParams &ini
         return NVDSINFER_CONFIG_FAILED;
     }
 
+    if (initParams.numInputIOFormats > 0 && initParams.inputIOFormats == nullptr) {
+        printError("numInputIOFormats >0 but inputIOFormats array not specified");
+        return NVDSINFER_CONFIG_FAILED;
+    }
+
     if (initParams.numLayerDevicePrecisions > 0 && initParams.layerDevicePrecisions == nullptr) {
         printError("numLayerDevicePrecisions >0 but layerDevicePrecisions array not specified");
         return NVDSINFER_CONFIG_FAILED;
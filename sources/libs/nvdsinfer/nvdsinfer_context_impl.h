@@ -34,6 +34,7 @@
 #include <nvdsinfer_utils.h>
 
 #include "nvdsinfer_backend.h"
+#include "nvdsinfer_conversion.h"
 
 namespace nvdsinfer {
 
@@ -73,6 +74,7 @@ public:
     NvDsInferFormat getNetworkFormat() { return m_NetworkInputFormat; };
 #endif
     bool setInputOrder(const NvDsInferTensorOrder order);
+    bool setInt8InputScale(float scale);
 
     NvDsInferStatus allocateResource();
     NvDsInferStatus syncStream();
@@ -84,6 +86,12 @@ public:
 
 private:
     NvDsInferStatus readMeanImageFile();
+    NvDsInferStatus transformOnCpu(NvDsInferContextBatchInput &batchInput,
+                                   void *outBuf,
+                                   NvDsInferConvertFcn convertFcn,
+                                   NvDsInferConvertFcnFloat convertFcnFloat,
+                                   NvDsInferDataType dataType,
+                                   float scaleFactor);
     DISABLE_CLASS_COPY(InferPreprocessor);
 
 private:
@@ -96,8 +104,14 @@ private:
     NvDsInferTensorOrder m_InputOrder = NvDsInferTensorOrder_kNCHW;
     NvDsInferBatchDimsLayerInfo m_NetworkInputLayer;
     float m_Scale = 1.0f;
+    /* Quantization scale of an INT8 network input binding. */
+    float m_Int8InputScale = 0.0f;
     std::vector<float> m_ChannelMeans; // same as channels
     std::string m_MeanFile;
+    /* Mean image in host memory, empty if no mean is subtracted. */
+    std::vector<float> m_MeanData;
+    /* No cuda device: conversions run on the CPU, all buffers are host memory. */
+    bool m_CpuConversion = false;
 
     std::unique_ptr<CudaStream> m_PreProcessStream;
     /* Cuda Event for synchronizing completion of pre-processing. */
@@ -10,6 +10,8 @@
  */
 
 #include <cuda.h>
+#include <cuda_fp16.h>
+#include <stdint.h>
 
 #include "nvdsinfer_conversion.h"
 
@@ -469,3 +471,196 @@ void NvDsInferConvert_FtFTensor(float *outBuffer,
             outBuffer, inBuffer, width, height, pitch, scaleFactor, meanDataBuffer);
     }
 }
+
+/* Reduced precision (HALF / INT8) output variants. The float value of each
+ * element is computed exactly like the float kernels above and only the store
+ * differs. */
+template <typename T>
+__device__ __forceinline__ T NvDsInferConvert_StoreValue(float value);
+
+template <>
+__device__ __forceinline__ __half NvDsInferConvert_StoreValue<__half>(float value)
+{
+    return __float2half_rn(value);
+}
+
+template <>
+__device__ __forceinline__ int8_t NvDsInferConvert_StoreValue<int8_t>(float value)
+{
+    return (int8_t)max(-128, min(127, __float2int_rn(value)));
+}
+
+template <typename T, bool Planar, bool Reverse>
+__global__ void NvDsInferConvert_CxTo3TypedKernel(T *outBuffer,
+                                                  unsigned char *inBuffer,
+                                                  unsigned int width,
+                                                  unsigned int height,
+                                                  unsigned int pitch,
+                                                  unsigned int inputPixelSize,
+                                                  float scaleFactor,
+                                                  float *meanDataBuffer)
+{
+    unsigned int row = blockIdx.y * blockDim.y + threadIdx.y;
+    unsigned int col = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if (col < width && row < height) {
+        for (unsigned int k = 0; k < 3; k++) {
+            unsigned char in = inBuffer[row * pitch + col * inputPixelSize + (Reverse ? 2 - k : k)];
+            float value = meanDataBuffer
+                              ? scaleFactor * ((float)in -
+                                               meanDataBuffer[(row * width * 3) + (col * 3) + k])
+                              : scaleFactor * in;
+            unsigned int outIdx = Planar ? width * height * k + row * width + col
+                                         : row * width * 3 + col * 3 + k;
+            outBuffer[outIdx] = NvDsInferConvert_StoreValue<T>(value);
+        }
+    }
+}
+
+template <typename T>
+__global__ void NvDsInferConvert_C1ToP1TypedKernel(T *outBuffer,
+                                                   unsigned char *inBuffer,
+                                                   unsigned int width,
+                                                   unsigned int height,
+                                                   unsigned int pitch,
+                                                   float scaleFactor,
+                                                   float *meanDataBuffer)
+{
+    unsigned int row = blockIdx.y * blockDim.y + threadIdx.y;
+    unsigned int col = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if (col < width && row < height) {
+        float value = meanDataBuffer ? scaleFactor * ((float)inBuffer[row * pitch + col] -
+                                                      meanDataBuffer[(row * width) + col])
+                                     : scaleFactor * inBuffer[row * pitch + col];
+        outBuffer[row * width + col] = NvDsInferConvert_StoreValue<T>(value);
+    }
+}
+
+template <typename T>
+__global__ void NvDsInferConvert_FtFTensorTypedKernel(T *outBuffer,
+                                                      float *inBuffer,
+                                                      unsigned int width,
+                                                      unsigned int height,
+                                                      unsigned int pitch,
+                                                      float scaleFactor,
+                                                      float *meanDataBuffer)
+{
+    unsigned int row = blockIdx.y * blockDim.y + threadIdx.y;
+    unsigned int col = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if (col < width && row < height) {
+        float value = meanDataBuffer ? scaleFactor * ((float)inBuffer[row * width + col] -
+                                                      meanDataBuffer[(row * width) + col])
+                                     : scaleFactor * inBuffer[row * width + col];
+        outBuffer[row * width + col] = NvDsInferConvert_StoreValue<T>(value);
+    }
+}
+
+template <typename T, bool Planar, bool Reverse, unsigned int InputPixelSize>
+static void NvDsInferConvert_CxTo3Typed(void *outBuffer,
+                                        unsigned char *inBuffer,
+                                        unsigned int width,
+                                        unsigned int height,
+                                        unsigned int pitch,
+                                        float scaleFactor,
+                                        float *meanDataBuffer,
+                                        cudaStream_t stream)
+{
+    dim3 threadsPerBlock(THREADS_PER_BLOCK, THREADS_PER_BLOCK);
+    dim3 blocks((width + THREADS_PER_BLOCK_1) / threadsPerBlock.x,
+                (height + THREADS_PER_BLOCK_1) / threadsPerBlock.y);
+
+    NvDsInferConvert_CxTo3TypedKernel<T, Planar, Reverse><<<blocks, threadsPerBlock, 0, stream>>>(
+        (T *)outBuffer, inBuffer, width, height, pitch, InputPixelSize, scaleFactor,
+        meanDataBuffer);
+}
+
+template <typename T>
+static void NvDsInferConvert_C1ToP1Typed(void *outBuffer,
+                                         unsigned char *inBuffer,
+                                         unsigned int width,
+                                         unsigned int height,
+                                         unsigned int pitch,
+                                         float scaleFactor,
+                                         float *meanDataBuffer,
+                                         cudaStream_t stream)
+{
+    dim3 threadsPerBlock(THREADS_PER_BLOCK, THREADS_PER_BLOCK);
+    dim3 blocks((width + THREADS_PER_BLOCK_1) / threadsPerBlock.x,
+                (height + THREADS_PER_BLOCK_1) / threadsPerBlock.y);
+
+    NvDsInferConvert_C1ToP1TypedKernel<T><<<blocks, threadsPerBlock, 0, stream>>>(
+        (T *)outBuffer, inBuffer, width, height, pitch, scaleFactor, meanDataBuffer);
+}
+
+template <typename T>
+static void NvDsInferConvert_FtFTensorTyped(void *outBuffer,
+                                            float *inBuffer,
+                                            unsigned int width,
+                                            unsigned int height,
+                                            unsigned int pitch,
+                                            float scaleFactor,
+                                            float *meanDataBuffer,
+                                            cudaStream_t stream)
+{
+    dim3 threadsPerBlock(THREADS_PER_BLOCK, THREADS_PER_BLOCK);
+    dim3 blocks((width + THREADS_PER_BLOCK_1) / threadsPerBlock.x,
+                (height + THREADS_PER_BLOCK_1) / threadsPerBlock.y);
+
+    NvDsInferConvert_FtFTensorTypedKernel<T><<<blocks, threadsPerBlock, 0, stream>>>(
+        (T *)outBuffer, inBuffer, width, height, pitch, scaleFactor, meanDataBuffer);
+}
+
+template <typename T>
+static NvDsInferConvertFcnTyped NvDsInferConvert_GetTypedFcnT(NvDsInferConvertFcn fcn)
+{
+    if (fcn == NvDsInferConvert_C3ToP3Float)
+        return NvDsInferConvert_CxTo3Typed<T, true, false, 3>;
+    if (fcn == NvDsInferConvert_C3ToL3Float)
+        return NvDsInferConvert_CxTo3Typed<T, false, false, 3>;
+    if (fcn == NvDsInferConvert_C4ToP3Float)
+        return NvDsInferConvert_CxTo3Typed<T, true, false, 4>;
+    if (fcn == NvDsInferConvert_C4ToL3Float)
+        return NvDsInferConvert_CxTo3Typed<T, false, false, 4>;
+    if (fcn == NvDsInferConvert_C3ToP3RFloat)
+        return NvDsInferConvert_CxTo3Typed<T, true, true, 3>;
+    if (fcn == NvDsInferConvert_C3ToL3RFloat)
+        return NvDsInferConvert_CxTo3Typed<T, false, true, 3>;
+    if (fcn == NvDsInferConvert_C4ToP3RFloat)
+        return NvDsInferConvert_CxTo3Typed<T, true, true, 4>;
+    if (fcn == NvDsInferConvert_C4ToL3RFloat)
+        return NvDsInferConvert_CxTo3Typed<T, false, true, 4>;
+    if (fcn == NvDsInferConvert_C1ToP1Float)
+        return NvDsInferConvert_C1ToP1Typed<T>;
+    return nullptr;
+}
+
+NvDsInferConvertFcnTyped NvDsInferConvert_GetTypedFcn(NvDsInferConvertFcn fcn,
+                                                      NvDsInferDataType dataType)
+{
+    switch (dataType) {
+    case HALF:
+        return NvDsInferConvert_GetTypedFcnT<__half>(fcn);
+    case INT8:
+        return NvDsInferConvert_GetTypedFcnT<int8_t>(fcn);
+    default:
+        return nullptr;
+    }
+}
+
+NvDsInferConvertFcnTypedFloat NvDsInferConvert_GetTypedFcnFloat(NvDsInferConvertFcnFloat fcn,
+                                                                NvDsInferDataType dataType)
+{
+    if (fcn != NvDsInferConvert_FtFTensor)
+        return nullptr;
+
+    switch (dataType) {
+    case HALF:
+        return NvDsInferConvert_FtFTensorTyped<__half>;
+    case INT8:
+        return NvDsInferConvert_FtFTensorTyped<int8_t>;
+    default:
+        return nullptr;
+    }
+}
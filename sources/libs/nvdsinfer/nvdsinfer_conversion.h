@@ -16,6 +16,8 @@
 #ifndef __NVDSINFER_CONVERSION_H__
 #define __NVDSINFER_CONVERSION_H__
 
+#include "nvdsinfer.h"
+
 /**
  * Converts an input packed 3 channel buffer of width x height resolution into an
  * planar 3-channel float buffer of width x height resolution. The input buffer can
@@ -306,4 +308,159 @@ typedef void (*NvDsInferConvertFcnFloat)(float *outBuffer,
                                          float *meanDataBuffer,
                                          cudaStream_t stream);
 
+/**
+ * Function pointer types for the reduced precision variants of the conversion
+ * functions. They compute the same float value per element as the float
+ * variants and store it as HALF (round to nearest even) or INT8 (round to
+ * nearest even and saturate to [-128, 127]) in the output buffer, halving or
+ * quartering the bytes written to the network input binding.
+ *
+ * For INT8 the per-tensor quantization scale must be folded into
+ * scaleFactor, i.e. scaleFactor = netScaleFactor / int8Scale.
+ */
+typedef void (*NvDsInferConvertFcnTyped)(void *outBuffer,
+                                         unsigned char *inBuffer,
+                                         unsigned int width,
+                                         unsigned int height,
+                                         unsigned int pitch,
+                                         float scaleFactor,
+                                         float *meanDataBuffer,
+                                         cudaStream_t stream);
+
+typedef void (*NvDsInferConvertFcnTypedFloat)(void *outBuffer,
+                                              float *inBuffer,
+                                              unsigned int width,
+                                              unsigned int height,
+                                              unsigned int pitch,
+                                              float scaleFactor,
+                                              float *meanDataBuffer,
+                                              cudaStream_t stream);
+
+/**
+ * Returns the variant of a float conversion function which writes the given
+ * network input data type. Returns nullptr for FLOAT (use the float function
+ * itself) and for data types without a conversion (INT32).
+ */
+NvDsInferConvertFcnTyped NvDsInferConvert_GetTypedFcn(NvDsInferConvertFcn fcn,
+                                                      NvDsInferDataType dataType);
+NvDsInferConvertFcnTypedFloat NvDsInferConvert_GetTypedFcnFloat(NvDsInferConvertFcnFloat fcn,
+                                                                NvDsInferDataType dataType);
+
+/**
+ * CPU implementations of the conversion functions above. They have the same
+ * signatures and produce bit-identical results, but all buffers (including the
+ * mean data buffer) are host memory and the stream argument is ignored.
+ * AVX2 (x86_64, runtime detected) or NEON (aarch64) is used when available.
+ * nvdsinfer pre-processing falls back to them when there is no cuda device.
+ */
+void NvDsInferConvert_C3ToP3FloatCpu(float *outBuffer,
+                                     unsigned char *inBuffer,
+                                     unsigned int width,
+                                     unsigned int height,
+                                     unsigned int pitch,
+                                     float scaleFactor,
+                                     float *meanDataBuffer,
+                                     cudaStream_t stream);
+
+void NvDsInferConvert_C3ToL3FloatCpu(float *outBuffer,
+                                     unsigned char *inBuffer,
+                                     unsigned int width,
+                                     unsigned int height,
+                                     unsigned int pitch,
+                                     float scaleFactor,
+                                     float *meanDataBuffer,
+                                     cudaStream_t stream);
+
+void NvDsInferConvert_C4ToP3FloatCpu(float *outBuffer,
+                                     unsigned char *inBuffer,
+                                     unsigned int width,
+                                     unsigned int height,
+                                     unsigned int pitch,
+                                     float scaleFactor,
+                                     float *meanDataBuffer,
+                                     cudaStream_t stream);
+
+void NvDsInferConvert_C4ToL3FloatCpu(float *outBuffer,
+                                     unsigned char *inBuffer,
+                                     unsigned int width,
+                                     unsigned int height,
+                                     unsigned int pitch,
+                                     float scaleFactor,
+                                     float *meanDataBuffer,
+                                     cudaStream_t stream);
+
+void NvDsInferConvert_C3ToP3RFloatCpu(float *outBuffer,
+                                      unsigned char *inBuffer,
+                                      unsigned int width,
+                                      unsigned int height,
+                                      unsigned int pitch,
+                                      float scaleFactor,
+                                      float *meanDataBuffer,
+                                      cudaStream_t stream);
+
+void NvDsInferConvert_C3ToL3RFloatCpu(float *outBuffer,
+                                      unsigned char *inBuffer,
+                                      unsigned int width,
+                                      unsigned int height,
+                                      unsigned int pitch,
+                                      float scaleFactor,
+                                      float *meanDataBuffer,
+                                      cudaStream_t stream);
+
+void NvDsInferConvert_C4ToP3RFloatCpu(float *outBuffer,
+                                      unsigned char *inBuffer,
+                                      unsigned int width,
+                                      unsigned int height,
+                                      unsigned int pitch,
+                                      float scaleFactor,
+                                      float *meanDataBuffer,
+                                      cudaStream_t stream);
+
+void NvDsInferConvert_C4ToL3RFloatCpu(float *outBuffer,
+                                      unsigned char *inBuffer,
+                                      unsigned int width,
+                                      unsigned int height,
+                                      unsigned int pitch,
+                                      float scaleFactor,
+                                      float *meanDataBuffer,
+                                      cudaStream_t stream);
+
+void NvDsInferConvert_C1ToP1FloatCpu(float *outBuffer,
+                                     unsigned char *inBuffer,
+                                     unsigned int width,
+                                     unsigned int height,
+                                     unsigned int pitch,
+                                     float scaleFactor,
+                                     float *meanDataBuffer,
+                                     cudaStream_t stream);
+
+void NvDsInferConvert_FtFTensorCpu(float *outBuffer,
+                                   float *inBuffer,
+                                   unsigned int width,
+                                   unsigned int height,
+                                   unsigned int pitch,
+                                   float scaleFactor,
+                                   float *meanDataBuffer,
+                                   cudaStream_t stream);
+
+/**
+ * Returns the CPU implementation matching a cuda conversion function, or
+ * nullptr if there is none.
+ */
+NvDsInferConvertFcn NvDsInferConvert_GetCpuFcn(NvDsInferConvertFcn fcn);
+NvDsInferConvertFcnFloat NvDsInferConvert_GetCpuFcnFloat(NvDsInferConvertFcnFloat fcn);
+
+/**
+ * CPU reference for the reduced precision conversions. Stores numElements
+ * float values computed by a CPU float conversion function as dataType
+ * (HALF or INT8) using the same rounding as the cuda kernels, so the result is
+ * bit-identical to the NvDsInferConvert_GetTypedFcn() variants. F16C is used
+ * for HALF on x86_64 when the CPU supports it.
+ * @return false if dataType is not HALF or INT8.
+ */
+bool NvDsInferConvert_ToDataTypeCpu(void *outBuffer,
+                                    const float *inBuffer,
+                                    unsigned int numElements,
+                                    NvDsInferDataType dataType);
+
 #endif /* __NVDSINFER_CONVERSION_H__ */
@@ -0,0 +1,568 @@
+/**
+ * CPU implementations of the pre-processing conversions in
+ * nvdsinfer_conversion.cu. Every function computes exactly the same float
+ * operations per element as the matching cuda kernel:
+ *   out = scaleFactor * in                  (no mean buffer)
+ *   out = scaleFactor * ((float)in - mean)  (with mean buffer)
+ * so results are bit-identical to the GPU path. AVX2 is used on x86_64 when the
+ * CPU supports it (checked at runtime), NEON on aarch64.
+ */
+
+#include <cuda_runtime_api.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "nvdsinfer_conversion.h"
+
+namespace {
+
+/* Output layouts of the 3 channel conversions. */
+enum class Layout { kPlanar, kLinear };
+
+/* Scalar conversion of pixels [colStart, width) of one row of a packed 3/4
+ * channel input. Also used for the tail of the SIMD loops. */
+template <Layout L, bool Reverse>
+inline void convertCxTo3Row(float *outBuffer,
+                            const unsigned char *inRow,
+                            unsigned int row,
+                            unsigned int colStart,
+                            unsigned int width,
+                            unsigned int height,
+                            unsigned int inputPixelSize,
+                            float scaleFactor,
+                            const float *meanDataBuffer)
+{
+    for (unsigned int col = colStart; col < width; col++) {
+        for (unsigned int k = 0; k < 3; k++) {
+            float in = (float)inRow[col * inputPixelSize + (Reverse ? (2 - k) : k)];
+            float value = meanDataBuffer
+                              ? scaleFactor * (in - meanDataBuffer[(row * width * 3) + (col * 3) + k])
+                              : scaleFactor * in;
+            if (L == Layout::kPlanar)
+                outBuffer[width * height * k + row * width + col] = value;
+            else
+                outBuffer[row * width * 3 + col * 3 + k] = value;
+        }
+    }
+}
+
+#if defined(__x86_64__)
+/* Converts 8 pixels per iteration. Each pixel is gathered as one 32-bit word
+ * and the channels are extracted by shifting. For 3 channel input the word
+ * includes the first byte of the next pixel, hence the loop stops one pixel
+ * early to never read past the end of the row. */
+template <Layout L, bool Reverse>
+__attribute__((target("avx2"))) unsigned int convertCxTo3RowAvx2(float *outBuffer,
+                                                                 const unsigned char *inRow,
+                                                                 unsigned int row,
+                                                                 unsigned int width,
+                                                                 unsigned int height,
+                                                                 unsigned int inputPixelSize,
+                                                                 float scaleFactor,
+                                                                 const float *meanDataBuffer)
+{
+    if (L != Layout::kPlanar)
+        return 0;
+
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i pixelSize = _mm256_set1_epi32(inputPixelSize);
+    const __m256i byteMask = _mm256_set1_epi32(0xff);
+    const __m256i three = _mm256_set1_epi32(3);
+    const __m256 scale = _mm256_set1_ps(scaleFactor);
+    const unsigned int margin = (inputPixelSize == 4) ? 0 : 1;
+    const float *meanRow = meanDataBuffer ? meanDataBuffer + row * width * 3 : nullptr;
+
+    unsigned int col = 0;
+    for (; col + 8 + margin <= width; col += 8) {
+        __m256i pixIdx = _mm256_add_epi32(_mm256_set1_epi32(col), lanes);
+        __m256i pixels =
+            _mm256_i32gather_epi32((const int *)inRow, _mm256_mullo_epi32(pixIdx, pixelSize), 1);
+        for (unsigned int k = 0; k < 3; k++) {
+            unsigned int channel = Reverse ? (2 - k) : k;
+            __m256 in = _mm256_cvtepi32_ps(
+                _mm256_and_si256(_mm256_srli_epi32(pixels, 8 * channel), byteMask));
+            __m256 value;
+            if (meanRow) {
+                __m256i meanIdx = _mm256_add_epi32(_mm256_mullo_epi32(pixIdx, three),
+                                                   _mm256_set1_epi32(k));
+                __m256 mean = _mm256_i32gather_ps(meanRow, meanIdx, 4);
+                value = _mm256_mul_ps(scale, _mm256_sub_ps(in, mean));
+            } else {
+                value = _mm256_mul_ps(scale, in);
+            }
+            _mm256_storeu_ps(outBuffer + width * height * k + row * width + col, value);
+        }
+    }
+    return col;
+}
+
+__attribute__((target("avx2"))) unsigned int convertC1RowAvx2(float *outRow,
+                                                              const unsigned char *inRow,
+                                                              unsigned int width,
+                                                              float scaleFactor,
+                                                              const float *meanRow)
+{
+    const __m256 scale = _mm256_set1_ps(scaleFactor);
+    unsigned int col = 0;
+    for (; col + 8 <= width; col += 8) {
+        __m256 in = _mm256_cvtepi32_ps(
+            _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(inRow + col))));
+        __m256 value = meanRow ? _mm256_mul_ps(scale, _mm256_sub_ps(in, _mm256_loadu_ps(meanRow + col)))
+                               : _mm256_mul_ps(scale, in);
+        _mm256_storeu_ps(outRow + col, value);
+    }
+    return col;
+}
+
+__attribute__((target("avx2"))) unsigned int convertFloatRowAvx2(float *outRow,
+                                                                 const float *inRow,
+                                                                 unsigned int width,
+                                                                 float scaleFactor,
+                                                                 const float *meanRow)
+{
+    const __m256 scale = _mm256_set1_ps(scaleFactor);
+    unsigned int col = 0;
+    for (; col + 8 <= width; col += 8) {
+        __m256 in = _mm256_loadu_ps(inRow + col);
+        __m256 value = meanRow ? _mm256_mul_ps(scale, _mm256_sub_ps(in, _mm256_loadu_ps(meanRow + col)))
+                               : _mm256_mul_ps(scale, in);
+        _mm256_storeu_ps(outRow + col, value);
+    }
+    return col;
+}
+
+inline bool haveAvx2()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+#elif defined(__ARM_NEON)
+inline float32x4_t neonConvert(float32x4_t in, float32x4_t scale, const float *mean)
+{
+    return mean ? vmulq_f32(scale, vsubq_f32(in, vld1q_f32(mean))) : vmulq_f32(scale, in);
+}
+
+/* Widens 8 unsigned bytes to two float vectors. */
+inline void neonWiden(uint8x8_t v, float32x4_t &lo, float32x4_t &hi)
+{
+    uint16x8_t w = vmovl_u8(v);
+    lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(w)));
+    hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(w)));
+}
+
+/* Converts 8 pixels per iteration. vld3/vld4 de-interleave the channels and
+ * vld3q_f32/vst3q_f32 handle the interleaved mean buffer and linear output. */
+template <Layout L, bool Reverse>
+unsigned int convertCxTo3RowNeon(float *outBuffer,
+                                 const unsigned char *inRow,
+                                 unsigned int row,
+                                 unsigned int width,
+                                 unsigned int height,
+                                 unsigned int inputPixelSize,
+                                 float scaleFactor,
+                                 const float *meanDataBuffer)
+{
+    const float32x4_t scale = vdupq_n_f32(scaleFactor);
+    const float *meanRow = meanDataBuffer ? meanDataBuffer + row * width * 3 : nullptr;
+
+    unsigned int col = 0;
+    for (; col + 8 <= width; col += 8) {
+        uint8x8_t ch[3];
+        if (inputPixelSize == 4) {
+            uint8x8x4_t px = vld4_u8(inRow + col * 4);
+            ch[0] = px.val[0];
+            ch[1] = px.val[1];
+            ch[2] = px.val[2];
+        } else {
+            uint8x8x3_t px = vld3_u8(inRow + col * 3);
+            ch[0] = px.val[0];
+            ch[1] = px.val[1];
+            ch[2] = px.val[2];
+        }
+
+        float32x4x3_t out[2];
+        for (unsigned int k = 0; k < 3; k++) {
+            float32x4_t lo, hi;
+            neonWiden(ch[Reverse ? (2 - k) : k], lo, hi);
+            out[0].val[k] = lo;
+            out[1].val[k] = hi;
+        }
+
+        for (unsigned int h = 0; h < 2; h++) {
+            unsigned int c = col + 4 * h;
+            if (meanRow) {
+                float32x4x3_t mean = vld3q_f32(meanRow + c * 3);
+                for (unsigned int k = 0; k < 3; k++)
+                    out[h].val[k] = vmulq_f32(scale, vsubq_f32(out[h].val[k], mean.val[k]));
+            } else {
+                for (unsigned int k = 0; k < 3; k++)
+                    out[h].val[k] = vmulq_f32(scale, out[h].val[k]);
+            }
+            if (L == Layout::kPlanar) {
+                for (unsigned int k = 0; k < 3; k++)
+                    vst1q_f32(outBuffer + width * height * k + row * width + c, out[h].val[k]);
+            } else {
+                vst3q_f32(outBuffer + row * width * 3 + c * 3, out[h]);
+            }
+        }
+    }
+    return col;
+}
+
+unsigned int convertC1RowNeon(float *outRow,
+                              const unsigned char *inRow,
+                              unsigned int width,
+                              float scaleFactor,
+                              const float *meanRow)
+{
+    const float32x4_t scale = vdupq_n_f32(scaleFactor);
+    unsigned int col = 0;
+    for (; col + 8 <= width; col += 8) {
+        float32x4_t lo, hi;
+        neonWiden(vld1_u8(inRow + col), lo, hi);
+        vst1q_f32(outRow + col, neonConvert(lo, scale, meanRow ? meanRow + col : nullptr));
+        vst1q_f32(outRow + col + 4, neonConvert(hi, scale, meanRow ? meanRow + col + 4 : nullptr));
+    }
+    return col;
+}
+
+unsigned int convertFloatRowNeon(float *outRow,
+                                 const float *inRow,
+                                 unsigned int width,
+                                 float scaleFactor,
+                                 const float *meanRow)
+{
+    const float32x4_t scale = vdupq_n_f32(scaleFactor);
+    unsigned int col = 0;
+    for (; col + 4 <= width; col += 4) {
+        vst1q_f32(outRow + col,
+                  neonConvert(vld1q_f32(inRow + col), scale, meanRow ? meanRow + col : nullptr));
+    }
+    return col;
+}
+#endif
+
+template <Layout L, bool Reverse>
+void convertCxTo3(float *outBuffer,
+                  unsigned char *inBuffer,
+                  unsigned int width,
+                  unsigned int height,
+                  unsigned int pitch,
+                  unsigned int inputPixelSize,
+                  float scaleFactor,
+                  float *meanDataBuffer)
+{
+    for (unsigned int row = 0; row < height; row++) {
+        const unsigned char *inRow = inBuffer + row * pitch;
+        unsigned int col = 0;
+#if defined(__x86_64__)
+        if (haveAvx2())
+            col = convertCxTo3RowAvx2<L, Reverse>(outBuffer, inRow, row, width, height,
+                                                  inputPixelSize, scaleFactor, meanDataBuffer);
+#elif defined(__ARM_NEON)
+        col = convertCxTo3RowNeon<L, Reverse>(outBuffer, inRow, row, width, height, inputPixelSize,
+                                              scaleFactor, meanDataBuffer);
+#endif
+        convertCxTo3Row<L, Reverse>(outBuffer, inRow, row, col, width, height, inputPixelSize,
+                                    scaleFactor, meanDataBuffer);
+    }
+}
+
+/* IEEE 754 float -> half with round to nearest even, same as __float2half_rn. */
+inline uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t absBits = bits & 0x7fffffff;
+
+    if (absBits >= 0x7f800000) /* Inf or NaN */
+        return sign | 0x7c00 | (absBits > 0x7f800000 ? 0x200 : 0);
+    if (absBits >= 0x477ff000) /* Rounds to >= 65520, overflows to Inf */
+        return sign | 0x7c00;
+    if (absBits < 0x38800000) { /* Subnormal half or zero */
+        if (absBits < 0x33000000)
+            return sign;
+        uint32_t mantissa = (absBits & 0x7fffff) | 0x800000;
+        uint32_t shift = 126 - (absBits >> 23);
+        uint32_t half = mantissa >> shift;
+        uint32_t rem = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (half & 1)))
+            half++;
+        return sign | half;
+    }
+    uint32_t half = ((absBits - 0x38000000) >> 13);
+    uint32_t rem = absBits & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (half & 1)))
+        half++;
+    return sign | half;
+}
+
+/* Same as __float2int_rn followed by saturation to [-128, 127]. NaN maps to
+ * -128 like the cuda kernel. */
+inline int8_t floatToInt8(float value)
+{
+    float rounded = nearbyintf(value);
+    if (!(rounded >= -128.0f))
+        return -128;
+    if (rounded > 127.0f)
+        return 127;
+    return (int8_t)rounded;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("f16c,avx"))) unsigned int convertToHalfF16c(uint16_t *outBuffer,
+                                                                    const float *inBuffer,
+                                                                    unsigned int numElements)
+{
+    unsigned int i = 0;
+    for (; i + 8 <= numElements; i += 8) {
+        __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(inBuffer + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i *)(outBuffer + i), half);
+    }
+    return i;
+}
+
+inline bool haveF16c()
+{
+    static const bool f16c = __builtin_cpu_supports("f16c") && __builtin_cpu_supports("avx");
+    return f16c;
+}
+#elif defined(__aarch64__)
+inline unsigned int convertToHalfNeon(uint16_t *outBuffer,
+                                      const float *inBuffer,
+                                      unsigned int numElements)
+{
+    unsigned int i = 0;
+    for (; i + 4 <= numElements; i += 4) {
+        float16x4_t half = vcvt_f16_f32(vld1q_f32(inBuffer + i));
+        vst1_u16(outBuffer + i, vreinterpret_u16_f16(half));
+    }
+    return i;
+}
+#endif
+
+} // namespace
+
+void NvDsInferConvert_C3ToP3FloatCpu(float *outBuffer,
+                                     unsigned char *inBuffer,
+                                     unsigned int width,
+                                     unsigned int height,
+                                     unsigned int pitch,
+                                     float scaleFactor,
+                                     float *meanDataBuffer,
+                                     cudaStream_t stream)
+{
+    convertCxTo3<Layout::kPlanar, false>(outBuffer, inBuffer, width, height, pitch, 3, scaleFactor,
+                                         meanDataBuffer);
+}
+
+void NvDsInferConvert_C3ToL3FloatCpu(float *outBuffer,
+                                     unsigned char *inBuffer,
+                                     unsigned int width,
+                                     unsigned int height,
+                                     unsigned int pitch,
+                                     float scaleFactor,
+                                     float *meanDataBuffer,
+                                     cudaStream_t stream)
+{
+    convertCxTo3<Layout::kLinear, false>(outBuffer, inBuffer, width, height, pitch, 3, scaleFactor,
+                                         meanDataBuffer);
+}
+
+void NvDsInferConvert_C4ToP3FloatCpu(float *outBuffer,
+                                     unsigned char *inBuffer,
+                                     unsigned int width,
+                                     unsigned int height,
+                                     unsigned int pitch,
+                                     float scaleFactor,
+                                     float *meanDataBuffer,
+                                     cudaStream_t stream)
+{
+    convertCxTo3<Layout::kPlanar, false>(outBuffer, inBuffer, width, height, pitch, 4, scaleFactor,
+                                         meanDataBuffer);
+}
+
+void NvDsInferConvert_C4ToL3FloatCpu(float *outBuffer,
+                                     unsigned char *inBuffer,
+                                     unsigned int width,
+                                     unsigned int height,
+                                     unsigned int pitch,
+                                     float scaleFactor,
+                                     float *meanDataBuffer,
+                                     cudaStream_t stream)
+{
+    convertCxTo3<Layout::kLinear, false>(outBuffer, inBuffer, width, height, pitch, 4, scaleFactor,
+                                         meanDataBuffer);
+}
+
+void NvDsInferConvert_C3ToP3RFloatCpu(float *outBuffer,
+                                      unsigned char *inBuffer,
+                                      unsigned int width,
+                                      unsigned int height,
+                                      unsigned int pitch,
+                                      float scaleFactor,
+                                      float *meanDataBuffer,
+                                      cudaStream_t stream)
+{
+    convertCxTo3<Layout::kPlanar, true>(outBuffer, inBuffer, width, height, pitch, 3, scaleFactor,
+                                        meanDataBuffer);
+}
+
+void NvDsInferConvert_C3ToL3RFloatCpu(float *outBuffer,
+                                      unsigned char *inBuffer,
+                                      unsigned int width,
+                                      unsigned int height,
+                                      unsigned int pitch,
+                                      float scaleFactor,
+                                      float *meanDataBuffer,
+                                      cudaStream_t stream)
+{
+    convertCxTo3<Layout::kLinear, true>(outBuffer, inBuffer, width, height, pitch, 3, scaleFactor,
+                                        meanDataBuffer);
+}
+
+void NvDsInferConvert_C4ToP3RFloatCpu(float *outBuffer,
+                                      unsigned char *inBuffer,
+                                      unsigned int width,
+                                      unsigned int height,
+                                      unsigned int pitch,
+                                      float scaleFactor,
+                                      float *meanDataBuffer,
+                                      cudaStream_t stream)
+{
+    convertCxTo3<Layout::kPlanar, true>(outBuffer, inBuffer, width, height, pitch, 4, scaleFactor,
+                                        meanDataBuffer);
+}
+
+void NvDsInferConvert_C4ToL3RFloatCpu(float *outBuffer,
+                                      unsigned char *inBuffer,
+                                      unsigned int width,
+                                      unsigned int height,
+                                      unsigned int pitch,
+                                      float scaleFactor,
+                                      float *meanDataBuffer,
+                                      cudaStream_t stream)
+{
+    convertCxTo3<Layout::kLinear, true>(outBuffer, inBuffer, width, height, pitch, 4, scaleFactor,
+                                        meanDataBuffer);
+}
+
+void NvDsInferConvert_C1ToP1FloatCpu(float *outBuffer,
+                                     unsigned char *inBuffer,
+                                     unsigned int width,
+                                     unsigned int height,
+                                     unsigned int pitch,
+                                     float scaleFactor,
+                                     float *meanDataBuffer,
+                                     cudaStream_t stream)
+{
+    for (unsigned int row = 0; row < height; row++) {
+        float *outRow = outBuffer + row * width;
+        const unsigned char *inRow = inBuffer + row * pitch;
+        const float *meanRow = meanDataBuffer ? meanDataBuffer + row * width : nullptr;
+        unsigned int col = 0;
+#if defined(__x86_64__)
+        if (haveAvx2())
+            col = convertC1RowAvx2(outRow, inRow, width, scaleFactor, meanRow);
+#elif defined(__ARM_NEON)
+        col = convertC1RowNeon(outRow, inRow, width, scaleFactor, meanRow);
+#endif
+        for (; col < width; col++) {
+            outRow[col] = meanRow ? scaleFactor * ((float)inRow[col] - meanRow[col])
+                                  : scaleFactor * inRow[col];
+        }
+    }
+}
+
+void NvDsInferConvert_FtFTensorCpu(float *outBuffer,
+                                   float *inBuffer,
+                                   unsigned int width,
+                                   unsigned int height,
+                                   unsigned int pitch,
+                                   float scaleFactor,
+                                   float *meanDataBuffer,
+                                   cudaStream_t stream)
+{
+    for (unsigned int row = 0; row < height; row++) {
+        float *outRow = outBuffer + row * width;
+        const float *inRow = inBuffer + row * width;
+        const float *meanRow = meanDataBuffer ? meanDataBuffer + row * width : nullptr;
+        unsigned int col = 0;
+#if defined(__x86_64__)
+        if (haveAvx2())
+            col = convertFloatRowAvx2(outRow, inRow, width, scaleFactor, meanRow);
+#elif defined(__ARM_NEON)
+        col = convertFloatRowNeon(outRow, inRow, width, scaleFactor, meanRow);
+#endif
+        for (; col < width; col++) {
+            outRow[col] = meanRow ? scaleFactor * ((float)inRow[col] - meanRow[col])
+                                  : scaleFactor * inRow[col];
+        }
+    }
+}
+
+NvDsInferConvertFcn NvDsInferConvert_GetCpuFcn(NvDsInferConvertFcn fcn)
+{
+    if (fcn == NvDsInferConvert_C3ToP3Float)
+        return NvDsInferConvert_C3ToP3FloatCpu;
+    if (fcn == NvDsInferConvert_C3ToL3Float)
+        return NvDsInferConvert_C3ToL3FloatCpu;
+    if (fcn == NvDsInferConvert_C4ToP3Float)
+        return NvDsInferConvert_C4ToP3FloatCpu;
+    if (fcn == NvDsInferConvert_C4ToL3Float)
+        return NvDsInferConvert_C4ToL3FloatCpu;
+    if (fcn == NvDsInferConvert_C3ToP3RFloat)
+        return NvDsInferConvert_C3ToP3RFloatCpu;
+    if (fcn == NvDsInferConvert_C3ToL3RFloat)
+        return NvDsInferConvert_C3ToL3RFloatCpu;
+    if (fcn == NvDsInferConvert_C4ToP3RFloat)
+        return NvDsInferConvert_C4ToP3RFloatCpu;
+    if (fcn == NvDsInferConvert_C4ToL3RFloat)
+        return NvDsInferConvert_C4ToL3RFloatCpu;
+    if (fcn == NvDsInferConvert_C1ToP1Float)
+        return NvDsInferConvert_C1ToP1FloatCpu;
+    return nullptr;
+}
+
+NvDsInferConvertFcnFloat NvDsInferConvert_GetCpuFcnFloat(NvDsInferConvertFcnFloat fcn)
+{
+    if (fcn == NvDsInferConvert_FtFTensor)
+        return NvDsInferConvert_FtFTensorCpu;
+    return nullptr;
+}
+
+bool NvDsInferConvert_ToDataTypeCpu(void *outBuffer,
+                                    const float *inBuffer,
+                                    unsigned int numElements,
+                                    NvDsInferDataType dataType)
+{
+    if (dataType == HALF) {
+        uint16_t *out = (uint16_t *)outBuffer;
+        unsigned int i = 0;
+#if defined(__x86_64__)
+        if (haveF16c())
+            i = convertToHalfF16c(out, inBuffer, numElements);
+#elif defined(__aarch64__)
+        i = convertToHalfNeon(out, inBuffer, numElements);
+#endif
+        for (; i < numElements; i++)
+            out[i] = floatToHalf(inBuffer[i]);
+        return true;
+    }
+    if (dataType == INT8) {
+        int8_t *out = (int8_t *)outBuffer;
+        for (unsigned int i = 0; i < numElements; i++)
+            out[i] = floatToInt8(inBuffer[i]);
+        return true;
+    }
+    return false;
+}
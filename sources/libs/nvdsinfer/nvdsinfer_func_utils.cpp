@@ -12,6 +12,8 @@
 #include "nvdsinfer_func_utils.h"
 
 #include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <numeric>
@@ -362,6 +364,31 @@ nvinfer1::DeviceType str2DeviceType(const std::string &deviceType)
     return nvinfer1::DeviceType::kGPU;
 }
 
+bool readInt8CalibrationScale(const std::string &calibFile,
+                              const std::string &tensorName,
+                              float &scale)
+{
+    std::ifstream file(calibFile);
+    if (!file.good())
+        return false;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t pos = line.rfind(':');
+        if (pos == std::string::npos || line.compare(0, pos, tensorName))
+            continue;
+        uint32_t bits = 0;
+        try {
+            bits = (uint32_t)std::stoul(line.substr(pos + 1), nullptr, 16);
+        } catch (const std::exception &) {
+            return false;
+        }
+        memcpy(&scale, &bits, sizeof(scale));
+        return scale > 0.0f;
+    }
+    return false;
+}
+
 } // namespace nvdsinfer
 
 __attribute__((visibility("default"))) const char *NvDsInferStatus2Str(NvDsInferStatus status)
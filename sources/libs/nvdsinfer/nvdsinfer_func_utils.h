@@ -260,6 +260,12 @@ bool isValidPrecisionType(const std::string &dataType);
 nvinfer1::DataType str2PrecisionType(const std::string &dataType);
 nvinfer1::DeviceType str2DeviceType(const std::string &deviceType);
 
+/* Reads the quantization scale of a tensor from a TensorRT INT8 calibration
+ * cache. Each entry is "<tensor-name>: <scale as hex float bits>". */
+bool readInt8CalibrationScale(const std::string &calibFile,
+                              const std::string &tensorName,
+                              float &scale);
+
 } // namespace nvdsinfer
 
 #endif
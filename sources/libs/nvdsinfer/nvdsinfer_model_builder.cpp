@@ -782,6 +782,31 @@ NvDsInferStatus TrtModelBuilder::buildNetwork(const NvDsInferContextInitParams &
             return NVDSINFER_CONFIG_FAILED;
         }
     }
+    for (unsigned int i = 0; i < initParams.numInputIOFormats; ++i) {
+        assert(initParams.inputIOFormats[i]);
+        std::string inputIOFormat(initParams.inputIOFormats[i]);
+        size_t pos1 = inputIOFormat.find(":");
+        size_t pos2 =
+            (pos1 == std::string::npos) ? std::string::npos : inputIOFormat.find(":", pos1 + 1);
+        if (pos2 == std::string::npos) {
+            dsInferError(
+                "failed to parse inputIOFormat %s."
+                "Expected layerName:type:fmt",
+                initParams.inputIOFormats[i]);
+            return NVDSINFER_CONFIG_FAILED;
+        }
+        std::string dataType = inputIOFormat.substr(pos1 + 1, pos2 - pos1 - 1);
+        if (dataType.compare("fp32") && dataType.compare("fp16") && dataType.compare("int8")) {
+            dsInferError("Invalid input datatype specified %s", dataType.c_str());
+            return NVDSINFER_CONFIG_FAILED;
+        }
+        std::string format = inputIOFormat.substr(pos2 + 1);
+        if (format.compare("chw")) {
+            dsInferError("Invalid input data format specified %s, only chw is supported",
+                         format.c_str());
+            return NVDSINFER_CONFIG_FAILED;
+        }
+    }
     for (unsigned int i = 0; i < initParams.numLayerDevicePrecisions; ++i) {
         assert(initParams.layerDevicePrecisions[i]);
         std::string outputDevicePrecision(initParams.layerDevicePrecisions[i]);
@@ -920,6 +945,20 @@ void TrtModelBuilder::initCommonParams(BuildParams &params,
         params.outputFormats.insert(outputFmt);
     }
 
+    for (unsigned int i = 0; i < initParams.numInputIOFormats; ++i) {
+        assert(initParams.inputIOFormats[i]);
+        std::string inputIOFormat(initParams.inputIOFormats[i]);
+        size_t pos1 = inputIOFormat.find(":");
+        size_t pos2 = inputIOFormat.find(":", pos1 + 1);
+        std::string layerName = inputIOFormat.substr(0, pos1);
+        std::string dataType = inputIOFormat.substr(pos1 + 1, pos2 - pos1 - 1);
+        std::string format = inputIOFormat.substr(pos2 + 1);
+        BuildParams::TensorIOFormat fmt =
+            std::make_tuple(str2DataType(dataType), str2TensorFormat(format));
+        std::pair<std::string, BuildParams::TensorIOFormat> inputFmt{layerName, fmt};
+        params.inputFormats.insert(inputFmt);
+    }
+
     for (unsigned int i = 0; i < initParams.numLayerDevicePrecisions; ++i) {
         assert(initParams.layerDevicePrecisions[i]);
         std::string outputDevicePrecision(initParams.layerDevicePrecisions[i]);
@@ -986,11 +1025,19 @@ NvDsInferStatus TrtModelBuilder::configCommonOptions(BuildParams &params)
         return NVDSINFER_CONFIG_FAILED;
     }
 
-    /* Set default datatype and tensor formats for input layers */
+    /* Set user defined or default datatype and tensor formats for input
+     * layers. A reduced precision input is written directly by the
+     * preprocessor. */
     for (int iL = 0; iL < inputLayerNum; iL++) {
         nvinfer1::ITensor *input = network.getInput(iL);
-        input->setType(kDefaultTensorDataType);
-        input->setAllowedFormats(kDefaultTensorFormats);
+        if (params.inputFormats.find(input->getName()) != params.inputFormats.end()) {
+            auto curFmt = params.inputFormats.at(input->getName());
+            input->setType(std::get<0>(curFmt));
+            input->setAllowedFormats(std::get<1>(curFmt));
+        } else {
+            input->setType(kDefaultTensorDataType);
+            input->setAllowedFormats(kDefaultTensorFormats);
+        }
     }
 
     /* Set user defined data type and tensor formats for all bound output layers. */
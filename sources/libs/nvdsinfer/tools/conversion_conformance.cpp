@@ -0,0 +1,400 @@
+/*
+ * Conformance check of the CPU pre-processing conversions
+ * (nvdsinfer_conversion_cpu.cpp), CPU only.
+ *
+ * Every conversion nvdsinfer selects (input format x network format x tensor
+ * order, plus the float tensor input) is run through the CPU function that
+ * NvDsInferConvert_GetCpuFcn() maps it to, as InferPreprocessor::transform
+ * does without a cuda device, and compared bit-for-bit with a plain scalar
+ * reference computed here from the definition:
+ *   out = scaleFactor * in                  (no mean)
+ *   out = scaleFactor * ((float)in - mean)  (per-channel offsets or mean image)
+ * Widths cover the SIMD loops and their scalar tails, pitches include row
+ * padding. Each result is also stored as HALF and INT8 and checked against a
+ * correctly rounded reference. A few hand-computed pixels pin the channel
+ * order and the layouts.
+ *
+ *   conversion_conformance [--verbose]
+ *
+ * Exit status 0 if every case matches, 1 otherwise.
+ */
+
+#include <cuda_runtime_api.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+#include "nvdsinfer_conversion.h"
+
+namespace {
+
+struct Conversion {
+    const char *name;
+    NvDsInferConvertFcn fcn;
+    /* Bytes per input pixel. */
+    unsigned int pixelSize;
+    bool planar;
+    /* Output channel k is taken from input channel 2 - k. */
+    bool reverse;
+};
+
+const Conversion conversions[] = {
+    {"C3ToP3Float", NvDsInferConvert_C3ToP3Float, 3, true, false},
+    {"C3ToL3Float", NvDsInferConvert_C3ToL3Float, 3, false, false},
+    {"C4ToP3Float", NvDsInferConvert_C4ToP3Float, 4, true, false},
+    {"C4ToL3Float", NvDsInferConvert_C4ToL3Float, 4, false, false},
+    {"C3ToP3RFloat", NvDsInferConvert_C3ToP3RFloat, 3, true, true},
+    {"C3ToL3RFloat", NvDsInferConvert_C3ToL3RFloat, 3, false, true},
+    {"C4ToP3RFloat", NvDsInferConvert_C4ToP3RFloat, 4, true, true},
+    {"C4ToL3RFloat", NvDsInferConvert_C4ToL3RFloat, 4, false, true},
+    {"C1ToP1Float", NvDsInferConvert_C1ToP1Float, 1, true, false},
+};
+
+enum class Mean { kNone, kOffsets, kImage };
+
+struct ScalingMode {
+    const char *name;
+    float scaleFactor;
+    Mean mean;
+};
+
+/* The usual normalizations: [0, 1], offsets only, and mean image with the
+ * 1/127.5 scale of the face models. */
+const ScalingMode scalingModes[] = {
+    {"scale", 1.0f / 255.0f, Mean::kNone},
+    {"offsets", 1.0f, Mean::kOffsets},
+    {"mean-image", 0.0078431373f, Mean::kImage},
+};
+
+/* Around the 4 and 8 pixel SIMD steps, for their scalar tails and the 3
+ * channel loops stopping one pixel early. */
+const unsigned int widths[] = {1, 3, 7, 8, 9, 15, 16, 17, 31, 33, 64};
+const unsigned int kHeight = 3;
+const unsigned int kRowPadding = 5;
+
+bool verbose = false;
+
+unsigned int outputChannels(const Conversion &c)
+{
+    return c.pixelSize == 1 ? 1 : 3;
+}
+
+/* Mean data laid out as nvdsinfer builds it: channels interleaved per pixel. */
+std::vector<float> makeMean(Mean mean,
+                            unsigned int width,
+                            unsigned int height,
+                            unsigned int channels,
+                            std::mt19937 &rng)
+{
+    std::vector<float> data;
+    if (mean == Mean::kNone)
+        return data;
+
+    const float offsets[3] = {123.675f, 116.28f, 103.53f};
+    std::uniform_real_distribution<float> dist(0.0f, 255.0f);
+    data.resize((size_t)width * height * channels);
+    for (size_t j = 0; j < (size_t)width * height; j++) {
+        for (unsigned int k = 0; k < channels; k++)
+            data[j * channels + k] = (mean == Mean::kOffsets) ? offsets[k] : dist(rng);
+    }
+    return data;
+}
+
+void referenceConvert(const Conversion &c,
+                      float *out,
+                      const unsigned char *in,
+                      unsigned int width,
+                      unsigned int height,
+                      unsigned int pitch,
+                      float scaleFactor,
+                      const float *mean)
+{
+    unsigned int channels = outputChannels(c);
+    for (unsigned int row = 0; row < height; row++) {
+        for (unsigned int col = 0; col < width; col++) {
+            for (unsigned int k = 0; k < channels; k++) {
+                unsigned int channel = c.reverse ? (2 - k) : k;
+                float value = (float)in[row * pitch + col * c.pixelSize + channel];
+                if (mean)
+                    value = scaleFactor * (value - mean[(row * width + col) * channels + k]);
+                else
+                    value = scaleFactor * value;
+                size_t idx = c.planar ? (size_t)width * height * k + row * width + col
+                                      : ((size_t)row * width + col) * channels + k;
+                out[idx] = value;
+            }
+        }
+    }
+}
+
+float halfToFloat(uint16_t half)
+{
+    int exponent = (half >> 10) & 0x1f;
+    int mantissa = half & 0x3ff;
+    float value;
+
+    if (exponent == 0)
+        value = ldexpf((float)mantissa, -24);
+    else if (exponent == 31)
+        value = mantissa ? NAN : INFINITY;
+    else
+        value = ldexpf((float)(mantissa | 0x400), exponent - 25);
+    return (half & 0x8000) ? -value : value;
+}
+
+/* Nearest half, ties to even, found by searching the ordered positive halves
+ * rather than by manipulating bits like the function under test. */
+uint16_t referenceHalf(float value)
+{
+    uint16_t sign = signbit(value) ? 0x8000 : 0;
+    float magnitude = fabsf(value);
+
+    if (isnan(value))
+        return 0x7e00;
+    /* 65520 is halfway between the largest half and the next power of 2. */
+    if (magnitude >= 65520.0f)
+        return sign | 0x7c00;
+
+    unsigned int lo = 0, hi = 0x7bff;
+    while (lo < hi) {
+        unsigned int mid = (lo + hi + 1) / 2;
+        if (halfToFloat(mid) <= magnitude)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    if (lo < 0x7bff) {
+        double below = magnitude - (double)halfToFloat(lo);
+        double above = (double)halfToFloat(lo + 1) - magnitude;
+        if (above < below || (above == below && (lo & 1)))
+            lo++;
+    }
+    return sign | lo;
+}
+
+int8_t referenceInt8(float value)
+{
+    if (isnan(value))
+        return -128;
+    double rounded = rint((double)value);
+    if (rounded < -128.0)
+        return -128;
+    if (rounded > 127.0)
+        return 127;
+    return (int8_t)rounded;
+}
+
+/* Compares float outputs bit-for-bit. Returns the index of the first
+ * mismatch, or -1. */
+long firstMismatch(const std::vector<float> &got, const std::vector<float> &expected)
+{
+    for (size_t i = 0; i < expected.size(); i++) {
+        if (memcmp(&got[i], &expected[i], sizeof(float)))
+            return (long)i;
+    }
+    return -1;
+}
+
+bool checkReducedPrecision(const char *caseName, const std::vector<float> &values)
+{
+    unsigned int n = values.size();
+    std::vector<uint16_t> half(n);
+    std::vector<int8_t> int8(n);
+    bool ok = true;
+
+    NvDsInferConvert_ToDataTypeCpu(half.data(), values.data(), n, HALF);
+    NvDsInferConvert_ToDataTypeCpu(int8.data(), values.data(), n, INT8);
+    for (unsigned int i = 0; i < n; i++) {
+        uint16_t expected = referenceHalf(values[i]);
+        if (half[i] != expected) {
+            printf("FAIL %s HALF: element %u of %g is 0x%04x, expected 0x%04x\n", caseName, i,
+                   values[i], half[i], expected);
+            ok = false;
+            break;
+        }
+    }
+    for (unsigned int i = 0; i < n; i++) {
+        int8_t expected = referenceInt8(values[i]);
+        if (int8[i] != expected) {
+            printf("FAIL %s INT8: element %u of %g is %d, expected %d\n", caseName, i, values[i],
+                   int8[i], expected);
+            ok = false;
+            break;
+        }
+    }
+    return ok;
+}
+
+bool checkConversion(const Conversion &c, const ScalingMode &mode, unsigned int width,
+                     std::mt19937 &rng)
+{
+    NvDsInferConvertFcn cpuFcn = NvDsInferConvert_GetCpuFcn(c.fcn);
+    unsigned int channels = outputChannels(c);
+    unsigned int pitch = width * c.pixelSize + kRowPadding;
+    size_t numElements = (size_t)width * kHeight * channels;
+    char caseName[128];
+
+    snprintf(caseName, sizeof(caseName), "%s %s width %u", c.name, mode.name, width);
+    if (!cpuFcn) {
+        printf("FAIL %s: no CPU function\n", caseName);
+        return false;
+    }
+
+    std::uniform_int_distribution<int> byteDist(0, 255);
+    std::vector<unsigned char> in((size_t)pitch * kHeight);
+    for (unsigned char &b : in)
+        b = (unsigned char)byteDist(rng);
+    std::vector<float> mean = makeMean(mode.mean, width, kHeight, channels, rng);
+    float *meanPtr = mean.empty() ? nullptr : mean.data();
+
+    std::vector<float> expected(numElements);
+    referenceConvert(c, expected.data(), in.data(), width, kHeight, pitch, mode.scaleFactor,
+                     meanPtr);
+    /* Canary after the output catches writes past the frame. */
+    std::vector<float> got(numElements + 8, -12345.0f);
+    cpuFcn(got.data(), in.data(), width, kHeight, pitch, mode.scaleFactor, meanPtr, nullptr);
+
+    for (size_t i = numElements; i < got.size(); i++) {
+        if (got[i] != -12345.0f) {
+            printf("FAIL %s: wrote past the end of the output\n", caseName);
+            return false;
+        }
+    }
+    got.resize(numElements);
+    long bad = firstMismatch(got, expected);
+    if (bad >= 0) {
+        printf("FAIL %s: element %ld is %.9g, expected %.9g\n", caseName, bad, got[bad],
+               expected[bad]);
+        return false;
+    }
+    if (!checkReducedPrecision(caseName, got))
+        return false;
+    if (verbose)
+        printf("ok   %s\n", caseName);
+    return true;
+}
+
+bool checkTensorConversion(const ScalingMode &mode, unsigned int width, std::mt19937 &rng)
+{
+    NvDsInferConvertFcnFloat cpuFcn = NvDsInferConvert_GetCpuFcnFloat(NvDsInferConvert_FtFTensor);
+    size_t numElements = (size_t)width * kHeight;
+    char caseName[128];
+
+    snprintf(caseName, sizeof(caseName), "FtFTensor %s width %u", mode.name, width);
+    if (!cpuFcn) {
+        printf("FAIL %s: no CPU function\n", caseName);
+        return false;
+    }
+
+    std::uniform_real_distribution<float> dist(-300.0f, 300.0f);
+    std::vector<float> in(numElements);
+    for (float &v : in)
+        v = dist(rng);
+    std::vector<float> mean = makeMean(mode.mean, width, kHeight, 1, rng);
+
+    std::vector<float> expected(numElements), got(numElements);
+    for (size_t i = 0; i < numElements; i++) {
+        expected[i] = mean.empty() ? mode.scaleFactor * in[i]
+                                   : mode.scaleFactor * (in[i] - mean[i]);
+    }
+    /* The tensor input has no row padding, the pitch is ignored. */
+    cpuFcn(got.data(), in.data(), width, kHeight, 0, mode.scaleFactor,
+           mean.empty() ? nullptr : mean.data(), nullptr);
+
+    long bad = firstMismatch(got, expected);
+    if (bad >= 0) {
+        printf("FAIL %s: element %ld is %.9g, expected %.9g\n", caseName, bad, got[bad],
+               expected[bad]);
+        return false;
+    }
+    if (!checkReducedPrecision(caseName, got))
+        return false;
+    if (verbose)
+        printf("ok   %s\n", caseName);
+    return true;
+}
+
+/* One pixel (10, 20, 30, 40) scaled by 0.5, hand-computed. */
+struct PinnedCase {
+    NvDsInferConvertFcn fcn;
+    const char *name;
+    float expected[3];
+};
+
+const PinnedCase pinnedCases[] = {
+    {NvDsInferConvert_C3ToP3Float, "C3ToP3Float", {5.0f, 10.0f, 15.0f}},
+    {NvDsInferConvert_C3ToL3RFloat, "C3ToL3RFloat", {15.0f, 10.0f, 5.0f}},
+    {NvDsInferConvert_C4ToP3RFloat, "C4ToP3RFloat", {15.0f, 10.0f, 5.0f}},
+    {NvDsInferConvert_C4ToL3Float, "C4ToL3Float", {5.0f, 10.0f, 15.0f}},
+    {NvDsInferConvert_C1ToP1Float, "C1ToP1Float", {5.0f, 0.0f, 0.0f}},
+};
+
+bool checkPinnedValues()
+{
+    unsigned char pixel[4] = {10, 20, 30, 40};
+    bool ok = true;
+
+    for (const PinnedCase &p : pinnedCases) {
+        NvDsInferConvertFcn cpuFcn = NvDsInferConvert_GetCpuFcn(p.fcn);
+        float out[3] = {0.0f, 0.0f, 0.0f};
+
+        if (!cpuFcn) {
+            printf("FAIL %s: no CPU function\n", p.name);
+            ok = false;
+            continue;
+        }
+        cpuFcn(out, pixel, 1, 1, 4, 0.5f, nullptr, nullptr);
+        if (memcmp(out, p.expected, sizeof(out))) {
+            printf("FAIL %s pinned pixel: got (%g, %g, %g), expected (%g, %g, %g)\n", p.name,
+                   out[0], out[1], out[2], p.expected[0], p.expected[1], p.expected[2]);
+            ok = false;
+        } else if (verbose) {
+            printf("ok   %s pinned pixel\n", p.name);
+        }
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    unsigned int cases = 0, failures = 0;
+    std::mt19937 rng(1);
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--verbose") || !strcmp(argv[i], "-v")) {
+            verbose = true;
+        } else {
+            fprintf(stderr, "usage: %s [--verbose]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    for (const Conversion &c : conversions) {
+        for (const ScalingMode &mode : scalingModes) {
+            for (unsigned int width : widths) {
+                cases++;
+                if (!checkConversion(c, mode, width, rng))
+                    failures++;
+            }
+        }
+    }
+    for (const ScalingMode &mode : scalingModes) {
+        for (unsigned int width : widths) {
+            cases++;
+            if (!checkTensorConversion(mode, width, rng))
+                failures++;
+        }
+    }
+    cases++;
+    if (!checkPinnedValues())
+        failures++;
+
+    printf("%u of %u cases match the reference\n", cases - failures, cases);
+    return failures ? 1 : 0;
+}
@@ -1,6 +1,8 @@
 #include <assert.h>
 #include <faiss/Index.h>
 #include <faiss/IndexFlat.h>
+#include <faiss/impl/IDSelector.h>
+#include <faiss/impl/io.h>
 #include <faiss/index_io.h>
 #include <faiss/utils/distances.h>
 #include <stdio.h>
@@ -9,16 +11,99 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
+#include <unistd.h>
 
 #include <codecvt>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <locale>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
+#include "face_gallery.h"
 #include "nvdsinfer_custom_impl.h"
+#include "student_labels.h"
+
+/* Matches are reported as integers: attributeIndex holds the student id of
+ * the faiss row (see student_labels.h) and attributeLabel stays NULL, so no
+ * string is built per recognised face. The application resolves ids to names
+ * where it needs them. */
+
+static const char *kIndexPath = "./faiss.index";
+static const char *kLabelsPath = "./labels.txt";
+
+/* The gallery: the faiss index, the student id and labels.txt line of each
+ * of its rows, and the mtime of the index file they were loaded from (and of
+ * the file last seen, checked every few faces). gallery_lock guards all of it
+ * against face_gallery_apply(). gallery_saving is set while an update writes
+ * the files without the lock, so the parser does not reload them half
+ * written. */
+static faiss::Index *faiss_index = nullptr;
+static std::vector<long> student_ids;
+static std::vector<std::string> student_lines;
+static char lastModified[100];
+static char checkedModified[100];
+static bool gallery_saving = false;
+static std::mutex gallery_lock;
+/* Serializes face_gallery_apply() calls, files included. */
+static std::mutex gallery_apply_lock;
+
+static void index_mtime(char *buf)
+{
+    struct stat attr;
+    stat(kIndexPath, &attr);
+    ctime_r(&attr.st_mtime, buf);
+}
+
+static void load_gallery(const char *modified)
+{
+    faiss_index = faiss::read_index(kIndexPath);
+
+    printf("index loaded!\n");
+
+    load_student_ids(kLabelsPath, student_ids, &student_lines);
+    strcpy(lastModified, modified);
+}
+
+/* nvinfer dlopens this library before it deserializes its engine, so the
+ * gallery is loaded on a thread started from here, in parallel with the
+ * engines, and the first face does not have to wait for it. Defined after
+ * the gallery state so that it is constructed after it. */
+static struct GalleryPreload {
+    std::thread thread;
+    std::once_flag joined;
+
+    GalleryPreload()
+    {
+        if (access(kIndexPath, R_OK) != 0)
+            return;
+        thread = std::thread([] {
+            char modified[100];
+            index_mtime(modified);
+            try {
+                std::lock_guard<std::mutex> lock(gallery_lock);
+                load_gallery(modified);
+            } catch (const std::exception &e) {
+                /* Retried, and reported, on the first face. */
+                fprintf(stderr, "gallery preload failed: %s\n", e.what());
+            }
+        });
+    }
+    ~GalleryPreload() { wait(); }
+
+    void wait()
+    {
+        std::call_once(joined, [this] {
+            if (thread.joinable())
+                thread.join();
+        });
+    }
+} gallery_preload;
 
 /* C-linkage to prevent name-mangling */
 extern "C" bool NvDsInferClassiferParseCustomFaceRecognition(
@@ -35,38 +120,18 @@ extern "C" bool NvDsInferClassiferParseCustomFaceRecognition(
     std::vector<NvDsInferAttribute> &attrList,
     std::string &descString)
 {
-    static faiss::Index *faiss_index = nullptr;
-    static std::vector<std::string> labels;
-    static char *lastModified = new char[100];
-    static char *curModified = new char[100];
     static int intervalNumber = -1;
+
+    gallery_preload.wait();
+    std::lock_guard<std::mutex> lock(gallery_lock);
     intervalNumber++;
 
     if (intervalNumber % 10 == 0) {
-        struct stat attr;
-        stat("./faiss.index", &attr);
-        strcpy(curModified, ctime(&attr.st_mtime));
+        index_mtime(checkedModified);
     }
 
-    if (faiss_index == NULL || strcmp(curModified, lastModified) != 0) {
-        faiss_index = faiss::read_index("./faiss.index");
-
-        printf("index loaded!\n");
-
-        printf("labels is:\n");
-        auto labels_file = std::fstream("./labels.txt");
-        std::string line;
-        if (labels_file.is_open()) {
-            while (std::getline(labels_file, line)) {
-                labels.push_back(line);
-                printf("\t%s\n", line.c_str());
-            }
-            printf("\n");
-
-        } else {
-            fprintf(stderr, "failed to load labels file\n");
-        }
-        strcpy(lastModified, curModified);
+    if (faiss_index == NULL || (!gallery_saving && strcmp(checkedModified, lastModified) != 0)) {
+        load_gallery(checkedModified);
     }
 
     const NvDsInferLayerInfo &layer = outputLayersInfo[0];
@@ -82,17 +147,16 @@ extern "C" bool NvDsInferClassiferParseCustomFaceRecognition(
 
     // std::cout << "I: " << I << " D: " << D << std::endl;
 
-    if (D > classifierThreshold) {
+    if (D > classifierThreshold && I >= 0 && static_cast<std::size_t>(I) < student_ids.size() &&
+        student_ids[static_cast<std::size_t>(I)] != kNoStudentId) {
         NvDsInferAttribute attr;
 
-        attr.attributeIndex = static_cast<unsigned int>(I);
+        attr.attributeIndex = static_cast<unsigned int>(student_ids[static_cast<std::size_t>(I)]);
         attr.attributeValue = 1;
         attr.attributeConfidence = static_cast<float>(D);
-        attr.attributeLabel = strdup(labels[static_cast<std::size_t>(I)].c_str());
+        attr.attributeLabel = nullptr;
 
         attrList.push_back(attr);
-
-        descString.append(attr.attributeLabel).append(" ");
     }
 
     return true;
@@ -100,3 +164,117 @@ extern "C" bool NvDsInferClassiferParseCustomFaceRecognition(
 
 /* Check that the custom function has been defined correctly */
 CHECK_CUSTOM_CLASSIFIER_PARSE_FUNC_PROTOTYPE(NvDsInferClassiferParseCustomFaceRecognition);
+
+/* Writes @size bytes to @path through a temporary file renamed over it, so
+ * the loaders never see a partial file. */
+static bool save_file(const char *path, const void *data, size_t size)
+{
+    std::string tmp = std::string(path) + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(static_cast<const char *>(data), size);
+        if (!out.flush())
+            return false;
+    }
+    return rename(tmp.c_str(), path) == 0;
+}
+
+/* Rows of a changed student are dropped in one compaction of the flat index
+ * (row order is kept, so student_ids and student_lines are compacted the same
+ * way) and its new vector appended: no other row is read, normalized or
+ * reloaded. The index and labels are serialized to memory under gallery_lock
+ * and written for the next start after it is released, so recognition does
+ * not wait for the disk; their new mtime is then recorded so the parser does
+ * not reload what it already holds. */
+extern "C" int face_gallery_apply(const FaceGalleryChange *changes, unsigned int count,
+                                  unsigned int dim)
+{
+    std::lock_guard<std::mutex> apply_lock(gallery_apply_lock);
+    faiss::VectorIOWriter index_data;
+    std::string labels;
+
+    gallery_preload.wait();
+    try {
+        std::lock_guard<std::mutex> lock(gallery_lock);
+
+        if (faiss_index == NULL) {
+            if (access(kIndexPath, F_OK) == 0) {
+                char modified[100];
+                index_mtime(modified);
+                load_gallery(modified);
+            } else {
+                faiss_index = new faiss::IndexFlatIP(dim);
+            }
+        }
+        faiss::IndexFlat *flat = dynamic_cast<faiss::IndexFlat *>(faiss_index);
+        if (flat == NULL || flat->d != (int)dim ||
+            student_ids.size() != (size_t)flat->ntotal) {
+            fprintf(stderr, "face gallery: cannot update the loaded index in place\n");
+            return -1;
+        }
+
+        std::unordered_set<long> changed;
+        for (unsigned int i = 0; i < count; i++)
+            changed.insert(changes[i].student_id);
+
+        std::vector<long> rows;
+        size_t kept = 0;
+        for (size_t row = 0; row < student_ids.size(); row++) {
+            if (changed.count(student_ids[row])) {
+                rows.push_back((long)row);
+                continue;
+            }
+            student_ids[kept] = student_ids[row];
+            student_lines[kept].swap(student_lines[row]);
+            kept++;
+        }
+        if (!rows.empty()) {
+            faiss::IDSelectorBatch selector(rows.size(), rows.data());
+            flat->remove_ids(selector);
+            student_ids.resize(kept);
+            student_lines.resize(kept);
+        }
+
+        std::vector<float> vectors;
+        for (unsigned int i = 0; i < count; i++) {
+            if (changes[i].vector == NULL)
+                continue;
+            vectors.insert(vectors.end(), changes[i].vector, changes[i].vector + dim);
+            student_ids.push_back(changes[i].student_id);
+            student_lines.push_back(std::to_string(changes[i].student_id) + "," +
+                                    (changes[i].label ? changes[i].label : ""));
+        }
+        if (!vectors.empty()) {
+            long n = (long)(vectors.size() / dim);
+            faiss::fvec_renorm_L2(dim, n, vectors.data());
+            flat->add(n, vectors.data());
+        }
+
+        printf("face gallery: %u changes applied, %zu removed rows, %zu rows\n", count,
+               rows.size(), student_ids.size());
+
+        faiss::write_index(faiss_index, &index_data);
+        for (const std::string &line : student_lines) {
+            labels += line;
+            labels += '\n';
+        }
+        gallery_saving = true;
+    } catch (const std::exception &e) {
+        fprintf(stderr, "face gallery: update failed: %s\n", e.what());
+        return -1;
+    }
+
+    bool saved = save_file(kIndexPath, index_data.data.data(), index_data.data.size()) &&
+                 save_file(kLabelsPath, labels.data(), labels.size());
+
+    std::lock_guard<std::mutex> lock(gallery_lock);
+    /* Also after a failed save: the gallery in memory is the valid one. */
+    index_mtime(lastModified);
+    strcpy(checkedModified, lastModified);
+    gallery_saving = false;
+    if (!saved) {
+        fprintf(stderr, "face gallery: failed to save %s / %s\n", kIndexPath, kLabelsPath);
+        return -2;
+    }
+    return 0;
+}
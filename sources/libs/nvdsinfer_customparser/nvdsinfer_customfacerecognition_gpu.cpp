@@ -22,6 +22,10 @@
 #include <vector>
 
 #include "nvdsinfer_custom_impl.h"
+#include "student_labels.h"
+
+/* Same reporting as the CPU parser: attributeIndex is the student id of the
+ * matched row, attributeLabel stays NULL. */
 
 /* C-linkage to prevent name-mangling */
 extern "C" bool NvDsInferClassiferParseCustomFaceRecognitionGpu(
@@ -41,25 +45,14 @@ extern "C" bool NvDsInferClassiferParseCustomFaceRecognitionGpu(
     static faiss::gpu::StandardGpuResources res;
     static faiss::Index *faiss_cpu_index = nullptr;
     static faiss::gpu::GpuIndex *faiss_gpu_index = nullptr;
-    static std::vector<std::string> labels;
+    static std::vector<long> student_ids;
 
     if (faiss_cpu_index == NULL) {
         faiss_cpu_index = faiss::read_index("./faiss.index");
 
         printf("index loaded!\n");
 
-        printf("labels is:\n");
-        auto labels_file = std::fstream("./labels.txt");
-        std::string line;
-        if (labels_file.is_open()) {
-            while (std::getline(labels_file, line)) {
-                labels.push_back(line);
-                printf("\t%s\n", line.c_str());
-            }
-            printf("\n");
-        } else {
-            fprintf(stderr, "failed to load labels file\n");
-        }
+        load_student_ids("./labels.txt", student_ids);
     }
 
     if (faiss_gpu_index == NULL) {
@@ -80,17 +73,16 @@ extern "C" bool NvDsInferClassiferParseCustomFaceRecognitionGpu(
 
     // std::cout << "I: " << I << " D: " << D << std::endl;
 
-    if (D > classifierThreshold) {
+    if (D > classifierThreshold && I >= 0 && static_cast<std::size_t>(I) < student_ids.size() &&
+        student_ids[static_cast<std::size_t>(I)] != kNoStudentId) {
         NvDsInferAttribute attr;
 
-        attr.attributeIndex = I;
+        attr.attributeIndex = static_cast<unsigned int>(student_ids[static_cast<std::size_t>(I)]);
         attr.attributeValue = 1;
-        attr.attributeConfidence = D;
-        attr.attributeLabel = strdup(labels[static_cast<std::size_t>(I)].c_str());
+        attr.attributeConfidence = static_cast<float>(D);
+        attr.attributeLabel = nullptr;
 
         attrList.push_back(attr);
-
-        descString.append(attr.attributeLabel).append(" ");
     }
 
     return true;
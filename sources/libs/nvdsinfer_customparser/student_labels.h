@@ -0,0 +1,58 @@
+/*
+ * labels.txt loading shared by the CPU and GPU face recognition parsers.
+ *
+ * Each line of labels.txt describes the faiss row of the same number and
+ * starts with the student id of that row, followed by ','. Matches are
+ * reported as that id; rows whose line has no valid id get kNoStudentId and
+ * are never reported.
+ */
+
+#ifndef __STUDENT_LABELS_H__
+#define __STUDENT_LABELS_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+static const long kNoStudentId = -1;
+
+/* Fills @student_ids with the id of each row of @path and, when @lines is
+ * not NULL, with the full line of each row. Both are left empty if the file
+ * cannot be opened. */
+static inline void load_student_ids(const char *path, std::vector<long> &student_ids,
+                                    std::vector<std::string> *lines = nullptr)
+{
+    student_ids.clear();
+    if (lines)
+        lines->clear();
+
+    auto labels_file = std::ifstream(path);
+    if (!labels_file.is_open()) {
+        fprintf(stderr, "failed to load labels file\n");
+        return;
+    }
+
+    std::string line;
+    unsigned int missing = 0;
+    while (std::getline(labels_file, line)) {
+        char *end = nullptr;
+        unsigned long id = strtoul(line.c_str(), &end, 10);
+        if (end == line.c_str() || *end != ',' || id > 0xffffffffUL) {
+            student_ids.push_back(kNoStudentId);
+            missing++;
+        } else {
+            student_ids.push_back(static_cast<long>(id));
+        }
+        if (lines)
+            lines->push_back(line);
+    }
+    printf("labels loaded: %zu rows", student_ids.size());
+    if (missing)
+        printf(", %u without a student id (never reported)", missing);
+    printf("\n");
+}
+
+#endif /* __STUDENT_LABELS_H__ */
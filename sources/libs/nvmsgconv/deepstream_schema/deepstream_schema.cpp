@@ -339,6 +339,93 @@ done:
     return ret;
 }
 
+/////////////////
+/* Start Custom */
+/////////////////
+static bool nvds_msg2p_parse_payload(void *privData, GKeyFile *key_file, gchar *group)
+{
+    bool ret = false;
+    gchar **keys = NULL;
+    gchar **key = NULL;
+    GError *error = NULL;
+    NvDsPayloadPriv *privObj = (NvDsPayloadPriv *)privData;
+    gchar *keyVal;
+
+    keys = g_key_file_get_keys(key_file, group, NULL, &error);
+    CHECK_ERROR(error);
+
+    for (key = keys; *key; key++) {
+        keyVal = NULL;
+        if (!g_strcmp0(*key, CONFIG_KEY_FEATURE_VECTOR_ENCODING)) {
+            keyVal = g_key_file_get_string(key_file, group, CONFIG_KEY_FEATURE_VECTOR_ENCODING,
+                                           &error);
+            CHECK_ERROR(error);
+            if (!g_strcmp0(keyVal, "json")) {
+                privObj->featureVectorEncoding = NVDS_FEATURE_VECTOR_JSON;
+            } else if (!g_strcmp0(keyVal, "float32")) {
+                privObj->featureVectorEncoding = NVDS_FEATURE_VECTOR_FLOAT32;
+            } else if (!g_strcmp0(keyVal, "fp16")) {
+                privObj->featureVectorEncoding = NVDS_FEATURE_VECTOR_FP16;
+            } else if (!g_strcmp0(keyVal, "int8")) {
+                privObj->featureVectorEncoding = NVDS_FEATURE_VECTOR_INT8;
+            } else {
+                cout << "Unknown " CONFIG_KEY_FEATURE_VECTOR_ENCODING " " << keyVal
+                     << ", expected json, float32, fp16 or int8" << endl;
+                g_free(keyVal);
+                goto done;
+            }
+        } else if (!g_strcmp0(*key, CONFIG_KEY_MESSAGE_PER)) {
+            keyVal = g_key_file_get_string(key_file, group, CONFIG_KEY_MESSAGE_PER, &error);
+            CHECK_ERROR(error);
+            if (!g_strcmp0(keyVal, "object")) {
+                privObj->messageGrouping = NVDS_MESSAGE_PER_OBJECT;
+            } else if (!g_strcmp0(keyVal, "frame")) {
+                privObj->messageGrouping = NVDS_MESSAGE_PER_FRAME;
+            } else if (!g_strcmp0(keyVal, "batch")) {
+                privObj->messageGrouping = NVDS_MESSAGE_PER_BATCH;
+            } else {
+                cout << "Unknown " CONFIG_KEY_MESSAGE_PER " " << keyVal
+                     << ", expected object, frame or batch" << endl;
+                g_free(keyVal);
+                goto done;
+            }
+        } else if (!g_strcmp0(*key, CONFIG_KEY_FORMAT)) {
+            keyVal = g_key_file_get_string(key_file, group, CONFIG_KEY_FORMAT, &error);
+            CHECK_ERROR(error);
+            if (!g_strcmp0(keyVal, "json")) {
+                privObj->payloadFormat = NVDS_PAYLOAD_FORMAT_JSON;
+            } else if (!g_strcmp0(keyVal, "protobuf")) {
+                privObj->payloadFormat = NVDS_PAYLOAD_FORMAT_PROTOBUF;
+            } else {
+                cout << "Unknown " CONFIG_KEY_FORMAT " " << keyVal
+                     << ", expected json or protobuf" << endl;
+                g_free(keyVal);
+                goto done;
+            }
+        } else {
+            cout << "Unknown key " << *key << " for group [" << group << "]\n";
+        }
+
+        if (keyVal)
+            g_free(keyVal);
+    }
+
+    ret = true;
+
+done:
+    if (error) {
+        g_error_free(error);
+    }
+    if (keys) {
+        g_strfreev(keys);
+    }
+
+    return ret;
+}
+////////////////
+/* End Custom */
+////////////////
+
 bool nvds_msg2p_parse_csv(void *privData, const gchar *file)
 {
     NvDsPayloadPriv *privObj = NULL;
@@ -446,6 +533,14 @@ bool nvds_msg2p_parse_key_value(void *privData, const gchar *file)
             retVal = nvds_msg2p_parse_place(privData, cfgFile, *group);
         } else if (!strncmp(*group, CONFIG_GROUP_ANALYTICS, strlen(CONFIG_GROUP_ANALYTICS))) {
             retVal = nvds_msg2p_parse_analytics(privData, cfgFile, *group);
+            /////////////////
+            /* Start Custom */
+            /////////////////
+        } else if (!g_strcmp0(*group, CONFIG_GROUP_PAYLOAD)) {
+            retVal = nvds_msg2p_parse_payload(privData, cfgFile, *group);
+            ////////////////
+            /* End Custom */
+            ////////////////
         } else {
             cout << "Unknown group " << *group << endl;
         }
@@ -58,6 +58,17 @@ using namespace std;
 #define CONFIG_KEY_PLACE_SUB_FIELD2 "place-sub-field2"
 #define CONFIG_KEY_PLACE_SUB_FIELD3 "place-sub-field3"
 
+/////////////////
+/* Start Custom */
+/////////////////
+#define CONFIG_GROUP_PAYLOAD "payload"
+#define CONFIG_KEY_FEATURE_VECTOR_ENCODING "feature-vector-encoding"
+#define CONFIG_KEY_MESSAGE_PER "message-per"
+#define CONFIG_KEY_FORMAT "format"
+////////////////
+/* End Custom */
+////////////////
+
 #define DEFAULT_CSV_FIELDS 10
 
 #define CHECK_ERROR(error)                           \
@@ -103,10 +114,63 @@ struct NvDsAnalyticsObject {
     string version;
 };
 
+/////////////////
+/* Start Custom */
+/////////////////
+/**
+ * How the featureVector of an object is written in the custom payloads. The
+ * binary encodings are base64 of packed little-endian values, declared by the
+ * featureVectorEncoding member next to it.
+ */
+enum NvDsFeatureVectorEncoding {
+    /** JSON array of numbers */
+    NVDS_FEATURE_VECTOR_JSON,
+    /** float32 */
+    NVDS_FEATURE_VECTOR_FLOAT32,
+    /** IEEE half precision */
+    NVDS_FEATURE_VECTOR_FP16,
+    /** int8, value = int8 * featureVectorScale */
+    NVDS_FEATURE_VECTOR_INT8,
+};
+
+/** What one custom dsmeta message (NVDS_PAYLOAD_CUSTOM) covers. */
+enum NvDsMessageGrouping {
+    /** One object with its own envelope (default) */
+    NVDS_MESSAGE_PER_OBJECT,
+    /** All objects of a frame under one envelope */
+    NVDS_MESSAGE_PER_FRAME,
+    /** All frames of a batch under one envelope */
+    NVDS_MESSAGE_PER_BATCH,
+};
+
+/** Serialization of the custom and minimal dsmeta payloads */
+enum NvDsPayloadFormat {
+    /** JSON text (default) */
+    NVDS_PAYLOAD_FORMAT_JSON,
+    /** Protocol Buffers, schema dsmeta_payload.proto */
+    NVDS_PAYLOAD_FORMAT_PROTOBUF,
+};
+////////////////
+/* End Custom */
+////////////////
+
 struct NvDsPayloadPriv {
     unordered_map<int, NvDsSensorObject> sensorObj;
     unordered_map<int, NvDsPlaceObject> placeObj;
     unordered_map<int, NvDsAnalyticsObject> analyticsObj;
+    /////////////////
+    /* Start Custom */
+    /////////////////
+    NvDsFeatureVectorEncoding featureVectorEncoding = NVDS_FEATURE_VECTOR_JSON;
+    NvDsMessageGrouping messageGrouping = NVDS_MESSAGE_PER_OBJECT;
+    NvDsPayloadFormat payloadFormat = NVDS_PAYLOAD_FORMAT_JSON;
+    /** Batch of the last per-batch message, told apart by its first frame */
+    const void *lastBatch = NULL;
+    guint lastBatchSource = 0;
+    gint lastBatchFrame = -1;
+    ////////////////
+    /* End Custom */
+    ////////////////
 };
 
 gchar *generate_event_message(void *privData, NvDsEventMsgMeta *meta);
@@ -124,6 +188,12 @@ bool nvds_msg2p_parse_csv(void *privData, const gchar *file);
 gchar *generate_event_message_custom(void *privData, NvDsEventMsgMeta *meta);
 gchar *generate_dsmeta_message_custom(void *privData, void *frameMeta, void *objMeta);
 gchar *generate_dsmeta_message_minimal_custom(void *privData, void *frameMeta);
+/* Binary message, to be freed with g_free(); NULL when the call is covered by
+ * the message of an earlier one (see message-per) */
+gpointer generate_dsmeta_message_proto(void *privData, void *frameMeta, void *objMeta, gsize *size);
+/* Whether a message was already generated for the batch of frameMeta, and
+ * marks it as generated otherwise */
+bool dsmeta_batch_already_sent(void *privData, void *frameMeta);
 ////////////////
 /* End Custom */
 ////////////////
@@ -26,6 +26,7 @@
 /////////////////
 #include <math.h>
 
+#include <algorithm>
 #include <limits>
 ////////////////
 /* End Custom */
@@ -48,6 +49,8 @@
 #include "gstnvdsmeta.h"
 #include "nvdsmeta.h"
 #include "nvdsmeta_schema.h"
+#include "payload_writer.h"
+#include "proto_writer.h"
 ////////////////
 /* End Custom */
 ////////////////
@@ -326,9 +329,15 @@ static JsonObject *generate_object_object(void *privData,
 
         for (NvDsLabelInfoList *ll = cl_meta->label_info_list; ll; ll = ll->next) {
             NvDsLabelInfo *ll_meta = (NvDsLabelInfo *)ll->data;
-            if (cl_meta->classifier_type != NULL && strcmp("", cl_meta->classifier_type))
-                json_object_set_string_member(jobject, cl_meta->classifier_type,
-                                              ll_meta->result_label);
+            if (cl_meta->classifier_type != NULL && strcmp("", cl_meta->classifier_type)) {
+                /* Face recognition reports only the student id in label_id */
+                if (ll_meta->result_label[0] == '\0')
+                    json_object_set_int_member(jobject, cl_meta->classifier_type,
+                                               ll_meta->label_id);
+                else
+                    json_object_set_string_member(jobject, cl_meta->classifier_type,
+                                                  ll_meta->result_label);
+            }
         }
     }
     json_object_set_object_member(objectObj, obj_meta->obj_label, jobject);
@@ -390,65 +399,202 @@ static JsonObject *generate_event_object(NvDsObjectMeta *obj_meta)
 /* Start Custom */
 /////////////////
 
-static JsonObject *generate_object_object_custom(void *privData,
-                                                 NvDsFrameMeta *frame_meta,
-                                                 NvDsObjectMeta *obj_meta)
+/* IEEE half precision of `value`, rounded to nearest even. */
+static uint16_t float_to_half(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t abs = bits & 0x7fffffff;
+
+    if (abs >= 0x7f800000) /* inf, nan */
+        return sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 : 0);
+    if (abs >= 0x477ff000) /* rounds above 65504 */
+        return sign | 0x7c00;
+    if (abs < 0x38800000) { /* subnormal half */
+        if (abs < 0x33000001)
+            return sign;
+        uint32_t mant = (abs & 0x007fffff) | 0x00800000;
+        int shift = 126 - (int)(abs >> 23);
+        uint32_t half = mant >> shift;
+        uint32_t rest = mant & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+            half++;
+        return sign | half;
+    }
+    abs += 0xc8000fff + ((abs >> 13) & 1); /* rebias to 15 and round */
+    return sign | (abs >> 13);
+}
+
+/* The values packed little endian as `encoding` (float32 for json), in a
+ * buffer of the calling thread; `scale` is set for int8. */
+static const vector<uint8_t> &pack_feature_vector(NvDsFeatureVectorEncoding encoding,
+                                                  const float *values,
+                                                  unsigned int dim,
+                                                  float *scale)
+{
+    static thread_local vector<uint8_t> packed;
+
+    *scale = 1;
+    switch (encoding) {
+    case NVDS_FEATURE_VECTOR_FP16:
+        packed.resize(dim * 2);
+        for (unsigned int i = 0; i < dim; i++) {
+            uint16_t half = float_to_half(values[i]);
+            packed[2 * i] = (uint8_t)half;
+            packed[2 * i + 1] = (uint8_t)(half >> 8);
+        }
+        break;
+    case NVDS_FEATURE_VECTOR_INT8: {
+        float max_abs = 0;
+        for (unsigned int i = 0; i < dim; i++) {
+            if (isfinite(values[i]))
+                max_abs = std::max(max_abs, fabsf(values[i]));
+        }
+        *scale = max_abs > 0 ? max_abs / 127 : 1;
+        packed.resize(dim);
+        for (unsigned int i = 0; i < dim; i++) {
+            float q = isnan(values[i]) ? 0 : roundf(values[i] / *scale);
+            packed[i] = (uint8_t)(int8_t)std::max(-127.0f, std::min(127.0f, q));
+        }
+        break;
+    }
+    default:
+        packed.resize(dim * 4);
+        for (unsigned int i = 0; i < dim; i++) {
+            uint32_t bits;
+            memcpy(&bits, &values[i], sizeof(bits));
+            for (int b = 0; b < 4; b++)
+                packed[4 * i + b] = (uint8_t)(bits >> (8 * b));
+        }
+        break;
+    }
+    return packed;
+}
+
+/* featureVector as base64 of packed little-endian values, with the encoding
+ * (and the scale of int8) declared next to it. */
+static void write_feature_vector_binary(PayloadWriter &w,
+                                        NvDsFeatureVectorEncoding encoding,
+                                        const float *values,
+                                        unsigned int dim)
+{
+    float scale;
+    const vector<uint8_t> &packed = pack_feature_vector(encoding, values, dim, &scale);
+
+    w.add_base64("featureVector", packed.data(), packed.size());
+    switch (encoding) {
+    case NVDS_FEATURE_VECTOR_FP16:
+        w.add_string("featureVectorEncoding", "fp16");
+        break;
+    case NVDS_FEATURE_VECTOR_INT8:
+        w.add_string("featureVectorEncoding", "int8");
+        w.add_float("featureVectorScale", scale);
+        break;
+    default:
+        w.add_string("featureVectorEncoding", "float32");
+        break;
+    }
+}
+
+/* The first output layer of the tensor meta of an object, its feature vector. */
+static const float *tensor_feature_vector(NvDsInferTensorMeta *meta, unsigned int *dim)
+{
+    for (unsigned int i = 0; i < meta->num_output_layers; i++) {
+        NvDsInferLayerInfo *info = &meta->output_layers_info[i];
+        info->buffer = meta->out_buf_ptrs_host[i];
+    }
+
+    NvDsInferDimsCHW dims;
+    getDimsCHWFromDims(dims, meta->output_layers_info[0].inferDims);
+    *dim = dims.c;
+    return (const float *)meta->output_layers_info[0].buffer;
+}
+
+/* Corners of the object box as fractions of the frame size. */
+static void object_bbox_fraction(NvDsFrameMeta *frame_meta,
+                                 NvDsObjectMeta *obj_meta,
+                                 float *left,
+                                 float *top,
+                                 float *right,
+                                 float *bottom)
+{
+    float frame_width = (frame_meta->pipeline_width == 0) ? (float)frame_meta->source_frame_width
+                                                          : frame_meta->pipeline_width;
+    float frame_height = (frame_meta->pipeline_height == 0)
+                             ? (float)frame_meta->source_frame_height
+                             : frame_meta->pipeline_height;
+
+    *left = obj_meta->rect_params.left / frame_width;
+    *top = obj_meta->rect_params.top / frame_height;
+    *right = *left + obj_meta->rect_params.width / frame_width;
+    *bottom = *top + obj_meta->rect_params.height / frame_height;
+}
+
+/* Writes the object as member `name` of the current object, or as an array
+ * element if `name` is NULL. */
+static void write_object_object_custom(PayloadWriter &w,
+                                       const char *name,
+                                       void *privData,
+                                       NvDsFrameMeta *frame_meta,
+                                       NvDsObjectMeta *obj_meta)
 {
-    JsonObject *objectObj;
-    JsonObject *jobject;
-    JsonObject *jobjectAttribute;
-    JsonObject *jobjectAttributeElement;
     gchar tracking_id[64];
     // gchar parent_id[64];
     // GList *objectMask = NULL;
 
     // object object
-    objectObj = json_object_new();
+    w.begin_object(name);
 
     if (obj_meta->object_id != UNTRACKED_OBJECT_ID) {
         if (snprintf(tracking_id, sizeof(tracking_id), "%lu", obj_meta->object_id) >=
             (int)sizeof(tracking_id))
             g_warning("Not enough space to copy trackingId");
-        json_object_set_string_member(objectObj, "id", tracking_id);
+        w.add_string("id", tracking_id);
     } else
-        json_object_set_string_member(objectObj, "id", "");
+        w.add_string("id", "");
 
     // if (obj_meta->unique_component_id == 2) {
     //     if (obj_meta->parent) {
     //         if (snprintf(parent_id, sizeof(parent_id), "%lu", obj_meta->parent->object_id) >=
     //             (int)sizeof(parent_id))
     //             g_warning("Not enough space to copy parentId");
-    //         json_object_set_string_member(objectObj, "parentId", parent_id);
+    //         w.add_string("parentId", parent_id);
     //     } else
-    //         json_object_set_string_member(objectObj, "parentId", "");
+    //         w.add_string("parentId", "");
     // } else
-    //     json_object_set_string_member(objectObj, "parentId", "");
+    //     w.add_string("parentId", "");
 
-    // json_object_set_double_member(objectObj, "speed", 0);
-    // json_object_set_double_member(objectObj, "direction", 0);
-    // json_object_set_double_member(objectObj, "orientation", 0);
+    // w.add_double("speed", 0);
+    // w.add_double("direction", 0);
+    // w.add_double("orientation", 0);
 
-    json_object_set_string_member(objectObj, "label", obj_meta->obj_label);
-    json_object_set_double_member(objectObj, "confidence", obj_meta->confidence);
+    w.add_string("label", obj_meta->obj_label);
+    w.add_float("confidence", obj_meta->confidence);
 
     for (NvDsClassifierMetaList *cl = obj_meta->classifier_meta_list; cl; cl = cl->next) {
         NvDsClassifierMeta *cl_meta = (NvDsClassifierMeta *)cl->data;
 
         if (cl_meta->unique_component_id == 2) {
-            jobjectAttribute = json_object_new();
+            w.begin_object("attribute");
 
             for (NvDsLabelInfoList *ll = cl_meta->label_info_list; ll; ll = ll->next) {
                 NvDsLabelInfo *ll_meta = (NvDsLabelInfo *)ll->data;
 
-                jobjectAttributeElement = json_object_new();
-                json_object_set_int_member(jobjectAttributeElement, "index", ll_meta->label_id);
-                json_object_set_double_member(jobjectAttributeElement, "confidence",
-                                              ll_meta->result_prob);
-
-                json_object_set_object_member(jobjectAttribute, ll_meta->result_label,
-                                              jobjectAttributeElement);
+                if (ll_meta->result_label[0] == '\0') {
+                    /* Id-only result: key the element by the student id */
+                    gchar key[16];
+                    g_snprintf(key, sizeof(key), "%u", ll_meta->label_id);
+                    w.begin_object(key);
+                } else {
+                    w.begin_object(ll_meta->result_label);
+                }
+                w.add_int("index", ll_meta->label_id);
+                w.add_float("confidence", ll_meta->result_prob);
+                w.end_object();
             }
-            json_object_set_object_member(objectObj, "attribute", jobjectAttribute);
+            w.end_object();
         } else {
             // TODO: Warnings not implemented
             // std::cout << cl_meta->classifier_type << " "
@@ -463,177 +609,411 @@ static JsonObject *generate_object_object_custom(void *privData,
         if (user_meta->base_meta.meta_type == (NvDsMetaType)NVDSINFER_TENSOR_OUTPUT_META) {
             /* convert to tensor metadata */
             NvDsInferTensorMeta *meta = (NvDsInferTensorMeta *)user_meta->user_meta_data;
-
-            for (unsigned int i = 0; i < meta->num_output_layers; i++) {
-                NvDsInferLayerInfo *info = &meta->output_layers_info[i];
-                info->buffer = meta->out_buf_ptrs_host[i];
-            }
-
-            NvDsInferDimsCHW dims;
-            getDimsCHWFromDims(dims, meta->output_layers_info[0].inferDims);
-            unsigned int featureDim = dims.c;
-
-            float *outputCoverageBuffer = (float *)meta->output_layers_info[0].buffer;
-
-            JsonArray *feature_vector = json_array_new();
-            for (unsigned int c = 0; c < featureDim; c++) {
-                if (outputCoverageBuffer[c] == std::numeric_limits<double>::infinity()) {
-                    // TODO: Wanrnings this is error
-                    json_array_add_double_element(feature_vector, 999999);
-                } else if (outputCoverageBuffer[c] == -std::numeric_limits<double>::infinity()) {
-                    json_array_add_double_element(feature_vector, -999999);
-                } else {
-                    json_array_add_double_element(feature_vector, outputCoverageBuffer[c]);
+            unsigned int featureDim;
+            const float *outputCoverageBuffer = tensor_feature_vector(meta, &featureDim);
+            NvDsFeatureVectorEncoding encoding =
+                privData ? ((NvDsPayloadPriv *)privData)->featureVectorEncoding
+                         : NVDS_FEATURE_VECTOR_JSON;
+
+            if (encoding != NVDS_FEATURE_VECTOR_JSON) {
+                write_feature_vector_binary(w, encoding, outputCoverageBuffer, featureDim);
+            } else {
+                w.begin_array("featureVector");
+                for (unsigned int c = 0; c < featureDim; c++) {
+                    if (outputCoverageBuffer[c] == std::numeric_limits<double>::infinity()) {
+                        // TODO: Wanrnings this is error
+                        w.add_int(NULL, 999999);
+                    } else if (outputCoverageBuffer[c] ==
+                               -std::numeric_limits<double>::infinity()) {
+                        w.add_int(NULL, -999999);
+                    } else {
+                        w.add_float(NULL, outputCoverageBuffer[c]);
+                    }
                 }
+                w.end_array();
             }
-            json_object_set_array_member(objectObj, "featureVector", feature_vector);
         }
 
         if (user_meta->base_meta.meta_type == (NvDsMetaType)NVDSINFER_LANDMARK_META) {
             NvDSInferLandmarkMeta *landmark_meta =
                 (NvDSInferLandmarkMeta *)user_meta->user_meta_data;
 
-            JsonArray *landmark = json_array_new();
-
+            w.begin_array("landmark");
             for (unsigned int landmark_id = 0; landmark_id < landmark_meta->num_landmark;
                  landmark_id++) {
-                json_array_add_double_element(landmark, landmark_meta->data[2 * landmark_id]);
-                json_array_add_double_element(landmark, landmark_meta->data[2 * landmark_id + 1]);
+                w.add_float(NULL, landmark_meta->data[2 * landmark_id]);
+                w.add_float(NULL, landmark_meta->data[2 * landmark_id + 1]);
             }
-            json_object_set_array_member(objectObj, "landmark", landmark);
+            w.end_array();
         }
 
         if (user_meta->base_meta.meta_type == NVDS_IMG_CROP_OBJECT_USER_OBJECT_META) {
             // FilePath from ds-example
-            json_object_set_string_member(objectObj, "filePath",
-                                          (gchar *)user_meta->user_meta_data);
+            w.add_string("filePath", (gchar *)user_meta->user_meta_data);
         }
 
         if (user_meta->base_meta.meta_type == NVDS_CUSTOM_MSG_BLOB) {
+            /* Already JSON: its members are copied in without parsing */
             NvDsCustomMsgInfo *custom_blob = (NvDsCustomMsgInfo *)user_meta->user_meta_data;
-            string msg = string((const char *)custom_blob->message, custom_blob->size);
-
-            GError *err = NULL;
-            JsonNode *jnode = json_from_string(msg.c_str(), &err);
-
-            JsonObject *jdata = json_node_get_object(jnode);
-            GList *keys = json_object_get_members(jdata);
-
-            for (GList *k = keys; k; k = g_list_next(k)) {
-                JsonNode *node_value = json_object_get_member(jdata, (gchar *)k->data);
-                if (json_object_has_member(objectObj, (gchar *)k->data)) {
-                    // TODO: Warnings
-                }
-                json_object_set_member(objectObj, (gchar *)k->data, node_value);
-            }
+            if (!w.splice_members((const char *)custom_blob->message, custom_blob->size))
+                g_warning("Custom message blob of an object is not a JSON object");
         }
     }
 
-    float left = obj_meta->rect_params.left / ((frame_meta->pipeline_width == 0)
-                                                   ? (float)frame_meta->source_frame_width
-                                                   : frame_meta->pipeline_width);
-    float top = obj_meta->rect_params.top / ((frame_meta->pipeline_height == 0)
-                                                 ? (float)frame_meta->source_frame_height
-                                                 : frame_meta->pipeline_height);
-    float width = obj_meta->rect_params.width / ((frame_meta->pipeline_width == 0)
-                                                     ? (float)frame_meta->source_frame_width
-                                                     : frame_meta->pipeline_width);
-    float height = obj_meta->rect_params.height / ((frame_meta->pipeline_height == 0)
-                                                       ? (float)frame_meta->source_frame_height
-                                                       : frame_meta->pipeline_height);
+    float left, top, right, bottom;
+    object_bbox_fraction(frame_meta, obj_meta, &left, &top, &right, &bottom);
 
-    jobject = json_object_new();
-    json_object_set_double_member(jobject, "topleftx", left);
-    json_object_set_double_member(jobject, "toplefty", top);
-    json_object_set_double_member(jobject, "bottomrightx", left + width);
-    json_object_set_double_member(jobject, "bottomrighty", top + height);
-    json_object_set_object_member(objectObj, "bbox", jobject);
+    w.begin_object("bbox");
+    w.add_float("topleftx", left);
+    w.add_float("toplefty", top);
+    w.add_float("bottomrightx", right);
+    w.add_float("bottomrighty", bottom);
+    w.end_object();
 
     // // location sub object
-    // jobject = json_object_new();
-    // json_object_set_object_member(objectObj, "location", jobject);
+    // w.begin_object("location");
+    // w.end_object();
 
     // // coordinate sub object
-    // jobject = json_object_new();
-    // json_object_set_object_member(objectObj, "coordinate", jobject);
+    // w.begin_object("coordinate");
+    // w.end_object();
 
-    return objectObj;
+    w.end_object();
 }
 
-gchar *generate_dsmeta_message_custom(void *privData, void *frameMeta, void *objMeta)
+/* Writes the members of a frame into the current object: its timestamps, its
+ * custom message blobs and all its objects. */
+static void write_frame_members_custom(PayloadWriter &w,
+                                       void *privData,
+                                       NvDsFrameMeta *frame_meta)
 {
-    JsonNode *rootNode;
-    JsonObject *rootObj;
-    // JsonObject *placeObj;
-    // JsonObject *sensorObj;
-    // JsonObject *analyticsObj;
-    // JsonObject *eventObj;
-    JsonObject *objectObj;
-    gchar *message;
+    gchar buf_pts[MAX_TIME_STAMP_LEN + 1];
+    gchar ntp_timestamp[MAX_TIME_STAMP_LEN + 1];
 
-    NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)frameMeta;
-    NvDsObjectMeta *obj_meta = (NvDsObjectMeta *)objMeta;
+    /* frame_number comes with the custom message of the app */
+    w.add_int("source_id", frame_meta->source_id);
+    generate_ts_rfc3339_from_ts(buf_pts, MAX_TIME_STAMP_LEN, frame_meta->buf_pts);
+    w.add_string("buf_pts", buf_pts);
+    generate_ts_rfc3339_from_ts(ntp_timestamp, MAX_TIME_STAMP_LEN, frame_meta->ntp_timestamp);
+    w.add_string("ntp_timestamp", ntp_timestamp);
 
-    uuid_t msgId;
-    gchar msgIdStr[37];
+    for (NvDsUserMetaList *l = frame_meta->frame_user_meta_list; l; l = l->next) {
+        NvDsUserMeta *frame_usermeta = (NvDsUserMeta *)l->data;
 
-    uuid_generate_random(msgId);
-    uuid_unparse_lower(msgId, msgIdStr);
+        if (frame_usermeta && frame_usermeta->base_meta.meta_type == NVDS_CUSTOM_MSG_BLOB) {
+            NvDsCustomMsgInfo *custom_blob = (NvDsCustomMsgInfo *)frame_usermeta->user_meta_data;
+            if (!w.splice_members((const char *)custom_blob->message, custom_blob->size))
+                g_warning("Custom message blob of a frame is not a JSON object");
+        }
+    }
 
-    // // place object
-    // placeObj = generate_place_object(privData, frame_meta);
+    w.begin_array("objects");
+    for (NvDsObjectMetaList *obj_l = frame_meta->obj_meta_list; obj_l; obj_l = obj_l->next) {
+        NvDsObjectMeta *obj_meta = (NvDsObjectMeta *)obj_l->data;
+        if (obj_meta)
+            write_object_object_custom(w, NULL, privData, frame_meta, obj_meta);
+    }
+    w.end_array();
+}
 
-    // // sensor object
-    // sensorObj = generate_sensor_object(privData, frame_meta);
+/* Whether the message of the batch of `frame_meta` was already generated. The
+ * frames of a batch are converted one after another on the streaming thread,
+ * so remembering the last batch is enough; batch metas are pooled, hence its
+ * first frame tells batches at the same address apart. */
+static bool batch_already_sent(NvDsPayloadPriv *privObj, NvDsFrameMeta *frame_meta)
+{
+    NvDsBatchMeta *batch_meta = frame_meta->base_meta.batch_meta;
+    NvDsFrameMeta *first = batch_meta->frame_meta_list
+                               ? (NvDsFrameMeta *)batch_meta->frame_meta_list->data
+                               : frame_meta;
+
+    if (privObj->lastBatch == batch_meta && privObj->lastBatchSource == first->source_id &&
+        privObj->lastBatchFrame == first->frame_num)
+        return true;
+    privObj->lastBatch = batch_meta;
+    privObj->lastBatchSource = first->source_id;
+    privObj->lastBatchFrame = first->frame_num;
+    return false;
+}
 
-    // // analytics object
-    // analyticsObj = generate_analytics_module_object(privData, frame_meta);
+bool dsmeta_batch_already_sent(void *privData, void *frameMeta)
+{
+    return batch_already_sent((NvDsPayloadPriv *)privData, (NvDsFrameMeta *)frameMeta);
+}
 
-    // object object
-    objectObj = generate_object_object_custom(privData, frame_meta, obj_meta);
+/* Whether the message of an earlier call already covers this one, when
+ * messages are grouped per frame or per batch. */
+static bool grouped_call_covered(NvDsPayloadPriv *privObj,
+                                 NvDsFrameMeta *frame_meta,
+                                 NvDsObjectMeta *obj_meta)
+{
+    if (obj_meta && frame_meta->obj_meta_list && obj_meta != frame_meta->obj_meta_list->data)
+        return true;
+    return privObj->messageGrouping == NVDS_MESSAGE_PER_BATCH &&
+           batch_already_sent(privObj, frame_meta);
+}
+
+/* One message for the frame or the batch, with a shared envelope. The
+ * converter asks for every object (or every frame): only the first call of a
+ * frame or batch produces the message, the others return NULL. */
+static gchar *generate_dsmeta_message_grouped_custom(NvDsPayloadPriv *privObj,
+                                                     NvDsFrameMeta *frame_meta,
+                                                     NvDsObjectMeta *obj_meta)
+{
+    if (grouped_call_covered(privObj, frame_meta, obj_meta))
+        return NULL;
 
-    // // event object
-    // eventObj = generate_event_object(obj_meta);
+    PayloadWriter &w = payload_writer_get();
+
+    gchar msgIdStr[PAYLOAD_MESSAGE_ID_LEN + 1];
+    generate_message_id(msgIdStr);
+
+    char ts[MAX_TIME_STAMP_LEN + 1];
+    generate_ts_rfc3339(ts, MAX_TIME_STAMP_LEN);
+
+    w.begin_object();
+    w.add_string("messageid", msgIdStr);
+    w.add_string("@timestamp", ts);
+    if (privObj->messageGrouping == NVDS_MESSAGE_PER_FRAME) {
+        write_frame_members_custom(w, privObj, frame_meta);
+    } else {
+        w.begin_array("frames");
+        for (NvDsFrameMetaList *l = frame_meta->base_meta.batch_meta->frame_meta_list; l;
+             l = l->next) {
+            w.begin_object();
+            write_frame_members_custom(w, privObj, (NvDsFrameMeta *)l->data);
+            w.end_object();
+        }
+        w.end_array();
+    }
+    w.end_object();
+
+    return w.dup();
+}
+
+gchar *generate_dsmeta_message_custom(void *privData, void *frameMeta, void *objMeta)
+{
+    NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)frameMeta;
+    NvDsObjectMeta *obj_meta = (NvDsObjectMeta *)objMeta;
+    NvDsPayloadPriv *privObj = (NvDsPayloadPriv *)privData;
+
+    if (privObj && privObj->messageGrouping != NVDS_MESSAGE_PER_OBJECT)
+        return generate_dsmeta_message_grouped_custom(privObj, frame_meta, obj_meta);
+
+    PayloadWriter &w = payload_writer_get();
+    bool has_custom_message = false;
+
+    gchar msgIdStr[PAYLOAD_MESSAGE_ID_LEN + 1];
+    generate_message_id(msgIdStr);
 
     char ts[MAX_TIME_STAMP_LEN + 1];
     generate_ts_rfc3339(ts, MAX_TIME_STAMP_LEN);
 
     // root object
-    rootObj = json_object_new();
-    json_object_set_string_member(rootObj, "messageid", msgIdStr);
-    // json_object_set_string_member(rootObj, "mdsversion", "1.0");
-    json_object_set_string_member(rootObj, "@timestamp", ts);
-    // json_object_set_object_member(rootObj, "place", placeObj);
-    // json_object_set_object_member(rootObj, "sensor", sensorObj);
-    // json_object_set_object_member(rootObj, "analyticsModule", analyticsObj);
-    json_object_set_object_member(rootObj, "object", objectObj);
-    // json_object_set_object_member(rootObj, "event", eventObj);
+    w.begin_object();
+    w.add_string("messageid", msgIdStr);
+    // w.add_string("mdsversion", "1.0");
+    w.add_string("@timestamp", ts);
+    // place, sensor, analyticsModule and event objects are not sent
 
-    // json_object_set_string_member(rootObj, "videoPath", "");
+    // object object
+    write_object_object_custom(w, "object", privData, frame_meta, obj_meta);
+
+    // w.add_string("videoPath", "");
 
     // Search for any custom message blob within frame usermeta list
-    JsonArray *jArray = json_array_new();
     for (NvDsUserMetaList *l = frame_meta->frame_user_meta_list; l; l = l->next) {
         NvDsUserMeta *frame_usermeta = (NvDsUserMeta *)l->data;
         if (frame_usermeta && frame_usermeta->base_meta.meta_type == NVDS_CUSTOM_MSG_BLOB) {
             NvDsCustomMsgInfo *custom_blob = (NvDsCustomMsgInfo *)frame_usermeta->user_meta_data;
-            string msg = string((const char *)custom_blob->message, custom_blob->size);
-            json_array_add_string_element(jArray, msg.c_str());
+            if (!has_custom_message) {
+                w.begin_array("customMessage");
+                has_custom_message = true;
+            }
+            w.add_string(NULL, (const char *)custom_blob->message, custom_blob->size);
         }
     }
-    if (json_array_get_length(jArray) > 0)
-        json_object_set_array_member(rootObj, "customMessage", jArray);
-    else
-        json_array_unref(jArray);
+    if (has_custom_message)
+        w.end_array();
+    w.end_object();
 
-    rootNode = json_node_new(JSON_NODE_OBJECT);
-    json_node_set_object(rootNode, rootObj);
+    return w.dup();
+}
 
-    message = json_to_string(rootNode, TRUE);
-    json_node_free(rootNode);
-    json_object_unref(rootObj);
+/* Version and field numbers of dsmeta_payload.proto */
+#define PAYLOAD_PROTO_VERSION 1
+
+enum { PB_MESSAGE_VERSION = 1, PB_MESSAGE_ID, PB_MESSAGE_TIMESTAMP_US, PB_MESSAGE_FRAMES };
+enum {
+    PB_FRAME_SOURCE_ID = 1,
+    PB_FRAME_NUM,
+    PB_FRAME_BUF_PTS,
+    PB_FRAME_NTP_TIMESTAMP,
+    PB_FRAME_CUSTOM_JSON,
+    PB_FRAME_OBJECTS,
+};
+enum {
+    PB_OBJECT_TRACKING_ID = 1,
+    PB_OBJECT_LABEL,
+    PB_OBJECT_CONFIDENCE,
+    PB_OBJECT_BBOX,
+    PB_OBJECT_LANDMARKS,
+    PB_OBJECT_IDENTITIES,
+    PB_OBJECT_EMBEDDING,
+    PB_OBJECT_FILE_PATH,
+    PB_OBJECT_CUSTOM_JSON,
+};
+enum { PB_BBOX_LEFT = 1, PB_BBOX_TOP, PB_BBOX_RIGHT, PB_BBOX_BOTTOM };
+enum { PB_IDENTITY_INDEX = 1, PB_IDENTITY_LABEL, PB_IDENTITY_CONFIDENCE };
+enum { PB_EMBEDDING_ENCODING = 1, PB_EMBEDDING_DATA, PB_EMBEDDING_SCALE };
+enum { PB_ENCODING_FLOAT32, PB_ENCODING_FP16, PB_ENCODING_INT8 };
+
+static void write_object_proto(ProtoWriter &p,
+                               void *privData,
+                               NvDsFrameMeta *frame_meta,
+                               NvDsObjectMeta *obj_meta)
+{
+    NvDsFeatureVectorEncoding encoding = ((NvDsPayloadPriv *)privData)->featureVectorEncoding;
+    size_t object = p.begin_message(PB_FRAME_OBJECTS);
+
+    if (obj_meta->object_id != UNTRACKED_OBJECT_ID)
+        p.add_uint(PB_OBJECT_TRACKING_ID, obj_meta->object_id);
+    if (obj_meta->obj_label[0] != '\0')
+        p.add_string(PB_OBJECT_LABEL, obj_meta->obj_label);
+    p.add_float(PB_OBJECT_CONFIDENCE, obj_meta->confidence);
+
+    float left, top, right, bottom;
+    object_bbox_fraction(frame_meta, obj_meta, &left, &top, &right, &bottom);
+    size_t bbox = p.begin_message(PB_OBJECT_BBOX);
+    p.add_float(PB_BBOX_LEFT, left);
+    p.add_float(PB_BBOX_TOP, top);
+    p.add_float(PB_BBOX_RIGHT, right);
+    p.add_float(PB_BBOX_BOTTOM, bottom);
+    p.end_message(bbox);
 
-    return message;
+    for (NvDsClassifierMetaList *cl = obj_meta->classifier_meta_list; cl; cl = cl->next) {
+        NvDsClassifierMeta *cl_meta = (NvDsClassifierMeta *)cl->data;
+
+        if (cl_meta->unique_component_id != 2)
+            continue;
+        for (NvDsLabelInfoList *ll = cl_meta->label_info_list; ll; ll = ll->next) {
+            NvDsLabelInfo *ll_meta = (NvDsLabelInfo *)ll->data;
+            size_t identity = p.begin_message(PB_OBJECT_IDENTITIES);
+
+            p.add_uint(PB_IDENTITY_INDEX, ll_meta->label_id);
+            if (ll_meta->result_label[0] != '\0')
+                p.add_string(PB_IDENTITY_LABEL, ll_meta->result_label);
+            p.add_float(PB_IDENTITY_CONFIDENCE, ll_meta->result_prob);
+            p.end_message(identity);
+        }
+    }
+
+    for (NvDsMetaList *l_user = obj_meta->obj_user_meta_list; l_user; l_user = l_user->next) {
+        NvDsUserMeta *user_meta = (NvDsUserMeta *)l_user->data;
+
+        if (user_meta->base_meta.meta_type == (NvDsMetaType)NVDSINFER_TENSOR_OUTPUT_META) {
+            unsigned int dim;
+            const float *values = tensor_feature_vector(
+                (NvDsInferTensorMeta *)user_meta->user_meta_data, &dim);
+            float scale;
+            const vector<uint8_t> &packed = pack_feature_vector(encoding, values, dim, &scale);
+            size_t embedding = p.begin_message(PB_OBJECT_EMBEDDING);
+
+            switch (encoding) {
+            case NVDS_FEATURE_VECTOR_FP16:
+                p.add_uint(PB_EMBEDDING_ENCODING, PB_ENCODING_FP16);
+                break;
+            case NVDS_FEATURE_VECTOR_INT8:
+                p.add_uint(PB_EMBEDDING_ENCODING, PB_ENCODING_INT8);
+                p.add_float(PB_EMBEDDING_SCALE, scale);
+                break;
+            default:
+                p.add_uint(PB_EMBEDDING_ENCODING, PB_ENCODING_FLOAT32);
+                break;
+            }
+            p.add_bytes(PB_EMBEDDING_DATA, packed.data(), packed.size());
+            p.end_message(embedding);
+        } else if (user_meta->base_meta.meta_type == (NvDsMetaType)NVDSINFER_LANDMARK_META) {
+            NvDSInferLandmarkMeta *landmark_meta =
+                (NvDSInferLandmarkMeta *)user_meta->user_meta_data;
+            p.add_packed_floats(PB_OBJECT_LANDMARKS, landmark_meta->data,
+                                2 * landmark_meta->num_landmark);
+        } else if (user_meta->base_meta.meta_type == NVDS_IMG_CROP_OBJECT_USER_OBJECT_META) {
+            p.add_string(PB_OBJECT_FILE_PATH, (gchar *)user_meta->user_meta_data);
+        } else if (user_meta->base_meta.meta_type == NVDS_CUSTOM_MSG_BLOB) {
+            NvDsCustomMsgInfo *custom_blob = (NvDsCustomMsgInfo *)user_meta->user_meta_data;
+            p.add_bytes(PB_OBJECT_CUSTOM_JSON, custom_blob->message, custom_blob->size);
+        }
+    }
+
+    p.end_message(object);
+}
+
+/* The frame with `obj_meta`, or with all its objects if it is NULL. */
+static void write_frame_proto(ProtoWriter &p,
+                              void *privData,
+                              NvDsFrameMeta *frame_meta,
+                              NvDsObjectMeta *obj_meta)
+{
+    size_t frame = p.begin_message(PB_MESSAGE_FRAMES);
+
+    p.add_uint(PB_FRAME_SOURCE_ID, frame_meta->source_id);
+    p.add_uint(PB_FRAME_NUM, (uint64_t)(int64_t)frame_meta->frame_num);
+    p.add_uint(PB_FRAME_BUF_PTS, frame_meta->buf_pts);
+    p.add_uint(PB_FRAME_NTP_TIMESTAMP, frame_meta->ntp_timestamp);
+
+    for (NvDsUserMetaList *l = frame_meta->frame_user_meta_list; l; l = l->next) {
+        NvDsUserMeta *frame_usermeta = (NvDsUserMeta *)l->data;
+
+        if (frame_usermeta && frame_usermeta->base_meta.meta_type == NVDS_CUSTOM_MSG_BLOB) {
+            NvDsCustomMsgInfo *custom_blob = (NvDsCustomMsgInfo *)frame_usermeta->user_meta_data;
+            p.add_bytes(PB_FRAME_CUSTOM_JSON, custom_blob->message, custom_blob->size);
+        }
+    }
+
+    if (obj_meta) {
+        write_object_proto(p, privData, frame_meta, obj_meta);
+    } else {
+        for (NvDsObjectMetaList *obj_l = frame_meta->obj_meta_list; obj_l; obj_l = obj_l->next) {
+            if (obj_l->data)
+                write_object_proto(p, privData, frame_meta, (NvDsObjectMeta *)obj_l->data);
+        }
+    }
+
+    p.end_message(frame);
+}
+
+gpointer generate_dsmeta_message_proto(void *privData, void *frameMeta, void *objMeta, gsize *size)
+{
+    NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)frameMeta;
+    NvDsObjectMeta *obj_meta = (NvDsObjectMeta *)objMeta;
+    NvDsPayloadPriv *privObj = (NvDsPayloadPriv *)privData;
+
+    *size = 0;
+    if (privObj->messageGrouping != NVDS_MESSAGE_PER_OBJECT &&
+        grouped_call_covered(privObj, frame_meta, obj_meta))
+        return NULL;
+
+    ProtoWriter &p = proto_writer_get();
+
+    gchar msgIdStr[PAYLOAD_MESSAGE_ID_LEN + 1];
+    generate_message_id(msgIdStr);
+
+    p.add_uint(PB_MESSAGE_VERSION, PAYLOAD_PROTO_VERSION);
+    p.add_string(PB_MESSAGE_ID, msgIdStr);
+    p.add_uint(PB_MESSAGE_TIMESTAMP_US, g_get_real_time());
+
+    if (privObj->messageGrouping == NVDS_MESSAGE_PER_BATCH) {
+        for (NvDsFrameMetaList *l = frame_meta->base_meta.batch_meta->frame_meta_list; l;
+             l = l->next)
+            write_frame_proto(p, privData, (NvDsFrameMeta *)l->data, NULL);
+    } else {
+        /* Per object, unless called per frame as for the minimal payload */
+        write_frame_proto(p, privData, frame_meta,
+                          privObj->messageGrouping == NVDS_MESSAGE_PER_OBJECT ? obj_meta : NULL);
+    }
+
+    return p.dup(size);
 }
 
 ////////////////
@@ -788,7 +1168,10 @@ gchar *generate_dsmeta_message_minimal(void *privData, void *frameMeta)
                 NvDsClassifierMeta *cl_meta = (NvDsClassifierMeta *)cl->data;
                 for (NvDsLabelInfoList *ll = cl_meta->label_info_list; ll; ll = ll->next) {
                     NvDsLabelInfo *ll_meta = (NvDsLabelInfo *)ll->data;
-                    ss << "|" << ll_meta->result_label;
+                    if (ll_meta->result_label[0] == '\0')
+                        ss << "|" << ll_meta->label_id;
+                    else
+                        ss << "|" << ll_meta->result_label;
                 }
             }
             ss << "|" << obj_meta->confidence;
@@ -848,86 +1231,58 @@ gchar *generate_dsmeta_message_minimal(void *privData, void *frameMeta)
 
 gchar *generate_dsmeta_message_minimal_custom(void *privData, void *frameMeta)
 {
-    JsonNode *rootNode;
-    JsonObject *jobject;
-    JsonArray *jArray;
-    stringstream ss;
-    gchar *message = NULL;
-    JsonObject *objectObj;
-
-    jArray = json_array_new();
-
     NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)frameMeta;
-    for (NvDsObjectMetaList *obj_l = frame_meta->obj_meta_list; obj_l; obj_l = obj_l->next) {
-        NvDsObjectMeta *obj_meta = (NvDsObjectMeta *)obj_l->data;
-        if (obj_meta == NULL || obj_meta->confidence <= 0) {
-            // Ignore Null object.
-            continue;
-        }
-        objectObj = generate_object_object_custom(privData, frame_meta, obj_meta);
-        json_array_add_object_element(jArray, objectObj);
-    }
+    PayloadWriter &w = payload_writer_get();
 
     // generate timestamp
     char ts[MAX_TIME_STAMP_LEN + 1];
     generate_ts_rfc3339(ts, MAX_TIME_STAMP_LEN);
 
-    jobject = json_object_new();
-    json_object_set_string_member(jobject, "version", "4.0");
-    // json_object_set_int_member(jobject, "frame_number", frame_meta->frame_num);
-    json_object_set_int_member(jobject, "source_id", frame_meta->source_id);
-    json_object_set_int_member(jobject, "num_frames_in_batch",
-                               frame_meta->base_meta.batch_meta->num_frames_in_batch);
-    json_object_set_int_member(jobject, "max_frames_in_batch",
-                               frame_meta->base_meta.batch_meta->max_frames_in_batch);
-    json_object_set_string_member(jobject, "msg_timestamp", ts);
-    // json_object_set_double_member(jobject, "width", frame_meta->source_frame_width);
-    // json_object_set_double_member(jobject, "height", frame_meta->source_frame_height);
+    w.begin_object();
+    w.add_string("version", "4.0");
+    // w.add_int("frame_number", frame_meta->frame_num);
+    w.add_int("source_id", frame_meta->source_id);
+    w.add_int("num_frames_in_batch", frame_meta->base_meta.batch_meta->num_frames_in_batch);
+    w.add_int("max_frames_in_batch", frame_meta->base_meta.batch_meta->max_frames_in_batch);
+    w.add_string("msg_timestamp", ts);
+    // w.add_double("width", frame_meta->source_frame_width);
+    // w.add_double("height", frame_meta->source_frame_height);
 
     // std::cout << frame_meta->frame_num << "-" << frame_meta->bInferDone << std::endl;
 
-    gchar *buf_pts = (gchar *)g_malloc0(MAX_TIME_STAMP_LEN);
+    gchar buf_pts[MAX_TIME_STAMP_LEN + 1];
     generate_ts_rfc3339_from_ts(buf_pts, MAX_TIME_STAMP_LEN, frame_meta->buf_pts);
-    json_object_set_string_member(jobject, "buf_pts", buf_pts);
+    w.add_string("buf_pts", buf_pts);
 
-    gchar *ntp_timestamp = (gchar *)g_malloc0(MAX_TIME_STAMP_LEN);
+    gchar ntp_timestamp[MAX_TIME_STAMP_LEN + 1];
     generate_ts_rfc3339_from_ts(ntp_timestamp, MAX_TIME_STAMP_LEN, frame_meta->ntp_timestamp);
-    json_object_set_string_member(jobject, "ntp_timestamp", ntp_timestamp);
+    w.add_string("ntp_timestamp", ntp_timestamp);
 
-    json_object_set_array_member(jobject, "objects", jArray);
+    w.begin_array("objects");
+    for (NvDsObjectMetaList *obj_l = frame_meta->obj_meta_list; obj_l; obj_l = obj_l->next) {
+        NvDsObjectMeta *obj_meta = (NvDsObjectMeta *)obj_l->data;
+        if (obj_meta == NULL || obj_meta->confidence <= 0) {
+            // Ignore Null object.
+            continue;
+        }
+        write_object_object_custom(w, NULL, privData, frame_meta, obj_meta);
+    }
+    w.end_array();
 
     // Search for any custom message blob within frame usermeta list
     for (NvDsUserMetaList *l = frame_meta->frame_user_meta_list; l; l = l->next) {
         NvDsUserMeta *frame_usermeta = (NvDsUserMeta *)l->data;
 
         if (frame_usermeta->base_meta.meta_type == NVDS_CUSTOM_MSG_BLOB) {
+            /* Already JSON: its members are copied in without parsing */
             NvDsCustomMsgInfo *custom_blob = (NvDsCustomMsgInfo *)frame_usermeta->user_meta_data;
-            string msg = string((const char *)custom_blob->message, custom_blob->size);
-
-            GError *err = NULL;
-            JsonNode *jnode = json_from_string(msg.c_str(), &err);
-
-            JsonObject *jdata = json_node_get_object(jnode);
-            GList *keys = json_object_get_members(jdata);
-
-            for (GList *k = keys; k; k = g_list_next(k)) {
-                JsonNode *node_value = json_object_get_member(jdata, (gchar *)k->data);
-                if (json_object_has_member(jobject, (gchar *)k->data)) {
-                    // TODO: Warnings
-                }
-                json_object_set_member(jobject, (gchar *)k->data, node_value);
-            }
+            if (!w.splice_members((const char *)custom_blob->message, custom_blob->size))
+                g_warning("Custom message blob of a frame is not a JSON object");
         }
     }
+    w.end_object();
 
-    rootNode = json_node_new(JSON_NODE_OBJECT);
-    json_node_set_object(rootNode, jobject);
-
-    message = json_to_string(rootNode, TRUE);
-    json_node_free(rootNode);
-    json_object_unref(jobject);
-
-    return message;
+    return w.dup();
 }
 ////////////////
 /* End Custom */
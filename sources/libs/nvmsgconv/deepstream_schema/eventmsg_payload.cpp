@@ -19,6 +19,13 @@
 #include <vector>
 
 #include "deepstream_schema.h"
+/////////////////
+/* Start Custom */
+/////////////////
+#include "payload_writer.h"
+////////////////
+/* End Custom */
+////////////////
 
 static JsonObject *generate_place_object(void *privData, NvDsEventMsgMeta *meta)
 {
@@ -532,287 +539,272 @@ static JsonObject *generate_object_object(void *privData, NvDsEventMsgMeta *meta
 
 // TODO: Add custom payload generate event message
 
-static JsonObject *generate_object_object_custom(void *privData, NvDsEventMsgMeta *meta)
+static void write_object_object_custom(PayloadWriter &w, void *privData, NvDsEventMsgMeta *meta)
 {
-    JsonObject *objectObj;
-    JsonObject *jobject;
     guint i;
     gchar tracking_id[64];
     GList *objectMask = NULL;
 
     // object object
-    objectObj = json_object_new();
+    w.begin_object("object");
     if (snprintf(tracking_id, sizeof(tracking_id), "%lu", meta->trackingId) >=
         (int)sizeof(tracking_id))
         g_warning("Not enough space to copy trackingId");
 
-    json_object_set_string_member(objectObj, "id", tracking_id);
-    json_object_set_double_member(objectObj, "speed", 0);
-    json_object_set_double_member(objectObj, "direction", 0);
-    json_object_set_double_member(objectObj, "orientation", 0);
+    w.add_string("id", tracking_id);
+    w.add_double("speed", 0);
+    w.add_double("direction", 0);
+    w.add_double("orientation", 0);
 
     switch (meta->objType) {
     case NVDS_OBJECT_TYPE_VEHICLE:
         // vehicle sub object
-        jobject = json_object_new();
+        w.begin_object("vehicle");
 
         if (meta->extMsgSize) {
             NvDsVehicleObject *dsObj = (NvDsVehicleObject *)meta->extMsg;
             if (dsObj) {
-                json_object_set_string_member(jobject, "type", dsObj->type);
-                json_object_set_string_member(jobject, "make", dsObj->make);
-                json_object_set_string_member(jobject, "model", dsObj->model);
-                json_object_set_string_member(jobject, "color", dsObj->color);
-                json_object_set_string_member(jobject, "licenseState", dsObj->region);
-                json_object_set_string_member(jobject, "license", dsObj->license);
-                json_object_set_double_member(jobject, "confidence", meta->confidence);
+                w.add_string("type", dsObj->type);
+                w.add_string("make", dsObj->make);
+                w.add_string("model", dsObj->model);
+                w.add_string("color", dsObj->color);
+                w.add_string("licenseState", dsObj->region);
+                w.add_string("license", dsObj->license);
+                w.add_double("confidence", meta->confidence);
             }
         } else {
             // No vehicle object in meta data. Attach empty vehicle sub object.
-            json_object_set_string_member(jobject, "type", "");
-            json_object_set_string_member(jobject, "make", "");
-            json_object_set_string_member(jobject, "model", "");
-            json_object_set_string_member(jobject, "color", "");
-            json_object_set_string_member(jobject, "licenseState", "");
-            json_object_set_string_member(jobject, "license", "");
-            json_object_set_double_member(jobject, "confidence", 1.0);
+            w.add_string("type", "");
+            w.add_string("make", "");
+            w.add_string("model", "");
+            w.add_string("color", "");
+            w.add_string("licenseState", "");
+            w.add_string("license", "");
+            w.add_double("confidence", 1.0);
         }
-        json_object_set_object_member(objectObj, "vehicle", jobject);
+        w.end_object();
         break;
     case NVDS_OBJECT_TYPE_PERSON:
         // person sub object
-        jobject = json_object_new();
+        w.begin_object("person");
 
         if (meta->extMsgSize) {
             NvDsPersonObject *dsObj = (NvDsPersonObject *)meta->extMsg;
             if (dsObj) {
-                json_object_set_int_member(jobject, "age", dsObj->age);
-                json_object_set_string_member(jobject, "gender", dsObj->gender);
-                json_object_set_string_member(jobject, "hair", dsObj->hair);
-                json_object_set_string_member(jobject, "cap", dsObj->cap);
-                json_object_set_string_member(jobject, "apparel", dsObj->apparel);
-                json_object_set_double_member(jobject, "confidence", meta->confidence);
+                w.add_int("age", dsObj->age);
+                w.add_string("gender", dsObj->gender);
+                w.add_string("hair", dsObj->hair);
+                w.add_string("cap", dsObj->cap);
+                w.add_string("apparel", dsObj->apparel);
+                w.add_double("confidence", meta->confidence);
             }
         } else {
             // No person object in meta data. Attach empty person sub object.
-            json_object_set_int_member(jobject, "age", 0);
-            json_object_set_string_member(jobject, "gender", "");
-            json_object_set_string_member(jobject, "hair", "");
-            json_object_set_string_member(jobject, "cap", "");
-            json_object_set_string_member(jobject, "apparel", "");
-            json_object_set_double_member(jobject, "confidence", 1.0);
+            w.add_int("age", 0);
+            w.add_string("gender", "");
+            w.add_string("hair", "");
+            w.add_string("cap", "");
+            w.add_string("apparel", "");
+            w.add_double("confidence", 1.0);
         }
-        json_object_set_object_member(objectObj, "person", jobject);
+        w.end_object();
         break;
     case NVDS_OBJECT_TYPE_FACE:
         // face sub object
-        jobject = json_object_new();
+        w.begin_object("face");
 
         if (meta->extMsgSize) {
             NvDsFaceObject *dsObj = (NvDsFaceObject *)meta->extMsg;
             if (dsObj) {
-                json_object_set_int_member(jobject, "age", dsObj->age);
-                json_object_set_string_member(jobject, "gender", dsObj->gender);
-                json_object_set_string_member(jobject, "hair", dsObj->hair);
-                json_object_set_string_member(jobject, "cap", dsObj->cap);
-                json_object_set_string_member(jobject, "glasses", dsObj->glasses);
-                json_object_set_string_member(jobject, "facialhair", dsObj->facialhair);
-                json_object_set_string_member(jobject, "name", dsObj->name);
-                json_object_set_string_member(jobject, "eyecolor", dsObj->eyecolor);
-                json_object_set_double_member(jobject, "confidence", meta->confidence);
+                w.add_int("age", dsObj->age);
+                w.add_string("gender", dsObj->gender);
+                w.add_string("hair", dsObj->hair);
+                w.add_string("cap", dsObj->cap);
+                w.add_string("glasses", dsObj->glasses);
+                w.add_string("facialhair", dsObj->facialhair);
+                w.add_string("name", dsObj->name);
+                w.add_string("eyecolor", dsObj->eyecolor);
+                w.add_double("confidence", meta->confidence);
             }
         } else {
             // No face object in meta data. Attach empty face sub object.
-            json_object_set_int_member(jobject, "age", 0);
-            json_object_set_string_member(jobject, "gender", "");
-            json_object_set_string_member(jobject, "hair", "");
-            json_object_set_string_member(jobject, "cap", "");
-            json_object_set_string_member(jobject, "glasses", "");
-            json_object_set_string_member(jobject, "facialhair", "");
-            json_object_set_string_member(jobject, "name", "");
-            json_object_set_string_member(jobject, "eyecolor", "");
-            json_object_set_double_member(jobject, "confidence", 1.0);
+            w.add_int("age", 0);
+            w.add_string("gender", "");
+            w.add_string("hair", "");
+            w.add_string("cap", "");
+            w.add_string("glasses", "");
+            w.add_string("facialhair", "");
+            w.add_string("name", "");
+            w.add_string("eyecolor", "");
+            w.add_double("confidence", 1.0);
         }
-        json_object_set_object_member(objectObj, "face", jobject);
+        w.end_object();
         break;
     case NVDS_OBJECT_TYPE_VEHICLE_EXT:
         // vehicle sub object
-        jobject = json_object_new();
+        w.begin_object("vehicle");
 
         if (meta->extMsgSize) {
             NvDsVehicleObjectExt *dsObj = (NvDsVehicleObjectExt *)meta->extMsg;
             if (dsObj) {
-                json_object_set_string_member(jobject, "type", dsObj->type);
-                json_object_set_string_member(jobject, "make", dsObj->make);
-                json_object_set_string_member(jobject, "model", dsObj->model);
-                json_object_set_string_member(jobject, "color", dsObj->color);
-                json_object_set_string_member(jobject, "licenseState", dsObj->region);
-                json_object_set_string_member(jobject, "license", dsObj->license);
-                json_object_set_double_member(jobject, "confidence", meta->confidence);
+                w.add_string("type", dsObj->type);
+                w.add_string("make", dsObj->make);
+                w.add_string("model", dsObj->model);
+                w.add_string("color", dsObj->color);
+                w.add_string("licenseState", dsObj->region);
+                w.add_string("license", dsObj->license);
+                w.add_double("confidence", meta->confidence);
 
                 objectMask = dsObj->mask;
             }
         } else {
             // No vehicle object in meta data. Attach empty vehicle sub object.
-            json_object_set_string_member(jobject, "type", "");
-            json_object_set_string_member(jobject, "make", "");
-            json_object_set_string_member(jobject, "model", "");
-            json_object_set_string_member(jobject, "color", "");
-            json_object_set_string_member(jobject, "licenseState", "");
-            json_object_set_string_member(jobject, "license", "");
-            json_object_set_double_member(jobject, "confidence", 1.0);
+            w.add_string("type", "");
+            w.add_string("make", "");
+            w.add_string("model", "");
+            w.add_string("color", "");
+            w.add_string("licenseState", "");
+            w.add_string("license", "");
+            w.add_double("confidence", 1.0);
         }
-        json_object_set_object_member(objectObj, "vehicle", jobject);
+        w.end_object();
         break;
     case NVDS_OBJECT_TYPE_PERSON_EXT:
         // person sub object
-        jobject = json_object_new();
+        w.begin_object("person");
 
         if (meta->extMsgSize) {
             NvDsPersonObjectExt *dsObj = (NvDsPersonObjectExt *)meta->extMsg;
             if (dsObj) {
-                json_object_set_int_member(jobject, "age", dsObj->age);
-                json_object_set_string_member(jobject, "gender", dsObj->gender);
-                json_object_set_string_member(jobject, "hair", dsObj->hair);
-                json_object_set_string_member(jobject, "cap", dsObj->cap);
-                json_object_set_string_member(jobject, "apparel", dsObj->apparel);
-                json_object_set_double_member(jobject, "confidence", meta->confidence);
+                w.add_int("age", dsObj->age);
+                w.add_string("gender", dsObj->gender);
+                w.add_string("hair", dsObj->hair);
+                w.add_string("cap", dsObj->cap);
+                w.add_string("apparel", dsObj->apparel);
+                w.add_double("confidence", meta->confidence);
 
                 objectMask = dsObj->mask;
             }
         } else {
             // No person object in meta data. Attach empty person sub object.
-            json_object_set_int_member(jobject, "age", 0);
-            json_object_set_string_member(jobject, "gender", "");
-            json_object_set_string_member(jobject, "hair", "");
-            json_object_set_string_member(jobject, "cap", "");
-            json_object_set_string_member(jobject, "apparel", "");
-            json_object_set_double_member(jobject, "confidence", 1.0);
+            w.add_int("age", 0);
+            w.add_string("gender", "");
+            w.add_string("hair", "");
+            w.add_string("cap", "");
+            w.add_string("apparel", "");
+            w.add_double("confidence", 1.0);
         }
-        json_object_set_object_member(objectObj, "person", jobject);
+        w.end_object();
         break;
     case NVDS_OBJECT_TYPE_FACE_EXT:
         // face sub object
-        jobject = json_object_new();
+        w.begin_object("face");
 
         if (meta->extMsgSize) {
             NvDsFaceObjectExt *dsObj = (NvDsFaceObjectExt *)meta->extMsg;
             if (dsObj) {
-                json_object_set_int_member(jobject, "age", dsObj->age);
-                json_object_set_string_member(jobject, "gender", dsObj->gender);
-                json_object_set_string_member(jobject, "hair", dsObj->hair);
-                json_object_set_string_member(jobject, "cap", dsObj->cap);
-                json_object_set_string_member(jobject, "glasses", dsObj->glasses);
-                json_object_set_string_member(jobject, "facialhair", dsObj->facialhair);
-                json_object_set_string_member(jobject, "name", dsObj->name);
-                json_object_set_string_member(jobject, "eyecolor", dsObj->eyecolor);
-                json_object_set_double_member(jobject, "confidence", meta->confidence);
+                w.add_int("age", dsObj->age);
+                w.add_string("gender", dsObj->gender);
+                w.add_string("hair", dsObj->hair);
+                w.add_string("cap", dsObj->cap);
+                w.add_string("glasses", dsObj->glasses);
+                w.add_string("facialhair", dsObj->facialhair);
+                w.add_string("name", dsObj->name);
+                w.add_string("eyecolor", dsObj->eyecolor);
+                w.add_double("confidence", meta->confidence);
 
                 objectMask = dsObj->mask;
             }
         } else {
             // No face object in meta data. Attach empty face sub object.
-            json_object_set_int_member(jobject, "age", 0);
-            json_object_set_string_member(jobject, "gender", "");
-            json_object_set_string_member(jobject, "hair", "");
-            json_object_set_string_member(jobject, "cap", "");
-            json_object_set_string_member(jobject, "glasses", "");
-            json_object_set_string_member(jobject, "facialhair", "");
-            json_object_set_string_member(jobject, "name", "");
-            json_object_set_string_member(jobject, "eyecolor", "");
-            json_object_set_double_member(jobject, "confidence", 1.0);
+            w.add_int("age", 0);
+            w.add_string("gender", "");
+            w.add_string("hair", "");
+            w.add_string("cap", "");
+            w.add_string("glasses", "");
+            w.add_string("facialhair", "");
+            w.add_string("name", "");
+            w.add_string("eyecolor", "");
+            w.add_double("confidence", 1.0);
         }
-        json_object_set_object_member(objectObj, "face", jobject);
+        w.end_object();
         break;
     case NVDS_OBJECT_TYPE_UNKNOWN:
         if (!meta->objectId) {
             break;
         }
         /** No information to add; object type unknown within NvDsEventMsgMeta */
-        jobject = json_object_new();
-        json_object_set_object_member(objectObj, meta->objectId, jobject);
+        w.begin_object(meta->objectId);
+        w.end_object();
         break;
     default:
         cout << "Object type not implemented" << endl;
     }
 
     // bbox sub object
-    jobject = json_object_new();
-    json_object_set_int_member(jobject, "topleftx", meta->bbox.left);
-    json_object_set_int_member(jobject, "toplefty", meta->bbox.top);
-    json_object_set_int_member(jobject, "bottomrightx", meta->bbox.left + meta->bbox.width);
-    json_object_set_int_member(jobject, "bottomrighty", meta->bbox.top + meta->bbox.height);
-    json_object_set_object_member(objectObj, "bbox", jobject);
+    w.begin_object("bbox");
+    w.add_int("topleftx", meta->bbox.left);
+    w.add_int("toplefty", meta->bbox.top);
+    w.add_int("bottomrightx", meta->bbox.left + meta->bbox.width);
+    w.add_int("bottomrighty", meta->bbox.top + meta->bbox.height);
+    w.end_object();
 
     if (objectMask) {
         GList *l;
-        JsonArray *maskArray = json_array_sized_new(g_list_length(objectMask));
+        w.begin_array("maskoutline");
 
         for (l = objectMask; l != NULL; l = l->next) {
             GArray *polygon = (GArray *)l->data;
-            JsonArray *polygonArray = json_array_sized_new(polygon->len);
+            w.begin_array();
 
             for (i = 0; i < polygon->len; i++) {
                 gdouble value = g_array_index(polygon, gdouble, i);
 
-                json_array_add_double_element(polygonArray, value);
+                w.add_double(NULL, value);
             }
 
-            json_array_add_array_element(maskArray, polygonArray);
+            w.end_array();
         }
 
-        json_object_set_array_member(objectObj, "maskoutline", maskArray);
+        w.end_array();
     }
 
     // signature sub array
     if (meta->objSignature.size) {
-        JsonArray *jArray = json_array_sized_new(meta->objSignature.size);
+        w.begin_array("signature");
 
         for (i = 0; i < meta->objSignature.size; i++) {
-            json_array_add_double_element(jArray, meta->objSignature.signature[i]);
+            w.add_double(NULL, meta->objSignature.signature[i]);
         }
-        json_object_set_array_member(objectObj, "signature", jArray);
+        w.end_array();
     }
 
-    return objectObj;
+    w.end_object();
 }
 
 gchar *generate_event_message_custom(void *privData, NvDsEventMsgMeta *meta)
 {
-    JsonNode *rootNode;
-    JsonObject *rootObj;
-    JsonObject *objectObj;
-    gchar *message;
+    PayloadWriter &w = payload_writer_get();
 
-    uuid_t msgId;
-    gchar msgIdStr[37];
+    gchar msgIdStr[PAYLOAD_MESSAGE_ID_LEN + 1];
+    generate_message_id(msgIdStr);
 
-    uuid_generate_random(msgId);
-    uuid_unparse_lower(msgId, msgIdStr);
+    // root object
+    w.begin_object();
+    w.add_string("messageid", msgIdStr);
+    w.add_string("mdsversion", "1.0");
+    w.add_string("@timestamp", meta->ts);
 
     // object object
-    objectObj = generate_object_object_custom(privData, meta);
-
-    // root object
-    rootObj = json_object_new();
-    json_object_set_string_member(rootObj, "messageid", msgIdStr);
-    json_object_set_string_member(rootObj, "mdsversion", "1.0");
-    json_object_set_string_member(rootObj, "@timestamp", meta->ts);
-    json_object_set_object_member(rootObj, "object", objectObj);
+    write_object_object_custom(w, privData, meta);
 
     if (meta->videoPath)
-        json_object_set_string_member(rootObj, "videoPath", meta->videoPath);
+        w.add_string("videoPath", meta->videoPath);
     else
-        json_object_set_string_member(rootObj, "videoPath", "");
+        w.add_string("videoPath", "");
+    w.end_object();
 
-    rootNode = json_node_new(JSON_NODE_OBJECT);
-    json_node_set_object(rootNode, rootObj);
-
-    message = json_to_string(rootNode, TRUE);
-    json_node_free(rootNode);
-    json_object_unref(rootObj);
-
-    return message;
+    return w.dup();
 }
 
 ////////////////
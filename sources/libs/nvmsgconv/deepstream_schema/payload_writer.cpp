@@ -0,0 +1,312 @@
+/*
+ * Streaming JSON writer and message ids, see payload_writer.h.
+ */
+
+#include "payload_writer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <uuid.h>
+
+void PayloadWriter::reset()
+{
+    buf_.clear();
+    has_elements_ = 0;
+    depth_ = 0;
+}
+
+void PayloadWriter::separator()
+{
+    uint64_t bit = uint64_t(1) << (depth_ & 63);
+
+    if (has_elements_ & bit)
+        buf_ += ',';
+    has_elements_ |= bit;
+}
+
+void PayloadWriter::quoted(const char *s, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t run = 0;
+
+    buf_ += '"';
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+        buf_.append(s + run, i - run);
+        run = i + 1;
+        switch (c) {
+        case '"':
+            buf_ += "\\\"";
+            break;
+        case '\\':
+            buf_ += "\\\\";
+            break;
+        case '\n':
+            buf_ += "\\n";
+            break;
+        case '\r':
+            buf_ += "\\r";
+            break;
+        case '\t':
+            buf_ += "\\t";
+            break;
+        default: {
+            char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+            buf_.append(esc, sizeof(esc));
+        }
+        }
+    }
+    buf_.append(s + run, len - run);
+    buf_ += '"';
+}
+
+void PayloadWriter::name(const char *name)
+{
+    separator();
+    if (name) {
+        quoted(name, strlen(name));
+        buf_ += ':';
+    }
+}
+
+void PayloadWriter::open(char c)
+{
+    buf_ += c;
+    depth_++;
+    has_elements_ &= ~(uint64_t(1) << (depth_ & 63));
+}
+
+void PayloadWriter::close(char c)
+{
+    depth_--;
+    buf_ += c;
+}
+
+void PayloadWriter::begin_object(const char *name)
+{
+    if (depth_ > 0)
+        this->name(name);
+    open('{');
+}
+
+void PayloadWriter::end_object()
+{
+    close('}');
+}
+
+void PayloadWriter::begin_array(const char *name)
+{
+    this->name(name);
+    open('[');
+}
+
+void PayloadWriter::end_array()
+{
+    close(']');
+}
+
+void PayloadWriter::add_string(const char *name, const char *value)
+{
+    add_string(name, value, value ? strlen(value) : 0);
+}
+
+void PayloadWriter::add_string(const char *name, const char *value, size_t len)
+{
+    this->name(name);
+    if (value)
+        quoted(value, len);
+    else
+        buf_ += "null";
+}
+
+void PayloadWriter::add_int(const char *name, int64_t value)
+{
+    char digits[24];
+    char *p = digits + sizeof(digits);
+    uint64_t v = value < 0 ? -(uint64_t)value : (uint64_t)value;
+
+    do {
+        *--p = char('0' + v % 10);
+        v /= 10;
+    } while (v);
+    if (value < 0)
+        *--p = '-';
+
+    this->name(name);
+    buf_.append(p, digits + sizeof(digits) - p);
+}
+
+void PayloadWriter::add_float(const char *name, float value)
+{
+    char text[32];
+    int len;
+
+    this->name(name);
+    if (!isfinite(value)) {
+        buf_ += "null";
+        return;
+    }
+    /* Most values read back from 7 digits; the rest need 9. */
+    len = snprintf(text, sizeof(text), "%.7g", value);
+    if (strtof(text, NULL) != value)
+        len = snprintf(text, sizeof(text), "%.9g", value);
+    buf_.append(text, len);
+}
+
+void PayloadWriter::add_double(const char *name, double value)
+{
+    char text[32];
+    int len;
+
+    this->name(name);
+    if (!isfinite(value)) {
+        buf_ += "null";
+        return;
+    }
+    len = snprintf(text, sizeof(text), "%.15g", value);
+    if (strtod(text, NULL) != value)
+        len = snprintf(text, sizeof(text), "%.17g", value);
+    buf_.append(text, len);
+}
+
+void PayloadWriter::add_base64(const char *name, const void *data, size_t len)
+{
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const unsigned char *in = (const unsigned char *)data;
+    size_t start;
+    char *out;
+    size_t i;
+
+    this->name(name);
+    buf_ += '"';
+    start = buf_.size();
+    buf_.resize(start + (len + 2) / 3 * 4);
+    out = &buf_[start];
+    for (i = 0; i + 3 <= len; i += 3) {
+        uint32_t v = (uint32_t(in[i]) << 16) | (uint32_t(in[i + 1]) << 8) | in[i + 2];
+        *out++ = alphabet[v >> 18];
+        *out++ = alphabet[(v >> 12) & 63];
+        *out++ = alphabet[(v >> 6) & 63];
+        *out++ = alphabet[v & 63];
+    }
+    if (i < len) {
+        uint32_t v = uint32_t(in[i]) << 16;
+        if (i + 1 < len)
+            v |= uint32_t(in[i + 1]) << 8;
+        *out++ = alphabet[v >> 18];
+        *out++ = alphabet[(v >> 12) & 63];
+        *out++ = i + 1 < len ? alphabet[(v >> 6) & 63] : '=';
+        *out++ = '=';
+    }
+    buf_ += '"';
+}
+
+bool PayloadWriter::splice_members(const char *json, size_t len)
+{
+    const char *begin = json;
+    const char *end = json + len;
+
+    while (begin < end && g_ascii_isspace(*begin))
+        begin++;
+    while (end > begin && g_ascii_isspace(end[-1]))
+        end--;
+    if (end - begin < 2 || *begin != '{' || end[-1] != '}')
+        return false;
+
+    begin++;
+    end--;
+    while (begin < end && g_ascii_isspace(*begin))
+        begin++;
+    if (begin == end)
+        return true; /* {} */
+    separator();
+    buf_.append(begin, end - begin);
+    return true;
+}
+
+gchar *PayloadWriter::dup() const
+{
+    return g_strndup(buf_.data(), buf_.size());
+}
+
+PayloadWriter &payload_writer_get()
+{
+    static thread_local PayloadWriter writer;
+
+    writer.reset();
+    return writer;
+}
+
+namespace {
+
+struct MessageIdState {
+    bool seeded = false;
+    uint64_t last_ms = 0;
+    unsigned counter = 0;
+    uint64_t rng = 0;
+};
+
+/* xorshift64*: the ids only need to be unique, not unpredictable. */
+uint64_t next_random(MessageIdState &state)
+{
+    state.rng ^= state.rng >> 12;
+    state.rng ^= state.rng << 25;
+    state.rng ^= state.rng >> 27;
+    return state.rng * 0x2545F4914F6CDD1DULL;
+}
+
+} // namespace
+
+void generate_message_id(gchar out[PAYLOAD_MESSAGE_ID_LEN + 1])
+{
+    static const char hex[] = "0123456789abcdef";
+    static thread_local MessageIdState state;
+    unsigned char id[16];
+    struct timespec now;
+    uint64_t ms;
+    uint64_t random;
+    gchar *p = out;
+
+    if (!state.seeded) {
+        uuid_t seed;
+        uuid_generate_random(seed);
+        memcpy(&state.rng, seed, sizeof(state.rng));
+        state.rng |= 1;
+        state.seeded = true;
+    }
+
+    /* 12 bits of counter below the millisecond keep the ids of the thread
+     * increasing, also when the clock steps back. */
+    clock_gettime(CLOCK_REALTIME, &now);
+    ms = uint64_t(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+    if (ms > state.last_ms) {
+        state.last_ms = ms;
+        state.counter = 0;
+    } else if (++state.counter > 0xfff) {
+        state.last_ms++;
+        state.counter = 0;
+    }
+
+    for (int i = 0; i < 6; i++)
+        id[i] = (unsigned char)(state.last_ms >> (40 - 8 * i));
+    id[6] = (unsigned char)(0x70 | (state.counter >> 8));
+    id[7] = (unsigned char)state.counter;
+    random = next_random(state);
+    id[8] = (unsigned char)(0x80 | (random & 0x3f));
+    for (int i = 9; i < 16; i++)
+        id[i] = (unsigned char)(random >> (8 * (i - 8)));
+
+    for (int i = 0; i < 16; i++) {
+        if (i == 4 || i == 6 || i == 8 || i == 10)
+            *p++ = '-';
+        *p++ = hex[id[i] >> 4];
+        *p++ = hex[id[i] & 15];
+    }
+    *p = '\0';
+}
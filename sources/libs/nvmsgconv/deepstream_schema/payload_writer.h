@@ -0,0 +1,76 @@
+/*
+ * Streaming JSON writer and message ids for the custom payloads.
+ *
+ * Members are appended to one buffer in the order they are written, with no
+ * document tree in between, and the buffer keeps its capacity from message to
+ * message. Custom message blobs that are already JSON are copied in as they
+ * are. The output is compact.
+ */
+
+#ifndef NVDS_PAYLOAD_WRITER_H_
+#define NVDS_PAYLOAD_WRITER_H_
+
+#include <glib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+/** Length of a message id, without the NUL. */
+#define PAYLOAD_MESSAGE_ID_LEN 36
+
+class PayloadWriter {
+public:
+    /// Empties the buffer for a new message, keeping its capacity.
+    void reset();
+
+    /// In the add_* and begin_* calls, `name` is the member name inside an
+    /// object and NULL for an element of an array.
+    void begin_object(const char *name = NULL);
+    void end_object();
+    void begin_array(const char *name = NULL);
+    void end_array();
+
+    /// A NULL value is written as null.
+    void add_string(const char *name, const char *value);
+    void add_string(const char *name, const char *value, size_t len);
+    void add_int(const char *name, int64_t value);
+    /// With just enough digits to read back as the same value; non-finite
+    /// values are written as null.
+    void add_float(const char *name, float value);
+    void add_double(const char *name, double value);
+    /// `len` bytes of `data` as a base64 string.
+    void add_base64(const char *name, const void *data, size_t len);
+
+    /// Copies the members of the serialized JSON object `json` into the
+    /// current object without parsing them. Names are not de-duplicated.
+    /// @return false, writing nothing, if `json` is not an object.
+    bool splice_members(const char *json, size_t len);
+
+    const std::string &str() const { return buf_; }
+
+    /// NUL-terminated copy of the message, to be freed with g_free().
+    gchar *dup() const;
+
+private:
+    void separator();
+    void name(const char *name);
+    void quoted(const char *s, size_t len);
+    void open(char c);
+    void close(char c);
+
+    std::string buf_;
+    /// Bit n set once the container at depth n has an element.
+    uint64_t has_elements_ = 0;
+    unsigned depth_ = 0;
+};
+
+/// Writer for the calling thread, reset.
+PayloadWriter &payload_writer_get();
+
+/// Writes a time-ordered UUID (version 7) and a NUL to `out`. Ids of one
+/// thread increase strictly; the random part comes from a per-thread
+/// generator seeded once, so no system call is made per message.
+void generate_message_id(gchar out[PAYLOAD_MESSAGE_ID_LEN + 1]);
+
+#endif /* NVDS_PAYLOAD_WRITER_H_ */
@@ -0,0 +1,107 @@
+/*
+ * Protocol Buffers wire format writer, see proto_writer.h.
+ */
+
+#include "proto_writer.h"
+
+#include <string.h>
+
+enum { WIRE_VARINT = 0, WIRE_LENGTH_DELIMITED = 2, WIRE_FIXED32 = 5 };
+
+/* Embedded messages reserve one byte for their length, enough up to 127
+ * bytes; longer ones move their content to make room. */
+#define LENGTH_RESERVED 1
+
+void ProtoWriter::varint(uint64_t value)
+{
+    char bytes[10];
+    size_t n = 0;
+
+    while (value >= 0x80) {
+        bytes[n++] = char(value | 0x80);
+        value >>= 7;
+    }
+    bytes[n++] = char(value);
+    buf_.append(bytes, n);
+}
+
+void ProtoWriter::fixed32(float value)
+{
+    uint32_t bits;
+    char bytes[4];
+
+    memcpy(&bits, &value, sizeof(bits));
+    for (int b = 0; b < 4; b++)
+        bytes[b] = char(bits >> (8 * b));
+    buf_.append(bytes, sizeof(bytes));
+}
+
+void ProtoWriter::add_uint(uint32_t field, uint64_t value)
+{
+    tag(field, WIRE_VARINT);
+    varint(value);
+}
+
+void ProtoWriter::add_float(uint32_t field, float value)
+{
+    tag(field, WIRE_FIXED32);
+    fixed32(value);
+}
+
+void ProtoWriter::add_bytes(uint32_t field, const void *data, size_t len)
+{
+    tag(field, WIRE_LENGTH_DELIMITED);
+    varint(len);
+    buf_.append((const char *)data, len);
+}
+
+void ProtoWriter::add_string(uint32_t field, const char *value)
+{
+    if (value)
+        add_bytes(field, value, strlen(value));
+}
+
+void ProtoWriter::add_packed_floats(uint32_t field, const float *values, size_t count)
+{
+    tag(field, WIRE_LENGTH_DELIMITED);
+    varint(count * 4);
+    for (size_t i = 0; i < count; i++)
+        fixed32(values[i]);
+}
+
+size_t ProtoWriter::begin_message(uint32_t field)
+{
+    tag(field, WIRE_LENGTH_DELIMITED);
+    buf_.append(LENGTH_RESERVED, '\0');
+    return buf_.size();
+}
+
+void ProtoWriter::end_message(size_t mark)
+{
+    uint64_t len = buf_.size() - mark;
+    char bytes[10];
+    size_t n = 0;
+
+    while (len >= 0x80) {
+        bytes[n++] = char(len | 0x80);
+        len >>= 7;
+    }
+    bytes[n++] = char(len);
+    if (n > LENGTH_RESERVED)
+        buf_.insert(mark, n - LENGTH_RESERVED, '\0');
+    memcpy(&buf_[mark - LENGTH_RESERVED], bytes, n);
+}
+
+gpointer ProtoWriter::dup(gsize *size) const
+{
+    *size = buf_.size();
+    return g_memdup(buf_.data(), buf_.size());
+}
+
+ProtoWriter &proto_writer_get()
+{
+    static thread_local ProtoWriter writer;
+
+    writer.reset();
+    return writer;
+}
@@ -0,0 +1,53 @@
+/*
+ * Protocol Buffers wire format writer for the binary custom payloads.
+ *
+ * Fields are encoded straight from the metadata into one buffer that keeps its
+ * capacity from message to message; no generated code or protobuf library is
+ * needed. The schema is dsmeta_payload.proto.
+ */
+
+#ifndef NVDS_PROTO_WRITER_H_
+#define NVDS_PROTO_WRITER_H_
+
+#include <glib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+class ProtoWriter {
+public:
+    /// Empties the buffer for a new message, keeping its capacity.
+    void reset() { buf_.clear(); }
+
+    /// Also for enums, bools and non-negative int32/int64.
+    void add_uint(uint32_t field, uint64_t value);
+    void add_float(uint32_t field, float value);
+    /// Also for strings; a NULL string is not written.
+    void add_bytes(uint32_t field, const void *data, size_t len);
+    void add_string(uint32_t field, const char *value);
+    void add_packed_floats(uint32_t field, const float *values, size_t count);
+
+    /// Starts the embedded message `field`; the fields added until
+    /// end_message(mark) belong to it.
+    size_t begin_message(uint32_t field);
+    void end_message(size_t mark);
+
+    const std::string &str() const { return buf_; }
+
+    /// Copy of the message to be freed with g_free(), its size in `size`.
+    gpointer dup(gsize *size) const;
+
+private:
+    void varint(uint64_t value);
+    /// Little endian, whatever the host order.
+    void fixed32(float value);
+    void tag(uint32_t field, unsigned wire_type) { varint((uint64_t(field) << 3) | wire_type); }
+
+    std::string buf_;
+};
+
+/// Writer for the calling thread, reset.
+ProtoWriter &proto_writer_get();
+
+#endif /* NVDS_PROTO_WRITER_H_ */
@@ -186,6 +186,80 @@ NvDsPayload *nvds_msg2p_generate(NvDsMsg2pCtx *ctx, NvDsEvent *events, guint siz
     return payload;
 }
 
+/////////////////
+/* Start Custom */
+/////////////////
+/* Whether the dsmeta payloads are binary, see format in the [payload] group */
+static bool payload_is_protobuf(NvDsMsg2pCtx *ctx)
+{
+    return (ctx->payloadType == NVDS_PAYLOAD_DEEPSTREAM_MINIMAL ||
+            ctx->payloadType == NVDS_PAYLOAD_CUSTOM) &&
+           ctx->privData &&
+           ((NvDsPayloadPriv *)ctx->privData)->payloadFormat == NVDS_PAYLOAD_FORMAT_PROTOBUF;
+}
+
+/* Copied once out of the writer of the thread and owned by the payload. The
+ * minimal payload is asked for per frame and holds all its objects. */
+static gpointer generate_proto_payload(NvDsMsg2pCtx *ctx,
+                                       NvDsFrameMeta *frame_meta,
+                                       NvDsObjectMeta *obj_meta,
+                                       guint *size)
+{
+    gsize len = 0;
+    gpointer message = generate_dsmeta_message_proto(
+        ctx->privData, frame_meta, ctx->payloadType == NVDS_PAYLOAD_CUSTOM ? obj_meta : NULL,
+        &len);
+
+    *size = len;
+    return message;
+}
+
+/* Custom payload grouped per frame, when the plugin takes several payloads per
+ * call: it asks for every object, so the first call of a batch returns the
+ * message of each frame of the batch, frames without objects included (with
+ * an empty objects array), and later calls of the batch return none. */
+static bool payload_per_frame(NvDsMsg2pCtx *ctx)
+{
+    return ctx->payloadType == NVDS_PAYLOAD_CUSTOM && ctx->privData &&
+           ((NvDsPayloadPriv *)ctx->privData)->messageGrouping == NVDS_MESSAGE_PER_FRAME;
+}
+
+static NvDsPayload **generate_frame_payloads(NvDsMsg2pCtx *ctx,
+                                             NvDsFrameMeta *frame_meta,
+                                             guint *payloadCount)
+{
+    NvDsFrameMetaList *frames = frame_meta->base_meta.batch_meta->frame_meta_list;
+    NvDsPayload **payloads =
+        (NvDsPayload **)g_malloc0(sizeof(NvDsPayload *) * MAX(g_list_length(frames), 1));
+
+    *payloadCount = 0;
+    if (dsmeta_batch_already_sent(ctx->privData, frame_meta))
+        return payloads;
+
+    for (NvDsFrameMetaList *l = frames; l; l = l->next) {
+        gpointer message;
+        gsize len = 0;
+
+        if (payload_is_protobuf(ctx)) {
+            message = generate_dsmeta_message_proto(ctx->privData, l->data, NULL, &len);
+        } else {
+            message = generate_dsmeta_message_custom(ctx->privData, l->data, NULL);
+            if (message)
+                len = strlen((const gchar *)message);
+        }
+        if (!message)
+            continue;
+        payloads[*payloadCount] = (NvDsPayload *)g_malloc0(sizeof(NvDsPayload));
+        payloads[*payloadCount]->payload = message;
+        payloads[*payloadCount]->payloadSize = len;
+        ++(*payloadCount);
+    }
+    return payloads;
+}
+////////////////
+/* End Custom */
+////////////////
+
 NvDsPayload *nvds_msg2p_generate_new(NvDsMsg2pCtx *ctx, void *metadataInfo)
 {
     gchar *message = NULL;
@@ -196,6 +270,17 @@ NvDsPayload *nvds_msg2p_generate_new(NvDsMsg2pCtx *ctx, void *metadataInfo)
 
     NvDsPayload *payload = (NvDsPayload *)g_malloc0(sizeof(NvDsPayload));
 
+    /////////////////
+    /* Start Custom */
+    /////////////////
+    if (payload_is_protobuf(ctx)) {
+        payload->payload = generate_proto_payload(ctx, frame_meta, obj_meta, &payload->payloadSize);
+        return payload;
+    }
+    ////////////////
+    /* End Custom */
+    ////////////////
+
     if (ctx->payloadType == NVDS_PAYLOAD_DEEPSTREAM) {
         message = generate_dsmeta_message(ctx->privData, frame_meta, obj_meta);
         if (message) {
@@ -258,13 +343,41 @@ NvDsPayload **nvds_msg2p_generate_multiple_new(NvDsMsg2pCtx *ctx,
     gint len = 0;
     NvDsPayload **payloads = NULL;
     *payloadCount = 0;
-    // Set how many payloads are being sent back to the plugin
-    payloads = (NvDsPayload **)g_malloc0(sizeof(NvDsPayload *) * 1);
 
     NvDsMsg2pMetaInfo *meta_info = (NvDsMsg2pMetaInfo *)metadataInfo;
     NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)meta_info->frameMeta;
     NvDsObjectMeta *obj_meta = (NvDsObjectMeta *)meta_info->objMeta;
 
+    /////////////////
+    /* Start Custom */
+    /////////////////
+    if (payload_per_frame(ctx))
+        return generate_frame_payloads(ctx, frame_meta, payloadCount);
+    ////////////////
+    /* End Custom */
+    ////////////////
+
+    // Set how many payloads are being sent back to the plugin
+    payloads = (NvDsPayload **)g_malloc0(sizeof(NvDsPayload *) * 1);
+
+    /////////////////
+    /* Start Custom */
+    /////////////////
+    if (payload_is_protobuf(ctx)) {
+        guint size;
+        gpointer binary = generate_proto_payload(ctx, frame_meta, obj_meta, &size);
+        if (binary) {
+            payloads[*payloadCount] = (NvDsPayload *)g_malloc0(sizeof(NvDsPayload));
+            payloads[*payloadCount]->payload = binary;
+            payloads[*payloadCount]->payloadSize = size;
+            ++(*payloadCount);
+        }
+        return payloads;
+    }
+    ////////////////
+    /* End Custom */
+    ////////////////
+
     if (ctx->payloadType == NVDS_PAYLOAD_DEEPSTREAM) {
         message = generate_dsmeta_message(ctx->privData, frame_meta, obj_meta);
         if (message) {
@@ -0,0 +1,584 @@
+/*
+ * Micro-benchmark of the nvmsgconv payload serializers, CPU only.
+ *
+ * Fabricates a batch of NvDsFrameMeta/NvDsObjectMeta the way the pipeline
+ * fills it (classifier identities, landmark meta, feature-vector tensor meta,
+ * custom message blobs of the app) plus the matching NvDsEventMsgMeta, and
+ * runs every payload type through the nvmsgconv entry points the plugin
+ * calls: once per object, or once per frame for the minimal types. Payloads
+ * are released as the plugin does, so the copies into NvDsPayload count.
+ *
+ * Reported per object of the batch: time, payload bytes and heap
+ * allocations (malloc, calloc and realloc calls, counted by this binary).
+ * Results can be saved and later compared against with a tolerance, the exit
+ * status telling whether a case regressed:
+ *
+ *   payload_bench --objects 16 --feature-dim 512 --save base.ini
+ *   payload_bench --objects 16 --feature-dim 512 --compare base.ini --tolerance 10
+ *
+ * The sample msgconv config describes sensors, places and analytics modules
+ * 0-3, so frames take the source ids 0-3 in turn.
+ */
+
+#include <glib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+#include "deepstream_schema/deepstream_schema.h"
+#include "gstnvdsinfer.h"
+#include "nvdsmeta.h"
+#include "nvmsgconv.h"
+
+#define NUM_CONFIG_SOURCES 4
+
+/* ---------------------------------------------------------------------- */
+/* Allocation counting                                                      */
+/* ---------------------------------------------------------------------- */
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+/* The benchmark is single threaded: plain counters are enough. */
+static bool counting = false;
+static unsigned long long allocations = 0;
+
+void *malloc(size_t size)
+{
+    if (counting)
+        allocations++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    if (counting)
+        allocations++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    if (counting)
+        allocations++;
+    return __libc_realloc(ptr, size);
+}
+}
+
+/* ---------------------------------------------------------------------- */
+/* Options                                                                  */
+/* ---------------------------------------------------------------------- */
+
+static gint num_frames = 4;
+static gint num_objects = 8;
+static gint num_identities = 1;
+static gint num_landmarks = 5;
+static gint feature_dim = 512;
+static gint iterations = 2000;
+static gint warmup = 200;
+static gchar *config_file = NULL;
+static gchar *case_filter = NULL;
+static gchar *feature_vector_encoding = NULL;
+static gchar *save_file = NULL;
+static gchar *compare_file = NULL;
+static gdouble tolerance = 10;
+
+static GOptionEntry entries[] = {
+    {"frames", 'f', 0, G_OPTION_ARG_INT, &num_frames, "Frames in the batch (4)", "N"},
+    {"objects", 'o', 0, G_OPTION_ARG_INT, &num_objects, "Objects per frame (8)", "N"},
+    {"identities", 0, 0, G_OPTION_ARG_INT, &num_identities,
+     "Classifier labels per object, 0 for no classifier meta (1)", "N"},
+    {"landmarks", 0, 0, G_OPTION_ARG_INT, &num_landmarks,
+     "Landmarks per object, 0 for no landmark meta (5)", "N"},
+    {"feature-dim", 0, 0, G_OPTION_ARG_INT, &feature_dim,
+     "Feature vector size, 0 for no tensor meta (512)", "N"},
+    {"iterations", 'i', 0, G_OPTION_ARG_INT, &iterations, "Measured batches per case (2000)",
+     "N"},
+    {"warmup", 0, 0, G_OPTION_ARG_INT, &warmup, "Unmeasured batches per case (200)", "N"},
+    {"config", 'c', 0, G_OPTION_ARG_FILENAME, &config_file,
+     "msgconv config (samples/configs/config_msgconv.txt)", "FILE"},
+    {"case", 0, 0, G_OPTION_ARG_STRING, &case_filter, "Only the cases containing NAME", "NAME"},
+    {"feature-vector-encoding", 0, 0, G_OPTION_ARG_STRING, &feature_vector_encoding,
+     "json, float32, fp16 or int8 (json)", "ENC"},
+    {"save", 0, 0, G_OPTION_ARG_FILENAME, &save_file, "Write the results to FILE", "FILE"},
+    {"compare", 0, 0, G_OPTION_ARG_FILENAME, &compare_file,
+     "Fail if a case is slower, larger or allocates more than in FILE", "FILE"},
+    {"tolerance", 't', 0, G_OPTION_ARG_DOUBLE, &tolerance,
+     "Allowed increase over --compare, in percent (10)", "PCT"},
+    {NULL}};
+
+/* ---------------------------------------------------------------------- */
+/* Fabricated metadata                                                      */
+/* ---------------------------------------------------------------------- */
+
+/* One batch and the per-object events derived from it. Everything lives until
+ * the end of the run; lists are built with GList as in the real metadata. */
+struct Scene {
+    NvDsBatchMeta batch;
+    std::vector<NvDsFrameMeta *> frames;
+    std::vector<NvDsObjectMeta *> objects;
+    /* Per frame, the events of its objects */
+    std::vector<std::vector<NvDsEvent>> events;
+};
+
+static NvDsUserMeta *new_user_meta(NvDsMetaType type, gpointer data)
+{
+    NvDsUserMeta *user_meta = g_new0(NvDsUserMeta, 1);
+
+    user_meta->base_meta.meta_type = type;
+    user_meta->user_meta_data = data;
+    return user_meta;
+}
+
+static NvDsUserMeta *new_custom_blob(gchar *json)
+{
+    NvDsCustomMsgInfo *blob = g_new0(NvDsCustomMsgInfo, 1);
+
+    blob->message = json;
+    blob->size = strlen(json);
+    return new_user_meta(NVDS_CUSTOM_MSG_BLOB, blob);
+}
+
+static NvDsUserMeta *new_tensor_meta(guint dim)
+{
+    NvDsInferTensorMeta *tensor = g_new0(NvDsInferTensorMeta, 1);
+    float *values = g_new(float, dim);
+
+    for (guint i = 0; i < dim; i++)
+        values[i] = g_random_double_range(-0.2, 0.2);
+    tensor->num_output_layers = 1;
+    tensor->output_layers_info = g_new0(NvDsInferLayerInfo, 1);
+    tensor->output_layers_info->dataType = FLOAT;
+    tensor->output_layers_info->inferDims.numDims = 1;
+    tensor->output_layers_info->inferDims.d[0] = dim;
+    tensor->output_layers_info->inferDims.numElements = dim;
+    tensor->out_buf_ptrs_host = g_new0(void *, 1);
+    tensor->out_buf_ptrs_host[0] = values;
+    return new_user_meta((NvDsMetaType)NVDSINFER_TENSOR_OUTPUT_META, tensor);
+}
+
+static NvDsUserMeta *new_landmark_meta(guint count, const NvOSD_RectParams &rect)
+{
+    NvDSInferLandmarkMeta *landmarks = g_new0(NvDSInferLandmarkMeta, 1);
+
+    landmarks->num_landmark = count;
+    landmarks->size = 2 * count;
+    landmarks->data = g_new(gfloat, 2 * count);
+    for (guint i = 0; i < count; i++) {
+        landmarks->data[2 * i] = rect.left + g_random_double() * rect.width;
+        landmarks->data[2 * i + 1] = rect.top + g_random_double() * rect.height;
+    }
+    return new_user_meta((NvDsMetaType)NVDSINFER_LANDMARK_META, landmarks);
+}
+
+static NvDsClassifierMeta *new_identities(guint count)
+{
+    NvDsClassifierMeta *classifier = g_new0(NvDsClassifierMeta, 1);
+
+    classifier->unique_component_id = 2;
+    classifier->num_labels = count;
+    for (guint i = 0; i < count; i++) {
+        NvDsLabelInfo *label = g_new0(NvDsLabelInfo, 1);
+        label->label_id = g_random_int_range(1, 100000);
+        /* Id-only results, as the recognizer attaches them */
+        label->result_label[0] = '\0';
+        label->result_prob = g_random_double_range(0.5, 1);
+        classifier->label_info_list = g_list_append(classifier->label_info_list, label);
+    }
+    return classifier;
+}
+
+static NvDsEvent new_event(NvDsFrameMeta *frame, NvDsObjectMeta *obj, const gchar *ts)
+{
+    NvDsEventMsgMeta *meta = g_new0(NvDsEventMsgMeta, 1);
+    NvDsPersonObject *person = g_new0(NvDsPersonObject, 1);
+    NvDsEvent event;
+
+    meta->type = NVDS_EVENT_ENTRY;
+    meta->objType = NVDS_OBJECT_TYPE_PERSON;
+    meta->bbox.left = obj->rect_params.left;
+    meta->bbox.top = obj->rect_params.top;
+    meta->bbox.width = obj->rect_params.width;
+    meta->bbox.height = obj->rect_params.height;
+    meta->objClassId = obj->class_id;
+    meta->sensorId = frame->source_id;
+    meta->placeId = frame->source_id;
+    meta->moduleId = frame->source_id;
+    meta->frameId = frame->frame_num;
+    meta->confidence = obj->confidence;
+    meta->trackingId = obj->object_id;
+    meta->ts = g_strdup(ts);
+    meta->objectId = g_strdup_printf("%lu", obj->object_id);
+    if (feature_dim > 0) {
+        meta->objSignature.size = feature_dim;
+        meta->objSignature.signature = g_new(gdouble, feature_dim);
+        for (gint i = 0; i < feature_dim; i++)
+            meta->objSignature.signature[i] = g_random_double_range(-0.2, 0.2);
+    }
+    person->gender = g_strdup("unknown");
+    person->hair = g_strdup("black");
+    person->cap = g_strdup("none");
+    person->apparel = g_strdup("uniform");
+    person->age = 20;
+    meta->extMsg = person;
+    meta->extMsgSize = sizeof(NvDsPersonObject);
+
+    event.eventType = NVDS_EVENT_ENTRY;
+    event.metadata = meta;
+    return event;
+}
+
+static void build_scene(Scene &scene)
+{
+    gchar ts[32];
+    time_t now = time(NULL);
+
+    strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%S.000Z", gmtime(&now));
+    memset(&scene.batch, 0, sizeof(scene.batch));
+    scene.batch.num_frames_in_batch = num_frames;
+    scene.batch.max_frames_in_batch = num_frames;
+    scene.events.resize(num_frames);
+
+    for (gint f = 0; f < num_frames; f++) {
+        NvDsFrameMeta *frame = g_new0(NvDsFrameMeta, 1);
+
+        frame->base_meta.batch_meta = &scene.batch;
+        frame->source_id = f % NUM_CONFIG_SOURCES;
+        frame->batch_id = f;
+        frame->source_frame_width = 1920;
+        frame->source_frame_height = 1080;
+        frame->pipeline_width = 1920;
+        frame->pipeline_height = 1080;
+        frame->buf_pts = 40000000;
+        frame->ntp_timestamp = (guint64)now * 1000000000;
+        frame->frame_user_meta_list = g_list_append(
+            frame->frame_user_meta_list,
+            new_custom_blob(g_strdup_printf(
+                "{\"uri\":\"rtsp://10.0.0.%d/stream1\",\"frame_number\":0,"
+                "\"filePath\":\"outputs/images/camera-%u_frame_0000000000.jpg\"}",
+                f + 10, frame->source_id)));
+
+        for (gint o = 0; o < num_objects; o++) {
+            NvDsObjectMeta *obj = g_new0(NvDsObjectMeta, 1);
+
+            obj->object_id = 1000 * f + o;
+            obj->class_id = 0;
+            obj->unique_component_id = 1;
+            obj->confidence = g_random_double_range(0.5, 1);
+            g_strlcpy(obj->obj_label, "face", sizeof(obj->obj_label));
+            obj->rect_params.width = g_random_double_range(60, 200);
+            obj->rect_params.height = obj->rect_params.width * 1.25;
+            obj->rect_params.left = g_random_double_range(0, 1920 - obj->rect_params.width);
+            obj->rect_params.top = g_random_double_range(0, 1080 - obj->rect_params.height);
+
+            if (num_identities > 0)
+                obj->classifier_meta_list =
+                    g_list_append(obj->classifier_meta_list, new_identities(num_identities));
+            if (feature_dim > 0)
+                obj->obj_user_meta_list =
+                    g_list_append(obj->obj_user_meta_list, new_tensor_meta(feature_dim));
+            if (num_landmarks > 0)
+                obj->obj_user_meta_list = g_list_append(
+                    obj->obj_user_meta_list, new_landmark_meta(num_landmarks, obj->rect_params));
+            obj->obj_user_meta_list = g_list_append(
+                obj->obj_user_meta_list,
+                new_custom_blob(g_strdup_printf(
+                    "{\"filePath\":\"outputs/crops/camera-%u_face_%010u.jpg\"}", frame->source_id,
+                    (guint)obj->object_id)));
+
+            frame->obj_meta_list = g_list_append(frame->obj_meta_list, obj);
+            frame->num_obj_meta++;
+            scene.objects.push_back(obj);
+            scene.events[f].push_back(new_event(frame, obj, ts));
+        }
+
+        scene.batch.frame_meta_list = g_list_append(scene.batch.frame_meta_list, frame);
+        scene.frames.push_back(frame);
+    }
+}
+
+/* A new batch for the converter: per-batch grouping tells batches apart by
+ * their first frame. */
+static void next_batch(Scene &scene)
+{
+    for (NvDsFrameMeta *frame : scene.frames)
+        frame->frame_num++;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Cases                                                                    */
+/* ---------------------------------------------------------------------- */
+
+enum BenchCall {
+    /* nvds_msg2p_generate() with the event of each object */
+    CALL_EVENT_PER_OBJECT,
+    /* nvds_msg2p_generate() with the events of each frame */
+    CALL_EVENTS_PER_FRAME,
+    /* nvds_msg2p_generate_new() for each object */
+    CALL_DSMETA_PER_OBJECT,
+    /* nvds_msg2p_generate_new() for each frame, no object */
+    CALL_DSMETA_PER_FRAME,
+    /* generate_dsmeta_message_minimal() for each frame: the minimal type now
+     * routes to the custom minimal message, the stock one is called directly */
+    CALL_STOCK_MINIMAL_PER_FRAME,
+};
+
+struct BenchCase {
+    const char *name;
+    const char *function;
+    NvDsPayloadType type;
+    BenchCall call;
+    NvDsPayloadFormat format;
+    NvDsMessageGrouping grouping;
+};
+
+static const BenchCase cases[] = {
+    {"event", "generate_event_message", NVDS_PAYLOAD_DEEPSTREAM, CALL_EVENT_PER_OBJECT},
+    {"event-minimal", "generate_event_message_minimal", NVDS_PAYLOAD_DEEPSTREAM_MINIMAL,
+     CALL_EVENTS_PER_FRAME},
+    {"event-custom", "generate_event_message_custom", NVDS_PAYLOAD_CUSTOM,
+     CALL_EVENT_PER_OBJECT},
+    {"dsmeta", "generate_dsmeta_message", NVDS_PAYLOAD_DEEPSTREAM, CALL_DSMETA_PER_OBJECT},
+    {"dsmeta-minimal", "generate_dsmeta_message_minimal", NVDS_PAYLOAD_DEEPSTREAM_MINIMAL,
+     CALL_STOCK_MINIMAL_PER_FRAME},
+    {"minimal-custom", "generate_dsmeta_message_minimal_custom",
+     NVDS_PAYLOAD_DEEPSTREAM_MINIMAL, CALL_DSMETA_PER_FRAME},
+    {"minimal-protobuf", "generate_dsmeta_message_proto", NVDS_PAYLOAD_DEEPSTREAM_MINIMAL,
+     CALL_DSMETA_PER_FRAME, NVDS_PAYLOAD_FORMAT_PROTOBUF},
+    {"custom", "generate_dsmeta_message_custom", NVDS_PAYLOAD_CUSTOM, CALL_DSMETA_PER_OBJECT},
+    {"custom-frame", "generate_dsmeta_message_custom", NVDS_PAYLOAD_CUSTOM,
+     CALL_DSMETA_PER_OBJECT, NVDS_PAYLOAD_FORMAT_JSON, NVDS_MESSAGE_PER_FRAME},
+    {"custom-batch", "generate_dsmeta_message_custom", NVDS_PAYLOAD_CUSTOM,
+     CALL_DSMETA_PER_OBJECT, NVDS_PAYLOAD_FORMAT_JSON, NVDS_MESSAGE_PER_BATCH},
+    {"custom-protobuf", "generate_dsmeta_message_proto", NVDS_PAYLOAD_CUSTOM,
+     CALL_DSMETA_PER_OBJECT, NVDS_PAYLOAD_FORMAT_PROTOBUF},
+};
+
+struct BenchResult {
+    double ns_per_object;
+    double bytes_per_object;
+    double allocs_per_object;
+    double messages_per_batch;
+};
+
+struct Totals {
+    guint64 bytes;
+    guint64 messages;
+};
+
+static void take_payload(NvDsMsg2pCtx *ctx, NvDsPayload *payload, Totals &totals)
+{
+    if (payload->payload) {
+        totals.bytes += payload->payloadSize;
+        totals.messages++;
+    }
+    nvds_msg2p_release(ctx, payload);
+}
+
+static void run_batch(const BenchCase &c, NvDsMsg2pCtx *ctx, Scene &scene, Totals &totals)
+{
+    NvDsMsg2pMetaInfo meta_info = {};
+
+    for (gint f = 0; f < num_frames; f++) {
+        NvDsFrameMeta *frame = scene.frames[f];
+        std::vector<NvDsEvent> &events = scene.events[f];
+
+        meta_info.frameMeta = frame;
+        switch (c.call) {
+        case CALL_EVENT_PER_OBJECT:
+            for (NvDsEvent &event : events)
+                take_payload(ctx, nvds_msg2p_generate(ctx, &event, 1), totals);
+            break;
+        case CALL_EVENTS_PER_FRAME:
+            if (!events.empty())
+                take_payload(ctx, nvds_msg2p_generate(ctx, events.data(), events.size()),
+                             totals);
+            break;
+        case CALL_DSMETA_PER_OBJECT:
+            for (GList *l = frame->obj_meta_list; l; l = l->next) {
+                meta_info.objMeta = l->data;
+                take_payload(ctx, nvds_msg2p_generate_new(ctx, &meta_info), totals);
+            }
+            break;
+        case CALL_DSMETA_PER_FRAME:
+            meta_info.objMeta = NULL;
+            take_payload(ctx, nvds_msg2p_generate_new(ctx, &meta_info), totals);
+            break;
+        case CALL_STOCK_MINIMAL_PER_FRAME: {
+            gchar *message = generate_dsmeta_message_minimal(ctx->privData, frame);
+            if (message) {
+                totals.bytes += strlen(message);
+                totals.messages++;
+                g_free(message);
+            }
+            break;
+        }
+        }
+    }
+    next_batch(scene);
+}
+
+static NvDsFeatureVectorEncoding parse_encoding(const gchar *name)
+{
+    if (!g_strcmp0(name, "float32"))
+        return NVDS_FEATURE_VECTOR_FLOAT32;
+    if (!g_strcmp0(name, "fp16"))
+        return NVDS_FEATURE_VECTOR_FP16;
+    if (!g_strcmp0(name, "int8"))
+        return NVDS_FEATURE_VECTOR_INT8;
+    return NVDS_FEATURE_VECTOR_JSON;
+}
+
+static bool run_case(const BenchCase &c, Scene &scene, BenchResult &result)
+{
+    NvDsMsg2pCtx *ctx = nvds_msg2p_ctx_create(config_file, c.type);
+    Totals totals = {};
+    struct timespec start, end;
+    unsigned long long start_allocations;
+    double objects = (double)iterations * num_frames * num_objects;
+
+    if (!ctx || !ctx->privData) {
+        printf("%-18s cannot create the converter with %s\n", c.name, config_file);
+        return false;
+    }
+
+    /* The [payload] group of the config is overridden per case */
+    NvDsPayloadPriv *priv = (NvDsPayloadPriv *)ctx->privData;
+    priv->payloadFormat = c.format;
+    priv->messageGrouping = c.grouping;
+    priv->featureVectorEncoding = parse_encoding(feature_vector_encoding);
+
+    for (gint i = 0; i < warmup; i++)
+        run_batch(c, ctx, scene, totals);
+    totals = {};
+
+    start_allocations = allocations;
+    counting = true;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (gint i = 0; i < iterations; i++)
+        run_batch(c, ctx, scene, totals);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    counting = false;
+
+    result.ns_per_object =
+        ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / objects;
+    result.bytes_per_object = totals.bytes / objects;
+    result.allocs_per_object = (allocations - start_allocations) / objects;
+    result.messages_per_batch = (double)totals.messages / iterations;
+
+    nvds_msg2p_ctx_destroy(ctx);
+    return true;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Baselines                                                                */
+/* ---------------------------------------------------------------------- */
+
+static void save_result(GKeyFile *key_file, const BenchCase &c, const BenchResult &result)
+{
+    g_key_file_set_double(key_file, c.name, "ns-per-object", result.ns_per_object);
+    g_key_file_set_double(key_file, c.name, "bytes-per-object", result.bytes_per_object);
+    g_key_file_set_double(key_file, c.name, "allocs-per-object", result.allocs_per_object);
+}
+
+/* Prints the metrics of the case that went up by more than the tolerance.
+ * Cases missing from the baseline pass. */
+static bool compare_result(GKeyFile *baseline, const BenchCase &c, const BenchResult &result)
+{
+    static const char *const keys[] = {"ns-per-object", "bytes-per-object",
+                                       "allocs-per-object"};
+    const double values[] = {result.ns_per_object, result.bytes_per_object,
+                             result.allocs_per_object};
+    bool ok = true;
+
+    if (!g_key_file_has_group(baseline, c.name))
+        return true;
+    for (size_t k = 0; k < G_N_ELEMENTS(keys); k++) {
+        GError *error = NULL;
+        double base = g_key_file_get_double(baseline, c.name, keys[k], &error);
+
+        if (error) {
+            g_error_free(error);
+            continue;
+        }
+        if (values[k] > base * (1 + tolerance / 100) + 1e-9) {
+            printf("REGRESSION %s %s: %.2f, baseline %.2f (+%.1f%%)\n", c.name, keys[k],
+                   values[k], base, base > 0 ? 100 * (values[k] / base - 1) : 100.0);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    GOptionContext *context = g_option_context_new("- nvmsgconv payload micro-benchmark");
+    GError *error = NULL;
+    GKeyFile *results = g_key_file_new();
+    GKeyFile *baseline = NULL;
+    Scene scene;
+    bool ok = true;
+
+    g_option_context_add_main_entries(context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        fprintf(stderr, "%s\n", error->message);
+        return 2;
+    }
+    g_option_context_free(context);
+    if (num_frames < 1 || num_objects < 1 || iterations < 1 || warmup < 0) {
+        fprintf(stderr, "--frames, --objects and --iterations must be positive\n");
+        return 2;
+    }
+    if (!config_file)
+        config_file = g_strdup("samples/configs/config_msgconv.txt");
+    if (compare_file) {
+        baseline = g_key_file_new();
+        if (!g_key_file_load_from_file(baseline, compare_file, G_KEY_FILE_NONE, &error)) {
+            fprintf(stderr, "%s: %s\n", compare_file, error->message);
+            return 2;
+        }
+    }
+
+    g_random_set_seed(1);
+    build_scene(scene);
+
+    printf("%d frames x %d objects, %d identities, %d landmarks, feature dim %d (%s), "
+           "%d batches\n\n",
+           num_frames, num_objects, num_identities, num_landmarks, feature_dim,
+           feature_vector_encoding ? feature_vector_encoding : "json", iterations);
+    printf("%-18s %-40s %10s %12s %12s %10s\n", "case", "function", "ns/object", "bytes/object",
+           "allocs/obj", "msgs/batch");
+
+    for (const BenchCase &c : cases) {
+        BenchResult result;
+
+        if (case_filter && !strstr(c.name, case_filter))
+            continue;
+        if (!run_case(c, scene, result)) {
+            ok = false;
+            continue;
+        }
+        printf("%-18s %-40s %10.0f %12.1f %12.2f %10.2f\n", c.name, c.function,
+               result.ns_per_object, result.bytes_per_object, result.allocs_per_object,
+               result.messages_per_batch);
+        save_result(results, c, result);
+        if (baseline && !compare_result(baseline, c, result))
+            ok = false;
+    }
+
+    if (save_file && !g_key_file_save_to_file(results, save_file, &error)) {
+        fprintf(stderr, "%s: %s\n", save_file, error->message);
+        g_error_free(error);
+        ok = false;
+    }
+    g_key_file_free(results);
+    if (baseline)
+        g_key_file_free(baseline);
+    return ok ? 0 : 1;
+}